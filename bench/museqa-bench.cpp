@@ -0,0 +1,442 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file The benchmark suite's entry point.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+
+#include "io.hpp"
+#include "mpi.hpp"
+#include "node.hpp"
+#include "cuda.cuh"
+#include "utils.hpp"
+#include "format.hpp"
+#include "museqa.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
+#include "benchmark.hpp"
+#include "exception.hpp"
+
+#include "pairwise.cuh"
+#include "phylogeny.cuh"
+#include "pgalign.cuh"
+
+#include "pairwise/needleman/needleman.cuh"
+#include "phylogeny/njoining/njoining.cuh"
+#include "pgalign/myers/myers.cuh"
+
+using namespace museqa;
+
+/**
+ * The list of command line options available. Any positional argument is taken
+ * as a sequence database file, and benchmarked as a dataset of its own.
+ * @since 0.1.1
+ */
+static const std::vector<terminal::option> options = {
+    {"multigpu",      {"-m", "--multigpu"},      "Use multiple devices in a single host if possible."}
+,   {"node-gpus",     {"-g", "--node-gpus"},     "The number of local GPUs driven by each node.", true}
+,   {"threads",       {"-t", "--threads"},       "The number of host threads to use on each node.", true}
+,   {"scoring-table", {"-s", "--scoring-table"}, "The scoring table name or file to align sequences with.", true}
+,   {"pairwise",      {"-1", "--pairwise"},      "Comma-separated pairwise algorithms to benchmark, instead of all.", true}
+,   {"phylogeny",     {"-2", "--phylogeny"},     "Comma-separated phylogeny algorithms to benchmark, instead of all.", true}
+,   {"pgalign",       {"-3", "--pgalign"},       "Comma-separated profile-aligner algorithms to benchmark, instead of all.", true}
+,   {"warmup",        {"-u", "--warmup"},        "The number of untimed runs before each benchmark.", true}
+,   {"repetitions",   {"-n", "--repetitions"},   "The number of timed runs of each benchmark.", true}
+,   {"no-sweep",      {"-x", "--no-sweep"},      "Skips the synthetic sequence length and count sweeps."}
+,   {"label",         {"-l", "--label"},         "Labels the results, usually with the benchmarked release.", true}
+,   {"output",        {"-o", "--output"},        "Writes the results into a JSON file.", true}
+};
+
+namespace museqa
+{
+    /**
+     * The global state instance. The benchmark suite runs in the same environment
+     * as the software itself, so its results are representative.
+     * @since 0.1.1
+     */
+    state global_state {
+      #if defined(__museqa_environment)
+        static_cast<env>(__museqa_environment)
+      #else
+        env::production
+      #endif
+    };
+}
+
+namespace
+{
+    /*
+     * The synthetic sweeps' parameters. The length sweep grows the sequences of
+     * a fixed-size database, while the count sweep grows the number of sequences.
+     */
+    static const std::vector<size_t> sweep_lengths = {125, 250, 500, 1000, 2000};
+    static const std::vector<size_t> sweep_counts = {16, 32, 64, 128};
+
+    enum : size_t { sweep_count = 16, sweep_length = 200 };
+
+    /*
+     * The alphabet synthetic sequences are generated over. This is the same protein
+     * alphabet used by the database generator script.
+     */
+    static const std::string alphabet = "ACTGRNDQEHILKMFPSWYVBJZ";
+
+    /**
+     * A set of sequences to be benchmarked on.
+     * @since 0.1.1
+     */
+    struct dataset
+    {
+        std::string name;               /// The dataset's name.
+        museqa::database db;            /// The dataset's sequences.
+    };
+
+    /**
+     * The result of benchmarking an algorithm over a dataset. The throughput is
+     * given by the amount of work done by the algorithm over its median duration.
+     * @since 0.1.1
+     */
+    struct result
+    {
+        std::string module;                     /// The benchmarked module.
+        std::string algorithm;                  /// The benchmarked algorithm.
+        std::string dataset;                    /// The dataset benchmarked on.
+        size_t count;                           /// The dataset's number of sequences.
+        benchmark::summary<double> time;        /// The runs' durations, in seconds.
+        std::string unit;                       /// The throughput's unit.
+        double throughput;                      /// The algorithm's median throughput.
+    };
+
+    /**
+     * Generates a synthetic dataset of random sequences. The sequences are drawn
+     * from a fixed seed with a fully specified engine, so every node and every
+     * run of the suite generate the very same sequences.
+     * @param count The number of sequences to generate.
+     * @param length The length of each generated sequence.
+     * @return The generated dataset.
+     */
+    static auto generate(size_t count, size_t length) -> dataset
+    {
+        std::mt19937 engine (uint32_t(count * 7919 + length));
+        std::string contents (length, ' ');
+
+        auto result = dataset {fmt::format("generated%lluxL%llu", count, length), database {count}};
+
+        for(size_t i = 0; i < count; ++i) {
+            for(auto& letter : contents)
+                letter = alphabet[engine() % alphabet.size()];
+
+            result.db.add(fmt::format("anonymous#%llu", i), sequence {contents});
+        }
+
+        return result;
+    }
+
+    /**
+     * Loads a dataset from a sequence database file. Every node loads the file on
+     * its own, so the datasets can be benchmarked without the bootstrap module.
+     * @param filename The name of the file to load.
+     * @return The loaded dataset.
+     */
+    static auto load(const std::string& filename) -> dataset
+    {
+        const auto slash = filename.find_last_of('/');
+        return {slash == std::string::npos ? filename : filename.substr(slash + 1), io::load<database>(filename)};
+    }
+
+    /**
+     * Counts the total number of cells needed to align all pairs of a dataset's
+     * sequences. For algorithms which do not fill the whole matrix, the resulting
+     * throughput is equivalent to the whole matrix's.
+     * @param db The dataset's sequences.
+     * @return The number of cells to fill.
+     */
+    static auto cells(const database& db) noexcept -> double
+    {
+        double total = 0, squared = 0;
+
+        for(const auto& entry : db) {
+            total += entry.contents.unpadded();
+            squared += double(entry.contents.unpadded()) * entry.contents.unpadded();
+        }
+
+        return (total * total - squared) / 2;
+    }
+
+    /**
+     * Picks the algorithms of a module to be benchmarked. Unless explicitly given,
+     * every registered algorithm is picked, once by its shortest name. Algorithms
+     * which require devices are left out when no devices are available.
+     * @tparam A The module's algorithm type.
+     * @tparam F The module's algorithm factory type.
+     * @param io The IO service instance to get the chosen algorithms from.
+     * @param module The module's name.
+     * @param devices The module's algorithms which require devices.
+     * @return The names of the algorithms to benchmark.
+     */
+    template <typename A, typename F>
+    static auto pick(const io::manager& io, const std::string& module, const std::vector<F>& devices)
+    -> std::vector<std::string>
+    {
+        auto bound = [&](const F& factory) {
+            return std::any_of(devices.begin(), devices.end(), [&](const F& f) { return &f == &factory; });
+        };
+
+        std::vector<std::pair<F, std::string>> chosen;
+
+        if(io.cmd.has(module)) {
+            std::string list = io.cmd.get(module) + ",";
+
+            for(size_t start = 0, end; (end = list.find(',', start)) != std::string::npos; start = end + 1) {
+                const auto name = list.substr(start, end - start);
+                enforce(A::has(name), "unknown %s algorithm chosen: '%s'", module, name);
+                enforce(global_state.use_devices || !bound(A::make(name)), "%s algorithm requires devices: '%s'", module, name);
+                chosen.push_back({A::make(name), name});
+            }
+        } else {
+            for(const auto& name : A::list()) {
+                const auto& factory = A::make(name);
+
+                const auto known = std::find_if(chosen.begin(), chosen.end(), [&](const std::pair<F, std::string>& c) {
+                    return &c.first == &factory;
+                });
+
+                if(known == chosen.end() && (global_state.use_devices || !bound(factory)))
+                    chosen.push_back({factory, name});
+                else if(known != chosen.end() && name.size() < known->second.size())
+                    known->second = name;
+            }
+        }
+
+        std::vector<std::string> result;
+
+        for(const auto& entry : chosen)
+            result.push_back(entry.second);
+
+        return result;
+    }
+
+    /**
+     * Benchmarks a functor. All nodes run the functor together, as the modules'
+     * algorithms are collective, and wait for each other before and after each
+     * run, so the master's timings cover the whole cluster's work.
+     * @tparam F The functor type.
+     * @param warmup The number of untimed runs.
+     * @param repetitions The number of timed runs.
+     * @param lambda The functor to benchmark.
+     * @return The timed runs' summary.
+     */
+    template <typename F>
+    static auto measure(size_t warmup, size_t repetitions, F&& lambda) -> benchmark::summary<double>
+    {
+        std::vector<benchmark::duration<double>> samples;
+
+        for(size_t i = 0; i < warmup + repetitions; ++i) {
+            mpi::barrier();
+
+            const auto duration = benchmark::run([&]() { lambda(); mpi::barrier(); });
+
+            if(i >= warmup)
+                samples.push_back(duration);
+        }
+
+        return benchmark::summarize(samples);
+    }
+
+    /**
+     * Prints a benchmark result as a line of the suite's report.
+     * @param current The result to be printed.
+     */
+    static void print(const result& current)
+    {
+        onlymaster fmt::print(
+                "%-9s %-28s %-20s %5llu %10.4lf %10.4lf %10.4lf %12.4lf %s\n"
+            ,   current.module, current.algorithm, current.dataset, current.count
+            ,   current.time.min, current.time.median, current.time.p90
+            ,   current.throughput, current.unit
+            );
+    }
+
+    /**
+     * Quotes a string to be written into a JSON file.
+     * @param text The string to be quoted.
+     * @return The quoted string.
+     */
+    static auto quote(const std::string& text) -> std::string
+    {
+        std::string result = "\"";
+
+        for(const char c : text) {
+            if(c == '"' || c == '\\') result += '\\';
+            result += c;
+        }
+
+        return result + "\"";
+    }
+
+    /**
+     * Writes the suite's results into a JSON file, so results of different releases
+     * can be compared to each other for tracking regressions.
+     * @param io The IO service instance with the suite's configuration.
+     * @param results The list of results to be written.
+     * @param filename The name of the file to write into.
+     */
+    static void dump(const io::manager& io, const std::vector<result>& results, const std::string& filename)
+    {
+        std::ofstream file (filename);
+        enforce(!file.fail(), "could not write benchmark results '%s'", filename);
+
+        file << "{\n"
+             << "  \"label\": " << quote(io.cmd.get("label", "")) << ",\n"
+             << "  \"nodes\": " << node::count << ",\n"
+             << "  \"threads\": " << global_state.threads << ",\n"
+             << "  \"devices\": " << (global_state.use_devices ? "true" : "false") << ",\n"
+             << "  \"scoring-table\": " << quote(io.cmd.get("scoring-table", "default")) << ",\n"
+             << "  \"warmup\": " << io.cmd.get<size_t>("warmup", 1) << ",\n"
+             << "  \"repetitions\": " << io.cmd.get<size_t>("repetitions", 5) << ",\n"
+             << "  \"results\": [";
+
+        for(size_t i = 0; i < results.size(); ++i) {
+            const auto& current = results[i];
+
+            file << (i > 0 ? "," : "") << "\n    {"
+                 << "\"module\": " << quote(current.module) << ", "
+                 << "\"algorithm\": " << quote(current.algorithm) << ", "
+                 << "\"dataset\": " << quote(current.dataset) << ", "
+                 << "\"count\": " << current.count << ", "
+                 << "\"seconds\": {"
+                    << "\"min\": " << current.time.min << ", "
+                    << "\"median\": " << current.time.median << ", "
+                    << "\"mean\": " << current.time.mean << ", "
+                    << "\"p90\": " << current.time.p90 << ", "
+                    << "\"p99\": " << current.time.p99 << ", "
+                    << "\"max\": " << current.time.max << "}, "
+                 << quote(current.unit) << ": " << current.throughput << "}";
+        }
+
+        file << "\n  ]\n}\n";
+    }
+
+    /**
+     * Benchmarks every chosen algorithm over a dataset. The phylogeny algorithms
+     * are given the distance matrix of the default pairwise algorithm, and the
+     * profile-aligner algorithms the guide tree of the default phylogeny one.
+     * @param io The IO service instance with the suite's configuration.
+     * @param data The dataset to benchmark on.
+     * @param results The list to append the benchmark results to.
+     */
+    static void bench(const io::manager& io, const dataset& data, std::vector<result>& results)
+    {
+        static const auto pw = pick<pairwise::algorithm>(io, "pairwise", std::vector<pairwise::factory> {
+                pairwise::needleman::hybrid, pairwise::needleman::hybrid_dynamic
+            ,   pairwise::needleman::wavefront, pairwise::needleman::banded
+            });
+
+        static const auto pg = pick<phylogeny::algorithm>(io, "phylogeny", std::vector<phylogeny::factory> {
+                phylogeny::njoining::hybrid_linear, phylogeny::njoining::hybrid_symmetric
+            ,   phylogeny::njoining::hybrid_lazy, phylogeny::njoining::batched_linear
+            ,   phylogeny::njoining::batched_symmetric
+            });
+
+        static const auto pa = pick<pgalign::algorithm>(io, "pgalign", std::vector<pgalign::factory> {
+                pgalign::myers::hybrid
+            });
+
+        const size_t warmup = io.cmd.get<size_t>("warmup", 1);
+        const size_t repetitions = utils::max<size_t>(io.cmd.get<size_t>("repetitions", 5), 1);
+        const size_t count = data.db.count();
+
+        const auto table = pairwise::scoring_table::make(io.cmd.get("scoring-table", "default"));
+        const auto matrix = pairwise::run(data.db, table);
+        const auto tree = phylogeny::run(matrix, count);
+
+        for(const auto& algorithm : pw) {
+            auto time = measure(warmup, repetitions, [&]() { pairwise::run(data.db, table, algorithm); });
+            results.push_back({"pairwise", algorithm, data.name, count, time, "gcups", cells(data.db) / time.median / 1e9});
+            print(results.back());
+        }
+
+        for(const auto& algorithm : pg) {
+            auto time = measure(warmup, repetitions, [&]() { phylogeny::run(matrix, count, algorithm); });
+            results.push_back({"phylogeny", algorithm, data.name, count, time, "joins/s", (count - 1) / time.median});
+            print(results.back());
+        }
+
+        for(const auto& algorithm : pa) {
+            auto time = measure(warmup, repetitions, [&]() { pgalign::run(data.db, tree, table, count, algorithm); });
+            results.push_back({"pgalign", algorithm, data.name, count, time, "merges/s", (count - 1) / time.median});
+            print(results.back());
+        }
+    }
+}
+
+/**
+ * Starts the benchmark suite. The suite must be run on the same cluster layout
+ * as the software itself, that is, with at least one master and one slave node.
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return The suite's exit code.
+ */
+int main(int argc, char **argv)
+try {
+    mpi::init(argc, argv);
+
+    auto io = io::manager::make(options, argc, argv);
+
+    enforce(node::count >= 2, "at least one slave node is needed");
+
+    onlyslaves try {
+        global_state.local_devices = cuda::device::count();
+    } catch(const cuda::exception&) {
+        global_state.local_devices = 0;
+    }
+
+    global_state.report_only = true;
+    onlyslaves global_state.use_multigpu = io.cmd.has("multigpu");
+    global_state.threads = utils::max(io.cmd.get<int>("threads", 1), 1);
+    onlyslaves global_state.node_devices = utils::max(utils::min(io.cmd.get<int>("node-gpus", 1), global_state.local_devices), 1);
+    global_state.use_devices = mpi::allreduce(global_state.local_devices, mpi::op::min);
+
+    parallel::init(global_state.threads);
+
+    std::vector<dataset> datasets;
+    std::vector<result> results;
+
+    for(const auto& filename : io.cmd.all())
+        datasets.push_back(load(filename));
+
+    if(!io.cmd.has("no-sweep")) {
+        for(const auto length : sweep_lengths)
+            datasets.push_back(generate(sweep_count, length));
+
+        for(const auto count : sweep_counts)
+            datasets.push_back(generate(count, sweep_length));
+    }
+
+    onlymaster fmt::print(
+            "%-9s %-28s %-20s %5s %10s %10s %10s %12s\n"
+        ,   "module", "algorithm", "dataset", "count", "min", "median", "p90", "throughput"
+        );
+
+    for(const auto& current : datasets)
+        bench(io, current, results);
+
+    onlymaster if(io.cmd.has("output"))
+        dump(io, results, io.cmd.get("output"));
+
+    mpi::finalize();
+
+    return 0;
+} catch(const std::exception& e) {
+    watchdog::error(e.what());
+    mpi::finalize();
+
+    return 1;
+}
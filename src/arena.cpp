@@ -0,0 +1,53 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the host arena allocator.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <cstdlib>
+
+#include "arena.hpp"
+#include "allocator.hpp"
+#include "exception.hpp"
+
+namespace museqa
+{
+    namespace
+    {
+        /**
+         * The upstream memory source for the host arena. Regions are simply taken
+         * from the process' heap.
+         * @since 0.1.1
+         */
+        struct heap
+        {
+            /**
+             * Acquires a new memory region from the heap.
+             * @param size The region's size in bytes.
+             * @return The new memory region.
+             */
+            static inline auto acquire(size_t size) -> void *
+            {
+                void *ptr = malloc(size);
+                enforce(ptr != nullptr, "could not allocate %llu bytes of host memory", size);
+                return ptr;
+            }
+
+            /**
+             * Releases a memory region back to the heap.
+             * @param ptr The region to be released.
+             */
+            static inline void release(void *ptr) noexcept
+            {
+                free(ptr);
+            }
+        };
+    }
+
+    /**
+     * The allocator instance for carving small or short-lived buffers from host
+     * memory arenas, without going through the heap for every allocation.
+     * @since 0.1.1
+     */
+    allocator arena::host = arena::pool<heap>::make();
+}
@@ -0,0 +1,190 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements arena allocators for many small and short-lived allocations.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "utils.hpp"
+#include "allocator.hpp"
+
+namespace museqa
+{
+    namespace arena
+    {
+        /**
+         * The default size of the memory regions acquired by an arena. Allocations
+         * larger than a quarter of this size are given a region on their own.
+         * @since 0.1.1
+         */
+        enum : size_t { region_size = 1 << 22 };
+
+        /**
+         * The alignment of every allocation carved from an arena.
+         * @since 0.1.1
+         */
+        enum : size_t { alignment = alignof(std::max_align_t) };
+
+        /**
+         * A memory region from which allocations are sequentially carved. The region
+         * is only released back to its upstream when all of its allocations have been
+         * released, and it is no longer the arena's current region.
+         * @since 0.1.1
+         */
+        struct region
+        {
+            std::atomic<size_t> refs;           /// The number of references to the region.
+            size_t capacity;                    /// The region's total size in bytes.
+            size_t used;                        /// The number of bytes already carved.
+        };
+
+        /**
+         * Rounds a size up to the arenas' alignment.
+         * @param size The size to be rounded.
+         * @return The rounded size.
+         */
+        inline constexpr auto align(size_t size) noexcept -> size_t
+        {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        /**
+         * An arena allocator over an upstream memory source. Every thread carves its
+         * allocations from its own current region, thus allocating needs neither
+         * locks nor any upstream calls. When all allocations carved from the current
+         * region have been released, the region is rewound and reused, so that buffers
+         * which are repeatedly allocated and released always reuse the same memory.
+         * The elements' constructors are not called, as with device allocators.
+         * @tparam U The upstream memory source, with static acquire and release.
+         * @since 0.1.1
+         */
+        template <typename U>
+        class pool
+        {
+            protected:
+                /**
+                 * Holds the current thread's region, and drops the arena's reference
+                 * to it when the thread finishes.
+                 * @since 0.1.1
+                 */
+                struct holder
+                {
+                    region *current = nullptr;  /// The thread's current region.
+
+                    inline ~holder()
+                    {
+                        if(current) pool::release(current);
+                    }
+                };
+
+                /**
+                 * The offset of the first allocation within a region, and the space
+                 * reserved before each allocation for its region's address.
+                 * @since 0.1.1
+                 */
+                enum : size_t { offset = arena::align(sizeof(region)) };
+                enum : size_t { stride = arena::align(sizeof(region *)) };
+
+            public:
+                /**
+                 * Carves a new allocation from the current thread's region.
+                 * @param ptr The target pointer to allocate memory to.
+                 * @param size The size of each element.
+                 * @param n The number of elements to allocate.
+                 */
+                static void allocate(void **ptr, size_t size, size_t n)
+                {
+                    static thread_local holder local;
+
+                    const size_t bytes = stride + arena::align(size * n);
+                    region *& current = local.current;
+
+                    if(current && current->refs.load(std::memory_order_acquire) == 1)
+                        current->used = offset;
+
+                    if(!current || current->used + bytes > current->capacity) {
+                        if(bytes > region_size / 4) {
+                            auto target = acquire(offset + bytes);
+                            *ptr = carve(target, bytes);
+                            release(target);
+                            return;
+                        }
+
+                        if(current) release(current);
+                        current = acquire(region_size);
+                    }
+
+                    *ptr = carve(current, bytes);
+                }
+
+                /**
+                 * Releases an allocation carved from any of the arena's regions.
+                 * @param ptr The pointer to be released.
+                 */
+                static void deallocate(void *ptr)
+                {
+                    if(ptr) release(*reinterpret_cast<region **>(static_cast<char *>(ptr) - stride));
+                }
+
+                /**
+                 * Creates an allocator instance for the arena.
+                 * @return The new arena allocator.
+                 */
+                static inline auto make() noexcept -> museqa::allocator
+                {
+                    return museqa::allocator {&pool::allocate, &pool::deallocate};
+                }
+
+            protected:
+                /**
+                 * Acquires a new region from upstream.
+                 * @param capacity The region's total size in bytes.
+                 * @return The new region.
+                 */
+                static inline auto acquire(size_t capacity) -> region *
+                {
+                    auto target = new (U::acquire(capacity)) region;
+                    target->refs.store(1, std::memory_order_relaxed);
+                    target->capacity = capacity;
+                    target->used = offset;
+                    return target;
+                }
+
+                /**
+                 * Carves an allocation from a region with enough room for it.
+                 * @param target The region to carve from.
+                 * @param bytes The number of bytes to carve, including the region's address.
+                 * @return The allocation's pointer.
+                 */
+                static inline auto carve(region *target, size_t bytes) noexcept -> void *
+                {
+                    char *base = reinterpret_cast<char *>(target) + target->used;
+                    target->refs.fetch_add(1, std::memory_order_relaxed);
+                    target->used += bytes;
+
+                    *reinterpret_cast<region **>(base) = target;
+                    return base + stride;
+                }
+
+                /**
+                 * Drops a reference to a region, and releases it if it was the last.
+                 * @param target The region to be released.
+                 */
+                static inline void release(region *target)
+                {
+                    if(target->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        target->~region();
+                        U::release(target);
+                    }
+                }
+        };
+
+        extern museqa::allocator host;
+    }
+}
@@ -6,9 +6,12 @@
  */
 #pragma once
 
+#include <cmath>
 #include <ratio>
 #include <chrono>
+#include <vector>
 #include <utility>
+#include <algorithm>
 
 namespace museqa
 {
@@ -107,5 +110,75 @@ namespace museqa
             return elapsed(start);
         }
         /**#@-*/
+
+        /**
+         * Summarizes the durations of repeated executions of a benchmarked functor.
+         * As timings are usually skewed by outliers, their median and percentiles
+         * are better suited for comparisons between runs than their mean.
+         * @tparam T The scalar type to represent durations with.
+         * @since 0.1.1
+         */
+        template <typename T = double>
+        struct summary
+        {
+            size_t count = 0;           /// The number of summarized samples.
+            T min = 0;                  /// The shortest sample duration.
+            T max = 0;                  /// The longest sample duration.
+            T mean = 0;                 /// The samples' average duration.
+            T median = 0;               /// The samples' median duration.
+            T p90 = 0;                  /// The samples' 90th percentile duration.
+            T p99 = 0;                  /// The samples' 99th percentile duration.
+        };
+
+        /**
+         * Retrieves a percentile from sorted samples, by linearly interpolating
+         * between the two samples closest to the percentile's rank.
+         * @tparam T The samples' scalar type.
+         * @param sorted The sorted list of samples.
+         * @param rank The percentile rank, between zero and one.
+         * @return The samples' percentile.
+         */
+        template <typename T>
+        inline auto percentile(const std::vector<T>& sorted, double rank) noexcept -> T
+        {
+            if(sorted.empty())
+                return T {};
+
+            const double position = rank * (sorted.size() - 1);
+            const size_t lower = static_cast<size_t>(std::floor(position));
+            const size_t upper = std::min(lower + 1, sorted.size() - 1);
+
+            return sorted[lower] + (sorted[upper] - sorted[lower]) * (position - lower);
+        }
+
+        /**
+         * Summarizes the durations of a list of benchmark samples.
+         * @tparam T The scalar type to which durations are represented by.
+         * @param samples The samples to be summarized.
+         * @return The samples' summary.
+         */
+        template <typename T>
+        inline auto summarize(const std::vector<duration<T>>& samples) -> summary<T>
+        {
+            std::vector<T> sorted (samples.begin(), samples.end());
+            std::sort(sorted.begin(), sorted.end());
+
+            summary<T> result;
+
+            if(!sorted.empty()) {
+                for(const T& sample : sorted)
+                    result.mean += sample;
+
+                result.count  = sorted.size();
+                result.min    = sorted.front();
+                result.max    = sorted.back();
+                result.mean  /= sorted.size();
+                result.median = percentile(sorted, .50);
+                result.p90    = percentile(sorted, .90);
+                result.p99    = percentile(sorted, .99);
+            }
+
+            return result;
+        }
     }
 }
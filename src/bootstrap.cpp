@@ -4,23 +4,87 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2020-present Rodrigo Siqueira
  */
+#include <new>
+#include <atomic>
+#include <thread>
 #include <vector>
+#include <numeric>
+#include <algorithm>
 
 #include "mpi.hpp"
 #include "utils.hpp"
 #include "tuple.hpp"
 #include "encoder.hpp"
+#include "exception.hpp"
 #include "pointer.hpp"
+#include "allocator.hpp"
 #include "database.hpp"
 #include "pipeline.hpp"
 #include "sequence.hpp"
+#include "trace.hpp"
 
+#include "stream.hpp"
 #include "bootstrap.hpp"
 
 namespace museqa
 {
     namespace
     {
+        /**
+         * The number of blocks sent within a single chunk of the database. The
+         * sequences are streamed in chunks of roughly this size, so that nodes can
+         * begin working on the first sequences while the last ones are still on
+         * their ways. A sequence is never split between two chunks. On debug builds,
+         * chunks are far smaller, so that even small databases are streamed in many
+         * chunks, and the nodes waiting for them can be exercised by the test suite.
+         * @since 0.1.1
+         */
+        #if defined(__museqa_debug)
+            enum : size_t { stream_chunk = 1 << 6 };
+        #else
+            enum : size_t { stream_chunk = 1 << 20 };
+        #endif
+
+        /**
+         * The state of the database stream on the current node. The number of chunks
+         * already arrived is kept within the host-shared segment itself, so only the
+         * host's first node must ever poll the pending broadcasts, while the others
+         * simply watch the counter advance.
+         * @since 0.1.1
+         */
+        struct streamer
+        {
+            std::vector<size_t> bounds;             /// The first sequence of each chunk.
+            std::vector<mpi::request> pending;      /// The chunks' pending broadcasts.
+            std::atomic<size_t> *arrived = nullptr; /// The number of host-arrived chunks.
+            size_t done = 0;                        /// The number of locally completed chunks.
+            bool leader = false;                    /// Is this node its host's first node?
+
+            mpi::communicator local;                /// The host-local nodes communicator.
+            mpi::communicator leaders;              /// The hosts' first nodes communicator.
+        };
+
+        static streamer state;
+
+        /**
+         * Splits the database's sequences into chunks. As every node knows all the
+         * sequences' sizes, all of them find the very same chunks out.
+         * @param sizes The list of sequences sizes.
+         * @return The first sequence of each chunk, with a trailing sentinel.
+         */
+        static auto split(const std::vector<size_t>& sizes) -> std::vector<size_t>
+        {
+            std::vector<size_t> bounds {0};
+
+            for(size_t i = 0, acc = 0, n = sizes.size(); i < n; ++i) {
+                if(acc >= stream_chunk) { bounds.push_back(i); acc = 0; }
+                acc += sizes[i];
+            }
+
+            if(!sizes.empty()) bounds.push_back(sizes.size());
+            return bounds;
+        }
+
         /**
          * Loads all sequence database files from command line arguments.
          * @param io The IO service instance to get file names from.
@@ -28,6 +92,8 @@ namespace museqa
          */
         static auto load(const io::manager& io) -> database
         {
+            trace::scope span {"bootstrap::load", "io"};
+
             auto db = database {32};
             auto dblist = io.load<database>();
 
@@ -38,21 +104,31 @@ namespace museqa
         }
 
         /**
-         * Unpacks a database from its flattened components and rebuilds an instance
-         * with the exact sequence contents as before serialization.
+         * The allocator for the host-shared sequences segment. The segment is owned
+         * by its memory window, which is only freed when MPI is finalized, thus
+         * sequences referencing it must not attempt to release its memory.
+         * @since 0.1.1
+         */
+        static const museqa::allocator shared_allocator = {
+            [](void **ptr, size_t, size_t) { *ptr = nullptr; }
+        ,   [](void *) {}
+        };
+
+        /**
+         * Unpacks a database from its flattened components. The sequences are not
+         * copied, but reference their blocks directly within the flattened buffer.
          * @param sizes The list of serialized sequences sizes.
          * @param blocks The flattened database blocks.
+         * @param total The total number of flattened blocks.
          * @return The reconstructed database.
          */
-        static database unpack(
-                const std::vector<size_t>& sizes
-            ,   const std::vector<encoder::block>& blocks
-            )
+        static database unpack(const std::vector<size_t>& sizes, encoder::block *blocks, size_t total)
         {
             auto db = database {sizes.size()};
+            auto arena = encoder::buffer {pointer<encoder::block[]> {blocks, shared_allocator}, total};
 
             for(size_t i = 0, j = 0, n = sizes.size(); i < n; ++i) {
-                db.add(sequence::copy(&blocks[j], sizes[i]));
+                db.add(sizes[i] ? sequence {arena.offset(j), sizes[i]} : sequence {});
                 j += sizes[i];
             }
 
@@ -70,26 +146,134 @@ namespace museqa
          */
         auto bootstrap::run(const io::manager& io, pipeline::pipe&) const -> pipeline::pipe
         {
+            trace::scope span {"bootstrap::run", "io"};
+
             database db;
             std::vector<size_t> sizes;
             std::vector<encoder::block> blocks;
 
             onlymaster db = load(io);
 
+            onlymaster if(io.cmd.has("dump-database"))
+                enforce(io.dump(db, io.cmd.get("dump-database")), "could not dump sequences database");
+
             onlymaster for(const auto& entry : db) {
                 sizes.push_back(entry.contents.size());
                 blocks.insert(blocks.end(), entry.contents.begin(), entry.contents.end());
             }
 
+            // The database is sent only once to each host, to the host's first
+            // node. The other nodes on the same host reference the sequences
+            // directly from a memory segment shared within the host.
+            state.local = mpi::communicator::split_local(mpi::world);
+            state.leaders = mpi::communicator::split(mpi::world, state.local.rank() == 0 ? 0 : 1);
+            state.leader = (state.local.rank() == 0);
+
             sizes = mpi::broadcast(sizes);
-            blocks = mpi::broadcast(blocks);
+            state.bounds = split(sizes);
+
+            const size_t total = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+            const size_t chunks = !sizes.empty() ? state.bounds.size() - 1 : 0;
+            const size_t offset = (sizeof(std::atomic<size_t>) + sizeof(encoder::block) - 1) / sizeof(encoder::block);
+
+            auto shared = static_cast<encoder::block *>(
+                    mpi::allocate_shared((offset + total) * sizeof(encoder::block), state.local)
+                );
+
+            state.arrived = reinterpret_cast<std::atomic<size_t> *>(shared);
+
+            // The sequences are sent in chunks, and this module does not wait for
+            // them to arrive. Each chunk's broadcast is posted here and later only
+            // completed when one of its sequences is needed by the current node.
+            if(state.leader) {
+                new (state.arrived) std::atomic<size_t> {0};
+
+                onlymaster std::copy(blocks.begin(), blocks.end(), shared + offset);
+                onlymaster state.arrived->store(chunks, std::memory_order_release);
+
+                for(size_t i = 0, displ = 0; i < chunks; ++i) {
+                    const size_t count = std::accumulate(
+                            sizes.begin() + state.bounds[i]
+                        ,   sizes.begin() + state.bounds[i + 1]
+                        ,   size_t(0)
+                        );
+
+                    state.pending.push_back(mpi::ibroadcast(shared + offset + displ, count, node::master, state.leaders));
+                    displ += count;
+                }
+            }
+
+            mpi::barrier(state.local);
+            blocks.clear();
+
+            onlyslaves db = unpack(sizes, shared + offset, total);
+
+            return pipeline::pipe {new bootstrap::conduit {db}};
+        }
+    }
+}
+
+namespace museqa
+{
+    namespace stream
+    {
+        /**
+         * Waits until the given number of leading sequences have arrived to the
+         * current node. The host's first node completes the pending broadcasts,
+         * while the other nodes watch the host's shared chunks counter.
+         * @param count The number of leading sequences needed.
+         */
+        void await(size_t count)
+        {
+            const auto& bounds = state.bounds;
+            if(!count || bounds.size() < 2 || state.done + 1 >= bounds.size()) return;
+
+            trace::scope span {"stream::await", "io"};
+
+            const auto found = std::lower_bound(bounds.begin() + 1, bounds.end(), count);
+            const size_t needed = utils::min<size_t>(found - bounds.begin(), bounds.size() - 1);
+
+            if(state.leader) {
+                for( ; state.done < needed; ++state.done)
+                    mpi::wait(state.pending[state.done]);
+
+                if(state.arrived->load() < needed)
+                    state.arrived->store(needed, std::memory_order_release);
+            } else {
+                while((state.done = state.arrived->load(std::memory_order_acquire)) < needed)
+                    std::this_thread::yield();
+            }
+        }
+
+        /**
+         * Advances the database stream without blocking. This is only relevant to
+         * the hosts' first nodes, as they are responsible for completing the stream
+         * broadcasts, so other nodes on the same host can see the chunks arriving.
+         */
+        void progress()
+        {
+            if(!state.leader) return;
+
+            for( ; state.done < state.pending.size() && mpi::test(state.pending[state.done]); ++state.done)
+                if(state.arrived->load() < state.done + 1)
+                    state.arrived->store(state.done + 1, std::memory_order_release);
+        }
+
+        /**
+         * Waits for the whole database to arrive and releases the stream's state.
+         * This must be called on all nodes before the sequences are no longer needed.
+         */
+        void complete()
+        {
+            if(state.bounds.empty()) return;
 
-            onlyslaves db = unpack(sizes, blocks);
+            await(state.bounds.back());
 
-            auto ptr = new bootstrap::conduit {db};
-            mpi::barrier();
+            mpi::communicator::free(state.leaders);
+            mpi::communicator::free(state.local);
 
-            return pipeline::pipe {ptr};
+            state.pending.clear();
+            state.bounds.clear();
         }
     }
 }
@@ -300,4 +300,107 @@ namespace museqa
             using underlying_buffer::copy;
             using underlying_buffer::make;
     };
+
+    /**
+     * Borrows a buffer's contents without sharing its ownership. A view holds nothing
+     * but the contents' address and size, thus it is trivially copied and can be
+     * kept in registers, without ever touching the buffer's references counter.
+     * Views are meant for inner loops, so they must never outlive their buffers.
+     * @tparam T The buffer contents type, const-qualified for read-only views.
+     * @since 0.1.1
+     */
+    template <typename T>
+    class buffer_view
+    {
+        public:
+            using element_type = T;     /// The view's element type.
+
+        protected:
+            element_type *m_ptr = nullptr;  /// The borrowed contents' address.
+            size_t m_size = 0;              /// The number of elements borrowed.
+
+        public:
+            __host__ __device__ inline constexpr buffer_view() noexcept = default;
+            __host__ __device__ inline constexpr buffer_view(const buffer_view&) noexcept = default;
+            __host__ __device__ inline constexpr buffer_view(buffer_view&&) noexcept = default;
+
+            /**
+             * Borrows a raw contents pointer.
+             * @param ptr The contents to be borrowed.
+             * @param size The number of elements to borrow.
+             */
+            __host__ __device__ inline constexpr buffer_view(element_type *ptr, size_t size) noexcept
+            :   m_ptr {ptr}
+            ,   m_size {size}
+            {}
+
+            /**
+             * Borrows the contents of a buffer.
+             * @tparam U The buffer's contents type.
+             * @param buf The buffer to be borrowed.
+             */
+            template <typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+            __host__ __device__ inline buffer_view(buffer<U>& buf) noexcept
+            :   buffer_view {buf.raw(), buf.size()}
+            {}
+
+            /**
+             * Borrows the contents of a const-qualified buffer.
+             * @tparam U The buffer's contents type.
+             * @param buf The buffer to be borrowed.
+             */
+            template <typename U, typename = typename std::enable_if<std::is_convertible<const U *, T *>::value>::type>
+            __host__ __device__ inline buffer_view(const buffer<U>& buf) noexcept
+            :   buffer_view {buf.raw(), buf.size()}
+            {}
+
+            __host__ __device__ inline buffer_view& operator=(const buffer_view&) noexcept = default;
+            __host__ __device__ inline buffer_view& operator=(buffer_view&&) noexcept = default;
+
+            /**
+             * Gives access to a specific location in the borrowed contents.
+             * @param offset The requested offset.
+             * @return The element at the given offset.
+             */
+            __host__ __device__ inline element_type& operator[](ptrdiff_t offset) const noexcept
+            {
+                return m_ptr[offset];
+            }
+
+            /**
+             * Allows the view to be iterated from its beginning.
+             * @return The pointer to the first borrowed element.
+             */
+            __host__ __device__ inline element_type *begin() const noexcept
+            {
+                return m_ptr;
+            }
+
+            /**
+             * Informs the view's final iterator point.
+             * @return The pointer after the last borrowed element.
+             */
+            __host__ __device__ inline element_type *end() const noexcept
+            {
+                return m_ptr + m_size;
+            }
+
+            /**
+             * Gives access to the borrowed contents' raw address.
+             * @return The view's raw pointer.
+             */
+            __host__ __device__ inline element_type *raw() const noexcept
+            {
+                return m_ptr;
+            }
+
+            /**
+             * Informs the number of elements borrowed by the view.
+             * @return The view's size.
+             */
+            __host__ __device__ inline size_t size() const noexcept
+            {
+                return m_size;
+            }
+    };
 }
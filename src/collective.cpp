@@ -0,0 +1,67 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the collective operations over device buffers.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <cstdint>
+#include <cstring>
+
+#include "mpi.hpp"
+#include "node.hpp"
+#include "trace.hpp"
+#include "exception.hpp"
+#include "environment.h"
+#include "collective.hpp"
+
+#if !defined(__museqa_runtime_cython) && defined(OPEN_MPI)
+  #include <mpi-ext.h>
+#endif
+
+namespace museqa
+{
+    /**
+     * Informs whether device buffers may be given to collective operations. As every
+     * node must pick the same communication path, the nodes agree on it when this
+     * is first called, so this must be first called on all nodes at once. The path
+     * is only taken if the MPI implementation is CUDA-aware on every single node.
+     * @return Can the collective operations be given device buffers?
+     */
+    auto collective::device() -> bool
+    {
+        #if !defined(__museqa_runtime_cython)
+            static const bool agreed = []() {
+                #if defined(MPIX_CUDA_AWARE_SUPPORT) && MPIX_CUDA_AWARE_SUPPORT
+                    int aware = MPIX_Query_cuda_support() == 1;
+                #else
+                    int aware = 0;
+                #endif
+
+                mpi::check(MPI_Allreduce(MPI_IN_PLACE, &aware, 1, MPI_INT, MPI_LAND, mpi::world));
+                return aware != 0;
+            }();
+
+            return agreed;
+        #else
+            return false;
+        #endif
+    }
+
+    /**
+     * Gathers a block of bytes from all nodes and delivers them to all nodes, in
+     * the order of the nodes' ranks. Both buffers may live in device memory, but
+     * any device work producing the outgoing block must have already finished.
+     * @param out The node's outgoing block.
+     * @param in The buffer to gather all nodes' blocks into.
+     * @param bytes The size of each node's block, in bytes.
+     */
+    void collective::allgather(const void *out, void *in, size_t bytes)
+    {
+        #if !defined(__museqa_runtime_cython)
+            trace::scope span {"collective::allgather", "mpi"};
+            mpi::check(MPI_Allgather(out, bytes, MPI_BYTE, in, bytes, MPI_BYTE, mpi::world));
+        #else
+            memcpy(in, out, bytes);
+        #endif
+    }
+}
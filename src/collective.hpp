@@ -0,0 +1,29 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements collective operations over buffers resident in device memory.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "environment.h"
+
+namespace museqa
+{
+    /**
+     * Exchanges data between nodes directly from and into device memory. When the
+     * MPI implementation is CUDA-aware, device buffers are handed over to it as
+     * they are, so no node must copy them into host memory before communicating.
+     * Otherwise, callers must fall back to the host collectives in the MPI wrapper.
+     * Unlike the MPI wrapper, these operations are declared without depending on
+     * MPI's headers, so they may be called from device code's translation units.
+     * @since 0.1.1
+     */
+    namespace collective
+    {
+        extern auto device() -> bool;
+        extern void allgather(const void *, void *, size_t);
+    }
+}
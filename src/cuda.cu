@@ -4,13 +4,19 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2018-present Rodrigo Siqueira
  */
+#include <map>
 #include <cuda.h>
+#include <mutex>
 #include <limits>
 #include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
 
 #include "cuda.cuh"
 #include "utils.hpp"
 #include "allocator.hpp"
+#include "arena.hpp"
 
 namespace
 {
@@ -19,42 +25,294 @@ namespace
         using namespace museqa;
 
         /**
-         * Stores the ID of the compute-capable device currently selected.
+         * Stores the ID of the compute-capable device currently selected. As the
+         * CUDA runtime keeps the current device per host thread, so must we.
          * @since 0.1.1
          */
-        cuda::device::id id = std::numeric_limits<cuda::word>::max();
+        thread_local cuda::device::id id = std::numeric_limits<cuda::word>::max();
 
         /**
          * Stores the properties of the currently selected compute-capable device.
          * @since 0.1.1
          */
-        cuda::device::property property;
+        thread_local cuda::device::property property;
     }
 }
 
 namespace museqa
 {
+    namespace
+    {
+        /*
+         * The size classes of the pooled blocks. Small blocks are rounded up to
+         * a power of two, and large blocks are rounded up to the granularity the
+         * driver reserves device memory with, so similar sizes share their blocks.
+         */
+        enum : size_t { min_block = 512 };
+        enum : size_t { large_block = 1 << 20 };
+        enum : size_t { large_step = 1 << 21 };
+
+        /**
+         * Rounds a size up to its pooled blocks' size class.
+         * @param bytes The size to be rounded.
+         * @return The size of the blocks serving the size.
+         */
+        static inline auto classify(size_t bytes) noexcept -> size_t
+        {
+            if(bytes > large_block)
+                return (bytes + large_step - 1) / large_step * large_step;
+
+            size_t size = min_block;
+            while(size < bytes) size <<= 1;
+            return size;
+        }
+
+        /**
+         * A caching pool of memory blocks over an upstream memory source. Released
+         * blocks are kept by the pool, rather than given back upstream, and are
+         * handed out again to later allocations of their size class. Thus, buffers
+         * which are repeatedly allocated and released do not go through the driver,
+         * which would synchronize the whole device. Blocks are pooled apart for
+         * every device, and are only given back upstream when an allocation could
+         * not otherwise be served, or when the pool is explicitly trimmed.
+         * @note As released blocks may be handed out again right away, a buffer
+         * must not be released while work enqueued into a non-blocking stream may
+         * still be using it. Work on the default stream is always ordered.
+         * @tparam U The upstream memory source.
+         * @since 0.1.1
+         */
+        template <typename U>
+        class cache
+        {
+            protected:
+                using key_type = std::pair<int, size_t>;
+
+                /**
+                 * Describes a block handed out by the pool to one of its buffers.
+                 * @since 0.1.1
+                 */
+                struct block
+                {
+                    int device;         /// The device the block has been allocated on.
+                    size_t size;        /// The block's size class.
+                };
+
+            protected:
+                std::mutex m_lock;                                  /// The lock guarding the pool.
+                std::unordered_map<void *, block> m_used;           /// The blocks currently handed out.
+                std::map<key_type, std::vector<void *>> m_idle;     /// The blocks kept for reuse.
+                std::map<int, size_t> m_bytes;                      /// The idle bytes kept for each device.
+
+            public:
+                /**
+                 * Hands out a block with at least the requested size.
+                 * @param ptr The target pointer to allocate memory to.
+                 * @param bytes The number of bytes to allocate.
+                 */
+                inline void allocate(void **ptr, size_t bytes)
+                {
+                    std::lock_guard<std::mutex> guard {m_lock};
+
+                    const int device = U::device();
+                    const size_t size = classify(bytes);
+                    auto& idle = m_idle[{device, size}];
+
+                    if(!idle.empty()) {
+                        *ptr = idle.back();
+                        idle.pop_back();
+                        m_bytes[device] -= size;
+                    } else if(U::acquire(ptr, size) != cudaSuccess) {
+                        // If the upstream cannot serve the block, the idle blocks
+                        // of any other size class are given back, and then the block
+                        // is requested once again before giving up on it.
+                        cudaGetLastError();
+                        release(device);
+                        cuda::check(U::acquire(ptr, size));
+                    }
+
+                    m_used[*ptr] = {device, size};
+                }
+
+                /**
+                 * Takes a block back into the pool, so it can be reused.
+                 * @param ptr The block to be taken back.
+                 */
+                inline void deallocate(void *ptr)
+                {
+                    if(!ptr) return;
+
+                    std::lock_guard<std::mutex> guard {m_lock};
+                    const auto found = m_used.find(ptr);
+
+                    if(found == m_used.end())
+                        return U::release(ptr);
+
+                    const block target = found->second;
+                    m_used.erase(found);
+
+                    m_idle[{target.device, target.size}].push_back(ptr);
+                    m_bytes[target.device] += target.size;
+                }
+
+                /**
+                 * Informs the number of idle bytes kept by the pool for a device.
+                 * @param device The device to inform the idle bytes of.
+                 * @return The device's number of idle bytes.
+                 */
+                inline auto idle(int device) -> size_t
+                {
+                    std::lock_guard<std::mutex> guard {m_lock};
+                    return m_bytes[device];
+                }
+
+                /**
+                 * Gives all idle blocks of a device back to the upstream.
+                 * @param device The device to be trimmed.
+                 */
+                inline void trim(int device)
+                {
+                    std::lock_guard<std::mutex> guard {m_lock};
+                    release(device);
+                }
+
+            protected:
+                /**
+                 * Gives all idle blocks of a device back to the upstream. The lock
+                 * must be held by the caller.
+                 * @param device The device to be released.
+                 */
+                inline void release(int device)
+                {
+                    for(auto& entry : m_idle)
+                        if(entry.first.first == device) {
+                            for(void *ptr : entry.second)
+                                U::release(ptr);
+                            entry.second.clear();
+                        }
+
+                    m_bytes[device] = 0;
+                }
+        };
+
+        /**
+         * The upstream memory source for the device pool. Blocks are taken from
+         * the currently selected device's global memory.
+         * @since 0.1.1
+         */
+        struct device_heap
+        {
+            static inline auto device() -> int { return cuda::device::current(); }
+            static inline auto acquire(void **ptr, size_t size) -> cudaError_t { return cudaMalloc(ptr, size); }
+            static inline void release(void *ptr) { cuda::check(cudaFree(ptr)); }
+        };
+
+        /**
+         * The upstream memory source for the pinned host pool. Pinned blocks are
+         * not bound to any device, so they are all pooled together.
+         * @since 0.1.1
+         */
+        struct pinned_host
+        {
+            static inline auto device() -> int { return -1; }
+            static inline auto acquire(void **ptr, size_t size) -> cudaError_t { return cudaMallocHost(ptr, size); }
+            static inline void release(void *ptr) { cuda::check(cudaFreeHost(ptr)); }
+        };
+
+        /*
+         * The pools for device and pinned host memory. The pools are never destroyed,
+         * as the device runtime might have been shut down by the time the process's
+         * static objects are destroyed, so their blocks are left to the driver.
+         */
+        static auto& device_pool = *new cache<device_heap>;
+        static auto& pinned_pool = *new cache<pinned_host>;
+    }
+
     /**
      * The allocator instance for reserving and managing pointers of memory regions
-     * allocated in device's global memory space.
+     * allocated in device's global memory space. The regions are pooled, so that
+     * releasing and then allocating a buffer does not synchronize the device.
      * @since 0.1.1
      */
     allocator cuda::allocator::device = {
-        [](void **ptr, size_t size, size_t n) { cuda::check(cudaMalloc(ptr, size * n)); }
-    ,   [](void *ptr) { cuda::check(cudaFree(ptr)); }
+        [](void **ptr, size_t size, size_t n) { device_pool.allocate(ptr, size * n); }
+    ,   [](void *ptr) { device_pool.deallocate(ptr); }
     };
 
     /**
      * The allocator instance for reserving and managing pointers to pinned host-side
      * memory regions. Pinned memory is unpaginated and thus can be accessed faster
-     * by the device's internal instructions.
+     * by the device's internal instructions. As pinning memory is expensive, the
+     * regions are pooled and reused by later buffers.
      * @since 0.1.1
      */
     allocator cuda::allocator::pinned = {
-        [](void **ptr, size_t size, size_t n) { cuda::check(cudaMallocHost(ptr, size * n)); }
-    ,   [](void *ptr) { cuda::check(cudaFreeHost(ptr)); }
+        [](void **ptr, size_t size, size_t n) { pinned_pool.allocate(ptr, size * n); }
+    ,   [](void *ptr) { pinned_pool.deallocate(ptr); }
     };
 
+    /**
+     * Returns the amount of free global memory in the current device. The memory
+     * kept idle by the device pool is also free to be used by any new buffer.
+     * @return The amount of free global memory in bytes.
+     */
+    auto cuda::device::free_memory() -> size_t
+    {
+        size_t free, total;
+        cuda::check(cudaMemGetInfo(&free, &total));
+        return free + device_pool.idle(cuda::device::current());
+    }
+
+    /**
+     * Gives the current device's idle pooled memory back to the driver, so it
+     * can be used by other processes or by allocations made outside of museqa.
+     * @see cuda::allocator::device
+     */
+    void cuda::memory::trim()
+    {
+        device_pool.trim(cuda::device::current());
+    }
+
+    namespace
+    {
+        /**
+         * The upstream memory source for the pinned host arena. The arena's regions
+         * are taken from the pinned host pool, so the regions given to allocations
+         * too large to share one, are kept and reused just as any other region.
+         * @since 0.1.1
+         */
+        struct pinned_heap
+        {
+            /**
+             * Acquires a new pinned host memory region.
+             * @param size The region's size in bytes.
+             * @return The new memory region.
+             */
+            static inline auto acquire(size_t size) -> void *
+            {
+                void *ptr;
+                pinned_pool.allocate(&ptr, size);
+                return ptr;
+            }
+
+            /**
+             * Releases a pinned host memory region back to the pool.
+             * @param ptr The region to be released.
+             */
+            static inline void release(void *ptr)
+            {
+                pinned_pool.deallocate(ptr);
+            }
+        };
+    }
+
+    /**
+     * The allocator instance for staging buffers in pinned host memory. As pinning
+     * memory is very expensive, the buffers are carved from pinned arenas, whose
+     * regions are only pinned once and then reused by many transfers.
+     * @since 0.1.1
+     */
+    allocator cuda::allocator::staging = arena::pool<pinned_heap>::make();
+
     /**
      * Obtain a brief textual explanation for a specified kind of CUDA Runtime 
      * API status or error code.
@@ -140,4 +398,15 @@ namespace museqa
     {
         return utils::min<size_t>(needed, ::current::property.maxThreadsDim[0]);
     }
+
+    /**
+     * Informs the total number of warps which can be resident on the device at once.
+     * @param needed The number of warps needed for a specific computation.
+     * @return The maximum number of warps available.
+     */
+    auto cuda::device::warps(size_t needed) -> size_t
+    {
+        const auto& property = ::current::property;
+        return utils::min<size_t>(needed, property.multiProcessorCount * property.maxThreadsPerMultiProcessor / cuda::warp_size);
+    }
 }
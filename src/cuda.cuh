@@ -246,16 +246,7 @@ namespace museqa
                  */
                 using property = cudaDeviceProp;
 
-                /**
-                 * Returns the amount of free global memory in the current device.
-                 * @return The amount of free global memory in bytes.
-                 */
-                inline size_t free_memory()
-                {
-                    size_t free, total;
-                    cuda::check(cudaMemGetInfo(&free, &total));
-                    return free;
-                }
+                extern auto free_memory() -> size_t;
             #endif
 
             extern auto count() -> size_t;
@@ -267,6 +258,7 @@ namespace museqa
                 extern auto properties(device::id) -> property;
                 extern auto blocks(size_t = std::numeric_limits<size_t>::max()) -> size_t;
                 extern auto threads(size_t = std::numeric_limits<size_t>::max()) -> size_t;
+                extern auto warps(size_t = std::numeric_limits<size_t>::max()) -> size_t;
             #endif
         }
 
@@ -297,6 +289,19 @@ namespace museqa
                         cuda::check(cudaStreamCreate(&m_stream));
                     }
 
+                    /**
+                     * Creates a new asynchronous stream with the given flags. A non-blocking
+                     * stream, for instance, does not synchronize with the default stream.
+                     * @param flags The stream's creation flags.
+                     */
+                    inline explicit stream(unsigned flags)
+                    {
+                        cuda::check(cudaStreamCreateWithFlags(&m_stream, flags));
+                    }
+
+                    stream(const stream&) = delete;
+                    stream& operator=(const stream&) = delete;
+
                     /**
                      * Destroys and cleans up the wrapped stream. In case the device
                      * is still doing work in the stream, the resources will be
@@ -391,10 +396,13 @@ namespace museqa
             {
                 extern museqa::allocator device;
                 extern museqa::allocator pinned;
+                extern museqa::allocator staging;
             }
 
             namespace memory
             {
+                extern void trim();
+
                 /**
                  * Synchronously copies data between memory spaces or pointers.
                  * @note Since we assume compute capability bigger or equal to 2.0,
@@ -412,6 +420,22 @@ namespace museqa
                     cuda::check(cudaMemcpy(dest, src, sizeof(T) * count, cudaMemcpyDefault));
                 }
 
+                /**
+                 * Asynchronously copies data between memory spaces or pointers. The
+                 * copy is enqueued in the given stream and the host is not blocked,
+                 * as long as the host memory involved in the copy is pinned.
+                 * @tparam T The pointer type.
+                 * @param dest A pointer on host memory or on a device's global memory.
+                 * @param src A pointer on host memory or on a device's global memory.
+                 * @param count The number of elements to copy from source to destination.
+                 * @param target The stream to enqueue the copy into.
+                 */
+                template <typename T>
+                inline void copy(T *dest, const T *src, size_t count, const stream& target)
+                {
+                    cuda::check(cudaMemcpyAsync(dest, src, sizeof(T) * count, cudaMemcpyDefault, target));
+                }
+
                 /**
                  * Synchronously sets all bytes in a region of memory to a value.
                  * @param ptr The position from where region starts.
@@ -0,0 +1,150 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements warp-synchronous reductions for device kernels.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2019-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "cuda.cuh"
+#include "utils.hpp"
+#include "environment.h"
+
+#if defined(__museqa_compiler_nvcc)
+
+namespace museqa
+{
+    namespace cuda
+    {
+        /**
+         * Groups the reductions of values held by the threads of a warp or of a
+         * block. Values are exchanged between lanes through warp shuffles, so they
+         * never go through shared memory within a warp. As shuffles are explicitly
+         * synchronized by their lanes' mask, these reductions do not rely on the
+         * implicit warp-synchronous execution, which Volta and later devices lack.
+         * @since 0.1.1
+         */
+        namespace reduce
+        {
+            /**
+             * Informs the number of lanes present in the current thread's warp.
+             * The block's last warp may have less than a full warp of threads.
+             * @return The number of the warp's present lanes.
+             */
+            __device__ inline uint32_t lanes() noexcept
+            {
+                const uint32_t first = (threadIdx.x / warp_size) * warp_size;
+                return utils::min<uint32_t>(blockDim.x - first, warp_size);
+            }
+
+            /**
+             * Builds the mask of a warp's first lanes.
+             * @param count The number of lanes in the mask.
+             * @return The mask of the warp's first lanes.
+             */
+            __device__ inline uint32_t mask(uint32_t count) noexcept
+            {
+                return count < warp_size ? (1U << count) - 1 : ~0U;
+            }
+
+            /**
+             * Shuffles a value down among the lanes of a warp. Values of any trivially
+             * copyable type are shuffled, one 32-bit word at a time.
+             * @tparam T The type of value to be shuffled.
+             * @param mask The mask of lanes taking part in the shuffle.
+             * @param value The current lane's value.
+             * @param delta The distance to the lane whose value is received.
+             * @return The value of the lane at the given distance.
+             */
+            template <typename T>
+            __device__ inline T shuffle_down(uint32_t mask, const T& value, uint32_t delta) noexcept
+            {
+                enum : size_t { words = (sizeof(T) + sizeof(int) - 1) / sizeof(int) };
+
+                int data[words];
+                T result = value;
+
+                memcpy(data, &value, sizeof(T));
+
+                #pragma unroll
+                for(size_t i = 0; i < words; ++i)
+                    data[i] = __shfl_down_sync(mask, data[i], delta);
+
+                memcpy(&result, data, sizeof(T));
+                return result;
+            }
+
+            /**
+             * Reduces the values held by the first lanes of a warp. All lanes in the
+             * mask must take part in the reduction, although only the values of the
+             * lanes lower than the given count are reduced. The operator is always
+             * called with the value of the lowest lane as its first argument, thus
+             * ties can be broken towards the lowest lanes.
+             * @tparam F The reduction's operator type.
+             * @tparam T The type of values being reduced.
+             * @param value The current lane's value.
+             * @param lambda The reduction's operator.
+             * @param count The number of lanes whose value must be reduced.
+             * @param mask The mask of the lanes taking part in the reduction.
+             * @return The reduced value, valid on the warp's first lane only.
+             */
+            template <typename F, typename T>
+            __device__ inline T warp(T value, F lambda, uint32_t count = warp_size, uint32_t mask = ~0U)
+            {
+                const uint32_t lane = threadIdx.x % warp_size;
+
+                #pragma unroll
+                for(uint32_t offset = warp_size / 2; offset > 0; offset /= 2) {
+                    const T other = shuffle_down(mask, value, offset);
+                    if(lane + offset < count) value = lambda(value, other);
+                }
+
+                return value;
+            }
+
+            /**
+             * Reduces the values held by all threads of a block. Each warp reduces
+             * its values by itself, and the results of all warps are then reduced
+             * by the block's first warp. The given shared memory scratch must have
+             * room for one value per warp. A following reduction can reuse the same
+             * scratch, as the block is synchronized before it is ever written to.
+             * @tparam F The reduction's operator type.
+             * @tparam T The type of values being reduced.
+             * @param value The current thread's value.
+             * @param lambda The reduction's operator.
+             * @param scratch The shared memory scratch for the warps' results.
+             * @return The reduced value, valid on the block's first thread only.
+             */
+            template <typename F, typename T>
+            __device__ inline T block(T value, F lambda, T *scratch)
+            {
+                const uint32_t lane = threadIdx.x % warp_size;
+                const uint32_t id = threadIdx.x / warp_size;
+                const uint32_t warps = (blockDim.x + warp_size - 1) / warp_size;
+                const uint32_t count = reduce::lanes();
+
+                value = warp(value, lambda, count, reduce::mask(count));
+
+                if(warps == 1)
+                    return value;
+
+                __syncthreads();
+
+                if(lane == 0)
+                    scratch[id] = value;
+
+                __syncthreads();
+
+                if(id == 0)
+                    value = warp(lane < warps ? scratch[lane] : scratch[0], lambda, warps);
+
+                return value;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the tracing layer's device spans.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include "environment.h"
+
+#if defined(__museqa_tracing)
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <utility>
+
+#include "cuda.cuh"
+#include "trace.hpp"
+
+namespace
+{
+    using namespace museqa;
+
+    /**
+     * A device span whose events have not yet been resolved. The span is kept
+     * along with the device its work has been enqueued into.
+     * @since 0.1.1
+     */
+    struct pending
+    {
+        const char *name;               /// The span's task name.
+        cudaEvent_t start;              /// The event marking the work's start.
+        cudaEvent_t stop;               /// The event marking the work's end.
+        cuda::device::id device;        /// The device the work ran on.
+    };
+
+    /**
+     * The spans waiting to be resolved, and the lock guarding them, as device work
+     * may be enqueued by any host thread.
+     * @since 0.1.1
+     */
+    static std::vector<pending> queue;
+    static std::mutex lock;
+
+    /**
+     * The reference event of each device, and the host time it has been reached
+     * at. Device events are placed on the host's timeline relative to these.
+     * @since 0.1.1
+     */
+    static std::map<cuda::device::id, std::pair<cudaEvent_t, double>> reference;
+
+    /**
+     * Resolves all pending device spans, by waiting for their events to be reached.
+     * The lock must be held by the caller.
+     */
+    static void resolve()
+    {
+        for(const auto& current : queue) {
+            const auto& origin = reference[current.device];
+            float offset, duration;
+
+            cuda::check(cudaEventSynchronize(current.stop));
+            cuda::check(cudaEventElapsedTime(&offset, origin.first, current.start));
+            cuda::check(cudaEventElapsedTime(&duration, current.start, current.stop));
+
+            trace::record(
+                    current.name, "device"
+                ,   origin.second + offset * 1e-3, duration * 1e-3
+                ,   trace::device_thread + current.device
+                );
+
+            cudaEventDestroy(current.start);
+            cudaEventDestroy(current.stop);
+        }
+
+        queue.clear();
+    }
+}
+
+namespace museqa
+{
+    /**
+     * Enqueues a device span to be resolved later on. The device's reference event
+     * is set when the first span is enqueued into it. If too many spans pile up,
+     * they are resolved at once, so their events can be released.
+     * @param name The span's task name.
+     * @param start The event marking the work's start.
+     * @param stop The event marking the work's end.
+     */
+    void trace::enqueue(const char *name, cudaEvent_t start, cudaEvent_t stop) noexcept
+    try {
+        const auto device = cuda::device::current();
+        std::lock_guard<std::mutex> guard {lock};
+
+        if(!reference.count(device)) {
+            cudaEvent_t origin;
+            cuda::check(cudaEventCreate(&origin));
+            cuda::check(cudaEventRecord(origin));
+            cuda::check(cudaEventSynchronize(origin));
+            reference[device] = {origin, trace::clock()};
+        }
+
+        queue.push_back({name, start, stop, device});
+
+        if(queue.size() >= trace::capacity / 16)
+            resolve();
+    } catch(const cuda::exception&) {
+        // A span is never worth interrupting the traced work over, so any span
+        // which cannot be timed is simply left out of the trace.
+    }
+
+    /**
+     * Resolves all pending device spans into the node's trace.
+     * @see trace::dump
+     */
+    void trace::flush()
+    try {
+        std::lock_guard<std::mutex> guard {lock};
+        resolve();
+    } catch(const cuda::exception&) {
+        queue.clear();
+    }
+}
+
+#endif
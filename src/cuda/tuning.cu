@@ -0,0 +1,143 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the autotuning of device kernels' launch configurations.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <map>
+#include <mutex>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+
+#include "cuda.cuh"
+#include "exception.hpp"
+
+#include "cuda/tuning.cuh"
+
+namespace
+{
+    using namespace museqa;
+
+    /**
+     * The file the tuned configurations are cached into, and the configurations
+     * known thus far, keyed by the host, device and kernel they have been tuned
+     * for. The lock guards both, as devices may be driven by any host thread.
+     * @since 0.1.1
+     */
+    static std::string filename;
+    static std::map<std::string, std::string> known;
+    static std::mutex lock;
+
+    /**
+     * Builds the key of a kernel tuned for the currently selected device. The
+     * key's fields are separated by tabs, as device names may contain spaces.
+     * @param kernel The name of the tuned kernel.
+     * @return The key of the kernel on the current device.
+     */
+    static auto key(const std::string& kernel) -> std::string
+    {
+        static const std::string host = []() {
+            char name[256] = {};
+            gethostname(name, sizeof(name) - 1);
+            return std::string {name};
+        }();
+
+        const auto property = cuda::device::properties();
+
+        return host
+            + "\t" + property.name
+            + "\tsm_" + std::to_string(property.major) + std::to_string(property.minor)
+            + "\t" + kernel;
+    }
+
+    /**
+     * Reads all configurations cached into the tuning file, if it exists. Each
+     * line holds a configuration's key, followed by the configuration's name.
+     * @param target The map to read the configurations into.
+     */
+    static void load(std::map<std::string, std::string>& target)
+    {
+        std::ifstream file (filename);
+        std::string line;
+
+        while(std::getline(file, line)) {
+            const auto split = line.rfind('\t');
+
+            if(split != std::string::npos)
+                target[line.substr(0, split)] = line.substr(split + 1);
+        }
+    }
+}
+
+namespace museqa
+{
+    /**
+     * Enables kernels to be tuned, caching their configurations into the given
+     * file. The configurations already cached into the file are used right away.
+     * @param name The name of the tuning file.
+     */
+    void cuda::tuning::init(const std::string& name)
+    {
+        std::lock_guard<std::mutex> guard {lock};
+
+        filename = name;
+        known.clear();
+        load(known);
+    }
+
+    /**
+     * Informs whether kernels may be tuned.
+     * @return Has a tuning file been given?
+     */
+    auto cuda::tuning::enabled() noexcept -> bool
+    {
+        return !filename.empty();
+    }
+
+    /**
+     * Retrieves the configuration a kernel has been tuned to on the current device.
+     * @param kernel The name of the tuned kernel.
+     * @return The configuration's name, or an empty string if it is not known.
+     */
+    auto cuda::tuning::lookup(const std::string& kernel) -> std::string
+    {
+        std::lock_guard<std::mutex> guard {lock};
+        const auto found = known.find(key(kernel));
+
+        return found != known.end() ? found->second : std::string {};
+    }
+
+    /**
+     * Caches the configuration a kernel has been tuned to on the current device.
+     * The configurations cached by other processes in the meantime are kept, and
+     * the file is written aside and renamed over the old one, so the hosts sharing
+     * the file never read it partially written.
+     * @param kernel The name of the tuned kernel.
+     * @param label The name of the configuration picked for the kernel.
+     */
+    void cuda::tuning::store(const std::string& kernel, const std::string& label)
+    {
+        std::lock_guard<std::mutex> guard {lock};
+
+        known[key(kernel)] = label;
+
+        auto merged = std::map<std::string, std::string> {};
+        load(merged);
+
+        for(const auto& entry : known)
+            merged[entry.first] = entry.second;
+
+        const auto temporary = filename + "." + std::to_string(getpid());
+        std::ofstream file (temporary, std::ofstream::trunc);
+        enforce(!file.fail(), "file cannot be written '%s'", temporary);
+
+        for(const auto& entry : merged)
+            file << entry.first << '\t' << entry.second << '\n';
+
+        file.close();
+
+        enforce(!file.fail() && !rename(temporary.c_str(), filename.c_str()), "file cannot be written '%s'", filename);
+    }
+}
@@ -0,0 +1,124 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the autotuning of device kernels' launch configurations.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cuda.cuh"
+#include "environment.h"
+
+namespace museqa
+{
+    namespace cuda
+    {
+        /**
+         * Picks the best launch configuration of a kernel for each device. A kernel
+         * may be instantiated with a small grid of configurations, which are timed
+         * at the kernel's first use on each device's architecture. The fastest
+         * configuration is cached into a file, keyed by the host, the device's
+         * model and its compute capability, so it is picked on later runs without
+         * any timing. Unless a tuning file is given, the kernels' default
+         * configurations are always used.
+         * @since 0.1.1
+         */
+        namespace tuning
+        {
+            extern void init(const std::string&);
+            extern auto enabled() noexcept -> bool;
+
+            #if defined(__museqa_compiler_nvcc)
+                extern auto lookup(const std::string&) -> std::string;
+                extern void store(const std::string&, const std::string&);
+
+                /**
+                 * Times a single run of a kernel's configuration on a stream. The
+                 * host is blocked until the configuration's run is finished.
+                 * @tparam F The configuration's launcher type.
+                 * @param run The launcher of the configuration to be timed.
+                 * @param stream The stream the configuration is launched into.
+                 * @return The configuration's run time, in milliseconds.
+                 */
+                template <typename F>
+                inline auto measure(F&& run, cudaStream_t stream) -> float
+                {
+                    cudaEvent_t start, stop;
+                    float elapsed;
+
+                    cuda::check(cudaEventCreate(&start));
+                    cuda::check(cudaEventCreate(&stop));
+                    cuda::check(cudaEventRecord(start, stream));
+
+                    run();
+
+                    cuda::check(cudaEventRecord(stop, stream));
+                    cuda::check(cudaEventSynchronize(stop));
+                    cuda::check(cudaEventElapsedTime(&elapsed, start, stop));
+
+                    cudaEventDestroy(start);
+                    cudaEventDestroy(stop);
+
+                    return elapsed;
+                }
+
+                /**
+                 * Picks the configuration to launch a kernel with on the current
+                 * device. If the kernel has not yet been tuned for the device, and
+                 * tuning is enabled, all configurations are timed on the given
+                 * launcher's work, and the fastest one is picked and cached.
+                 * @tparam F The configurations' launcher type.
+                 * @param kernel The name of the kernel to be tuned.
+                 * @param labels The names of the kernel's configurations.
+                 * @param fallback The kernel's default configuration.
+                 * @param run The launcher of each configuration's sample work.
+                 * @param stream The stream the configurations are launched into.
+                 * @return The index of the configuration to be used.
+                 */
+                template <typename F>
+                inline auto pick(
+                        const std::string& kernel
+                    ,   const std::vector<std::string>& labels
+                    ,   size_t fallback
+                    ,   F&& run
+                    ,   cudaStream_t stream = 0
+                    )
+                -> size_t
+                {
+                    const auto cached = lookup(kernel);
+
+                    for(size_t i = 0; i < labels.size(); ++i)
+                        if(labels[i] == cached)
+                            return i;
+
+                    if(!enabled())
+                        return fallback;
+
+                    size_t best = fallback;
+                    float fastest = 0;
+
+                    // The default configuration is run once before any timing, so
+                    // the first configuration timed is not charged for warming up
+                    // the device nor for loading the kernels' modules.
+                    measure([&]() { run(fallback); }, stream);
+
+                    for(size_t i = 0; i < labels.size(); ++i) {
+                        const float elapsed = measure([&]() { run(i); }, stream);
+
+                        if(i == 0 || elapsed < fastest) {
+                            fastest = elapsed;
+                            best = i;
+                        }
+                    }
+
+                    store(kernel, labels[best]);
+                    return best;
+                }
+            #endif
+        }
+    }
+}
@@ -4,8 +4,10 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2018-present Rodrigo Siqueira
  */
+#include <cstdint>
 #include <iterator>
 
+#include "utils.hpp"
 #include "database.hpp"
 
 namespace museqa
@@ -17,15 +19,33 @@ namespace museqa
      */
     int database::anonymous = 0;
 
+    namespace
+    {
+        /**
+         * Hashes a key with the FNV-1a function.
+         * @param ptr The key's first character.
+         * @param size The key's length.
+         * @return The key's hash.
+         */
+        inline auto hash(const char *ptr, size_t size) noexcept -> uint64_t
+        {
+            uint64_t result = 0xcbf29ce484222325ull;
+
+            for(size_t i = 0; i < size; ++i)
+                result = (result ^ static_cast<unsigned char>(ptr[i])) * 0x100000001b3ull;
+
+            return result;
+        }
+    }
+
     /**
      * Adds all elements from another database into this instance.
      * @param db The database to merge into this instance.
      */
     void database::merge(const database& db)
     {
-        const size_t last = m_entries.size();
         m_entries.insert(m_entries.end(), db.begin(), db.end());
-        update_keys(last);
+        share(db);
     }
 
     /**
@@ -34,21 +54,62 @@ namespace museqa
      */
     void database::merge(database&& db)
     {
-        const size_t last = m_entries.size();
         m_entries.insert(m_entries.end(), std::make_move_iterator(db.begin()), std::make_move_iterator(db.end()));
-        db.m_indeces.clear();
-        update_keys(last);
+        share(db);
+
+        db.m_entries.clear();
+        db.m_index.clear();
+        db.m_indexed = 0;
     }
 
     /**
-     * Updates the indeces keys from the given starting index.
-     * @param index The entry index from which updates must start.
+     * Keeps the descriptions of another database's entries alive, so they can
+     * be referenced by this database's entries without being copied.
+     * @param db The database to share descriptions with.
      */
-    void database::update_keys(size_t index)
+    void database::share(const database& db)
     {
-        for(size_t total = count(); index < total; ++index) {
-            const auto& entry = m_entries[index];
-            m_indeces[entry.description] = index;
+        if(db.m_pool) m_shared.push_back(db.m_pool);
+        m_shared.insert(m_shared.end(), db.m_shared.begin(), db.m_shared.end());
+    }
+
+    /**
+     * Finds the offset of the last entry with the given key. The keys index is
+     * only built when the database is first searched, and it is incrementally
+     * updated with the entries added since. An open-addressing hash table is used,
+     * and each of its slots holds an entry's offset plus one, or zero if empty.
+     * @param ptr The key's first character.
+     * @param size The key's length.
+     * @return The entry's offset, or a negative value if not found.
+     */
+    auto database::find(const char *ptr, size_t size) const -> ptrdiff_t
+    {
+        const size_t total = count();
+
+        if(m_index.size() < 2 * total) {
+            size_t capacity = 16;
+            while(capacity < 4 * total) capacity <<= 1;
+
+            m_index.assign(capacity, 0);
+            m_indexed = 0;
+        }
+
+        const size_t mask = m_index.size() - 1;
+
+        for( ; m_indexed < total; ++m_indexed) {
+            const auto& key = m_entries[m_indexed].description;
+            size_t slot = hash(key.data(), key.size()) & mask;
+
+            while(m_index[slot] && !m_entries[m_index[slot] - 1].description.equals(key.data(), key.size()))
+                slot = (slot + 1) & mask;
+
+            m_index[slot] = uint32_t(m_indexed + 1);
         }
+
+        for(size_t slot = hash(ptr, size) & mask; m_index[slot]; slot = (slot + 1) & mask)
+            if(m_entries[m_index[slot] - 1].description.equals(ptr, size))
+                return m_index[slot] - 1;
+
+        return -1;
     }
 }
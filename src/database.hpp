@@ -6,17 +6,174 @@
  */
 #pragma once
 
-#include <map>
 #include <set>
+#include <memory>
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <cstring>
 
+#include "utils.hpp"
 #include "format.hpp"
 #include "sequence.hpp"
 #include "exception.hpp"
 
 namespace museqa
 {
+    namespace detail
+    {
+        namespace database
+        {
+            /**
+             * Stores the descriptions of a database's sequences side by side. The
+             * strings are appended to fixed-size chunks and are never moved, so they
+             * can be directly referenced for as long as the pool exists.
+             * @since 0.1.1
+             */
+            class pool
+            {
+                protected:
+                    std::vector<std::unique_ptr<char[]>> m_chunks;  /// The pool's memory chunks.
+                    size_t m_capacity = 0;                          /// The last chunk's capacity.
+                    size_t m_used = 0;                              /// The last chunk's used space.
+
+                public:
+                    enum : size_t { chunk_size = 1 << 16 };
+
+                    /**
+                     * Copies a string into the pool.
+                     * @param ptr The string's first character.
+                     * @param size The string's length.
+                     * @return The pooled string's first character.
+                     */
+                    inline auto store(const char *ptr, size_t size) -> const char *
+                    {
+                        if(!size) return "";
+
+                        if(m_used + size > m_capacity) {
+                            m_chunks.emplace_back(new char[m_capacity = utils::max<size_t>(chunk_size, size)]);
+                            m_used = 0;
+                        }
+
+                        char *target = m_chunks.back().get() + m_used;
+                        memcpy(target, ptr, size);
+                        m_used += size;
+
+                        return target;
+                    }
+            };
+
+            /**
+             * References a sequence's description stored within a pool. Copying a
+             * description does not copy the string, thus database entries are cheap
+             * to be copied between databases, as long as the pool is kept alive.
+             * @since 0.1.1
+             */
+            class label
+            {
+                protected:
+                    const char *m_ptr = "";                         /// The description's first character.
+                    size_t m_size = 0;                              /// The description's length.
+
+                public:
+                    inline constexpr label() noexcept = default;
+                    inline constexpr label(const label&) noexcept = default;
+                    inline constexpr label(label&&) noexcept = default;
+
+                    /**
+                     * References a pooled description.
+                     * @param ptr The description's first character.
+                     * @param size The description's length.
+                     */
+                    inline constexpr label(const char *ptr, size_t size) noexcept
+                    :   m_ptr {ptr}
+                    ,   m_size {size}
+                    {}
+
+                    inline label& operator=(const label&) noexcept = default;
+                    inline label& operator=(label&&) noexcept = default;
+
+                    /**
+                     * Checks whether the description is equal to the given string.
+                     * @param ptr The string's first character.
+                     * @param size The string's length.
+                     * @return Are both strings equal?
+                     */
+                    inline bool equals(const char *ptr, size_t size) const noexcept
+                    {
+                        return m_size == size && !memcmp(m_ptr, ptr, size);
+                    }
+
+                    /**
+                     * Compares the description with another string.
+                     * @param other The string to compare with.
+                     * @return Are both strings equal?
+                     */
+                    inline bool operator==(const label& other) const noexcept
+                    {
+                        return equals(other.m_ptr, other.m_size);
+                    }
+
+                    /**
+                     * Compares the description with another string.
+                     * @param other The string to compare with.
+                     * @return Are both strings equal?
+                     */
+                    inline bool operator==(const std::string& other) const noexcept
+                    {
+                        return equals(other.data(), other.size());
+                    }
+
+                    /**
+                     * Compares the description with another string.
+                     * @param other The string to compare with.
+                     * @return Are both strings different?
+                     */
+                    template <typename T>
+                    inline bool operator!=(const T& other) const noexcept
+                    {
+                        return !operator==(other);
+                    }
+
+                    /**
+                     * Copies the description into a string.
+                     * @return The description as a string.
+                     */
+                    inline operator std::string() const
+                    {
+                        return str();
+                    }
+
+                    /**
+                     * Gives access to the description's characters.
+                     * @return The description's first character.
+                     */
+                    inline auto data() const noexcept -> const char *
+                    {
+                        return m_ptr;
+                    }
+
+                    /**
+                     * Informs the description's length.
+                     * @return The description's length.
+                     */
+                    inline auto size() const noexcept -> size_t
+                    {
+                        return m_size;
+                    }
+
+                    /**
+                     * Copies the description into a string.
+                     * @return The description as a string.
+                     */
+                    inline auto str() const -> std::string
+                    {
+                        return std::string {m_ptr, m_size};
+                    }
+            };
+        }
+    }
+
     /**
      * Stores a list of sequences read from possibly different sources. The added
      * sequences can only be accessed via their respective identity or iterator.
@@ -26,6 +183,7 @@ namespace museqa
     {
         public:
             using element_type = sequence;                      /// The type of database's elements.
+            using description_type = detail::database::label;   /// The type of database's descriptions.
 
         public:
             /**
@@ -33,20 +191,25 @@ namespace museqa
              * @since 0.1.1
              */
             using entry_type = struct {
-                std::string description;
+                description_type description;
                 element_type contents;
             };
 
         protected:
             using underlying_type = std::vector<entry_type>;
-            using mapping_type = std::map<std::string, ptrdiff_t>;
+            using pool_type = std::shared_ptr<detail::database::pool>;
+            using index_type = std::vector<uint32_t>;
 
         private:
             static int anonymous;                               /// Unique global IDs for anonymous sequences.
 
         protected:
             underlying_type m_entries;                          /// The database's element storage.
-            mapping_type m_indeces;                             /// The elements' indeces mapping.
+            pool_type m_pool;                                   /// The pool of descriptions added to this database.
+            std::vector<pool_type> m_shared;                    /// The pools shared with other databases.
+
+            mutable index_type m_index;                         /// The lazily built keys index.
+            mutable size_t m_indexed = 0;                       /// The number of entries already indexed.
 
         public:
             inline database() noexcept = default;
@@ -78,28 +241,40 @@ namespace museqa
             }
 
             /**
-             * Gives access to a specific entry in database via its key.
+             * Gives access to a specific entry in database via its key. If many
+             * entries share the same key, the last one added is retrieved.
              * @param key The requested key to be retrieved from database.
              * @return The retrieved entry.
              */
             inline const entry_type& operator[](const std::string& key) const
             {
-                const auto entry = m_indeces.find(key);
-                enforce(entry != m_indeces.end(), "cannot find key in database");
-                return m_entries[entry->second];
+                const auto offset = find(key.data(), key.size());
+                enforce(offset >= 0, "cannot find key in database");
+                return m_entries[offset];
             }
 
             /**
              * Adds a new entry to database. The sequence's description will not
              * be, in any way, checked for uniqueness. Thus, if a sequence with
              * the same description is already known, it will be duplicated.
+             * @param ptr The sequence's description first character.
+             * @param size The sequence's description length.
+             * @param elem The element to be added to database.
+             */
+            inline void add(const char *ptr, size_t size, const element_type& elem)
+            {
+                if(!m_pool) m_pool = std::make_shared<detail::database::pool>();
+                m_entries.push_back({description_type {m_pool->store(ptr, size), size}, elem});
+            }
+
+            /**
+             * Adds a new entry to database.
              * @param description The sequence's description.
              * @param elem The element to be added to database.
              */
             inline void add(const std::string& description, const element_type& elem)
             {
-                m_indeces[description] = m_entries.size();
-                m_entries.push_back({description, elem});
+                add(description.data(), description.size(), elem);
             }
 
             /**
@@ -184,26 +359,42 @@ namespace museqa
         private:
             /**
              * Creates a new instance from selected elements of another database.
+             * The descriptions are not copied, but shared with the original database.
              * @param db The database to copy elements from.
              * @param entries The selected entries to copy.
              */
             template <typename T>
             inline explicit database(const database& db, const std::set<T>& entries)
             {
+                m_entries.reserve(entries.size());
+                share(db);
+
                 for(const auto& entry : entries)
-                    add(db[entry]);
+                    m_entries.push_back(db[entry]);
             }
 
+            void share(const database&);
+            auto find(const char *, size_t) const -> ptrdiff_t;
+    };
+
+    namespace fmt
+    {
+        /**
+         * Formats a database entry's description to be printed.
+         * @since 0.1.1
+         */
+        template <>
+        struct formatter<detail::database::label> : public adapter<std::string>
+        {
             /**
-             * Adds a new entry to database. If an entry with equal description
-             * already exists in the database, it'll be overriden.
-             * @param entry The entry to be added to database.
+             * Copies the description into a string.
+             * @param tgt The description to be formatted.
+             * @return The formatted description.
              */
-            inline void add(const entry_type& entry)
+            inline auto parse(const detail::database::label& tgt) -> return_type
             {
-                add(entry.description, entry.contents);
+                return adapt(tgt.str());
             }
-
-            void update_keys(size_t);
-    };
+        };
+    }
 }
@@ -71,27 +71,25 @@ namespace museqa
      * Compresses a character string into a buffer of encoded blocks.
      * @param ptr The pointer to string to encode.
      * @param size The size of given string.
+     * @param allocator The allocator to get the blocks' memory from.
      * @return The buffer of enconded blocks.
      */
-    encoder::buffer encoder::encode(const char *ptr, size_t size)
+    encoder::buffer encoder::encode(const char *ptr, size_t size, const museqa::allocator& allocator)
     {
-        static constexpr uint8_t shift[] = {1, 6, 11, 17, 22, 27};
-
         const auto full_blocks = size / encoder::block_size;
         const auto has_padding = size % encoder::block_size;
 
-        auto encoded = encoder::buffer::make(full_blocks + !!has_padding);
+        auto encoded = encoder::buffer::make(allocator, full_blocks + !!has_padding);
 
         for(size_t i = 0, n = 0; n < size; ++i) {
             // The last bit on a block indicates whether the block has padding.
-            encoder::block current = (n + encoder::block_size > size);
+            const bool padded = (n + encoder::block_size > size);
+            encoder::unit units[encoder::block_size];
 
-            for(uint8_t j = 0; j < encoder::block_size; ++j, ++n) {
-                const auto value = (n < size) ? encoder::encode(ptr[n]) : encoder::end;
-                current |= value << shift[j];
-            }
+            for(uint8_t j = 0; j < encoder::block_size; ++j, ++n)
+                units[j] = (n < size) ? encoder::encode(ptr[n]) : encoder::end;
 
-            encoded[i] = current;
+            encoded[i] = encoder::pack(units, padded);
         }
 
         return encoded;
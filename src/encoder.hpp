@@ -12,6 +12,7 @@
 #include "utils.hpp"
 #include "buffer.hpp"
 #include "format.hpp"
+#include "allocator.hpp"
 
 namespace museqa
 {
@@ -76,8 +77,41 @@ namespace museqa
             return access(tgt[offset / block_size], offset % block_size);
         }
 
+        /**
+         * Packs a group of units into a block. The block's least significant bit
+         * indicates whether the block has any padding.
+         * @param units The units to be packed, one for each of the block's offsets.
+         * @param padded Does the block contain any padding?
+         * @return The packed block.
+         */
+        __host__ __device__ inline block pack(const unit *units, bool padded) noexcept
+        {
+            static constexpr uint8_t shift[] = {1, 6, 11, 17, 22, 27};
+            block result = padded;
+
+            for(uint8_t i = 0; i < block_size; ++i)
+                result |= units[i] << shift[i];
+
+            return result;
+        }
+
+        /**
+         * Decodes a contiguous run of blocks into their units, in bulk. As every
+         * offset's shift is a constant and there are no dependencies between the
+         * blocks, the loop is vectorized by the compiler.
+         * @param blocks The blocks to be decoded.
+         * @param count The number of blocks to decode.
+         * @param out The buffer to write the units to, one per block offset.
+         */
+        __host__ __device__ inline void unpack(const block *blocks, size_t count, unit *out) noexcept
+        {
+            for(size_t i = 0; i < count; ++i, out += block_size)
+                for(uint8_t j = 0; j < block_size; ++j)
+                    out[j] = access(blocks[i], j);
+        }
+
         extern unit encode(char) noexcept;
-        extern buffer encode(const char *, size_t);
+        extern buffer encode(const char *, size_t, const museqa::allocator& = museqa::allocator::builtin<block[]>());
 
         extern char decode(unit);
         extern std::string decode(const buffer&);
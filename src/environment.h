@@ -142,3 +142,11 @@
     #define __museqa_runtime_host
   #endif
 #endif
+
+/*
+ * Indicates whether the software's hot paths should be instrumented by the tracing
+ * layer. Tracing is unavailable when running on Cython, as there is no cluster.
+ */
+#if defined(TRACING) && !defined(__museqa_runtime_cython)
+  #define __museqa_tracing
+#endif
@@ -11,6 +11,7 @@
 #include "io/io.hpp"
 #include "terminal.hpp"
 
+#include "io/dumper/database.hpp"
 #include "io/loader/database.hpp"
 
 namespace museqa
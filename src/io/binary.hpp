@@ -0,0 +1,85 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the layout of the binary pre-encoded database format.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Groups the definitions of the binary database format. A binary database
+         * file holds the sequences already encoded, so it can be memory mapped and
+         * used without any parsing. All values are stored in the host's native
+         * byte order, and every section starts at an offset aligned to 8 bytes.
+         *
+         * The file's sections are laid out in the following order:
+         *  - the header, identifying the file and locating all other sections;
+         *  - the views table, with the first block and size of each sequence;
+         *  - the blocks stream, with all encoded sequences side by side;
+         *  - the descriptions table, with the offset of each description;
+         *  - the descriptions' characters, without any terminators.
+         *
+         * The views table locates the sequences by their blocks' offsets within the
+         * stream, rather than by pointers, so the file does not depend on the address
+         * it is mapped at. The blocks stream is already contiguous, but the pairwise
+         * module's device database still rebuilds its references to the sequences.
+         * @since 0.1.1
+         */
+        namespace binary
+        {
+            /**
+             * The magic number identifying a binary database file.
+             * @since 0.1.1
+             */
+            static constexpr char magic[8] = {'M', 'U', 'S', 'E', 'Q', 'A', 'D', 'B'};
+
+            /**
+             * The binary database format's current version.
+             * @since 0.1.1
+             */
+            enum : uint64_t { version = 1 };
+
+            /**
+             * The binary database file's header.
+             * @since 0.1.1
+             */
+            struct header
+            {
+                char magic[8];                  /// The file's magic number.
+                uint64_t version;               /// The file format's version.
+                uint64_t size;                  /// The file's total size in bytes.
+                uint64_t count;                 /// The number of sequences in file.
+                uint64_t blocks;                /// The total number of encoded blocks.
+                uint64_t views;                 /// The views table's offset.
+                uint64_t stream;                /// The blocks stream's offset.
+                uint64_t descriptions;          /// The descriptions table's offset.
+            };
+
+            /**
+             * Locates a sequence within the blocks stream.
+             * @since 0.1.1
+             */
+            struct view
+            {
+                uint64_t displ;                 /// The sequence's first block.
+                uint64_t size;                  /// The sequence's number of blocks.
+            };
+
+            /**
+             * Aligns a file offset to the beginning of the next section.
+             * @param offset The offset to be aligned.
+             * @return The aligned offset.
+             */
+            inline auto align(uint64_t offset) noexcept -> uint64_t
+            {
+                return (offset + 7) & ~uint64_t(7);
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the layout of the compact binary guide tree format.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "phylogeny/phylogeny.cuh"
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Groups the definitions of the compact guide tree format. A compact guide
+         * tree file holds the tree's joins, so the tree can be rebuilt just as the
+         * phylogeny module has built it. All values are stored in the host's native
+         * byte order. The file is laid out as its header, followed by one join for
+         * each of the tree's inner nodes, in the ascending order of their references.
+         * A join is only ever made between nodes with lower references than its own.
+         * @since 0.1.1
+         */
+        namespace compact
+        {
+            /**
+             * The magic number identifying a compact guide tree file.
+             * @since 0.1.1
+             */
+            static constexpr char magic[8] = {'M', 'U', 'S', 'E', 'Q', 'A', 'G', 'T'};
+
+            /**
+             * The compact guide tree format's current version.
+             * @since 0.1.1
+             */
+            enum : uint64_t { version = 1 };
+
+            /**
+             * The compact guide tree file's header.
+             * @since 0.1.1
+             */
+            struct header
+            {
+                char magic[8];                  /// The file's magic number.
+                uint64_t version;               /// The file format's version.
+                uint64_t leaves;                /// The number of leaves in tree.
+            };
+
+            /**
+             * The join of two nodes into one of the tree's inner nodes.
+             * @since 0.1.1
+             */
+            struct join
+            {
+                uint32_t child[2];                              /// The joined nodes' references.
+                phylogeny::otu::distance_type distance[2];      /// The joined nodes' distances to their parent.
+            };
+        }
+    }
+}
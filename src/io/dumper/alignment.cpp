@@ -0,0 +1,405 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the dumper of multiple sequence alignments.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <string>
+#include <thread>
+#include <vector>
+#include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <zlib.h>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "exception.hpp"
+#include "dispatcher.hpp"
+
+#include "pgalign.cuh"
+#include "io/dumper/alignment.hpp"
+
+using namespace museqa;
+
+namespace
+{
+    /**
+     * Aliases the target functor into the anonymous namespace.
+     * @since 0.1.1
+     */
+    using fwriter = typename io::dumper<pgalign::conduit>::functor;
+
+    /*
+     * Keeps the list of available writers and their respective file extensions
+     * correspondence. Whenever a new writer is introduced, it must be listed.
+     */
+    static const dispatcher<fwriter> writer_dispatcher = {
+        {"fasta",       io::writer::fasta}
+    ,   {"fa",          io::writer::fasta}
+    ,   {"afa",         io::writer::fasta}
+    ,   {"aln",         io::writer::clustal}
+    ,   {"clustal",     io::writer::clustal}
+    ,   {"sto",         io::writer::stockholm}
+    ,   {"stockholm",   io::writer::stockholm}
+    ,   {"gz",          io::writer::gzip}
+    };
+
+    /*
+     * The writers' configuration parameters. The alignment is assembled in chunks
+     * of about the given size, and no line of residues is wider than the given width.
+     */
+    enum : size_t { chunk_size = 1 << 25 };
+    enum : size_t { line_width = 60 };
+
+    /**
+     * Writes the chunks of an output file. Every chunk is written by a background
+     * thread, so the next chunk can be assembled while the last one is written.
+     * Files whose names end with the gzip extension are compressed on the fly.
+     * @since 0.1.1
+     */
+    class sink
+    {
+        protected:
+            FILE *m_file = nullptr;             /// The plain output file.
+            gzFile m_gzip = nullptr;            /// The compressed output file.
+            std::thread m_thread;               /// The thread writing the last chunk.
+            std::string m_pending;              /// The chunk being written.
+            bool m_failed = false;              /// Has writing any of the chunks failed?
+
+        public:
+            /**
+             * Opens the output file to be written.
+             * @param filename The name of the file to write into.
+             */
+            inline explicit sink(const std::string& filename)
+            {
+                if(utils::extension(filename) == "gz") m_gzip = gzopen(filename.c_str(), "wb");
+                else                                   m_file = fopen(filename.c_str(), "wb");
+
+                enforce(m_file || m_gzip, "file cannot be written '%s'", filename);
+            }
+
+            inline sink(const sink&) = delete;
+            inline sink(sink&&) = delete;
+
+            inline ~sink()
+            {
+                close();
+            }
+
+            inline sink& operator=(const sink&) = delete;
+            inline sink& operator=(sink&&) = delete;
+
+            /**
+             * Hands a chunk over to be written. The chunk is swapped with the last
+             * written one, so their memory can be reused for the following chunk.
+             * @param chunk The chunk to be written.
+             */
+            inline void write(std::string& chunk)
+            {
+                wait();
+                std::swap(m_pending, chunk);
+                m_thread = std::thread {[this]() { flush(); }};
+            }
+
+            /**
+             * Waits for all chunks to be written and closes the file.
+             * @return Have all chunks been successfully written?
+             */
+            inline auto close() -> bool
+            {
+                wait();
+
+                if(m_file) m_failed |= fclose(m_file) != 0;
+                if(m_gzip) m_failed |= gzclose(m_gzip) != Z_OK;
+
+                m_file = nullptr;
+                m_gzip = nullptr;
+
+                return !m_failed;
+            }
+
+        protected:
+            /**
+             * Waits for the last chunk to be written.
+             */
+            inline void wait()
+            {
+                if(m_thread.joinable())
+                    m_thread.join();
+            }
+
+            /**
+             * Writes the pending chunk into the file. As zlib takes the size of
+             * each write as an integer, large chunks are compressed in pieces.
+             */
+            inline void flush() noexcept
+            {
+                const char *ptr = m_pending.data();
+                size_t size = m_pending.size();
+
+                if(m_file) m_failed |= fwrite(ptr, 1, size, m_file) != size;
+
+                for(size_t piece; m_gzip && size > 0; ptr += piece, size -= piece) {
+                    piece = utils::min<size_t>(size, 1 << 30);
+
+                    if(gzwrite(m_gzip, ptr, (unsigned) piece) != (int) piece) {
+                        m_failed = true;
+                        break;
+                    }
+                }
+            }
+    };
+
+    /**
+     * Describes an interleaved alignment format. The alignment is written in blocks
+     * of columns, each block with a line for every sequence, prefixed by its name.
+     * @since 0.1.1
+     */
+    struct interleaved
+    {
+        const char *header;                     /// The file's header.
+        const char *footer;                     /// The file's footer.
+        size_t indent;                          /// The minimum width of the names' column.
+        bool conservation;                      /// Does every block mark its conserved columns?
+    };
+
+    /**
+     * Extracts the name of a sequence from its description. Interleaved formats
+     * separate names from residues by spaces, so only the first word is taken.
+     * @param description The sequence's description.
+     * @param origin The sequence's index on the database.
+     * @return The sequence's name.
+     */
+    static auto name(const database::description_type& description, uint32_t origin) -> std::string
+    {
+        size_t size = 0;
+        while(size < description.size() && !isspace(description.data()[size])) ++size;
+        return size > 0 ? std::string {description.data(), size} : std::to_string(origin);
+    }
+
+    /**
+     * Writes an alignment in an interleaved format. The alignment is cut into
+     * windows of columns, each assembled into a single chunk, with a new window
+     * assembled while the last one is written. As the position of every line in
+     * the chunk is known beforehand, the chunk's lines can be decoded in parallel.
+     * @param conduit The profile-aligner module's conduit.
+     * @param filename The name of the file to write the alignment into.
+     * @param format The interleaved format's description.
+     * @return Has the alignment been successfully written?
+     */
+    static auto write(const pgalign::conduit& conduit, const std::string& filename, const interleaved& format)
+    -> bool
+    {
+        const auto& aligned = conduit.aligned;
+        const size_t count = aligned.count();
+        const size_t length = count > 0 ? aligned[0].length() : 0;
+        const char gap = encoder::decode(encoder::gap);
+
+        auto names = std::vector<std::string> (count);
+        size_t indent = format.indent;
+
+        for(size_t s = 0; s < count; ++s) {
+            names[s] = name(conduit.db[aligned.origin(s)].description, aligned.origin(s));
+            indent = utils::max(indent, names[s].size() + 1);
+        }
+
+        const size_t lines = count + format.conservation;
+        const size_t full = lines * (indent + line_width + 1) + 1;
+        const size_t window = utils::max<size_t>(chunk_size / full, 1) * line_width;
+
+        sink output {filename};
+        std::string chunk {format.header};
+
+        for(size_t first = 0; first < length; first += window) {
+            const size_t last = utils::min(length, first + window);
+            const size_t blocks = (last - first + line_width - 1) / line_width;
+            const size_t start = chunk.size();
+
+            const auto width = [&](size_t b) { return utils::min<size_t>(line_width, last - first - b * line_width); };
+            const auto line = [&](size_t b, size_t s) { return &chunk[start + b * full + s * (indent + width(b) + 1)]; };
+
+            chunk.resize(start + (blocks - 1) * full + lines * (indent + width(blocks - 1) + 1) + 1);
+
+            parallel::foreach(count, [&](const range<size_t>& partition, size_t) {
+                for(size_t s = partition.offset; s < partition.offset + partition.total; ++s)
+                    for(size_t b = 0; b < blocks; ++b) {
+                        char *ptr = line(b, s);
+                        const size_t column = first + b * line_width;
+
+                        memcpy(ptr, names[s].data(), names[s].size());
+                        memset(ptr + names[s].size(), ' ', indent - names[s].size());
+
+                        aligned[s].decode(ptr + indent, column, column + width(b));
+                        ptr[indent + width(b)] = '\n';
+                    }
+            });
+
+            if(format.conservation) {
+                parallel::foreach(last - first, [&](const range<size_t>& partition, size_t) {
+                    for(size_t c = partition.offset; c < partition.offset + partition.total; ++c) {
+                        const size_t b = c / line_width, j = c % line_width;
+                        const size_t stride = indent + width(b) + 1;
+                        const char *column = line(b, 0) + indent + j;
+
+                        bool conserved = column[0] != gap;
+
+                        for(size_t s = 1; conserved && s < count; ++s)
+                            conserved = column[s * stride] == column[0];
+
+                        line(b, count)[indent + j] = conserved ? '*' : ' ';
+                    }
+                });
+            }
+
+            for(size_t b = 0; b < blocks; ++b) {
+                if(format.conservation) {
+                    memset(line(b, count), ' ', indent);
+                    line(b, count)[indent + width(b)] = '\n';
+                }
+
+                line(b, lines)[0] = '\n';
+            }
+
+            output.write(chunk);
+            chunk.clear();
+        }
+
+        chunk += format.footer;
+        output.write(chunk);
+
+        return output.close();
+    }
+}
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Retrives a writer from its identification name or file extension.
+         * @param ext The file extension to get the corresponding writer of.
+         * @return The retrieved writer functor.
+         */
+        auto dumper<pgalign::conduit>::factory(const std::string& ext) const -> fwriter
+        try {
+            return writer_dispatcher[ext];
+        } catch(const exception&) {
+            throw exception {"unknown alignment writer '%s'", ext};
+        }
+
+        /**
+         * Informs the list of all available writers.
+         * @return The list of writers names.
+         */
+        auto dumper<pgalign::conduit>::list() const noexcept -> const std::vector<std::string>&
+        {
+            return writer_dispatcher.list();
+        }
+
+        /**
+         * Writes an alignment into an aligned FASTA file. Sequences are gathered
+         * into chunks, and as the size of every sequence's record is known in
+         * advance, the records within a chunk are decoded in parallel, straight
+         * into the chunk, while the last chunk is still being written.
+         * @param conduit The profile-aligner module's conduit.
+         * @param filename The name of the file to write the alignment into.
+         * @return Has the alignment been successfully written?
+         */
+        auto writer::fasta(const pgalign::conduit& conduit, const std::string& filename) -> bool
+        {
+            const auto& aligned = conduit.aligned;
+            const size_t count = aligned.count();
+
+            auto offset = std::vector<size_t> {};
+            auto record = [&](size_t k) -> const database::entry_type& { return conduit.db[aligned.origin(k)]; };
+
+            sink output {filename};
+            std::string chunk;
+
+            for(size_t first = 0, last = 0; first < count; first = last) {
+                offset.assign(1, 0);
+
+                for(last = first; last < count && (last == first || offset.back() < chunk_size); ++last) {
+                    const size_t length = aligned[last].length();
+                    const size_t lines = (length + line_width - 1) / line_width;
+                    offset.push_back(offset.back() + record(last).description.size() + length + lines + 2);
+                }
+
+                chunk.resize(offset.back());
+
+                parallel::foreach(last - first, [&](const range<size_t>& partition, size_t) {
+                    for(size_t k = partition.offset; k < partition.offset + partition.total; ++k) {
+                        const auto& sequence = aligned[first + k];
+                        const auto& description = record(first + k).description;
+                        char *ptr = &chunk[offset[k]];
+
+                        *ptr++ = '>';
+                        memcpy(ptr, description.data(), description.size());
+                        ptr += description.size();
+                        *ptr++ = '\n';
+
+                        for(size_t c = 0, length = sequence.length(); c < length; c += line_width) {
+                            const size_t width = utils::min<size_t>(line_width, length - c);
+                            sequence.decode(ptr, c, c + width);
+                            ptr += width;
+                            *ptr++ = '\n';
+                        }
+                    }
+                });
+
+                output.write(chunk);
+            }
+
+            return output.close();
+        }
+
+        /**
+         * Writes an alignment into a Clustal file. Every block of columns is
+         * followed by a line marking its columns conserved among all sequences.
+         * @param conduit The profile-aligner module's conduit.
+         * @param filename The name of the file to write the alignment into.
+         * @return Has the alignment been successfully written?
+         */
+        auto writer::clustal(const pgalign::conduit& conduit, const std::string& filename) -> bool
+        {
+            return write(conduit, filename, {"CLUSTAL W multiple sequence alignment\n\n", "", 16, true});
+        }
+
+        /**
+         * Writes an alignment into a Stockholm file.
+         * @param conduit The profile-aligner module's conduit.
+         * @param filename The name of the file to write the alignment into.
+         * @return Has the alignment been successfully written?
+         */
+        auto writer::stockholm(const pgalign::conduit& conduit, const std::string& filename) -> bool
+        {
+            return write(conduit, filename, {"# STOCKHOLM 1.0\n\n", "//\n", 1, false});
+        }
+
+        /**
+         * Writes an alignment into a gzip compressed file. The file's format is
+         * picked by the extension before the gzip one, and just as compressed
+         * sequence files are read, the alignment is written as FASTA by default.
+         * @param conduit The profile-aligner module's conduit.
+         * @param filename The name of the file to write the alignment into.
+         * @return Has the alignment been successfully written?
+         */
+        auto writer::gzip(const pgalign::conduit& conduit, const std::string& filename) -> bool
+        {
+            const auto inner = filename.substr(0, filename.find_last_of('.'));
+            const auto ext = inner.find('.') != std::string::npos ? utils::extension(inner) : std::string {};
+
+            if(ext != "gz" && writer_dispatcher.has(ext))
+                return writer_dispatcher[ext] (conduit, filename);
+
+            return writer::fasta(conduit, filename);
+        }
+    }
+}
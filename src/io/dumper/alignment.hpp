@@ -0,0 +1,42 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements a dumper for multiple sequence alignments.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "pgalign.cuh"
+#include "io/dumper.hpp"
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Specializes a dumper for the profile-aligner module's conduit, as the
+         * sequences' descriptions are only known by the database it carries.
+         * @since 0.1.1
+         */
+        template <>
+        struct dumper<pgalign::conduit> : public base::dumper<pgalign::conduit>
+        {
+            auto factory(const std::string&) const -> functor override;
+            auto list() const noexcept -> const std::vector<std::string>& override;
+        };
+
+        namespace writer
+        {
+            /*
+             * Declaration of all available writers for the target datatype.
+             */
+            extern auto fasta(const pgalign::conduit&, const std::string&) -> bool;
+            extern auto clustal(const pgalign::conduit&, const std::string&) -> bool;
+            extern auto stockholm(const pgalign::conduit&, const std::string&) -> bool;
+            extern auto gzip(const pgalign::conduit&, const std::string&) -> bool;
+        }
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the dumper of sequences database.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+#include <database.hpp>
+#include "exception.hpp"
+#include "dispatcher.hpp"
+
+#include "io/binary.hpp"
+#include "io/dumper/database.hpp"
+
+using namespace museqa;
+
+namespace
+{
+    /**
+     * Aliases the target functor into the anonymous namespace.
+     * @since 0.1.1
+     */
+    using fwriter = typename io::dumper<database>::functor;
+
+    /*
+     * Keeps the list of available writers and their respective file extensions
+     * correspondence. Whenever a new writer is introduced, it must be listed.
+     */
+    static const dispatcher<fwriter> writer_dispatcher = {
+        {"mdb",   io::writer::binary}
+    };
+
+    /**
+     * Pads the file with zeroes until the beginning of the next section.
+     * @param file The file being written.
+     * @param offset The file's current offset.
+     * @return The next section's offset.
+     */
+    static auto pad(std::ofstream& file, uint64_t offset) -> uint64_t
+    {
+        static constexpr char zeroes[8] = {};
+        const auto aligned = io::binary::align(offset);
+
+        file.write(zeroes, aligned - offset);
+        return aligned;
+    }
+}
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Retrives a writer from its identification name or file extension.
+         * @param ext The file extension to get the corresponding writer of.
+         * @return The retrieved writer functor.
+         */
+        auto dumper<database>::factory(const std::string& ext) const -> fwriter
+        try {
+            return writer_dispatcher[ext];
+        } catch(const exception&) {
+            throw exception {"unknown database writer '%s'", ext};
+        }
+
+        /**
+         * Informs the list of all available writers.
+         * @return The list of writers names.
+         */
+        auto dumper<database>::list() const noexcept -> const std::vector<std::string>&
+        {
+            return writer_dispatcher.list();
+        }
+
+        /**
+         * Writes a database into a binary database file. The sequences are written
+         * already encoded, so the file can be loaded back without any parsing.
+         * @param db The database to be written.
+         * @param filename The name of the file to write the database into.
+         * @return Has the database been successfully written?
+         */
+        auto writer::binary(const database& db, const std::string& filename) -> bool
+        {
+            std::ofstream file (filename, std::ofstream::binary | std::ofstream::trunc);
+            enforce(!file.fail(), "file cannot be written '%s'", filename);
+
+            const uint64_t count = db.count();
+            auto views = std::vector<binary::view> (count);
+            auto offsets = std::vector<uint64_t> (count + 1, 0);
+
+            for(uint64_t i = 0, displ = 0; i < count; ++i) {
+                views[i] = {displ, db[i].contents.size()};
+                offsets[i + 1] = offsets[i] + db[i].description.size();
+                displ += views[i].size;
+            }
+
+            binary::header header;
+            memcpy(header.magic, binary::magic, sizeof(header.magic));
+
+            header.version      = binary::version;
+            header.count        = count;
+            header.blocks       = count ? views.back().displ + views.back().size : 0;
+            header.views        = binary::align(sizeof(binary::header));
+            header.stream       = binary::align(header.views + count * sizeof(binary::view));
+            header.descriptions = binary::align(header.stream + header.blocks * sizeof(encoder::block));
+            header.size         = header.descriptions + (count + 1) * sizeof(uint64_t) + offsets.back();
+
+            uint64_t offset = sizeof(binary::header);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+            offset = pad(file, offset) + count * sizeof(binary::view);
+            file.write(reinterpret_cast<const char *>(views.data()), count * sizeof(binary::view));
+
+            offset = pad(file, offset);
+
+            for(const auto& entry : db) {
+                const auto size = entry.contents.size() * sizeof(encoder::block);
+                file.write(reinterpret_cast<const char *>(entry.contents.raw()), size);
+                offset += size;
+            }
+
+            offset = pad(file, offset);
+            file.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+            for(const auto& entry : db)
+                file.write(entry.description.data(), entry.description.size());
+
+            file.close();
+            return !file.fail();
+        }
+    }
+}
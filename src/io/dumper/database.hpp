@@ -0,0 +1,38 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements a dumper for sequences database.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <database.hpp>
+#include "io/dumper.hpp"
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Specializes a dumper for our sequence database type.
+         * @since 0.1.1
+         */
+        template <>
+        struct dumper<database> : public base::dumper<database>
+        {
+            auto factory(const std::string&) const -> functor override;
+            auto list() const noexcept -> const std::vector<std::string>& override;
+        };
+
+        namespace writer
+        {
+            /*
+             * Declaration of all available writers for the target datatype.
+             */
+            extern auto binary(const database&, const std::string&) -> bool;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the dumper of phylogenetic guide trees.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "utils.hpp"
+#include "exception.hpp"
+#include "dispatcher.hpp"
+
+#include "io/compact.hpp"
+#include "io/dumper/guidetree.hpp"
+
+using namespace museqa;
+
+namespace
+{
+    /**
+     * Aliases the target functor into the anonymous namespace.
+     * @since 0.1.1
+     */
+    using fwriter = typename io::dumper<phylogeny::guidetree>::functor;
+
+    /*
+     * Keeps the list of available writers and their respective file extensions
+     * correspondence. Whenever a new writer is introduced, it must be listed.
+     */
+    static const dispatcher<fwriter> writer_dispatcher = {
+        {"nwk",     io::writer::newick}
+    ,   {"newick",  io::writer::newick}
+    ,   {"tre",     io::writer::newick}
+    ,   {"mgt",     io::writer::compact}
+    };
+}
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Retrives a writer from its identification name or file extension.
+         * @param ext The file extension to get the corresponding writer of.
+         * @return The retrieved writer functor.
+         */
+        auto dumper<phylogeny::guidetree>::factory(const std::string& ext) const -> fwriter
+        try {
+            return writer_dispatcher[ext];
+        } catch(const exception&) {
+            throw exception {"unknown guide tree writer '%s'", ext};
+        }
+
+        /**
+         * Informs the list of all available writers.
+         * @return The list of writers names.
+         */
+        auto dumper<phylogeny::guidetree>::list() const noexcept -> const std::vector<std::string>&
+        {
+            return writer_dispatcher.list();
+        }
+
+        /**
+         * Writes a guide tree into a Newick file. Leaves are labeled by the index
+         * of their sequence in the database, and every branch is written with its
+         * length, with enough digits for the lengths to be read back exactly. As
+         * trees may be very deep, nodes are visited without any recursion.
+         * @param tree The guide tree to be written.
+         * @param filename The name of the file to write the tree into.
+         * @return Has the tree been successfully written?
+         */
+        auto writer::newick(const phylogeny::guidetree& tree, const std::string& filename) -> bool
+        {
+            std::ofstream file (filename, std::ofstream::trunc);
+            enforce(!file.fail(), "file cannot be written '%s'", filename);
+
+            const size_t leaves = tree.leaves().size();
+            file.precision(std::numeric_limits<phylogeny::otu::distance_type>::max_digits10);
+
+            if(leaves > 0) {
+                const auto root = tree.root().id;
+                auto stack = std::vector<std::pair<phylogeny::oturef, int>> {{root, 0}};
+
+                while(!stack.empty()) {
+                    const auto ref = stack.back().first;
+                    const auto& node = tree[ref];
+
+                    if(ref >= leaves && stack.back().second < 2) {
+                        const int next = stack.back().second++;
+                        file << (next ? ',' : '(');
+                        stack.push_back({node.child[next], 0});
+                        continue;
+                    }
+
+                    if(ref >= leaves) file << ')';
+                    else              file << ref;
+
+                    if(ref != root) file << ':' << node.distance;
+                    stack.pop_back();
+                }
+            }
+
+            file << ";\n";
+            file.close();
+
+            return !file.fail();
+        }
+
+        /**
+         * Writes a guide tree into a compact guide tree file. The tree's inner
+         * nodes are written in the order they have been created in.
+         * @param tree The guide tree to be written.
+         * @param filename The name of the file to write the tree into.
+         * @return Has the tree been successfully written?
+         */
+        auto writer::compact(const phylogeny::guidetree& tree, const std::string& filename) -> bool
+        {
+            std::ofstream file (filename, std::ofstream::binary | std::ofstream::trunc);
+            enforce(!file.fail(), "file cannot be written '%s'", filename);
+
+            const size_t leaves = tree.leaves().size();
+            auto joins = std::vector<io::compact::join> (leaves > 0 ? leaves - 1 : 0);
+
+            for(size_t i = 0; i < joins.size(); ++i) {
+                const auto& node = tree[phylogeny::oturef(leaves + i)];
+
+                for(size_t k = 0; k < 2; ++k) {
+                    joins[i].child[k] = (uint32_t) node.child[k];
+                    joins[i].distance[k] = tree[node.child[k]].distance;
+                }
+            }
+
+            io::compact::header header;
+            memcpy(header.magic, io::compact::magic, sizeof(header.magic));
+
+            header.version = io::compact::version;
+            header.leaves  = leaves;
+
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(joins.data()), joins.size() * sizeof(io::compact::join));
+
+            file.close();
+            return !file.fail();
+        }
+    }
+}
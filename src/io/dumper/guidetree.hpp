@@ -0,0 +1,39 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements a dumper for phylogenetic guide trees.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "io/dumper.hpp"
+#include "phylogeny/phylogeny.cuh"
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Specializes a dumper for the phylogeny module's guide tree type.
+         * @since 0.1.1
+         */
+        template <>
+        struct dumper<phylogeny::guidetree> : public base::dumper<phylogeny::guidetree>
+        {
+            auto factory(const std::string&) const -> functor override;
+            auto list() const noexcept -> const std::vector<std::string>& override;
+        };
+
+        namespace writer
+        {
+            /*
+             * Declaration of all available writers for the target datatype.
+             */
+            extern auto newick(const phylogeny::guidetree&, const std::string&) -> bool;
+            extern auto compact(const phylogeny::guidetree&, const std::string&) -> bool;
+        }
+    }
+}
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 
+#include "trace.hpp"
 #include "utils.hpp"
 #include "functor.hpp"
 
@@ -45,6 +46,8 @@ namespace museqa
                  */
                 inline T load(const std::string& fname, const std::string& ext = {}) const
                 {
+                    trace::scope span {"io::load", "io"};
+
                     auto fext = ext.size() ? ext : utils::extension(fname);
                     auto func = factory(fext);
                     return func (fname);
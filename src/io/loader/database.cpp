@@ -31,6 +31,9 @@ namespace
     static const dispatcher<fparser> parser_dispatcher = {
         {"fa",    io::parser::fasta}
     ,   {"fasta", io::parser::fasta}
+    ,   {"gz",    io::parser::gzip}
+    ,   {"bgz",   io::parser::gzip}
+    ,   {"mdb",   io::parser::binary}
     };
 }
 
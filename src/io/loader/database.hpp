@@ -34,6 +34,9 @@ namespace museqa
              * Declaration of all available parsers to the target datatype. 
              */
             extern auto fasta(const std::string&) -> database;
+            extern auto fasta(const char *, size_t) -> database;
+            extern auto gzip(const std::string&) -> database;
+            extern auto binary(const std::string&) -> database;
         }
     }
 }
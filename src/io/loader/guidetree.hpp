@@ -0,0 +1,40 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements a loader for phylogenetic guide trees.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "io/loader.hpp"
+#include "phylogeny/phylogeny.cuh"
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Specializes a loader for the phylogeny module's guide tree type.
+         * @since 0.1.1
+         */
+        template <>
+        struct loader<phylogeny::guidetree> : public base::loader<phylogeny::guidetree>
+        {
+            auto factory(const std::string&) const -> functor override;
+            auto validate(const std::string&) const noexcept -> bool override;
+            auto list() const noexcept -> const std::vector<std::string>& override;
+        };
+
+        namespace parser
+        {
+            /*
+             * Declaration of all available parsers to the target datatype.
+             */
+            extern auto newick(const std::string&) -> phylogeny::guidetree;
+            extern auto compact(const std::string&) -> phylogeny::guidetree;
+        }
+    }
+}
@@ -0,0 +1,132 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the binary pre-encoded parser of sequences database.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "encoder.hpp"
+#include "pointer.hpp"
+#include "database.hpp"
+#include "sequence.hpp"
+#include "allocator.hpp"
+#include "exception.hpp"
+
+#include "io/binary.hpp"
+#include "io/loader/database.hpp"
+
+using namespace museqa;
+
+namespace
+{
+    /**
+     * The allocator for a memory mapped binary database. The mapping is never
+     * allocated through it, but it is unmapped as soon as it is no longer used
+     * by any of the sequences referencing it. As the mapping starts with the
+     * file's header, its size can be found out when it must be unmapped.
+     * @since 0.1.1
+     */
+    static const museqa::allocator mapping_allocator = {
+        [](void **ptr, size_t, size_t) { *ptr = nullptr; }
+    ,   [](void *ptr) { munmap(ptr, static_cast<io::binary::header *>(ptr)->size); }
+    };
+
+    /**
+     * Maps a binary database file into memory, and checks it is well-formed.
+     * @param filename The name of the file to be mapped.
+     * @return The file's mapped contents.
+     */
+    static auto map(const std::string& filename) -> encoder::buffer
+    {
+        struct stat info;
+        int fd = open(filename.c_str(), O_RDONLY);
+
+        enforce(fd >= 0, "file does not exist or cannot be read '%s'", filename);
+
+        const size_t size = (fstat(fd, &info) == 0) ? info.st_size : 0;
+        void *ptr = (size >= sizeof(io::binary::header))
+            ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+            : MAP_FAILED;
+
+        close(fd);
+        enforce(ptr != MAP_FAILED, "file is not a valid binary database '%s'", filename);
+
+        const auto *header = static_cast<const io::binary::header *>(ptr);
+
+        if(memcmp(header->magic, io::binary::magic, sizeof(header->magic)) || header->size != size) {
+            munmap(ptr, size);
+            throw exception {"file is not a valid binary database '%s'", filename};
+        }
+
+        auto blocks = static_cast<encoder::block *>(ptr);
+        return encoder::buffer {pointer<encoder::block[]> {blocks, mapping_allocator}, size / sizeof(encoder::block)};
+    }
+
+    /**
+     * Gives access to a section of the mapped file.
+     * @tparam T The type of the section's elements.
+     * @param file The mapped file.
+     * @param offset The section's offset.
+     * @param count The number of elements in the section.
+     * @return The pointer to the section's first element.
+     */
+    template <typename T>
+    inline auto section(const encoder::buffer& file, uint64_t offset, uint64_t count) -> const T *
+    {
+        const uint64_t size = reinterpret_cast<const io::binary::header *>(file.raw())->size;
+        enforce(offset <= size && count <= (size - offset) / sizeof(T), "corrupted binary database");
+        return reinterpret_cast<const T *>(reinterpret_cast<const char *>(file.raw()) + offset);
+    }
+}
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Loads a binary database file. The file is memory mapped, and its
+         * sequences reference their blocks directly within the mapping, so no
+         * sequence must ever be decoded, encoded or copied.
+         * @param filename The name of the file to be loaded.
+         * @return The sequences loaded from file.
+         */
+        auto parser::binary(const std::string& filename) -> database
+        {
+            auto file = ::map(filename);
+            const auto& header = *section<binary::header>(file, 0, 1);
+
+            enforce(header.version == binary::version, "unsupported binary database version '%s'", filename);
+
+            const auto *views = section<binary::view>(file, header.views, header.count);
+            const auto *offsets = section<uint64_t>(file, header.descriptions, header.count + 1);
+            const auto *names = section<char>(file, header.descriptions + (header.count + 1) * sizeof(uint64_t), offsets[header.count]);
+
+            enforce(header.stream % sizeof(encoder::block) == 0, "corrupted binary database");
+            section<encoder::block>(file, header.stream, header.blocks);
+
+            database result {header.count};
+            const size_t stream = header.stream / sizeof(encoder::block);
+
+            for(size_t i = 0; i < header.count; ++i) {
+                enforce(views[i].displ + views[i].size <= header.blocks, "corrupted binary database");
+                enforce(offsets[i] <= offsets[i + 1] && offsets[i + 1] <= offsets[header.count], "corrupted binary database");
+
+                result.add(
+                        names + offsets[i]
+                    ,   offsets[i + 1] - offsets[i]
+                    ,   views[i].size ? sequence {file.offset(stream + views[i].displ), views[i].size} : sequence {}
+                    );
+            }
+
+            return result;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the compact binary parser of phylogenetic guide trees.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "exception.hpp"
+
+#include "io/compact.hpp"
+#include "io/loader/guidetree.hpp"
+#include "phylogeny/njoining/star.cuh"
+
+using namespace museqa;
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Loads a compact guide tree file. The tree is rebuilt by replaying the
+         * file's joins, in the same order they have been made when it was built.
+         * @param filename The name of the file to be loaded.
+         * @return The guide tree loaded from file.
+         */
+        auto parser::compact(const std::string& filename) -> phylogeny::guidetree
+        {
+            std::ifstream file (filename, std::ifstream::binary);
+            enforce(!file.fail(), "file does not exist or cannot be read '%s'", filename);
+
+            io::compact::header header;
+            file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+            enforce(
+                    !file.fail() && !memcmp(header.magic, io::compact::magic, sizeof(header.magic))
+                ,   "file is not a valid guide tree '%s'", filename
+                );
+
+            enforce(header.version == io::compact::version, "unsupported guide tree version '%s'", filename);
+            enforce(header.leaves != 1 && header.leaves < (uint64_t(1) << 31), "file is not a valid guide tree '%s'", filename);
+
+            if(header.leaves == 0)
+                return phylogeny::guidetree {};
+
+            const uint32_t leaves = (uint32_t) header.leaves;
+
+            auto joins = std::vector<io::compact::join> (leaves - 1);
+            auto joined = std::vector<bool> (2 * leaves - 1, false);
+
+            file.read(reinterpret_cast<char *>(joins.data()), joins.size() * sizeof(io::compact::join));
+            enforce(!file.fail(), "file is not a valid guide tree '%s'", filename);
+
+            auto tree = phylogeny::njoining::star::make(leaves);
+
+            for(uint32_t i = 0; i < joins.size(); ++i) {
+                const auto parent = (phylogeny::oturef) (leaves + i);
+                const auto& join = joins[i];
+
+                for(size_t k = 0; k < 2; ++k) {
+                    enforce(join.child[k] < parent && !joined[join.child[k]], "corrupted guide tree '%s'", filename);
+                    joined[join.child[k]] = true;
+                }
+
+                tree.join(parent, {join.child[0], join.distance[0]}, {join.child[1], join.distance[1]});
+            }
+
+            return tree;
+        }
+    }
+}
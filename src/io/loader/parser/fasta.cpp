@@ -6,9 +6,18 @@
  */
 #include <string>
 #include <vector>
-#include <fstream>
+#include <cstring>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.hpp"
+#include "encoder.hpp"
 #include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
 #include "exception.hpp"
 
 #include "io/loader/database.hpp"
@@ -18,31 +27,290 @@ using namespace museqa;
 namespace
 {
     /**
-     * Extracts a sequence out of the file and puts it into a database.
-     * @param file The file to read sequence from.
-     * @param db The destination database for the sequence.
-     * @return Could a sequence be extracted?
+     * Maps a whole file into memory for reading. The file's contents are then
+     * read directly from the OS page cache, without being copied into any buffer.
+     * A region already holding a file's contents may also be parsed in place.
+     * @since 0.1.1
+     */
+    class mapping
+    {
+        protected:
+            const char *m_data = nullptr;           /// The file's mapped contents.
+            size_t m_size = 0;                      /// The file's size.
+            bool m_owned = true;                    /// Has the file been mapped by this instance?
+
+        public:
+            /**
+             * Maps the given file into memory.
+             * @param filename The name of the file to be mapped.
+             */
+            inline explicit mapping(const std::string& filename)
+            {
+                struct stat info;
+                int fd = open(filename.c_str(), O_RDONLY);
+
+                enforce(fd >= 0, "file does not exist or cannot be read '%s'", filename);
+
+                if(fstat(fd, &info) == 0 && (m_size = info.st_size) > 0) {
+                    void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    m_data = (ptr != MAP_FAILED) ? static_cast<const char *>(ptr) : nullptr;
+                    if(m_data) madvise(ptr, m_size, MADV_SEQUENTIAL);
+                }
+
+                close(fd);
+                enforce(m_data || !m_size, "file cannot be mapped into memory '%s'", filename);
+            }
+
+            /**
+             * Borrows a region of memory already holding a file's contents. The
+             * region is not copied, thus it must outlive the mapping.
+             * @param data The region's contents.
+             * @param size The region's size in bytes.
+             */
+            inline explicit mapping(const char *data, size_t size) noexcept
+            :   m_data {data}
+            ,   m_size {size}
+            ,   m_owned {false}
+            {}
+
+            mapping(const mapping&) = delete;
+            mapping& operator=(const mapping&) = delete;
+
+            /**
+             * Unmaps the file from memory, if it has been mapped by this instance.
+             */
+            inline ~mapping()
+            {
+                if(m_data && m_owned) munmap(const_cast<char *>(m_data), m_size);
+            }
+
+            /**
+             * Gives access to the file's mapped contents.
+             * @return The file's contents pointer.
+             */
+            inline auto data() const noexcept -> const char *
+            {
+                return m_data;
+            }
+
+            /**
+             * Informs the size of the mapped file.
+             * @return The file's size in bytes.
+             */
+            inline auto size() const noexcept -> size_t
+            {
+                return m_size;
+            }
+    };
+
+    /**
+     * Locates a sequence record within the mapped file. A record is composed by
+     * its description line, followed by the lines with the sequence contents.
+     * @since 0.1.1
+     */
+    struct record
+    {
+        size_t head;                        /// The description's first character offset.
+        size_t body;                        /// The sequence contents' first character offset.
+        size_t tail;                        /// The offset of the record's end.
+        size_t length;                      /// The number of units in the sequence.
+        size_t displ;                       /// The sequence's first block in the arena.
+    };
+
+    /**
+     * Finds the end of the line starting at the given offset.
+     * @param file The mapped file.
+     * @param offset The line's first character offset.
+     * @param limit The offset at which the search must stop.
+     * @return The offset of the line's end character.
+     */
+    inline auto endline(const mapping& file, size_t offset, size_t limit) noexcept -> size_t
+    {
+        const void *found = offset < limit
+            ? memchr(file.data() + offset, '\n', limit - offset)
+            : nullptr;
+
+        return found ? static_cast<const char *>(found) - file.data() : limit;
+    }
+
+    /**
+     * Informs the length of a line, not counting its line feed characters.
+     * @param file The mapped file.
+     * @param offset The line's first character offset.
+     * @param end The line's end character offset.
+     * @return The line's length.
+     */
+    inline auto linelength(const mapping& file, size_t offset, size_t end) noexcept -> size_t
+    {
+        return (end > offset && file.data()[end - 1] == '\r') ? end - offset - 1 : end - offset;
+    }
+
+    /**
+     * Finds all records in file. As a description line must always start with
+     * a ">", the file is split into chunks which are scanned in parallel for line
+     * beginnings with this symbol. Any characters before the first one are ignored.
+     * @param file The mapped file.
+     * @return The records found in file, in the order they appear.
+     */
+    static auto find(const mapping& file) -> std::vector<record>
+    {
+        const auto& workers = parallel::global();
+        auto found = std::vector<std::vector<record>> (workers.size());
+        std::vector<record> result;
+
+        parallel::foreach(file.size(), [&](const range<size_t>& chunk, size_t id) {
+            const char *data = file.data();
+
+            for(size_t i = chunk.offset; i < chunk.offset + chunk.total; ++i) {
+                const void *next = memchr(data + i, '>', chunk.offset + chunk.total - i);
+                if(!next) break;
+
+                i = static_cast<const char *>(next) - data;
+
+                if(i == 0 || data[i - 1] == '\n')
+                    found[id].push_back(record {i + 1, 0, 0, 0, 0});
+            }
+        });
+
+        for(const auto& partial : found)
+            result.insert(result.end(), partial.begin(), partial.end());
+
+        for(size_t i = 0; i < result.size(); ++i)
+            result[i].tail = (i + 1 < result.size()) ? result[i + 1].head - 1 : file.size();
+
+        return result;
+    }
+
+    /**
+     * Measures the records' sequences, so their encoded blocks can be placed side
+     * by side in a single arena. As in the file format, a sequence's contents end
+     * at the first blank line, and any lines after it are ignored.
+     * @param file The mapped file.
+     * @param records The records to be measured.
+     * @return The total number of blocks needed by all sequences.
+     */
+    static auto measure(const mapping& file, std::vector<record>& records) -> size_t
+    {
+        size_t total = 0;
+
+        parallel::foreach(records.size(), [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i) {
+                auto& current = records[i];
+                current.body = utils::min(endline(file, current.head, current.tail) + 1, current.tail);
+
+                for(size_t offset = current.body, end; offset < current.tail; offset = end + 1) {
+                    const auto length = linelength(file, offset, end = endline(file, offset, current.tail));
+                    if(!length) { current.tail = offset; break; }
+                    current.length += length;
+                }
+            }
+        });
+
+        for(auto& current : records) {
+            current.displ = total;
+            total += (current.length + encoder::block_size - 1) / encoder::block_size;
+        }
+
+        return total;
+    }
+
+    /**
+     * Translates every possible file character into its encoded unit. As the file
+     * might be huge, looking units up is much cheaper than encoding each character.
+     * @since 0.1.1
      */
-    static bool extract_to_db(std::fstream& file, database& db)
+    struct translator
     {
-        std::string line, contents;
-        std::string description;
-
-        while(line.size() < 1 || line[0] != 0x3E) {
-            // We must ignore all characters on file until a ">" is seen. This
-            // symbol indicates the beginning of a sequence description, and
-            // in this file format, sequences must always have a description.
-            if(file.eof()) return false;
-            std::getline(file, line);
+        encoder::unit table[256];               /// The unit corresponding to each character.
+
+        /**
+         * Builds the translation table from the encoder's rules.
+         */
+        inline translator() noexcept
+        {
+            for(size_t i = 0; i < 256; ++i)
+                table[i] = encoder::encode(static_cast<char>(i));
+        }
+
+        /**
+         * Translates a character into its encoded unit.
+         * @param value The character to be translated.
+         * @return The corresponding encoded unit.
+         */
+        inline auto operator[](char value) const noexcept -> encoder::unit
+        {
+            return table[static_cast<unsigned char>(value)];
         }
+    };
+
+    /**
+     * Encodes a record's sequence directly into its position in the arena,
+     * skipping the line feeds between the sequence's lines.
+     * @param file The mapped file.
+     * @param target The record to be encoded.
+     * @param arena The blocks arena shared by all sequences.
+     */
+    static void encode(const mapping& file, const record& target, encoder::buffer& arena)
+    {
+        static const translator translate;
+
+        encoder::unit units[encoder::block_size];
+        encoder::block *blocks = arena.raw() + target.displ;
+        size_t count = 0;
 
-        description = line.substr(1);
+        for(size_t offset = target.body, end; offset < target.tail; offset = end + 1) {
+            const char *line = file.data() + offset;
+            const size_t length = linelength(file, offset, end = endline(file, offset, target.tail));
 
-        while(file.peek() != 0x3E && std::getline(file, line) && line.size() > 0)
-            contents.append(line);
+            for(size_t i = 0; i < length; ++i) {
+                units[count++] = translate[line[i]];
 
-        db.add(description, contents);
-        return true;
+                if(count == encoder::block_size) {
+                    *blocks++ = encoder::pack(units, false);
+                    count = 0;
+                }
+            }
+        }
+
+        if(count > 0) {
+            for(size_t j = count; j < encoder::block_size; ++j)
+                units[j] = encoder::end;
+
+            *blocks = encoder::pack(units, true);
+        }
+    }
+
+    /**
+     * Parses all sequences contained in a mapped file. The file is parsed in
+     * parallel, and all sequences are encoded into a single blocks arena, without
+     * any intermediate strings.
+     * @param file The mapped file.
+     * @return The sequences parsed from file.
+     */
+    static auto parse(const mapping& file) -> database
+    {
+        auto records = find(file);
+        auto arena = encoder::buffer::make(measure(file, records));
+
+        parallel::foreach(records.size(), [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i)
+                encode(file, records[i], arena);
+        });
+
+        database result {records.size()};
+
+        for(const auto& current : records) {
+            const auto end = endline(file, current.head, current.tail);
+            const auto blocks = (current.length + encoder::block_size - 1) / encoder::block_size;
+
+            result.add(
+                    file.data() + current.head
+                ,   linelength(file, current.head, end)
+                ,   blocks ? sequence {arena.offset(current.displ), blocks} : sequence {}
+                );
+        }
+
+        return result;
     }
 }
 
@@ -51,22 +319,30 @@ namespace museqa
     namespace io
     {
         /**
-         * Reads a file and parses all sequences contained in it.
+         * Reads a file and parses all sequences contained in it. The file is mapped
+         * into memory and parsed in parallel, and all sequences are encoded into
+         * a single blocks arena, without any intermediate strings.
          * @param filename The name of the file to be loaded.
          * @return The sequences parsed from file.
          */
         auto parser::fasta(const std::string& filename) -> database
         {
-            database result;
-            std::fstream file (filename, std::fstream::in);
-
-            enforce(!file.fail(), "file does not exist or cannot be read '%s'", filename);
-
-            while(!file.eof() && !file.fail())
-                extract_to_db(file, result);
+            const mapping file {filename};
+            return ::parse(file);
+        }
 
-            file.close();
-            return result;
+        /**
+         * Parses all sequences contained in a FASTA file's contents already held
+         * in memory, such as a file mapped by the caller. The contents are parsed
+         * in place, and no sequence nor description refers to them afterwards.
+         * @param data The file's contents.
+         * @param size The contents' size in bytes.
+         * @return The sequences parsed from the contents.
+         */
+        auto parser::fasta(const char *data, size_t size) -> database
+        {
+            const mapping file {data, size};
+            return ::parse(file);
         }
     }
 }
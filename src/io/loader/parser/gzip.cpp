@@ -0,0 +1,426 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the compressed FASTA parser of sequences database.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <exception>
+#include <condition_variable>
+
+#include <zlib.h>
+
+#include "arena.hpp"
+#include "utils.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
+#include "exception.hpp"
+
+#include "io/loader/database.hpp"
+
+using namespace museqa;
+
+namespace
+{
+    /*
+     * The decompression pipeline's configuration parameters. The channel holds
+     * at most a fixed number of decompressed chunks, so the decompressor can only
+     * run ahead of the parser by a bounded amount of memory.
+     */
+    enum : size_t { chunk_size = 1 << 20 };
+    enum : size_t { channel_capacity = 8 };
+    enum : size_t { bgzf_batch = 64 };
+
+    /**
+     * A bounded queue of decompressed chunks. The decompressor pushes chunks into
+     * the channel while the parser pops them out, in the same order.
+     * @since 0.1.1
+     */
+    class channel
+    {
+        protected:
+            std::deque<std::string> m_chunks;       /// The chunks waiting to be parsed.
+            std::mutex m_mutex;                     /// The channel's synchronization mutex.
+            std::condition_variable m_pushed;       /// Notifies a chunk has been pushed.
+            std::condition_variable m_popped;       /// Notifies a chunk has been popped.
+            std::exception_ptr m_error;             /// The error raised by the decompressor.
+            bool m_closed = false;                  /// Has the decompressor finished?
+
+        public:
+            /**
+             * Pushes a new chunk into the channel, waiting for room if it is full.
+             * @param chunk The chunk to be pushed.
+             */
+            inline void push(std::string&& chunk)
+            {
+                std::unique_lock<std::mutex> lock {m_mutex};
+                m_popped.wait(lock, [this]() { return m_closed || m_chunks.size() < channel_capacity; });
+
+                enforce(!m_closed, "decompression has been interrupted");
+                m_chunks.push_back(std::move(chunk));
+                m_pushed.notify_one();
+            }
+
+            /**
+             * Pops the next chunk out of the channel, waiting for one if needed.
+             * @param chunk The destination of the popped chunk.
+             * @return Was a chunk popped, or has the channel been closed?
+             */
+            inline bool pop(std::string& chunk)
+            {
+                std::unique_lock<std::mutex> lock {m_mutex};
+                m_pushed.wait(lock, [this]() { return m_closed || !m_chunks.empty(); });
+
+                if(m_error) std::rethrow_exception(m_error);
+                if(m_chunks.empty()) return false;
+
+                chunk = std::move(m_chunks.front());
+                m_chunks.pop_front();
+                m_popped.notify_one();
+                return true;
+            }
+
+            /**
+             * Closes the channel, as no more chunks will be pushed or popped. If
+             * the parser closes the channel, the decompressor is interrupted.
+             * @param error The error which interrupted the decompressor, if any.
+             */
+            inline void close(std::exception_ptr error = nullptr)
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                if(!m_closed) m_error = error;
+                m_closed = true;
+                m_pushed.notify_all();
+                m_popped.notify_all();
+            }
+    };
+
+    /**
+     * Reads a little-endian 16-bit integer from a byte sequence.
+     * @param ptr The integer's first byte.
+     * @return The integer's value.
+     */
+    inline auto le16(const unsigned char *ptr) noexcept -> size_t
+    {
+        return size_t(ptr[0]) | size_t(ptr[1]) << 8;
+    }
+
+    /**
+     * Reads a little-endian 32-bit integer from a byte sequence.
+     * @param ptr The integer's first byte.
+     * @return The integer's value.
+     */
+    inline auto le32(const unsigned char *ptr) noexcept -> size_t
+    {
+        return le16(ptr) | le16(ptr + 2) << 16;
+    }
+
+    /**
+     * Checks whether a gzip member header belongs to a BGZF block. A BGZF file
+     * is a series of independent gzip members, whose compressed size is stored in
+     * an extra field, so the members can be located and inflated in parallel.
+     * @param header The member's first bytes.
+     * @param size The number of bytes available.
+     * @return The block's total compressed size, or zero if not a BGZF block.
+     */
+    static auto bgzf(const unsigned char *header, size_t size) noexcept -> size_t
+    {
+        if(size < 18 || header[0] != 0x1f || header[1] != 0x8b || !(header[3] & 0x04))
+            return 0;
+
+        const size_t xlen = le16(header + 10);
+
+        for(size_t i = 12; i + 4 <= 12 + xlen && i + 6 <= size; i += 4 + le16(header + i + 2))
+            if(header[i] == 'B' && header[i + 1] == 'C' && le16(header + i + 2) == 2)
+                return le16(header + i + 4) + 1;
+
+        return 0;
+    }
+
+    /**
+     * Inflates a single BGZF block.
+     * @param block The block's compressed contents, including header and footer.
+     * @return The block's decompressed contents.
+     */
+    static auto inflate_block(const std::string& block) -> std::string
+    {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(block.data());
+        const size_t header = 12 + le16(bytes + 10);
+
+        enforce(block.size() >= header + 8, "corrupted compressed block");
+
+        std::string result (le32(bytes + block.size() - 4), '\0');
+        z_stream stream = {};
+
+        enforce(inflateInit2(&stream, -MAX_WBITS) == Z_OK, "cannot initialize decompressor");
+
+        stream.next_in = const_cast<unsigned char *>(bytes + header);
+        stream.avail_in = uInt(block.size() - header - 8);
+        stream.next_out = reinterpret_cast<unsigned char *>(&result[0]);
+        stream.avail_out = uInt(result.size());
+
+        const int status = inflate(&stream, Z_FINISH);
+        inflateEnd(&stream);
+
+        enforce(status == Z_STREAM_END || (status == Z_BUF_ERROR && result.empty()), "corrupted compressed block");
+        return result;
+    }
+
+    /**
+     * Decompresses a BGZF file. Batches of blocks are read and then inflated in
+     * parallel by the node's threads, while the parser consumes the previous batch.
+     * @param file The compressed file, positioned at its beginning.
+     * @param output The channel to push decompressed chunks into.
+     */
+    static void decompress_bgzf(FILE *file, channel& output)
+    {
+        const size_t batch = bgzf_batch * parallel::global().size();
+        unsigned char header[18];
+
+        while(true) {
+            std::vector<std::string> blocks;
+
+            while(blocks.size() < batch) {
+                const size_t read = fread(header, 1, sizeof(header), file);
+                const size_t size = bgzf(header, read);
+
+                if(read == 0) break;
+                enforce(size >= sizeof(header), "corrupted compressed block");
+
+                std::string block (size, '\0');
+                std::copy(header, header + sizeof(header), block.begin());
+
+                const size_t tail = fread(&block[sizeof(header)], 1, size - sizeof(header), file);
+                enforce(tail == size - sizeof(header), "unexpected end of compressed file");
+
+                blocks.push_back(std::move(block));
+            }
+
+            if(blocks.empty()) return;
+
+            parallel::foreach(blocks.size(), [&](const range<size_t>& partition, size_t) {
+                for(size_t i = partition.offset; i < partition.offset + partition.total; ++i)
+                    blocks[i] = inflate_block(blocks[i]);
+            });
+
+            std::string chunk;
+
+            for(const auto& block : blocks)
+                chunk.append(block);
+
+            output.push(std::move(chunk));
+        }
+    }
+
+    /**
+     * Decompresses a regular gzip file as a single stream. Concatenated gzip
+     * members are decompressed one after the other.
+     * @param file The compressed file, positioned at its beginning.
+     * @param output The channel to push decompressed chunks into.
+     */
+    static void decompress_gzip(FILE *file, channel& output)
+    {
+        std::vector<unsigned char> input (chunk_size);
+        z_stream stream = {};
+        int status = Z_OK;
+
+        enforce(inflateInit2(&stream, MAX_WBITS + 32) == Z_OK, "cannot initialize decompressor");
+
+        while(status != Z_STREAM_END || stream.avail_in > 0 || !feof(file)) {
+            if(stream.avail_in == 0) {
+                stream.avail_in = uInt(fread(input.data(), 1, input.size(), file));
+                stream.next_in = input.data();
+                if(stream.avail_in == 0) break;
+            }
+
+            if(status == Z_STREAM_END)
+                inflateReset(&stream);
+
+            std::string chunk (chunk_size, '\0');
+            stream.next_out = reinterpret_cast<unsigned char *>(&chunk[0]);
+            stream.avail_out = uInt(chunk.size());
+
+            status = inflate(&stream, Z_NO_FLUSH);
+
+            if(status != Z_OK && status != Z_STREAM_END) {
+                inflateEnd(&stream);
+                throw exception {"corrupted compressed file"};
+            }
+
+            chunk.resize(chunk.size() - stream.avail_out);
+            if(!chunk.empty()) output.push(std::move(chunk));
+        }
+
+        inflateEnd(&stream);
+        enforce(status == Z_STREAM_END, "unexpected end of compressed file");
+    }
+
+    /**
+     * Incrementally builds a database from the file's decompressed contents.
+     * As chunks might end in the middle of a line, the incomplete last line
+     * of a chunk is carried over until the next one arrives.
+     * @since 0.1.1
+     */
+    class builder
+    {
+        protected:
+            database& m_db;                         /// The database being built.
+            std::string m_carry;                    /// The chunk's incomplete last line.
+            std::string m_description;              /// The current sequence's description.
+            std::string m_contents;                 /// The current sequence's contents.
+            bool m_open = false;                    /// Is there a sequence being read?
+            bool m_collecting = false;              /// Are the lines part of the sequence?
+
+        public:
+            /**
+             * Initializes a new builder for the given database.
+             * @param db The database to be built.
+             */
+            inline explicit builder(database& db) noexcept
+            :   m_db {db}
+            {}
+
+            /**
+             * Consumes a chunk of the file's decompressed contents.
+             * @param chunk The chunk to be consumed.
+             */
+            inline void feed(const std::string& chunk)
+            {
+                size_t offset = 0;
+
+                for(size_t end; (end = chunk.find('\n', offset)) != std::string::npos; offset = end + 1) {
+                    if(!m_carry.empty()) {
+                        m_carry.append(chunk, offset, end - offset);
+                        line(m_carry.data(), m_carry.size());
+                        m_carry.clear();
+                    } else {
+                        line(chunk.data() + offset, end - offset);
+                    }
+                }
+
+                m_carry.append(chunk, offset, std::string::npos);
+            }
+
+            /**
+             * Consumes the file's last line and flushes the last sequence read.
+             */
+            inline void finish()
+            {
+                if(!m_carry.empty()) line(m_carry.data(), m_carry.size());
+                flush();
+            }
+
+        protected:
+            /**
+             * Processes a single line of the file. As in the file format, a
+             * sequence's contents end at the first blank line or description.
+             * @param ptr The line's first character.
+             * @param size The line's length.
+             */
+            inline void line(const char *ptr, size_t size)
+            {
+                if(size > 0 && ptr[size - 1] == '\r') --size;
+
+                if(size > 0 && ptr[0] == '>') {
+                    flush();
+                    m_description.assign(ptr + 1, size - 1);
+                    m_open = m_collecting = true;
+                } else if(m_collecting) {
+                    m_collecting = (size > 0);
+                    m_contents.append(ptr, size);
+                }
+            }
+
+            /**
+             * Adds the sequence currently being read to the database.
+             */
+            inline void flush()
+            {
+                if(m_open) m_db.add(m_description, sequence {
+                        encoder::encode(m_contents.data(), m_contents.size(), arena::host)
+                    });
+                m_contents.clear();
+                m_open = false;
+            }
+    };
+
+    /**
+     * Closes a file when going out of scope.
+     * @since 0.1.1
+     */
+    struct closer
+    {
+        FILE *file;                         /// The file to be closed.
+
+        /**
+         * Closes the file.
+         */
+        inline ~closer()
+        {
+            fclose(file);
+        }
+    };
+}
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Reads a gzip or BGZF compressed FASTA file and parses all sequences in
+         * it. The file is decompressed by a background thread, while its contents
+         * are parsed and encoded into the database as soon as they are available.
+         * @param filename The name of the file to be loaded.
+         * @return The sequences parsed from file.
+         */
+        auto parser::gzip(const std::string& filename) -> database
+        {
+            FILE *file = fopen(filename.c_str(), "rb");
+            enforce(file != nullptr, "file does not exist or cannot be read '%s'", filename);
+
+            closer guard {file};
+            unsigned char header[18];
+
+            const size_t read = fread(header, 1, sizeof(header), file);
+            const bool blocked = bgzf(header, read) > 0;
+            rewind(file);
+
+            database result;
+            builder parse {result};
+            channel chunks;
+
+            std::thread decompressor ([&]() {
+                try {
+                    if(blocked) decompress_bgzf(file, chunks);
+                    else decompress_gzip(file, chunks);
+                    chunks.close();
+                } catch(...) {
+                    chunks.close(std::current_exception());
+                }
+            });
+
+            try {
+                for(std::string chunk; chunks.pop(chunk); )
+                    parse.feed(chunk);
+            } catch(...) {
+                chunks.close();
+                decompressor.join();
+                throw;
+            }
+
+            decompressor.join();
+            parse.finish();
+
+            return result;
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the substitution matrix parser of scoring tables.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+#include "pointer.hpp"
+#include "exception.hpp"
+
+#include "io/loader/table.hpp"
+#include "pairwise/pairwise.cuh"
+
+using namespace museqa;
+
+namespace
+{
+    /**
+     * Aliasing the scoring table's element type in order to avoid excessive
+     * verbosity with the fully-qualified type name.
+     * @since 0.1.1
+     */
+    using element_type = pairwise::scoring_table::element_type;
+
+    /*
+     * The number of units which can be scored by a table, and the value given
+     * to letters which cannot be scored, and whose rows and columns are skipped.
+     */
+    enum : size_t { alphabet = 25 };
+    enum : encoder::unit { ignored = 0xFF };
+
+    /**
+     * Translates a matrix label to the unit it scores. Only letters which are
+     * not merged into any other unit by the encoder have their own entries.
+     * @param label The matrix's row or column label.
+     * @return The labeled unit, or the ignored value.
+     */
+    inline auto unit(char label) noexcept -> encoder::unit
+    {
+        const encoder::unit value = encoder::encode(label);
+        const char upper = toupper(label);
+
+        return (value < alphabet && encoder::decode(value) == upper) ? value : encoder::unit(ignored);
+    }
+}
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Loads a substitution matrix file, in the same format as NCBI's. Comments
+         * start with a '#', the first row lists the columns' letters, and each of
+         * the following rows starts with its own letter. The gap penalties may be
+         * given by "open" and "extend" lines, anywhere in the file. If not given,
+         * the opening penalty is the matrix's lowest score, as for the builtin
+         * tables, and gaps are linear. Units missing from the matrix are scored
+         * as the unknown 'X' unit, if present, or by the lowest score otherwise.
+         * @param filename The name of the file to be loaded.
+         * @return The scoring table loaded from file.
+         */
+        auto parser::matrix(const std::string& filename) -> pairwise::scoring_table
+        {
+            std::ifstream file (filename);
+            enforce(!file.fail(), "file does not exist or cannot be read '%s'", filename);
+
+            auto check = [&filename](bool condition) {
+                enforce(condition, "file is not a valid scoring table '%s'", filename);
+            };
+
+            std::vector<encoder::unit> columns;
+            std::string text, token;
+
+            element_type values[alphabet][alphabet];
+            bool known[alphabet][alphabet] = {};
+            element_type open = 0, extend = 0, lowest = 0;
+            bool has_open = false, has_extend = false;
+
+            while(std::getline(file, text)) {
+                std::istringstream line (text.substr(0, text.find('#')));
+
+                if(!(line >> token))
+                    continue;
+
+                // A word longer than a single letter can only be one of the gap
+                // penalties, as every row and column is labeled by a single letter.
+                if(token.size() > 1) {
+                    element_type value;
+                    check(bool(line >> value) && value >= 0);
+
+                    if(token == "open" || token == "penalty") { open = value; has_open = true; }
+                    else if(token == "extend") { extend = value; has_extend = true; }
+                    else check(false);
+
+                    continue;
+                }
+
+                if(columns.empty()) {
+                    do {
+                        check(token.size() == 1);
+                        columns.push_back(unit(token[0]));
+                    } while(line >> token);
+
+                    continue;
+                }
+
+                const encoder::unit row = unit(token[0]);
+
+                for(const auto column : columns) {
+                    element_type value;
+                    check(bool(line >> value));
+
+                    lowest = utils::min(lowest, value);
+
+                    if(row != ignored && column != ignored) {
+                        values[row][column] = value;
+                        known[row][column] = true;
+                    }
+                }
+
+                check(!(line >> token));
+            }
+
+            check(!columns.empty());
+
+            // Units which are missing from the matrix are scored in the same way
+            // as unknown units, so any sequence can be scored with the table.
+            const encoder::unit unknown = unit('X');
+            auto contents = pointer<pairwise::scoring_table::raw_type>::make();
+
+            for(size_t i = 0; i < alphabet; ++i)
+                for(size_t j = 0; j < alphabet; ++j)
+                    (*contents)[i][j] = known[i][j] ? values[i][j]
+                        : known[unknown][j] && i != unknown ? values[unknown][j]
+                        : known[i][unknown] && j != unknown ? values[i][unknown]
+                        : lowest;
+
+            if(!has_open) open = -lowest;
+            if(!has_extend) extend = open;
+
+            enforce(extend <= open, "gap extension cannot be more penalized than opening '%s'", filename);
+
+            return pairwise::scoring_table {contents, open, extend};
+        }
+    }
+}
@@ -0,0 +1,246 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the Newick parser of phylogenetic guide trees.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "exception.hpp"
+
+#include "io/loader/guidetree.hpp"
+#include "phylogeny/njoining/star.cuh"
+
+using namespace museqa;
+
+namespace
+{
+    /**
+     * The guide tree's distance type.
+     * @since 0.1.1
+     */
+    using distance_type = phylogeny::otu::distance_type;
+
+    /**
+     * Represents a node found while parsing the tree. As the tree's total number
+     * of leaves is only known after all of it is read, inner nodes are numbered
+     * by the order in which they have been closed, and only later converted to
+     * their references on the tree.
+     * @since 0.1.1
+     */
+    struct node
+    {
+        bool leaf;                      /// Is the node a leaf?
+        uint32_t id;                    /// The leaf's label or inner node's closing order.
+        distance_type distance;         /// The node's distance to its parent.
+    };
+
+    /**
+     * Parses the contents of a Newick file. Only binary trees, whose leaves are
+     * labeled by their sequences' indeces, are accepted. As trees may be very
+     * deep, the nodes being built are kept on an explicit stack.
+     * @since 0.1.1
+     */
+    class reader
+    {
+        protected:
+            const std::string& m_text;                      /// The file's contents.
+            const std::string& m_filename;                  /// The file's name.
+            size_t m_pos = 0;                               /// The current reading position.
+
+        public:
+            std::vector<node> joins;                        /// The inner nodes' children, two by each.
+            std::vector<bool> labels;                       /// The leaf labels already used.
+
+        public:
+            inline reader(const std::string& text, const std::string& filename) noexcept
+            :   m_text {text}
+            ,   m_filename {filename}
+            {}
+
+            /**
+             * Reads the whole tree from the file's contents.
+             * @return The number of leaves in the tree.
+             */
+            inline auto read() -> size_t
+            {
+                auto stack = std::vector<std::vector<node>> {{}};
+                size_t leaves = 0;
+
+                while(peek() != ';') {
+                    const char token = peek();
+
+                    if(token == '(') {
+                        ++m_pos;
+                        stack.push_back({});
+                        continue;
+                    }
+
+                    if(token == ',' && stack.size() > 1 && !stack.back().empty()) {
+                        ++m_pos;
+                        continue;
+                    }
+
+                    node current;
+
+                    if(token == ')') {
+                        ++m_pos;
+                        check(stack.size() > 1 && stack.back().size() == 2);
+
+                        for(const auto& child : stack.back())
+                            joins.push_back(child);
+
+                        current = node {false, uint32_t(joins.size() / 2 - 1), 0};
+                        stack.pop_back();
+                        label();
+                    } else {
+                        current = node {true, leaf(), 0};
+                        ++leaves;
+                    }
+
+                    current.distance = length();
+                    stack.back().push_back(current);
+                    check(stack.size() > 1 || stack.back().size() == 1);
+                }
+
+                check(stack.size() == 1);
+                check(labels.size() <= leaves);
+
+                return leaves;
+            }
+
+        protected:
+            /**
+             * Checks whether the file is well-formed.
+             * @param condition The condition to be checked.
+             */
+            inline void check(bool condition) const
+            {
+                enforce(condition, "file is not a valid guide tree '%s'", m_filename);
+            }
+
+            /**
+             * Peeks the file's next non-whitespace character.
+             * @return The next character.
+             */
+            inline auto peek() -> char
+            {
+                while(m_pos < m_text.size() && isspace(m_text[m_pos]))
+                    ++m_pos;
+
+                check(m_pos < m_text.size());
+                return m_text[m_pos];
+            }
+
+            /**
+             * Reads a leaf's label, which must be its sequence's index.
+             * @return The leaf's sequence index.
+             */
+            inline auto leaf() -> uint32_t
+            {
+                const char *start = m_text.c_str() + m_pos;
+                char *end;
+
+                check(isdigit(*start));
+                const unsigned long id = strtoul(start, &end, 10);
+                check(id < (1UL << 31));
+
+                m_pos += end - start;
+
+                if(labels.size() <= id)
+                    labels.resize(id + 1, false);
+
+                check(!labels[id]);
+                labels[id] = true;
+
+                return (uint32_t) id;
+            }
+
+            /**
+             * Skips an inner node's label, if any, as it is ignored.
+             * @since 0.1.1
+             */
+            inline void label()
+            {
+                while(m_pos < m_text.size() && !strchr("(),:;", m_text[m_pos]) && !isspace(m_text[m_pos]))
+                    ++m_pos;
+            }
+
+            /**
+             * Reads a node's branch length, if any.
+             * @return The node's distance to its parent.
+             */
+            inline auto length() -> distance_type
+            {
+                if(peek() != ':')
+                    return distance_type {0};
+
+                ++m_pos;
+                peek();
+
+                const char *start = m_text.c_str() + m_pos;
+                char *end;
+
+                const distance_type distance = (distance_type) strtod(start, &end);
+                check(end != start);
+
+                m_pos += end - start;
+                return distance;
+            }
+    };
+}
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Loads a guide tree from a Newick file. The tree's leaves must be labeled
+         * by the indeces of their sequences on the database, just as the trees
+         * written by the Newick writer. The labels of inner nodes are ignored. As
+         * Newick does not record the order in which nodes have been joined, inner
+         * nodes are referenced in the order they are closed, which always keeps
+         * every node's children referenced lower than the node itself.
+         * @param filename The name of the file to be loaded.
+         * @return The guide tree loaded from file.
+         */
+        auto parser::newick(const std::string& filename) -> phylogeny::guidetree
+        {
+            std::ifstream file (filename);
+            std::stringstream contents;
+
+            enforce(!file.fail(), "file does not exist or cannot be read '%s'", filename);
+
+            contents << file.rdbuf();
+            const auto text = contents.str();
+
+            auto parser = reader {text, filename};
+            const size_t leaves = parser.read();
+
+            if(leaves < 2)
+                return phylogeny::guidetree {};
+
+            auto tree = phylogeny::njoining::star::make((uint32_t) leaves);
+
+            auto ref = [leaves](const node& target) -> phylogeny::oturef {
+                return (phylogeny::oturef) (target.leaf ? target.id : leaves + target.id);
+            };
+
+            for(size_t i = 0; i < parser.joins.size(); i += 2) {
+                const auto& one = parser.joins[i + 0];
+                const auto& two = parser.joins[i + 1];
+
+                tree.join((phylogeny::oturef) (leaves + i / 2), {ref(one), one.distance}, {ref(two), two.distance});
+            }
+
+            return tree;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements a loader for pairwise scoring tables.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "io/loader.hpp"
+#include "pairwise/pairwise.cuh"
+
+namespace museqa
+{
+    namespace io
+    {
+        /**
+         * Specializes a loader for the pairwise module's scoring table type.
+         * @since 0.1.1
+         */
+        template <>
+        struct loader<pairwise::scoring_table> : public base::loader<pairwise::scoring_table>
+        {
+            auto factory(const std::string&) const -> functor override;
+            auto validate(const std::string&) const noexcept -> bool override;
+            auto list() const noexcept -> const std::vector<std::string>& override;
+        };
+
+        namespace parser
+        {
+            /*
+             * Declaration of all available parsers to the target datatype.
+             */
+            extern auto matrix(const std::string&) -> pairwise::scoring_table;
+        }
+    }
+}
@@ -12,6 +12,7 @@
 
 #include "mpi.hpp"
 #include "node.hpp"
+#include "trace.hpp"
 
 namespace museqa
 {
@@ -41,6 +42,12 @@ namespace museqa
      */
     std::vector<mpi::op::id> mpi::op::ref_op;
 
+    /**
+     * Keeps track of all shared memory windows allocated during execution.
+     * @since 0.1.1
+     */
+    std::vector<mpi::window::id> mpi::window::ref_win;
+
     /**
      * Maps a datatype to an user-created operator. This is necessary because
      * it is almost technically impossible to inject the operator inside the
@@ -90,6 +97,19 @@ namespace museqa
         return build(newcomm);
     }
 
+    /**
+     * Splits nodes into communicators of nodes running on the same host, which
+     * are thus able to share memory with each other.
+     * @param comm The original communicator to be split.
+     * @return The communicator of nodes sharing the current node's host.
+     */
+    auto mpi::communicator::split_local(const communicator& comm) -> communicator
+    {
+        raw_type newcomm;
+        mpi::check(MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, comm.m_rank, MPI_INFO_NULL, &newcomm));
+        return build(newcomm);
+    }
+
     /**
      * Cleans up the resources used by communicator.
      * @param comm The communicator to be destroyed.
@@ -100,6 +120,31 @@ namespace museqa
         comm.m_raw = MPI_COMM_NULL;
     }
 
+    /**
+     * Allocates a memory segment shared by all nodes in a communicator. The whole
+     * segment is provided by the communicator's first node, and all other nodes
+     * are given direct access to it. Thus, all nodes must be on the same host.
+     * @param size The segment's size in bytes.
+     * @param comm The communicator of nodes sharing the segment.
+     * @return The pointer to the shared segment.
+     * @see mpi::communicator::split_local
+     */
+    auto mpi::allocate_shared(size_t size, const communicator& comm) -> void *
+    {
+        window::id win;
+        MPI_Aint segment;
+        int unit;
+        void *ptr;
+
+        const MPI_Aint local = comm.rank() == 0 ? MPI_Aint(size) : 0;
+
+        mpi::check(MPI_Win_allocate_shared(local, 1, MPI_INFO_NULL, comm, &ptr, &win));
+        mpi::check(MPI_Win_shared_query(win, 0, &segment, &unit, &ptr));
+        window::ref_win.push_back(win);
+
+        return ptr;
+    }
+
     /**
      * Initializes the cluster's communication and identifies the node in the cluster.
      * @param argc The number of arguments sent from terminal.
@@ -115,6 +160,8 @@ namespace museqa
 
         node::rank = comm.rank();
         node::count = comm.size();
+
+        trace::init();
     }
 
     /**
@@ -129,6 +176,9 @@ namespace museqa
         for(op::id& opref : op::ref_op)
             mpi::check(MPI_Op_free(&opref));
 
+        for(window::id& winref : window::ref_win)
+            mpi::check(MPI_Win_free(&winref));
+
         global_state.mpi_running = false;
 
         MPI_Finalize();
@@ -16,6 +16,7 @@
 #include "buffer.hpp"
 #include "exception.hpp"
 #include "environment.h"
+#include "trace.hpp"
 #include "reflection.hpp"
 
 #if !defined(__museqa_runtime_cython)
@@ -868,6 +869,7 @@ namespace museqa
 
                 static auto build(raw_type) -> communicator;
                 static auto split(const communicator&, int, int = any) -> communicator;
+                static auto split_local(const communicator&) -> communicator;
                 static void free(communicator&);
 
             private:
@@ -903,9 +905,76 @@ namespace museqa
          */
         inline void barrier(const communicator& comm = world)
         {
+            trace::scope span {"mpi::barrier", "mpi"};
             mpi::check(MPI_Barrier(comm));
         }
 
+        namespace window
+        {
+            /**
+             * Holds an identification value for a memory window shared by nodes.
+             * @since 0.1.1
+             */
+            using id = MPI_Win;
+
+            /**
+             * Keeps track of all memory windows allocated throughout execution.
+             * As freeing a window is a collective operation, windows are only
+             * freed when MPI is finalized.
+             * @since 0.1.1
+             */
+            extern std::vector<window::id> ref_win;
+        }
+
+        extern auto allocate_shared(size_t, const communicator&) -> void *;
+
+        /**
+         * Identifies a pending non-blocking operation.
+         * @since 0.1.1
+         */
+        using request = MPI_Request;
+
+        /**
+         * Starts broadcasting a buffer to all nodes in given communicator, without
+         * waiting for the operation to complete. The buffer must not be touched
+         * until the returned request has been completed.
+         * @tparam T The type of buffer data to broadcast.
+         * @param data The buffer to broadcast from or receive into.
+         * @param size The number of buffer's elements to broadcast.
+         * @param root The operation's root node.
+         * @param comm The communicator this operation applies to.
+         * @return The operation's pending request.
+         */
+        template <typename T>
+        inline auto ibroadcast(T *data, size_t size, node root, const communicator& comm) -> request
+        {
+            request pending;
+            mpi::check(MPI_Ibcast(data, size, datatype::get<T>(), root, comm, &pending));
+            return pending;
+        }
+
+        /**
+         * Checks whether a non-blocking operation has been completed.
+         * @param pending The operation's request.
+         * @return Has the operation been completed?
+         */
+        inline bool test(request& pending)
+        {
+            int flag;
+            mpi::check(MPI_Test(&pending, &flag, MPI_STATUS_IGNORE));
+            return flag != 0;
+        }
+
+        /**
+         * Blocks until a non-blocking operation has been completed.
+         * @param pending The operation's request.
+         */
+        inline void wait(request& pending)
+        {
+            trace::scope span {"mpi::wait", "mpi"};
+            mpi::check(MPI_Wait(&pending, MPI_STATUS_IGNORE));
+        }
+
         /**
          * Broadcasts a message to all nodes in given communicator.
          * @param out The message to broadcast.
@@ -915,6 +984,7 @@ namespace museqa
          */
         inline message broadcast(message out, node root, const communicator& comm)
         {
+            trace::scope span {"mpi::broadcast", "mpi"};
             message in = comm.rank() != root ? message::make(out, out.size) : out;
             mpi::check(MPI_Bcast(in.ptr, in.size, in.type, root, comm));
             return in;
@@ -929,6 +999,7 @@ namespace museqa
          */
         inline void send(message out, node dest, mpi::tag tag, const communicator& comm)
         {
+            trace::scope span {"mpi::send", "mpi"};
             mpi::tag msgtag = tag >= 0 ? tag : MPI_TAG_UB;
             mpi::check(MPI_Send(out.ptr, out.size, out.type, dest, msgtag, comm));
         }
@@ -943,6 +1014,7 @@ namespace museqa
          */
         inline message receive(message in, node src, mpi::tag tag, const communicator& comm)
         {
+            trace::scope span {"mpi::receive", "mpi"};
             status::raw_type stat;
             mpi::check(MPI_Recv(in.ptr, in.size, in.type, src, tag, comm, &stat));
             last_status = status {stat};
@@ -958,6 +1030,7 @@ namespace museqa
          */
         inline message allreduce(message out, const op::id& fop, const communicator& comm)
         {
+            trace::scope span {"mpi::allreduce", "mpi"};
             message in = message::make(out, out.size);
             mpi::check(MPI_Allreduce(out.ptr, in.ptr, in.size, in.type, op::active = fop, comm));
             return in;
@@ -973,6 +1046,7 @@ namespace museqa
          */
         inline message reduce(message out, const op::id& fop, node root, const communicator& comm)
         {
+            trace::scope span {"mpi::reduce", "mpi"};
             message in = message::make(out, out.size);
             mpi::check(MPI_Reduce(out.ptr, in.ptr, in.size, in.type, op::active = fop, root, comm));
             return in;
@@ -986,6 +1060,7 @@ namespace museqa
          */
         inline message allgather(message out, const communicator& comm)
         {
+            trace::scope span {"mpi::allgather", "mpi"};
             message in = message::make(out, out.size * comm.size());
             mpi::check(MPI_Allgather(out.ptr, out.size, in.type, in.ptr, out.size, in.type, comm));
             return in;
@@ -1001,6 +1076,7 @@ namespace museqa
          */
         inline message allgatherv(message out, message msize, message mdisp, const communicator& comm)
         {
+            trace::scope span {"mpi::allgatherv", "mpi"};
             const int *size = static_cast<const int *>(&msize.ptr);
             const int *disp = static_cast<const int *>(&mdisp.ptr);
             message in = message::make(out, std::accumulate(size, size + comm.size(), 0));
@@ -1017,6 +1093,7 @@ namespace museqa
          */
         inline message gather(message out, node root, const communicator& comm)
         {
+            trace::scope span {"mpi::gather", "mpi"};
             message in = message::make(out, comm.rank() != root ? 0 : out.size * comm.size());
             mpi::check(MPI_Gather(out.ptr, out.size, in.type, in.ptr, out.size, in.type, root, comm));
             return in;
@@ -1033,6 +1110,7 @@ namespace museqa
          */
         inline message gatherv(message out, message msize, message mdisp, node root, const communicator& comm)
         {
+            trace::scope span {"mpi::gatherv", "mpi"};
             const int *size = static_cast<const int *>(&msize.ptr);
             const int *disp = static_cast<const int *>(&mdisp.ptr);
             message in = message::make(out, comm.rank() != root ? 0 : std::accumulate(size, size + comm.size(), 0));
@@ -1049,6 +1127,7 @@ namespace museqa
          */
         inline message scatter(message out, node root, const communicator& comm)
         {
+            trace::scope span {"mpi::scatter", "mpi"};
             message in = message::make(out, out.size / comm.size());
             mpi::check(MPI_Scatter(out.ptr, in.size, in.type, in.ptr, in.size, in.type, root, comm));
             return in;
@@ -1065,6 +1144,7 @@ namespace museqa
          */
         inline message scatterv(message out, message msize, message mdisp, node root, const communicator& comm)
         {
+            trace::scope span {"mpi::scatterv", "mpi"};
             const int *size = static_cast<const int *>(&msize.ptr);
             const int *disp = static_cast<const int *>(&mdisp.ptr);
             message in = message::make(out, size[comm.rank()]);
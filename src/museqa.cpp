@@ -6,20 +6,31 @@
  */
 #include <string>
 #include <vector>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <sys/stat.h>
 
 #include "io.hpp"
 #include "mpi.hpp"
 #include "cuda.cuh"
+#include "cuda/tuning.cuh"
 #include "museqa.hpp"
 #include "encoder.hpp"
 #include "database.hpp"
 #include "benchmark.hpp"
 #include "exception.hpp"
+#include "parallel.hpp"
+#include "stream.hpp"
+#include "trace.hpp"
 
 #include "bootstrap.hpp"
 #include "pairwise.cuh"
 #include "phylogeny.cuh"
 #include "pgalign.cuh"
+#include "refine.cuh"
 
 using namespace museqa;
 
@@ -32,10 +43,27 @@ static const std::vector<terminal::option> options = {
     {"multigpu",      {"-m", "--multigpu"},      "Use multiple devices in a single host if possible."}
 ,   {"report-only",   {"-r", "--report-only"},   "Print only timing reports and nothing else."}
 ,   {"gpu-id",        {"-d", "--device"},        "Picks the GPU to be used on hosts with more than one.", true}
+,   {"node-gpus",     {"-g", "--node-gpus"},     "The number of local GPUs driven by each node.", true}
+,   {"dump-database", {"-b", "--dump-database"}, "Dumps the loaded sequences into a binary database file.", true}
+,   {"threads",       {"-t", "--threads"},       "The number of host threads to use on each node.", true}
 ,   {"scoring-table", {"-s", "--scoring-table"}, "The scoring table name or file to align sequences with.", true}
 ,   {"pairwise",      {"-1", "--pairwise"},      "Picks the algorithm to use within the pairwise module.", true}
+,   {"partition",     {"-p", "--partition"},     "Picks how pairs are partitioned among nodes in the pairwise module.", true}
+,   {"kmer-size",     {"-k", "--kmer-size"},     "The k-mer length used by alignment-free pairwise algorithms.", true}
+,   {"sketch-size",   {"-z", "--sketch-size"},   "The number of k-mers sketched per sequence, or zero for all.", true}
+,   {"consistency",   {"-y", "--consistency"},   "Builds a consistency library from the pairwise alignments for the profile-aligner."}
+,   {"incremental",   {"-i", "--incremental"},   "File with pairwise scores to reuse and extend with new sequences.", true}
+,   {"score-cache",   {"-c", "--score-cache"},   "Directory caching pairwise scores across runs.", true}
 ,   {"phylogeny",     {"-2", "--phylogeny"},     "Picks the algorithm to use within the phylogeny module.", true}
+,   {"dump-tree",     {"-w", "--dump-tree"},     "Dumps the phylogenetic guide tree into a Newick or compact file.", true}
+,   {"load-tree",     {"-l", "--load-tree"},     "Loads a precomputed guide tree, skipping the pairwise and phylogeny modules.", true}
 ,   {"pgalign",       {"-3", "--pgalign"},       "Picks the algorithm to use within the profile-aligner.", true}
+,   {"refine",        {"-f", "--refine"},        "Refines the alignment for up to the given number of seconds.", true}
+,   {"output",        {"-o", "--output"},        "Writes the alignment into a FASTA, Clustal or Stockholm file, optionally gzipped.", true}
+,   {"trace",         {"-e", "--trace"},         "Writes a Chrome trace of the execution's spans into a JSON file.", true}
+,   {"checkpoint",    {"-x", "--checkpoint"},    "Directory to checkpoint modules into and to resume the pipeline from.", true}
+,   {"autotune",      {"-a", "--autotune"},      "Tunes device kernels at first use, caching the best configurations into a file.", true}
+,   {"batch",         {"-q", "--batch"},         "Runs each line of the given file, or of stdin if '-', as a job within a single session.", true}
 };
 
 namespace museqa
@@ -67,6 +95,7 @@ namespace museqa
             auto run(const io::manager& io, pipeline::pipe& pipe) const -> pipeline::pipe override
             {
                 pipeline::pipe mresult;
+                trace::scope span {this->name(), "module"};
 
                 const auto lambda = [&]() { return std::move(this->next(io, pipe)); };
                 const auto duration = benchmark::run(mresult, lambda);
@@ -141,6 +170,22 @@ namespace museqa
 
                 return mresult;
             }
+
+            /**
+             * Resumes the pipeline module from its checkpoint.
+             * @param io The pipeline's IO service instance.
+             * @param pipe The previous module's conduit instance.
+             * @param filename The name of the module's checkpoint file.
+             * @return The resumed conduit, if any.
+             */
+            auto resume(const io::manager& io, pipeline::pipe& pipe, const std::string& filename) const
+            -> pipeline::pipe override
+            {
+                auto mresult = museqa::pairwise::module::resume(io, pipe, filename);
+                onlymaster if(mresult) watchdog::info("resumed pairwise scores from <bold>%s</>", filename);
+
+                return mresult;
+            }
         };
 
         /**
@@ -170,6 +215,51 @@ namespace museqa
 
                 return mresult;
             }
+
+            /**
+             * Resumes the pipeline module from its checkpoint.
+             * @param io The pipeline's IO service instance.
+             * @param pipe The previous module's conduit instance.
+             * @param filename The name of the module's checkpoint file.
+             * @return The resumed conduit, if any.
+             */
+            auto resume(const io::manager& io, pipeline::pipe& pipe, const std::string& filename) const
+            -> pipeline::pipe override
+            {
+                auto mresult = museqa::phylogeny::module::resume(io, pipe, filename);
+                onlymaster if(mresult) watchdog::info("resumed phylogenetic tree from <bold>%s</>", filename);
+
+                return mresult;
+            }
+        };
+
+        /**
+         * Loads a precomputed phylogenetic tree. This module takes the place of
+         * both the pairwise and phylogeny modules when a guide tree is given.
+         * @since 0.1.1
+         */
+        struct treeloader : public museqa::module::treeloader
+        {
+            /**
+             * Executes the pipeline module's logic.
+             * @param io The pipeline's IO service instance.
+             * @param pipe The previous module's conduit instance.
+             * @return The resulting conduit to send to the next module.
+             */
+            auto run(const io::manager& io, pipeline::pipe& pipe) const -> pipeline::pipe override
+            {
+                onlymaster {
+                    auto filename = io.cmd.get("load-tree");
+
+                    watchdog::info("chosen guide tree file <bold>%s</>", filename);
+                    watchdog::init("guidetree", "loading phylogenetic tree");
+                }
+
+                auto mresult = museqa::module::treeloader::run(io, pipe);
+                onlymaster watchdog::finish("guidetree", "phylogenetic tree loaded");
+
+                return mresult;
+            }
         };
 
         /**
@@ -200,6 +290,33 @@ namespace museqa
                 return mresult;
             }
         };
+
+        /**
+         * Executes the heuristic's optional refinement module. This module improves
+         * the global alignment for as long as its given time budget allows.
+         * @since 0.1.1
+         */
+        struct refine : public museqa::module::refine
+        {
+            /**
+             * Executes the pipeline module's logic.
+             * @param io The pipeline's IO service instance.
+             * @param pipe The previous module's conduit instance.
+             * @return The resulting conduit to send to the next module.
+             */
+            auto run(const io::manager& io, pipeline::pipe& pipe) const -> pipeline::pipe override
+            {
+                onlymaster if(io.cmd.has("refine")) {
+                    auto budget = io.cmd.get<double>("refine", 0);
+                    watchdog::init("refine", "refining alignment for <bold>%g</> seconds", budget);
+                }
+
+                auto mresult = museqa::refine::module::run(io, pipe);
+                onlymaster if(io.cmd.has("refine")) watchdog::finish("refine", "alignment refinement is completed");
+
+                return mresult;
+            }
+        };
     }
 
     /**
@@ -212,6 +329,19 @@ namespace museqa
         ,   heuristic::timer<heuristic::pairwise>
         ,   heuristic::timer<heuristic::phylogeny>
         ,   heuristic::timer<heuristic::pgalign>
+        ,   heuristic::timer<heuristic::refine>
+        >;
+
+    /**
+     * Definition of the heuristic's pipeline stages when a precomputed guide tree
+     * is given. The alignment then starts right after the sequences are loaded.
+     * @since 0.1.1
+     */
+    using preloaded = pipeline::runner<
+            heuristic::timer<heuristic::bootstrap>
+        ,   heuristic::timer<heuristic::treeloader>
+        ,   heuristic::timer<heuristic::pgalign>
+        ,   heuristic::timer<heuristic::refine>
         >;
 
     /**
@@ -222,18 +352,123 @@ namespace museqa
      */
     static void run(const io::manager& io)
     {
-        auto runner = museqa::runner {};
-        auto lambda = [&io, &runner]() { runner.run(io); };
+        onlymaster if(io.cmd.has("checkpoint")) {
+            const auto dirname = io.cmd.get("checkpoint");
+            enforce(!mkdir(dirname.c_str(), 0755) || errno == EEXIST, "checkpoint directory cannot be created '%s'", dirname);
+        }
+
+        auto lambda = [&io]() {
+            if(io.cmd.has("load-tree")) museqa::preloaded {}.run(io);
+            else                        museqa::runner {}.run(io);
+            stream::complete();
+        };
 
         onlyslaves if(global_state.local_devices > 0) {
             const auto rank  = node::rank - 1;
             const auto count = global_state.local_devices;
             const auto gpuid = io.cmd.get<unsigned>("gpu-id", cuda::device::init);
-            cuda::device::select((global_state.use_multigpu ? gpuid + rank : gpuid) % count);
+            const auto ngpus = global_state.node_devices;
+            cuda::device::select((global_state.use_multigpu ? gpuid + rank * ngpus : gpuid) % count);
         }
 
         watchdog::report("total", benchmark::run(lambda));
     }
+
+    /**
+     * Parses a batch job's command line. The session's own arguments are appended
+     * to the job's, so the job's options take precedence over the session's.
+     * @param line The job's line, with its own command line arguments.
+     * @param session The session's own command line arguments.
+     * @return The job's IO manager instance.
+     */
+    static auto command(const std::string& line, const std::vector<std::string>& session) -> io::manager
+    {
+        std::istringstream tokens {line};
+        std::vector<std::string> args;
+
+        for(std::string token; tokens >> token; )
+            args.push_back(token);
+
+        args.insert(args.end(), session.begin(), session.end());
+
+        // The arguments are laid out as a command line, whose first argument is
+        // the program's name and is thus ignored by the parser.
+        std::vector<char *> argv {nullptr};
+
+        for(auto& arg : args)
+            argv.push_back(&arg[0]);
+
+        return io::manager::make(options, (int) argv.size(), argv.data());
+    }
+
+    /**
+     * Reads the next job from a batch's queue. The queue is only read by the master
+     * node, which shares each job with all other nodes as soon as it is read, so
+     * jobs may still be queued while the session runs. Jobs whose command lines
+     * are invalid or whose input files cannot be read are reported and skipped,
+     * as they would otherwise fail on the master node alone.
+     * @param queue The queue of jobs, on the master node.
+     * @param session The session's own command line arguments.
+     * @return The job's line, or an empty line if the queue is over.
+     */
+    static auto next(std::istream& queue, const std::vector<std::string>& session) -> std::string
+    {
+        std::vector<char> line;
+
+        onlymaster for(std::string text; line.empty() && std::getline(queue, text); ) {
+            text = text.substr(0, text.find('#'));
+
+            if(text.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            try {
+                auto job = command(text, session);
+                enforce(!job.cmd.all().empty(), "no input files given");
+
+                for(const auto& file : job.cmd.all())
+                    enforce(std::ifstream {file}.good(), "file cannot be read '%s'", file);
+
+                line.assign(text.begin(), text.end());
+            } catch(const exception& e) {
+                watchdog::error("skipping job '%s': %s", text, e.what());
+            }
+        }
+
+        std::vector<char> received = mpi::broadcast(line);
+        return std::string {received.begin(), received.end()};
+    }
+
+    /**
+     * Runs a batch of jobs within a single session. The nodes, their devices and
+     * their thread pools are set up only once, and the devices' memory pools,
+     * scoring tables and tuned kernels are reused by all jobs. Each job is given
+     * by a line with its own command line arguments, and comments are ignored.
+     * @param session The session's own command line arguments.
+     * @param filename The name of the file listing the jobs to run.
+     */
+    static void batch(const std::vector<std::string>& session, const std::string& filename)
+    {
+        std::ifstream file;
+
+        // If the batch file cannot be read, its queue is simply left empty, so all
+        // nodes stop at once, instead of the master node alone.
+        onlymaster if(filename != "-") {
+            file.open(filename);
+            if(!file.good()) watchdog::error("batch file cannot be read '%s'", filename);
+        }
+
+        std::istream& queue = filename != "-" ? file : std::cin;
+
+        for(size_t count = 1; ; ++count) {
+            const auto line = next(queue, session);
+            if(line.empty()) break;
+
+            auto job = command(line, session);
+
+            onlymaster watchdog::info("running job <bold>%llu</>", count);
+            museqa::run(job);
+        }
+    }
 };
 
 /**
@@ -248,8 +483,10 @@ try {
 
     auto io = io::manager::make(options, argc, argv);
 
-    enforce(!io.cmd.all().empty(), "no input files given");
+    enforce(!io.cmd.all().empty() || io.cmd.has("batch"), "no input files given");
+    enforce(io.cmd.all().empty() || !io.cmd.has("batch"), "input files must be given by the batch's jobs");
     enforce(node::count >= 2, "at least one slave node is needed");
+    enforce(trace::enabled || !io.cmd.has("trace"), "tracing is not available, it must be compiled with -DTRACING");
 
     onlyslaves try {
         global_state.local_devices = cuda::device::count();
@@ -259,9 +496,32 @@ try {
 
     global_state.report_only = io.cmd.has("report-only");
     onlyslaves global_state.use_multigpu = io.cmd.has("multigpu");
+    global_state.threads = utils::max(io.cmd.get<int>("threads", 1), 1);
+    onlyslaves global_state.node_devices = utils::max(utils::min(io.cmd.get<int>("node-gpus", 1), global_state.local_devices), 1);
     global_state.use_devices = mpi::allreduce(global_state.local_devices, mpi::op::min);
 
-    museqa::run(io);
+    onlyslaves if(global_state.use_devices && io.cmd.has("autotune"))
+        cuda::tuning::init(io.cmd.get("autotune"));
+
+    parallel::init(global_state.threads);
+
+    if(!io.cmd.has("batch")) {
+        museqa::run(io);
+    } else {
+        std::vector<std::string> session;
+
+        // The session's options are passed on to every job, but for the batch
+        // option itself, which is followed by the batch file's name.
+        for(int i = 1; i < argc; ++i)
+            if(std::string {argv[i]} == "-q" || std::string {argv[i]} == "--batch") ++i;
+            else session.push_back(argv[i]);
+
+        museqa::batch(session, io.cmd.get("batch"));
+    }
+
+    if(io.cmd.has("trace"))
+        trace::dump(io.cmd.get("trace"));
+
     mpi::finalize();
 
     return 0;
@@ -43,6 +43,8 @@ namespace museqa
         bool use_multigpu = false;      /// Should MPI nodes use more than one GPU?
         bool use_devices = false;       /// Indicates whether devices should be used by default.
         int local_devices = 0;          /// The number of GPU devices available on node.
+        int node_devices = 1;           /// The number of GPU devices driven by each node.
+        int threads = 1;                /// The number of host threads to use on node.
 
         const env environment;          /// The execution runtime's environment.
 
@@ -5,12 +5,130 @@
  * @copyright 2020-present Rodrigo Siqueira
  */
 #include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 
 #include "io.hpp"
+#include "mpi.hpp"
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
 #include "pipeline.hpp"
 #include "exception.hpp"
 
+#include "stream.hpp"
 #include "pairwise.cuh"
+#include "pairwise/digest.hpp"
+#include "pairwise/kmer/kmer.cuh"
+
+namespace
+{
+    using namespace museqa;
+    namespace pw = museqa::pairwise;
+
+    /*
+     * Definitions of the pairwise checkpoint file format. The file is laid out as
+     * its header, followed by the distance matrix's scores in its linear layout.
+     */
+    static constexpr char magic[8] = {'M', 'U', 'S', 'E', 'Q', 'A', 'P', 'C'};
+    enum : uint64_t { version = 1 };
+
+    /**
+     * The pairwise checkpoint file's header.
+     * @since 0.1.1
+     */
+    struct header
+    {
+        char magic[8];                      /// The file's magic number.
+        uint64_t version;                   /// The file format's version.
+        uint64_t count;                     /// The number of sequences in file.
+        uint64_t key;                       /// The digest of the run the scores belong to.
+    };
+
+    /**
+     * Digests the sequences and setup the module's scores are computed from. A
+     * checkpoint is only resumed from if it has been saved with the same digest.
+     * @param io The pipeline's IO service instance.
+     * @param db The database of sequences being aligned.
+     * @return The run's digest.
+     */
+    static auto key(const io::manager& io, const museqa::database& db) -> uint64_t
+    {
+        auto algoname = io.cmd.get("pairwise", "default");
+        auto tablename = io.cmd.get("scoring-table", "default");
+        auto kmer = io.cmd.get<size_t>("kmer-size", pw::kmer::default_length);
+        auto sketch = io.cmd.get<size_t>("sketch-size", pw::kmer::default_sketch);
+
+        auto table = pw::scoring_table::make(tablename);
+        auto value = pw::digest::setup(table, algoname, kmer, sketch);
+
+        for(const auto& entry : db) {
+            const uint64_t contents = pw::digest::contents(entry.contents);
+            value = pw::digest::fnv(&contents, sizeof(contents), value);
+        }
+
+        return value;
+    }
+
+    /**
+     * Loads the scores saved into a checkpoint file. If the file does not exist
+     * or has been saved for a different run, no scores are loaded.
+     * @param filename The name of the checkpoint file.
+     * @param count The number of sequences being aligned.
+     * @param expected The digest of the current run.
+     * @return The loaded scores, if any.
+     */
+    static auto restore(const std::string& filename, size_t count, uint64_t expected) -> buffer<pw::score>
+    {
+        std::ifstream file (filename, std::ifstream::binary);
+        header head;
+
+        if(!file.read(reinterpret_cast<char *>(&head), sizeof(head)))
+            return buffer<pw::score> {};
+
+        enforce(!memcmp(head.magic, magic, sizeof(magic)), "file is not a valid pairwise checkpoint '%s'", filename);
+
+        if(head.version != version || head.count != count || head.key != expected)
+            return buffer<pw::score> {};
+
+        auto scores = buffer<pw::score>::make(utils::nchoose(count));
+        file.read(reinterpret_cast<char *>(scores.raw()), scores.size() * sizeof(pw::score));
+
+        enforce(!file.fail(), "corrupted pairwise checkpoint '%s'", filename);
+        return scores;
+    }
+
+    /**
+     * Saves the scores into a checkpoint file. The file is first written aside and
+     * then moved into place, so a run killed while saving leaves no broken file.
+     * @param filename The name of the checkpoint file.
+     * @param count The number of sequences being aligned.
+     * @param key The digest of the current run.
+     * @param scores The distance matrix's scores.
+     */
+    static void save(const std::string& filename, size_t count, uint64_t key, const buffer<pw::score>& scores)
+    {
+        const auto partial = filename + ".tmp";
+        std::ofstream file (partial, std::ofstream::binary | std::ofstream::trunc);
+        enforce(!file.fail(), "file cannot be written '%s'", partial);
+
+        header head;
+        memcpy(head.magic, magic, sizeof(head.magic));
+
+        head.version = version;
+        head.count   = count;
+        head.key     = key;
+
+        file.write(reinterpret_cast<const char *>(&head), sizeof(head));
+        file.write(reinterpret_cast<const char *>(scores.raw()), scores.size() * sizeof(pw::score));
+
+        file.close();
+        enforce(!file.fail(), "file cannot be written '%s'", partial);
+        enforce(!std::rename(partial.c_str(), filename.c_str()), "file cannot be written '%s'", filename);
+    }
+}
 
 namespace museqa
 {
@@ -28,11 +146,91 @@ namespace museqa
         {
             auto algoname = io.cmd.get("pairwise", "default");
             auto tablename = io.cmd.get("scoring-table", "default");
+            auto partition = io.cmd.get("partition", "uniform");
+            auto kmer = io.cmd.get<size_t>("kmer-size", pw::kmer::default_length);
+            auto sketch = io.cmd.get<size_t>("sketch-size", pw::kmer::default_sketch);
             auto previous = pipeline::convert<pairwise::previous>(pipe);
 
+            auto directory = io.cmd.get("checkpoint", "");
             auto table = pw::scoring_table::make(tablename);
+
+            // While the module runs, the scores aligned so far are saved aside from
+            // the module's checkpoint, so an interrupted run loses as little as possible.
+            pw::progress saved {};
+
+            onlymaster if(!directory.empty())
+                saved = pw::progress {directory + "/" + this->name() + ".part", ::key(io, previous->db)};
+
+            if(io.cmd.has("consistency")) {
+                auto outcome = pw::consistency::run(previous->db, table, partition);
+                stream::complete();
+
+                return pipeline::pipe {new pairwise::conduit {previous->db, outcome.distances, outcome.result}};
+            }
             
-            auto result = pw::run(previous->db, table, algoname);
+            auto result = io.cmd.has("incremental")
+                ? pw::incremental(io.cmd.get("incremental"), previous->db, table, algoname, partition, kmer, sketch)
+                : io.cmd.has("score-cache")
+                ? pw::cached(io.cmd.get("score-cache"), previous->db, table, algoname, partition, kmer, sketch)
+                : pw::run(previous->db, table, algoname, partition, kmer, sketch, saved);
+            stream::complete();
+
+            auto ptr = new pairwise::conduit {previous->db, result};
+
+            return pipeline::pipe {ptr};
+        }
+
+        /**
+         * Saves the module's distance matrix into a checkpoint, on the master node.
+         * As a consistency library is not saved, runs building one are never saved.
+         * @param io The pipeline's IO service instance.
+         * @param result The module's resulting conduit.
+         * @param filename The name of the module's checkpoint file.
+         */
+        void pairwise::checkpoint(
+                const io::manager& io
+            ,   pipeline::pipe&
+            ,   pipeline::pipe& result
+            ,   const std::string& filename
+            ) const
+        {
+            auto current = pipeline::convert<pairwise>(result);
+
+            onlymaster if(!io.cmd.has("consistency") && current->count > 1)
+                ::save(filename, current->count, ::key(io, current->db), current->distances.linear());
+        }
+
+        /**
+         * Resumes the module from its checkpoint. The checkpoint is only read by
+         * the master node, as the distance matrix is only known by it anyway.
+         * @param io The pipeline's IO service instance.
+         * @param pipe The previous module's conduit.
+         * @param filename The name of the module's checkpoint file.
+         * @return The resumed conduit, or an empty pipe if it cannot be resumed.
+         */
+        auto pairwise::resume(const io::manager& io, pipeline::pipe& pipe, const std::string& filename) const
+        -> pipeline::pipe
+        {
+            auto previous = pipeline::convert<pairwise::previous>(pipe);
+
+            buffer<pw::score> scores;
+            size_t resumed = 0;
+
+            onlymaster if(!io.cmd.has("consistency") && previous->total > 1) {
+                scores = ::restore(filename, previous->total, ::key(io, previous->db));
+                resumed = scores.size() > 0;
+            }
+
+            #if !defined(__museqa_runtime_cython)
+                resumed = mpi::broadcast(&resumed);
+            #endif
+
+            if(!resumed)
+                return pipeline::pipe {};
+
+            stream::complete();
+
+            auto result = pw::distance_matrix {scores, previous->total};
             auto ptr = new pairwise::conduit {previous->db, result};
 
             return pipeline::pipe {ptr};
@@ -50,6 +248,18 @@ namespace museqa
 
             auto tablename = io.cmd.get("scoring-table", "default");
             enforce(pw::scoring_table::has(tablename), "unknown scoring table chosen: '%s'", tablename);
+
+            auto partition = io.cmd.get("partition", "uniform");
+            enforce(pw::algorithm::partitionable(partition), "unknown pairwise partition chosen: '%s'", partition);
+
+            auto kmer = io.cmd.get<size_t>("kmer-size", pw::kmer::default_length);
+            enforce(kmer > 0 && kmer <= pw::kmer::max_length, "k-mer size must be between 1 and %llu", pw::kmer::max_length);
+
+            auto persisted = io.cmd.has("incremental") && io.cmd.has("score-cache");
+            enforce(!persisted, "incremental mode and scores cache cannot be used together");
+
+            auto consistent = io.cmd.has("consistency") && (io.cmd.has("incremental") || io.cmd.has("score-cache"));
+            enforce(!consistent, "consistency library cannot be built from persisted scores");
             
             return true;
         }
@@ -21,6 +21,7 @@
  */
 
 #include "pairwise/pairwise.cuh"
+#include "pairwise/consistency/consistency.cuh"
 
 namespace museqa
 {
@@ -47,19 +48,25 @@ namespace museqa
 
             auto run(const io::manager&, pipeline::pipe&) const -> pipeline::pipe override;
             auto check(const io::manager&) const -> bool override;
+
+            void checkpoint(const io::manager&, pipeline::pipe&, pipeline::pipe&, const std::string&) const override;
+            auto resume(const io::manager&, pipeline::pipe&, const std::string&) const -> pipeline::pipe override;
         };
 
         /**
          * Defines the module's conduit. This conduit is composed of the sequences
-         * that have been aligned and their pairwise distance matrix.
+         * that have been aligned, their pairwise distance matrix and, optionally,
+         * their consistency library.
          * @since 0.1.1
          */
         struct pairwise::conduit : public pipeline::conduit
         {
             typedef museqa::pairwise::distance_matrix distance_matrix;
+            typedef museqa::pairwise::consistency::library library_type;
 
             database db;                    /// The loaded sequences' database.
             distance_matrix distances;      /// The sequences' pairwise distances.
+            library_type library;           /// The sequences' consistency library, if built.
             const size_t count;             /// The total number of sequences.
 
             inline conduit() noexcept = delete;
@@ -77,6 +84,19 @@ namespace museqa
             ,   count {db.count()}
             {}
 
+            /**
+             * Instantiates a new conduit with a consistency library.
+             * @param mdb The sequence database to transfer to the next module.
+             * @param mmat The database's resulting pairwise distance matrix.
+             * @param mlib The database's consistency library.
+             */
+            inline conduit(database& mdb, distance_matrix& mmat, library_type& mlib) noexcept
+            :   db {std::move(mdb)}
+            ,   distances {std::move(mmat)}
+            ,   library {std::move(mlib)}
+            ,   count {db.count()}
+            {}
+
             inline conduit& operator=(const conduit&) = delete;
             inline conduit& operator=(conduit&&) = delete;
         };
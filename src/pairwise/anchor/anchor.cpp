@@ -0,0 +1,217 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the search of anchors shared by a pair of sequences.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+
+#include "pairwise/kmer/kmer.cuh"
+#include "pairwise/anchor/anchor.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    /**
+     * A k-mer occurrence within a sequence, identified by its packed units.
+     * @since 0.1.1
+     */
+    using occurrence = std::pair<kmer::hash, uint32_t>;
+
+    /**
+     * Checks whether a unit may be part of an anchor. Just as with the k-mers,
+     * anchors must never span over gaps or the sequences' padding.
+     * @param unit The unit to be checked.
+     * @return Can the unit be anchored?
+     */
+    inline bool valid(encoder::unit unit) noexcept
+    {
+        return unit != encoder::end && unit != encoder::gap;
+    }
+
+    /**
+     * Informs the diagonal on which a pair of positions lies.
+     * @param i The position on the first sequence.
+     * @param j The position on the second sequence.
+     * @return The positions' diagonal.
+     */
+    inline int64_t diagonal(uint32_t i, uint32_t j) noexcept
+    {
+        return int64_t(i) - int64_t(j);
+    }
+
+    /**
+     * Lists the k-mers which occur exactly once within a sequence. Repeated k-mers
+     * cannot be told apart from each other, so they are never used as anchors.
+     * @param units The sequence's decoded units.
+     * @param size The sequence's number of units.
+     * @param length The k-mers' length.
+     * @return The sequence's unique k-mers, sorted by their packed units.
+     */
+    static auto unique(const encoder::unit *units, size_t size, size_t length) -> std::vector<occurrence>
+    {
+        const kmer::hash mask = (kmer::hash(1) << (5 * length)) - 1;
+
+        std::vector<occurrence> list;
+        kmer::hash packed = 0;
+
+        list.reserve(size);
+
+        for(size_t i = 0, count = 0; i < size; ++i) {
+            if(!valid(units[i])) {
+                count = 0;
+                continue;
+            }
+
+            packed = ((packed << 5) | units[i]) & mask;
+
+            if(++count >= length)
+                list.push_back({packed, uint32_t(i + 1 - length)});
+        }
+
+        std::sort(list.begin(), list.end());
+
+        size_t kept = 0;
+
+        for(size_t i = 0, j; i < list.size(); i = j) {
+            for(j = i + 1; j < list.size() && list[j].first == list[i].first; ++j);
+            if(j == i + 1) list[kept++] = list[i];
+        }
+
+        list.resize(kept);
+        return list;
+    }
+
+    /**
+     * Finds the longest collinear subset of the k-mers shared by both sequences.
+     * As the hits are sorted by their position on the first sequence, this is the
+     * longest strictly increasing subsequence on their positions on the second.
+     * @param hits The positions of the k-mers shared by both sequences.
+     * @return The collinear hits, in order.
+     */
+    static auto collinear(const std::vector<std::pair<uint32_t, uint32_t>>& hits)
+    -> std::vector<std::pair<uint32_t, uint32_t>>
+    {
+        std::vector<size_t> tails, previous (hits.size());
+
+        for(size_t k = 0; k < hits.size(); ++k) {
+            const auto it = std::lower_bound(tails.begin(), tails.end(), hits[k].second, [&](size_t t, uint32_t value) {
+                return hits[t].second < value;
+            });
+
+            previous[k] = it == tails.begin() ? ~size_t(0) : *(it - 1);
+
+            if(it == tails.end()) tails.push_back(k);
+            else *it = k;
+        }
+
+        std::vector<std::pair<uint32_t, uint32_t>> result (tails.size());
+
+        for(size_t k = tails.size(), t = tails.empty() ? 0 : tails.back(); k-- > 0; t = previous[t])
+            result[k] = hits[t];
+
+        return result;
+    }
+}
+
+namespace museqa
+{
+    /**
+     * Finds a chain of anchors shared by two sequences. Unique k-mers shared by
+     * both sequences are chained so they are collinear, those on the same diagonal
+     * are merged, and every anchor is then extended for as long as it matches
+     * exactly. Short anchors are dropped, as they are likely to be spurious.
+     * @param one The first sequence's decoded units.
+     * @param n The first sequence's number of units.
+     * @param two The second sequence's decoded units.
+     * @param m The second sequence's number of units.
+     * @param length The seeds' length.
+     * @return The chain of anchors between the sequences.
+     */
+    auto pairwise::anchor::find(
+            const encoder::unit *one, size_t n
+        ,   const encoder::unit *two, size_t m
+        ,   size_t length
+        ) -> chain
+    {
+        length = utils::min<size_t>(utils::max<size_t>(length, 1), kmer::max_length);
+
+        const auto first = unique(one, n, length);
+        const auto second = unique(two, m, length);
+
+        std::vector<std::pair<uint32_t, uint32_t>> hits;
+
+        for(size_t i = 0, j = 0; i < first.size() && j < second.size(); ) {
+            if(first[i].first < second[j].first) ++i;
+            else if(second[j].first < first[i].first) ++j;
+            else hits.push_back({first[i++].second, second[j++].second});
+        }
+
+        std::sort(hits.begin(), hits.end());
+
+        chain seeds;
+
+        // Hits on the same diagonal as the last anchor are merged into it. Otherwise,
+        // a hit's beginning is trimmed off if it overlaps the last anchor on either
+        // of the sequences, so that anchors never overlap.
+        for(const auto& hit : collinear(hits)) {
+            if(!seeds.empty()) {
+                auto& last = seeds.back();
+                const uint32_t end[2] = {last.one + last.length, last.two + last.length};
+
+                if(diagonal(hit.first, hit.second) == diagonal(last.one, last.two) && hit.first <= end[0]) {
+                    last.length = utils::max<uint32_t>(end[0], hit.first + uint32_t(length)) - last.one;
+                    continue;
+                }
+
+                const uint32_t skip = utils::max<uint32_t>(
+                        end[0] > hit.first ? end[0] - hit.first : 0
+                    ,   end[1] > hit.second ? end[1] - hit.second : 0
+                    );
+
+                if(skip < length)
+                    seeds.push_back({hit.first + skip, hit.second + skip, uint32_t(length) - skip});
+            } else {
+                seeds.push_back({hit.first, hit.second, uint32_t(length)});
+            }
+        }
+
+        chain result;
+
+        for(size_t k = 0; k < seeds.size(); ++k) {
+            auto current = seeds[k];
+
+            const uint32_t low[2] = {
+                    result.empty() ? 0 : result.back().one + result.back().length
+                ,   result.empty() ? 0 : result.back().two + result.back().length
+                };
+
+            const uint32_t high[2] = {
+                    k + 1 < seeds.size() ? seeds[k + 1].one : uint32_t(n)
+                ,   k + 1 < seeds.size() ? seeds[k + 1].two : uint32_t(m)
+                };
+
+            while(current.one > low[0] && current.two > low[1] && valid(one[current.one - 1])
+                && one[current.one - 1] == two[current.two - 1])
+                { --current.one; --current.two; ++current.length; }
+
+            while(current.one + current.length < high[0] && current.two + current.length < high[1]
+                && valid(one[current.one + current.length])
+                && one[current.one + current.length] == two[current.two + current.length])
+                ++current.length;
+
+            if(current.length >= 2 * length)
+                result.push_back(current);
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,53 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the search for anchors shared by a pair of long sequences.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "encoder.hpp"
+
+#include "pairwise/kmer/kmer.cuh"
+
+namespace museqa
+{
+    namespace pairwise
+    {
+        namespace anchor
+        {
+            /*
+             * The anchors' configuration parameters. Seeds are k-mers packed just
+             * like the k-mer algorithm's, so their length is limited in the same way.
+             * Sequences shorter than the threshold are not worth anchoring at all.
+             */
+            enum : size_t { default_length = kmer::max_length };
+            enum : size_t { threshold = 1 << 12 };
+
+            /**
+             * An anchor between two sequences. An anchor is an exact match between
+             * both sequences, which is assumed to be part of their optimal alignment,
+             * so only the segments between consecutive anchors must be aligned.
+             * @since 0.1.1
+             */
+            struct seed
+            {
+                uint32_t one;                   /// The anchor's position on the first sequence.
+                uint32_t two;                   /// The anchor's position on the second sequence.
+                uint32_t length;                /// The anchor's number of units.
+            };
+
+            /**
+             * A chain of anchors. The anchors in a chain are collinear and never
+             * overlap, so both of their positions are strictly increasing.
+             * @since 0.1.1
+             */
+            using chain = std::vector<seed>;
+
+            extern auto find(const encoder::unit *, size_t, const encoder::unit *, size_t, size_t) -> chain;
+        }
+    }
+}
@@ -0,0 +1,389 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the pairwise module's persistent scores cache.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mpi.hpp"
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "database.hpp"
+#include "exception.hpp"
+
+#include "pairwise/digest.hpp"
+#include "pairwise/pairwise.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    /*
+     * Definitions of the scores cache file format. A cache directory holds one
+     * file for each setup scores have been computed with. Each file is an open
+     * addressing hash table, with linear probing, from the digest of a pair of
+     * sequences to the pair's score. The table is memory mapped as is, so its
+     * pairs can be looked up without the file having to be read beforehand.
+     */
+    static constexpr char magic[8] = {'M', 'U', 'S', 'E', 'Q', 'A', 'S', 'C'};
+    enum : uint64_t { version = 1 };
+    enum : uint64_t { min_capacity = 1024 };
+
+    /*
+     * The least share of cached pairs for only the missing pairs to be listed and
+     * aligned. When fewer pairs are cached, the list of missing pairs would be as
+     * large as the whole pair space itself, so all pairs are plainly aligned again.
+     */
+    enum : uint64_t { min_hit_share = 8 };
+
+    /**
+     * The scores cache file's header.
+     * @since 0.1.1
+     */
+    struct header
+    {
+        char magic[8];                      /// The file's magic number.
+        uint64_t version;                   /// The file format's version.
+        uint64_t capacity;                  /// The number of slots in the table.
+        uint64_t count;                     /// The number of occupied slots.
+    };
+
+    /**
+     * A slot of the scores cache table. A slot with a zero key is empty.
+     * @since 0.1.1
+     */
+    struct slot
+    {
+        uint64_t key;                       /// The digest of the slot's pair.
+        score value;                        /// The pair's score.
+        uint32_t padding;                   /// Unused, keeps slots aligned.
+    };
+
+    /**
+     * Maps the key of a pair into the table, never to the empty slots' key.
+     * @param one The first sequence's digest.
+     * @param two The second sequence's digest.
+     * @return The pair's key.
+     */
+    inline auto key(uint64_t one, uint64_t two) noexcept -> uint64_t
+    {
+        const uint64_t value = digest::pair(one, two);
+        return value ? value : 1;
+    }
+
+    /**
+     * A memory mapped scores cache file. If the file does not exist or is not
+     * valid, the cache is simply empty and every pair must be aligned.
+     * @since 0.1.1
+     */
+    class store
+    {
+        protected:
+            void *m_mapping = nullptr;          /// The file's mapped contents.
+            size_t m_size = 0;                  /// The file's size.
+            const slot *m_slots = nullptr;      /// The table's slots.
+            uint64_t m_capacity = 0;            /// The table's number of slots.
+            uint64_t m_count = 0;               /// The table's number of occupied slots.
+
+        public:
+            /**
+             * Maps the given cache file into memory.
+             * @param filename The name of the file to be mapped.
+             */
+            inline explicit store(const std::string& filename)
+            {
+                struct stat info;
+                int fd = filename.empty() ? -1 : open(filename.c_str(), O_RDONLY);
+
+                if(fd < 0) return;
+
+                m_size = (fstat(fd, &info) == 0) ? info.st_size : 0;
+                void *ptr = (m_size >= sizeof(header))
+                    ? mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0)
+                    : MAP_FAILED;
+
+                close(fd);
+                if(ptr == MAP_FAILED) return;
+
+                const auto *head = static_cast<const header *>(ptr);
+                m_mapping = ptr;
+
+                enforce(!memcmp(head->magic, magic, sizeof(magic)), "file is not a valid scores cache '%s'", filename);
+                enforce(head->version == version, "unsupported scores cache version '%s'", filename);
+                enforce(head->capacity && !(head->capacity & (head->capacity - 1)), "corrupted scores cache '%s'", filename);
+                enforce(head->capacity <= (m_size - sizeof(header)) / sizeof(slot), "corrupted scores cache '%s'", filename);
+
+                m_slots = reinterpret_cast<const slot *>(static_cast<const char *>(ptr) + sizeof(header));
+                m_capacity = head->capacity;
+                m_count = head->count;
+
+                madvise(ptr, m_size, MADV_RANDOM);
+            }
+
+            store(const store&) = delete;
+            store& operator=(const store&) = delete;
+
+            /**
+             * Unmaps the file from memory.
+             */
+            inline ~store()
+            {
+                if(m_mapping) munmap(m_mapping, m_size);
+            }
+
+            /**
+             * Looks a pair up in the cache.
+             * @param key The pair's key.
+             * @return The pair's slot, or null if the pair is not cached.
+             */
+            inline auto find(uint64_t key) const noexcept -> const slot *
+            {
+                for(uint64_t i = key & (m_capacity - 1), n = 0; n < m_capacity; i = (i + 1) & (m_capacity - 1), ++n) {
+                    if(m_slots[i].key == key) return &m_slots[i];
+                    if(m_slots[i].key == 0) break;
+                }
+
+                return nullptr;
+            }
+
+            /**
+             * Gives access to the table's slots.
+             * @return The pointer to the table's first slot.
+             */
+            inline auto slots() const noexcept -> const slot *
+            {
+                return m_slots;
+            }
+
+            /**
+             * Informs the table's number of slots.
+             * @return The table's capacity.
+             */
+            inline auto capacity() const noexcept -> uint64_t
+            {
+                return m_capacity;
+            }
+
+            /**
+             * Informs the number of pairs in the cache.
+             * @return The number of cached pairs.
+             */
+            inline auto count() const noexcept -> uint64_t
+            {
+                return m_count;
+            }
+    };
+
+    /**
+     * Lists the pairs missing from the cache, from the bitmap of cached pairs. The
+     * pairs are listed in the same order as their offsets in the pair space.
+     * @param hits The bitmap of cached pairs, indexed by the pairs' offsets.
+     * @param count The number of sequences in the database.
+     * @return The list of pairs missing from the cache.
+     */
+    static auto missing(const std::vector<uint8_t>& hits, size_t count) -> buffer<pair>
+    {
+        const size_t space = utils::nchoose(count);
+        size_t total = 0;
+
+        for(size_t c = 0; c < space; ++c)
+            total += !(hits[c >> 3] & (1 << (c & 7)));
+
+        auto pairs = buffer<pair>::make(total);
+
+        for(size_t i = 1, c = 0, k = 0; i < count; ++i)
+            for(size_t j = 0; j < i; ++j, ++c)
+                if(!(hits[c >> 3] & (1 << (c & 7))))
+                    pairs[k++] = pair {seqref(i), seqref(j)};
+
+        return pairs;
+    }
+
+    /**
+     * Informs the name of the cache file for a given setup.
+     * @param dirname The cache directory.
+     * @param setup The setup's digest.
+     * @return The cache file's name.
+     */
+    static auto location(const std::string& dirname, uint64_t setup) -> std::string
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.msc", static_cast<unsigned long long>(setup));
+        return dirname + name;
+    }
+
+    /**
+     * Writes a new cache file with both the previously cached and the newly
+     * aligned pairs. The file is written aside and then renamed over the old
+     * one, so a concurrent run never maps a partially written file.
+     * @param filename The name of the cache file.
+     * @param cache The previously cached pairs.
+     * @param fresh The newly aligned pairs.
+     */
+    static void save(const std::string& filename, const store& cache, const std::vector<slot>& fresh)
+    {
+        uint64_t capacity = min_capacity;
+        uint64_t count = 0;
+
+        while(capacity < 2 * (cache.count() + fresh.size()))
+            capacity <<= 1;
+
+        auto table = std::vector<slot> (capacity, slot {0, 0, 0});
+
+        auto insert = [&](const slot& entry) {
+            uint64_t i = entry.key & (capacity - 1);
+
+            while(table[i].key && table[i].key != entry.key)
+                i = (i + 1) & (capacity - 1);
+
+            count += !table[i].key;
+            table[i] = entry;
+        };
+
+        for(uint64_t i = 0; i < cache.capacity(); ++i)
+            if(cache.slots()[i].key) insert(cache.slots()[i]);
+
+        for(const auto& entry : fresh)
+            insert(entry);
+
+        header head;
+        memcpy(head.magic, magic, sizeof(head.magic));
+
+        head.version  = version;
+        head.capacity = capacity;
+        head.count    = count;
+
+        const auto temporary = filename + "." + std::to_string(getpid());
+        std::ofstream file (temporary, std::ofstream::binary | std::ofstream::trunc);
+        enforce(!file.fail(), "file cannot be written '%s'", temporary);
+
+        file.write(reinterpret_cast<const char *>(&head), sizeof(head));
+        file.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(slot));
+        file.close();
+
+        enforce(!file.fail() && !rename(temporary.c_str(), filename.c_str()), "file cannot be written '%s'", filename);
+    }
+}
+
+namespace museqa
+{
+    namespace pairwise
+    {
+        /**
+         * Runs the module over a persistent cache of pairwise scores. Every pair is
+         * looked up in the cache before any pair is scheduled, so only the pairs
+         * not cached are aligned. The newly aligned pairs are then added to the cache.
+         * @param dirname The cache directory.
+         * @param db The database of sequences to align.
+         * @param table The chosen scoring table.
+         * @param algorithm The chosen pairwise algorithm.
+         * @param partition The chosen pairs partitioning strategy.
+         * @param kmer The k-mer length, or zero for the algorithm's default.
+         * @param sketch The sketch size, or zero for keeping all k-mers.
+         * @return The resulting distance matrix, on the master node.
+         */
+        auto cached(
+                const std::string& dirname
+            ,   const museqa::database& db
+            ,   const scoring_table& table
+            ,   const std::string& algorithm
+            ,   const std::string& partition
+            ,   size_t kmer
+            ,   size_t sketch
+            ) -> distance_matrix
+        {
+            const size_t count = db.count();
+            const auto filename = ::location(dirname, digest::setup(table, algorithm, kmer, sketch));
+
+            std::vector<uint64_t> digests;
+            std::vector<uint8_t> hits;
+            buffer<score> scores;
+
+            size_t found = 0;
+            bool plain = false;
+
+            onlymaster {
+                enforce(!mkdir(dirname.c_str(), 0755) || errno == EEXIST, "cache directory cannot be created '%s'", dirname);
+            }
+
+            ::store cache {node::rank == node::master ? filename : std::string {}};
+
+            onlymaster {
+                scores = buffer<score>::make(utils::nchoose(count));
+                hits.resize((utils::nchoose(count) + 7) / 8, 0);
+
+                for(const auto& entry : db)
+                    digests.push_back(digest::contents(entry.contents));
+
+                for(size_t i = 1, c = 0; i < count; ++i) {
+                    for(size_t j = 0; j < i; ++j, ++c) {
+                        if(const auto hit = cache.find(::key(digests[i], digests[j]))) {
+                            hits[c >> 3] |= 1 << (c & 7);
+                            scores[c] = hit->value;
+                            ++found;
+                        }
+                    }
+                }
+
+                plain = found * min_hit_share < utils::nchoose(count);
+            }
+
+            // Only the bitmap of cached pairs is sent to the slaves, which then list
+            // the missing pairs by themselves. The bitmap is not needed at all if
+            // so few pairs are cached that all pairs must be plainly aligned again.
+            #if !defined(__museqa_runtime_cython)
+                plain = mpi::broadcast(&plain);
+                found = mpi::broadcast(&found);
+                if(!plain) hits = mpi::broadcast(hits);
+            #endif
+
+            if(found < utils::nchoose(count)) {
+                auto pairs = plain ? buffer<pair> {} : ::missing(hits, count);
+                auto lambda = pairwise::algorithm::make(algorithm);
+
+                const pairwise::algorithm *worker = lambda ();
+                auto result = worker->run({db, table, partition, kmer, sketch, 0, pairs});
+
+                delete worker;
+
+                onlymaster {
+                    const auto& aligned = result.linear();
+                    auto fresh = std::vector<slot> ();
+
+                    if(plain) {
+                        for(size_t i = 1, c = 0; i < count; ++i)
+                            for(size_t j = 0; j < i; ++j, ++c)
+                                if(!(hits[c >> 3] & (1 << (c & 7))))
+                                    fresh.push_back(slot {::key(digests[i], digests[j]), aligned[c], 0});
+
+                        scores = aligned;
+                    } else {
+                        for(size_t i = 0; i < pairs.size(); ++i) {
+                            const size_t x = pairs[i].first, y = pairs[i].second;
+                            scores[utils::nchoose(x) + y] = aligned[i];
+                            fresh.push_back(slot {::key(digests[x], digests[y]), aligned[i], 0});
+                        }
+                    }
+
+                    ::save(filename, cache, fresh);
+                }
+            }
+
+            return distance_matrix {scores, count};
+        }
+    }
+}
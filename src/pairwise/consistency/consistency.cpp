@@ -0,0 +1,319 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the consistency library built from pairwise alignments.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "mpi.hpp"
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
+
+#include "pairwise/pairwise.cuh"
+#include "pairwise/needleman/kernel.hpp"
+#include "pairwise/needleman/needleman.cuh"
+#include "pairwise/consistency/consistency.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    using consistency::match;
+    using consistency::library;
+    using needleman::policy::operation;
+
+    /**
+     * Lays the given matches out as a symmetric compressed sparse library. Matches
+     * between the same pair of residues are merged, by adding their weights up.
+     * @param origin The global index of each sequence's first residue.
+     * @param matches The matches to compose the library with.
+     * @return The new library.
+     */
+    static auto assemble(std::vector<uint32_t> origin, const std::vector<match>& matches) -> library
+    {
+        std::vector<match> entries;
+        entries.reserve(2 * matches.size());
+
+        for(const auto& current : matches)
+            if(current.weight > 0) {
+                entries.push_back({current.one, current.two, current.weight});
+                entries.push_back({current.two, current.one, current.weight});
+            }
+
+        std::sort(entries.begin(), entries.end(), [](const match& a, const match& b) {
+            return a.one < b.one || (a.one == b.one && a.two < b.two);
+        });
+
+        library result;
+        result.origin = std::move(origin);
+        result.offset.assign(result.residues() + 1, 0);
+
+        for(size_t i = 0; i < entries.size(); ++i) {
+            if(i > 0 && entries[i].one == entries[i - 1].one && entries[i].two == entries[i - 1].two) {
+                result.weight.back() += entries[i].weight;
+                continue;
+            }
+
+            result.column.push_back(entries[i].two);
+            result.weight.push_back(entries[i].weight);
+            ++result.offset[entries[i].one + 1];
+        }
+
+        for(size_t r = 0; r < result.residues(); ++r)
+            result.offset[r + 1] += result.offset[r];
+
+        return result;
+    }
+
+    /**
+     * Aligns two sequences and lists the pairs of residues matched by their
+     * alignment. Every match is weighted by the alignment's identity, that is,
+     * the fraction of its matched residues which are identical.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param first The global index of the first sequence's first residue.
+     * @param second The global index of the second sequence's first residue.
+     * @param table The scoring table used to compare both sequences.
+     * @param out The list to append the alignment's matches to.
+     * @return The alignment score.
+     */
+    static score align_pair(
+            const sequence& one, const sequence& two
+        ,   uint32_t first, uint32_t second
+        ,   const scoring_table& table
+        ,   std::vector<match>& out
+        )
+    {
+        thread_local std::vector<encoder::unit> decoded[2];
+        decoded[0].resize(one.length()); one.unpack(decoded[0].data());
+        decoded[1].resize(two.length()); two.unpack(decoded[1].data());
+
+        const auto result = needleman::align<needleman::policy::traceback>(
+                decoded[0].data(), one.unpadded()
+            ,   decoded[1].data(), two.unpadded()
+            ,   table
+            );
+
+        const size_t start = out.size();
+        size_t identical = 0;
+
+        for(size_t i = 0, j = 0, k = 0; k < result.script.size(); ++k) {
+            if(result.script[k] == operation::match) {
+                identical += decoded[0][i] == decoded[1][j];
+                out.push_back({uint32_t(first + i++), uint32_t(second + j++), 0});
+            } else {
+                result.script[k] == operation::deletion ? ++i : ++j;
+            }
+        }
+
+        const score identity = out.size() > start ? score(identical) / (out.size() - start) : 0;
+
+        for(size_t k = start; k < out.size(); ++k)
+            out[k].weight = identity;
+
+        return result.value;
+    }
+
+    /**
+     * The consistency library builder. The node's pairs are aligned with their
+     * traceback, so both the pairs' scores and their matched residues are produced
+     * by the same alignment. The scores are gathered just as any other needleman
+     * algorithm's, while the matches are kept to be shared among the nodes.
+     * @since 0.1.1
+     */
+    struct builder : public needleman::algorithm
+    {
+        mutable std::vector<match> found;   /// The matches found by the node's alignments.
+
+        /**
+         * Aligns the node's pairs, keeping their matched residues.
+         * @param ctx The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            const size_t count = ctx.db.count();
+            std::vector<uint32_t> origin (count + 1, 0);
+            buffer<score> result;
+
+            for(size_t i = 0; i < count; ++i)
+                origin[i + 1] = origin[i] + uint32_t(ctx.db[i].contents.unpadded());
+
+            onlyslaves {
+                const auto pairs = this->generate(ctx);
+                std::vector<std::vector<match>> partial (utils::max<size_t>(parallel::global().size(), 1));
+
+                result = buffer<score>::make(pairs.size());
+
+                parallel::foreach(pairs.size(), [&](const range<size_t>& partition, size_t id) {
+                    for(size_t i = partition.offset; i < partition.offset + partition.total; ++i) {
+                        const auto x = pairs[i].first, y = pairs[i].second;
+                        result[i] = align_pair(
+                                ctx.db[x].contents, ctx.db[y].contents
+                            ,   origin[x], origin[y]
+                            ,   ctx.table, partial[id]
+                            );
+                    }
+                });
+
+                for(const auto& list : partial)
+                    found.insert(found.end(), list.begin(), list.end());
+            }
+
+            return distance_matrix {this->gather(result), count};
+        }
+    };
+
+    /**
+     * Shares the matches found by every node with all nodes, so each node can
+     * build the whole library on its own.
+     * @param found The matches found by the current node.
+     * @return The matches found by all nodes.
+     */
+    static auto share(std::vector<match>& found) -> std::vector<match>
+    {
+        #if !defined(__museqa_runtime_cython)
+            std::vector<uint32_t> residues (2 * found.size());
+            std::vector<score> weights (found.size());
+
+            for(size_t k = 0; k < found.size(); ++k) {
+                residues[2 * k + 0] = found[k].one;
+                residues[2 * k + 1] = found[k].two;
+                weights[k] = found[k].weight;
+            }
+
+            std::vector<uint32_t> rresidues = mpi::allgather(residues);
+            std::vector<score> rweights = mpi::allgather(weights);
+            std::vector<match> result (rweights.size());
+
+            for(size_t k = 0; k < result.size(); ++k)
+                result[k] = {rresidues[2 * k + 0], rresidues[2 * k + 1], rweights[k]};
+
+            return result;
+        #else
+            return std::move(found);
+        #endif
+    }
+}
+
+namespace museqa
+{
+    /**
+     * Builds the consistency library from the matches found by pairwise alignments.
+     * @param db The database of the aligned sequences.
+     * @param matches The matches found by aligning the database's pairs.
+     * @return The sequences' primary library.
+     */
+    auto pairwise::consistency::make(const museqa::database& db, const std::vector<match>& matches) -> library
+    {
+        std::vector<uint32_t> origin (db.count() + 1, 0);
+
+        for(size_t i = 0; i < db.count(); ++i)
+            origin[i + 1] = origin[i] + uint32_t(db[i].contents.unpadded());
+
+        return assemble(std::move(origin), matches);
+    }
+
+    /**
+     * Extends a library by its triplets. A pair of residues from two different
+     * sequences is reinforced by every residue of a third sequence to which both
+     * of them have been matched, by the weakest of both matches. Each pair of
+     * sequences is extended independently, so they're spread among host threads.
+     * The extended weights are normalized by the number of sequences involved.
+     * @param primary The library to be extended.
+     * @return The extended library.
+     */
+    auto pairwise::consistency::extend(const library& primary) -> library
+    {
+        const size_t count = primary.origin.size() - 1;
+        const score normal = score(utils::max<size_t>(count, 2) - 1);
+
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        std::vector<std::vector<match>> partial (utils::max<size_t>(parallel::global().size(), 1));
+
+        for(uint32_t x = 0; x < count; ++x)
+            for(uint32_t y = x + 1; y < count; ++y)
+                pairs.push_back({x, y});
+
+        parallel::foreach(pairs.size(), [&](const range<size_t>& partition, size_t id) {
+            std::vector<score> accumulated;
+            std::vector<uint32_t> touched;
+
+            for(size_t p = partition.offset; p < partition.offset + partition.total; ++p) {
+                const uint32_t x = pairs[p].first, y = pairs[p].second;
+                const uint32_t low = primary.origin[y], high = primary.origin[y + 1];
+
+                accumulated.assign(high - low, 0);
+
+                auto add = [&](uint32_t residue, score value) {
+                    if(accumulated[residue - low] == 0) touched.push_back(residue - low);
+                    accumulated[residue - low] += value;
+                };
+
+                for(uint32_t a = primary.origin[x]; a < primary.origin[x + 1]; ++a) {
+                    for(uint32_t e = primary.offset[a]; e < primary.offset[a + 1]; ++e) {
+                        const uint32_t c = primary.column[e];
+
+                        if(c >= low && c < high) {
+                            add(c, primary.weight[e]);
+                        } else if(c < primary.origin[x] || c >= primary.origin[x + 1]) {
+                            const auto begin = primary.column.begin();
+                            const auto first = std::lower_bound(begin + primary.offset[c], begin + primary.offset[c + 1], low);
+
+                            for(auto it = first; it != begin + primary.offset[c + 1] && *it < high; ++it)
+                                add(*it, utils::min(primary.weight[e], primary.weight[it - begin]));
+                        }
+                    }
+
+                    for(const auto t : touched) {
+                        partial[id].push_back({a, low + t, accumulated[t] / normal});
+                        accumulated[t] = 0;
+                    }
+
+                    touched.clear();
+                }
+            }
+        });
+
+        std::vector<match> matches;
+
+        for(const auto& list : partial)
+            matches.insert(matches.end(), list.begin(), list.end());
+
+        return assemble(primary.origin, matches);
+    }
+
+    /**
+     * Runs the pairwise module while building the consistency library. Slaves
+     * align their pairs with traceback, and emit their alignments' scores and
+     * matched residues. The scores form the distance matrix, while the matches
+     * are shared among all nodes, so each node builds its own extended library.
+     * @param db The database of sequences to align.
+     * @param table The chosen scoring table.
+     * @param partition The chosen pairs partitioning strategy.
+     * @return The pairs' distance matrix and the sequences' extended library.
+     */
+    auto pairwise::consistency::run(
+            const museqa::database& db
+        ,   const scoring_table& table
+        ,   const std::string& partition
+        ) -> outcome
+    {
+        const builder worker;
+        auto distances = worker.run({db, table, partition, 0, 0, 0, {}});
+        auto shared = share(worker.found);
+
+        return {distances, extend(make(db, shared))};
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the consistency library built from the pairwise alignments.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "database.hpp"
+
+#include "pairwise/pairwise.cuh"
+
+namespace museqa
+{
+    namespace pairwise
+    {
+        namespace consistency
+        {
+            /**
+             * A pair of residues matched by the alignment of their sequences. The
+             * residues are identified by their global index, that is, their position
+             * on the concatenation of all the database's sequences.
+             * @since 0.1.1
+             */
+            struct match
+            {
+                uint32_t one;                   /// The first residue's global index.
+                uint32_t two;                   /// The second residue's global index.
+                score weight;                   /// The match's weight.
+            };
+
+            /**
+             * The consistency library of a set of sequences. For each residue, the
+             * library keeps the residues it has been matched to by any pairwise
+             * alignment, and how strongly. The library is symmetric, and laid out
+             * as a compressed sparse matrix whose rows are sorted by column.
+             * @since 0.1.1
+             */
+            struct library
+            {
+                std::vector<uint32_t> origin;   /// The global index of each sequence's first residue.
+                std::vector<uint32_t> offset;   /// The offset of each residue's row of matches.
+                std::vector<uint32_t> column;   /// The global index of each match's other residue.
+                std::vector<score> weight;      /// The weight of each match.
+
+                /**
+                 * Informs whether the library has any matches at all.
+                 * @return Is the library empty?
+                 */
+                inline bool empty() const noexcept
+                {
+                    return column.empty();
+                }
+
+                /**
+                 * Informs the total number of residues within the library's sequences.
+                 * @return The library's number of residues.
+                 */
+                inline size_t residues() const noexcept
+                {
+                    return origin.empty() ? 0 : origin.back();
+                }
+
+                /**
+                 * Finds the sequence owning a residue.
+                 * @param residue The residue's global index.
+                 * @return The index of the residue's sequence.
+                 */
+                inline size_t owner(uint32_t residue) const noexcept
+                {
+                    return std::upper_bound(origin.begin(), origin.end(), residue) - origin.begin() - 1;
+                }
+            };
+
+            /**
+             * The result of the pairwise module when building a consistency library,
+             * as the pairs' scores come out of the very same alignments.
+             * @since 0.1.1
+             */
+            struct outcome
+            {
+                distance_matrix distances;      /// The pairs' alignment scores.
+                library result;                 /// The sequences' extended library.
+            };
+
+            extern auto make(const museqa::database&, const std::vector<match>&) -> library;
+            extern auto extend(const library&) -> library;
+
+            extern auto run(const museqa::database&, const scoring_table&, const std::string& = "uniform") -> outcome;
+        }
+    }
+}
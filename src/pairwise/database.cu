@@ -6,6 +6,8 @@
  */
 #include <vector>
 #include <cstdint>
+#include <numeric>
+#include <algorithm>
 
 #include "cuda.cuh"
 #include "encoder.hpp"
@@ -17,40 +19,75 @@
 namespace museqa
 {
     /**
-     * Sets up the view pointers responsible for keeping track of internal sequences.
-     * @param seq The merged sequence to have its internal parts splitted.
+     * Lists the identifiers of all sequences in a database.
+     * @param db The database to list the sequences of.
+     * @return The identifiers of all sequences in the database.
+     */
+    auto pairwise::database::all(const museqa::database& db) -> std::vector<ptrdiff_t>
+    {
+        auto result = std::vector<ptrdiff_t> (db.count());
+        std::iota(result.begin(), result.end(), 0);
+        return result;
+    }
+
+    /**
+     * Sets up the references responsible for keeping track of internal sequences.
+     * The references borrow the merged sequence, which is owned by the database.
+     * @param merged The merged sequence to have its internal parts splitted.
      * @param db The database to have its sequences mapped.
+     * @param selected The identifiers of the merged sequences.
+     * @return The buffer of references to the merged sequences.
      */
-    auto pairwise::database::init(underlying_type& merged, const museqa::database& db) -> entry_buffer
+    auto pairwise::database::init(
+            underlying_type& merged
+        ,   const museqa::database& db
+        ,   const std::vector<ptrdiff_t>& selected
+        )
+    -> entry_buffer
     {
-        auto const count = db.count();
+        auto const count = selected.size();
         auto result = entry_buffer::make(count);
 
         for(size_t i = 0, j = 0; i < count; ++i) {
-            result[i] = sequence_view {merged, ptrdiff_t(j), db[i].contents.size()};
-            j += db[i].contents.size();
+            const size_t size = db[selected[i]].contents.size();
+            result[i] = sequence_ref {merged.raw() + j, size};
+            j += size;
         }
 
         return result;
     }
 
     /**
-     * Merges all sequences in given database to a single contiguous sequence.
+     * Merges the selected sequences of a database to a single contiguous sequence.
      * @param db The database to have its sequences merged.
+     * @param selected The identifiers of the sequences to be merged.
      * @return The merged sequences blocks.
      */
-    auto pairwise::database::merge(const museqa::database& db) -> underlying_type
+    auto pairwise::database::merge(const museqa::database& db, const std::vector<ptrdiff_t>& selected)
+    -> underlying_type
     {
-        std::vector<encoder::block> merged;
+        size_t total = 0;
+
+        for(const auto id : selected)
+            total += db[id].contents.size();
 
-        for(const auto& entry : db)
-            merged.insert(merged.end(), entry.contents.begin(), entry.contents.end());
+        // The merged blocks are only needed for being transferred to a device, so
+        // they are staged in pinned memory, which does not need to be paged in.
+        auto merged = underlying_type::make(cuda::allocator::staging, total);
+        size_t j = 0;
+
+        for(const auto id : selected) {
+            const sequence& contents = db[id].contents;
+            std::copy(contents.begin(), contents.end(), merged.raw() + j);
+            j += contents.size();
+        }
 
-        return underlying_type::copy(merged);
+        return merged;
     }
 
     /**
-     * Transfers this database instance to the compute-capable device.
+     * Transfers this database instance to the compute-capable device. The device's
+     * references borrow the device's blocks at the same offsets as the host's.
      * @return The database instance allocated in device.
      */
     auto pairwise::database::to_device() const -> pairwise::database
@@ -63,7 +100,7 @@ namespace museqa
         auto helper = entry_buffer::make(total_views);
 
         for(size_t i = 0; i < total_views; ++i)
-            helper[i] = sequence_view {blocks, m_views[i]};
+            helper[i] = sequence_ref {blocks.raw() + (m_views[i].raw() - this->raw()), m_views[i].size()};
 
         cuda::memory::copy(blocks.raw(), this->raw(), total_blocks);
         cuda::memory::copy(views.raw(), helper.raw(), total_views);
@@ -6,6 +6,7 @@
  */
 #pragma once
 
+#include <vector>
 #include <cstdint>
 
 #include "cuda.cuh"
@@ -27,7 +28,7 @@ namespace museqa
         class database : public sequence
         {
             public:
-                using element_type = sequence_view;             /// The database's element type.
+                using element_type = sequence_ref;              /// The database's element type.
 
             protected:
                 using underlying_type = sequence;               /// The database's underlying type.
@@ -46,8 +47,20 @@ namespace museqa
                  * @param db The database to be transformed.
                  */
                 inline database(const museqa::database& db) noexcept
-                :   underlying_type {merge(db)}
-                ,   m_views {init(*this, db)}
+                :   database {db, all(db)}
+                {}
+
+                /**
+                 * Initializes a contiguous database from a selection of a common
+                 * database's sequences, which are then identified by their order
+                 * in the selection. The selected sequences are merged right away,
+                 * without building any intermediate database.
+                 * @param db The database to select the sequences from.
+                 * @param selected The identifiers of the selected sequences.
+                 */
+                inline database(const museqa::database& db, const std::vector<ptrdiff_t>& selected) noexcept
+                :   underlying_type {merge(db, selected)}
+                ,   m_views {init(*this, db, selected)}
                 {}
 
                 inline database& operator=(const database&) = default;
@@ -86,8 +99,9 @@ namespace museqa
                 ,   m_views {views}
                 {}
 
-                static auto init(underlying_type&, const museqa::database&) -> entry_buffer;
-                static auto merge(const museqa::database&) -> underlying_type;
+                static auto all(const museqa::database&) -> std::vector<ptrdiff_t>;
+                static auto init(underlying_type&, const museqa::database&, const std::vector<ptrdiff_t>&) -> entry_buffer;
+                static auto merge(const museqa::database&, const std::vector<ptrdiff_t>&) -> underlying_type;
         };
     }
 }
@@ -0,0 +1,105 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the digests identifying persisted pairwise scores.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+#include "sequence.hpp"
+
+#include "pairwise/pairwise.cuh"
+
+namespace museqa
+{
+    namespace pairwise
+    {
+        /**
+         * Groups the digests of the values pairwise scores depend on. Persisted
+         * scores are identified by these digests, so they can be found again on
+         * later runs even if the sequences are reordered, renamed or removed.
+         * @since 0.1.1
+         */
+        namespace digest
+        {
+            /**
+             * Feeds a sequence of bytes into a running FNV-1a digest.
+             * @param ptr The bytes to be digested.
+             * @param size The number of bytes to be digested.
+             * @param value The running digest value.
+             * @return The updated digest value.
+             */
+            inline auto fnv(const void *ptr, size_t size, uint64_t value = 0xcbf29ce484222325) noexcept -> uint64_t
+            {
+                const auto *bytes = static_cast<const unsigned char *>(ptr);
+
+                for(size_t i = 0; i < size; ++i)
+                    value = (value ^ bytes[i]) * 0x100000001b3;
+
+                return value;
+            }
+
+            /**
+             * Digests a sequence's contents. As sequences are always padded in
+             * the same way, equal sequences are always encoded into equal blocks.
+             * @param target The sequence to be digested.
+             * @return The sequence's digest.
+             */
+            inline auto contents(const museqa::sequence& target) noexcept -> uint64_t
+            {
+                return fnv(target.raw(), target.size() * sizeof(encoder::block));
+            }
+
+            /**
+             * Digests a pair of sequences' digests, regardless of the pair's order.
+             * @param one The first sequence's digest.
+             * @param two The second sequence's digest.
+             * @return The pair's digest.
+             */
+            inline auto pair(uint64_t one, uint64_t two) noexcept -> uint64_t
+            {
+                const uint64_t values[] = {utils::min(one, two), utils::max(one, two)};
+                return fnv(values, sizeof(values));
+            }
+
+            /**
+             * Digests the setup scores are computed with. Scores computed with a different
+             * algorithm or scoring table cannot be reused, so they are never mixed up.
+             * @param table The scoring table used to align the sequences.
+             * @param algorithm The name of the chosen pairwise algorithm.
+             * @param kmer The chosen k-mer length.
+             * @param sketch The chosen sketch size.
+             * @return The setup's digest.
+             */
+            inline auto setup(const scoring_table& table, const std::string& algorithm, size_t kmer, size_t sketch)
+            -> uint64_t
+            {
+                score values[25 * 25 + 1] = {table.penalty()};
+                const uint64_t sizes[] = {kmer, sketch};
+
+                for(size_t i = 0; i < 25; ++i)
+                    for(size_t j = 0; j < 25; ++j)
+                        values[i * 25 + j + 1] = table[{encoder::unit(i), encoder::unit(j)}];
+
+                auto value = fnv(algorithm.data(), algorithm.size());
+                value = fnv(sizes, sizeof(sizes), value);
+                value = fnv(values, sizeof(values), value);
+
+                // The gap extension is only digested for affine tables, so the digests
+                // of linear tables remain the same as before affine gaps were known.
+                if(table.affine()) {
+                    const score extend = table.extend();
+                    value = fnv(&extend, sizeof(extend), value);
+                }
+
+                return value;
+            }
+        }
+    }
+}
@@ -0,0 +1,292 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the pairwise module's incremental alignment.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "mpi.hpp"
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "database.hpp"
+#include "exception.hpp"
+
+#include "stream.hpp"
+
+#include "pairwise/digest.hpp"
+#include "pairwise/pairwise.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    /*
+     * Definitions of the distance matrix file format. A distance matrix file holds
+     * the content digest of every sequence the matrix has been computed for, so
+     * the known scores can be found even if sequences are reordered or removed.
+     * The file is laid out as its header, followed by the sequences' digests and
+     * by the matrix's scores, in the distance matrix's own linear layout.
+     */
+    static constexpr char magic[8] = {'M', 'U', 'S', 'E', 'Q', 'A', 'D', 'M'};
+    enum : uint64_t { version = 1 };
+
+    /**
+     * The distance matrix file's header.
+     * @since 0.1.1
+     */
+    struct header
+    {
+        char magic[8];                      /// The file's magic number.
+        uint64_t version;                   /// The file format's version.
+        uint64_t count;                     /// The number of sequences in file.
+        uint64_t setup;                     /// The digest of the setup the scores were computed with.
+    };
+
+    /**
+     * The scores previously computed and persisted to a distance matrix file.
+     * @since 0.1.1
+     */
+    struct snapshot
+    {
+        std::vector<uint64_t> digests;      /// The content digest of each known sequence.
+        buffer<score> scores;               /// The known sequences' pairwise scores.
+    };
+
+    /**
+     * Loads the scores persisted to a distance matrix file. If the file does not
+     * exist or its scores have been computed with a different setup, no sequence
+     * is known and all pairs must be aligned.
+     * @param filename The name of the file to load the scores from.
+     * @param expected The digest of the current setup.
+     * @return The loaded scores.
+     */
+    static auto load(const std::string& filename, uint64_t expected) -> snapshot
+    {
+        std::ifstream file (filename, std::ifstream::binary);
+        snapshot result;
+        header head;
+
+        if(!file.read(reinterpret_cast<char *>(&head), sizeof(head)))
+            return result;
+
+        enforce(!memcmp(head.magic, magic, sizeof(magic)), "file is not a valid distance matrix '%s'", filename);
+        enforce(head.version == version, "unsupported distance matrix version '%s'", filename);
+
+        if(head.setup != expected)
+            return result;
+
+        auto digests = std::vector<uint64_t> (head.count);
+        auto scores = buffer<score>::make(utils::nchoose(head.count));
+
+        file.read(reinterpret_cast<char *>(digests.data()), digests.size() * sizeof(uint64_t));
+        file.read(reinterpret_cast<char *>(scores.raw()), scores.size() * sizeof(score));
+
+        enforce(!file.fail(), "corrupted distance matrix '%s'", filename);
+
+        result.digests = std::move(digests);
+        result.scores = std::move(scores);
+
+        return result;
+    }
+
+    /**
+     * Persists a distance matrix to file, so it can be extended by later runs.
+     * @param filename The name of the file to save the scores into.
+     * @param digests The content digest of each sequence in the matrix.
+     * @param scores The sequences' pairwise scores.
+     * @param setup The digest of the setup the scores were computed with.
+     */
+    static void save(
+            const std::string& filename
+        ,   const std::vector<uint64_t>& digests
+        ,   const buffer<score>& scores
+        ,   uint64_t setup
+        )
+    {
+        std::ofstream file (filename, std::ofstream::binary | std::ofstream::trunc);
+        enforce(!file.fail(), "file cannot be written '%s'", filename);
+
+        header head;
+        memcpy(head.magic, magic, sizeof(head.magic));
+
+        head.version = version;
+        head.count   = digests.size();
+        head.setup   = setup;
+
+        file.write(reinterpret_cast<const char *>(&head), sizeof(head));
+        file.write(reinterpret_cast<const char *>(digests.data()), digests.size() * sizeof(uint64_t));
+        file.write(reinterpret_cast<const char *>(scores.raw()), scores.size() * sizeof(score));
+
+        file.close();
+        enforce(!file.fail(), "file cannot be written '%s'", filename);
+    }
+
+    /**
+     * Orders the database's sequences so that all known sequences come first.
+     * The pairs among the known sequences then take up a prefix of the linear
+     * pair space, and only the remaining pairs must be aligned. Repeated sequences
+     * are known only once, as their pair's score is not in the matrix.
+     * @param db The database of sequences to align.
+     * @param digests The content digest of each sequence in the database.
+     * @param known The previously computed scores.
+     * @param order The sequences' new order.
+     * @param origin The known sequences' index within the previous matrix.
+     * @return The number of known sequences.
+     */
+    static auto arrange(
+            const museqa::database& db
+        ,   const std::vector<uint64_t>& digests
+        ,   const snapshot& known
+        ,   std::vector<size_t>& order
+        ,   std::vector<size_t>& origin
+        ) -> size_t
+    {
+        std::unordered_map<uint64_t, size_t> previous;
+        std::vector<size_t> unknown;
+
+        for(size_t i = 0; i < known.digests.size(); ++i)
+            previous.emplace(known.digests[i], i);
+
+        for(size_t i = 0; i < db.count(); ++i) {
+            auto found = previous.find(digests[i]);
+
+            if(found == previous.end()) {
+                unknown.push_back(i);
+            } else {
+                origin.push_back(found->second);
+                order.push_back(i);
+                previous.erase(found);
+            }
+        }
+
+        order.insert(order.end(), unknown.begin(), unknown.end());
+        return origin.size();
+    }
+
+    /**
+     * Rebuilds the full distance matrix in the database's original order, from
+     * the known scores and the scores of the pairs that have just been aligned.
+     * @param order The order in which sequences have been aligned.
+     * @param origin The known sequences' index within the previous matrix.
+     * @param known The previously computed scores.
+     * @param aligned The scores of the pairs involving any unknown sequence.
+     * @return The full matrix's linear buffer.
+     */
+    static auto merge(
+            const std::vector<size_t>& order
+        ,   const std::vector<size_t>& origin
+        ,   const snapshot& known
+        ,   const buffer<score>& aligned
+        ) -> buffer<score>
+    {
+        const size_t count = order.size();
+        const size_t first = utils::nchoose(origin.size());
+
+        auto result = buffer<score>::make(utils::nchoose(count));
+
+        for(size_t p = 1; p < count; ++p) {
+            for(size_t q = 0; q < p; ++q) {
+                const auto i = utils::max(order[p], order[q]);
+                const auto j = utils::min(order[p], order[q]);
+
+                if(p < origin.size()) {
+                    const auto a = utils::max(origin[p], origin[q]);
+                    const auto b = utils::min(origin[p], origin[q]);
+                    result[utils::nchoose(i) + j] = known.scores[utils::nchoose(a) + b];
+                } else {
+                    result[utils::nchoose(i) + j] = aligned[utils::nchoose(p) + q - first];
+                }
+            }
+        }
+
+        return result;
+    }
+}
+
+namespace museqa
+{
+    namespace pairwise
+    {
+        /**
+         * Runs the module incrementally over a persisted distance matrix. The pairs
+         * among sequences already in the persisted matrix are not aligned again,
+         * so only the pairs involving new sequences must be aligned. The extended
+         * matrix is then persisted back to the same file, for the next run.
+         * @param filename The file to load the known scores from and save them to.
+         * @param db The database of sequences to align.
+         * @param table The chosen scoring table.
+         * @param algorithm The chosen pairwise algorithm.
+         * @param partition The chosen pairs partitioning strategy.
+         * @param kmer The k-mer length, or zero for the algorithm's default.
+         * @param sketch The sketch size, or zero for keeping all k-mers.
+         * @return The extended distance matrix, on the master node.
+         */
+        auto incremental(
+                const std::string& filename
+            ,   const museqa::database& db
+            ,   const scoring_table& table
+            ,   const std::string& algorithm
+            ,   const std::string& partition
+            ,   size_t kmer
+            ,   size_t sketch
+            ) -> distance_matrix
+        {
+            const uint64_t setup = digest::setup(table, algorithm, kmer, sketch);
+
+            std::vector<uint64_t> digests;
+            std::vector<size_t> order, origin;
+            ::snapshot known;
+
+            onlymaster {
+                known = ::load(filename, setup);
+
+                for(const auto& entry : db)
+                    digests.push_back(digest::contents(entry.contents));
+
+                ::arrange(db, digests, known, order, origin);
+            }
+
+            #if !defined(__museqa_runtime_cython)
+                size_t count = origin.size();
+
+                order = mpi::broadcast(order);
+                count = mpi::broadcast(&count);
+
+                // As the sequences are reordered, the sequences an aligner waits
+                // for are no longer the leading ones, so all of them are awaited.
+                if(count) stream::await(db.count());
+            #else
+                size_t count = origin.size();
+            #endif
+
+            auto arranged = museqa::database {db.count()};
+
+            for(size_t i : order)
+                arranged.add(db[i].description.data(), db[i].description.size(), db[i].contents);
+
+            auto lambda = pairwise::algorithm::make(algorithm);
+
+            const pairwise::algorithm *worker = lambda ();
+            auto result = worker->run({arranged, table, partition, kmer, sketch, count, {}});
+
+            delete worker;
+
+            buffer<score> scores;
+
+            onlymaster {
+                scores = ::merge(order, origin, known, result.linear());
+                ::save(filename, digests, scores, setup);
+            }
+
+            return distance_matrix {scores, db.count()};
+        }
+    }
+}
@@ -0,0 +1,191 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the pairwise module's alignment-free k-mer algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
+#include "exception.hpp"
+
+#include "stream.hpp"
+#include "pairwise/pairwise.cuh"
+#include "pairwise/kmer/kmer.cuh"
+#include "pairwise/needleman/needleman.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    /**
+     * Scrambles the bits of a packed k-mer, so the smallest hashes of a sequence
+     * are an uniform sample of its k-mers, rather than the lexicographically smallest.
+     * @param value The packed k-mer to be hashed.
+     * @return The k-mer's hash.
+     */
+    inline auto mix(kmer::hash value) noexcept -> kmer::hash
+    {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    /**
+     * Aligns the sequence pairs by comparing their sequences' sketches. The sketches
+     * of all sequences are built beforehand, as each of them is used by many pairs.
+     * @param pairs The workpairs to compare in the current node.
+     * @param db The sequences available for comparison.
+     * @param length The k-mers' length.
+     * @param size The sketches' size.
+     * @return The score of compared pairs.
+     */
+    static auto align(const buffer<pair>& pairs, const database& db, size_t length, size_t size)
+    -> buffer<score>
+    {
+        const size_t count = pairs.size();
+        auto sketches = std::vector<kmer::sketch> (db.count());
+        auto result = buffer<score>::make(count);
+
+        #if !defined(__museqa_runtime_cython)
+            stream::await(db.count());
+        #endif
+
+        parallel::foreach(db.count(), [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i)
+                sketches[i] = kmer::make(db[i].contents, length, size);
+        });
+
+        parallel::foreach(count, [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i)
+                result[i] = kmer::compare(sketches[pairs[i].first], sketches[pairs[i].second], length, size);
+        });
+
+        return result;
+    }
+
+    /**
+     * The sequential k-mer algorithm object. Rather than aligning the sequences,
+     * this algorithm estimates how related two sequences are from the fraction
+     * of k-mers they share, which is orders of magnitude faster than aligning them.
+     * @since 0.1.1
+     */
+    struct sequential : public needleman::algorithm
+    {
+        /**
+         * Executes the sequential k-mer algorithm for the pairwise step. This method is
+         * responsible for distributing and gathering workload from different cluster nodes.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            buffer<score> result;
+            size_t nsequences = ctx.db.count();
+            size_t length = ctx.kmer ? ctx.kmer : size_t(kmer::default_length);
+
+            enforce(length <= kmer::max_length, "k-mers must not be longer than %llu", kmer::max_length);
+
+            onlyslaves {
+                auto pairs = this->generate(ctx);
+                result = align(pairs, ctx.db, length, ctx.sketch);
+            }
+
+            return distance_matrix {this->gather(result), nsequences};
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Builds the sketch of a sequence. The k-mers are read directly from the
+     * sequence's encoded units, which are packed side by side into an integer.
+     * @param target The sequence to be sketched.
+     * @param length The k-mers' length.
+     * @param size The maximum sketch size, or zero for keeping all k-mers.
+     * @return The sequence's sketch.
+     */
+    auto pairwise::kmer::make(const sequence& target, size_t length, size_t size) -> sketch
+    {
+        const kmer::hash mask = (kmer::hash(1) << (5 * length)) - 1;
+
+        sketch result;
+        kmer::hash packed = 0;
+
+        result.reserve(target.unpadded());
+
+        for(size_t i = 0, valid = 0; i < target.length(); ++i) {
+            const auto unit = target[i];
+
+            // K-mers must not span over gaps or the padding, so whenever one of
+            // these is found, the k-mer currently being packed must be restarted.
+            if(unit == encoder::end || unit == encoder::gap) {
+                valid = 0;
+                continue;
+            }
+
+            packed = ((packed << 5) | unit) & mask;
+
+            if(++valid >= length)
+                result.push_back(mix(packed));
+        }
+
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+
+        if(size && result.size() > size)
+            result.resize(size);
+
+        return result;
+    }
+
+    /**
+     * Compares the sketches of two sequences. The fraction of k-mers shared by
+     * both sequences is estimated from the smallest hashes of their union, and
+     * then converted into an estimate of the sequences' evolutionary distance.
+     * As the module's result is a similarity score, the distance is negated.
+     * @param one The first sequence's sketch.
+     * @param two The second sequence's sketch.
+     * @param length The k-mers' length.
+     * @param size The sketches' size, or zero if all k-mers have been kept.
+     * @return The pair's similarity score.
+     */
+    auto pairwise::kmer::compare(const sketch& one, const sketch& two, size_t length, size_t size) -> score
+    {
+        const size_t limit = size ? size : one.size() + two.size();
+        size_t shared = 0, total = 0;
+
+        for(size_t i = 0, j = 0; total < limit && (i < one.size() || j < two.size()); ++total) {
+            if(j >= two.size() || (i < one.size() && one[i] < two[j])) ++i;
+            else if(i >= one.size() || two[j] < one[i]) ++j;
+            else { ++i; ++j; ++shared; }
+        }
+
+        if(!shared) return score {-1};
+
+        const double jaccard = double(shared) / double(total);
+        const double distance = -std::log(2 * jaccard / (1 + jaccard)) / double(length);
+
+        return score(-utils::min(distance, 1.0));
+    }
+
+    /**
+     * Instantiates a new sequential k-mer instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::kmer::sequential() -> pairwise::algorithm *
+    {
+        return new ::sequential;
+    }
+}
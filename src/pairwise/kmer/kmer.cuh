@@ -0,0 +1,56 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the pairwise module's alignment-free k-mer algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "sequence.hpp"
+
+#include "pairwise/pairwise.cuh"
+
+namespace museqa
+{
+    namespace pairwise
+    {
+        namespace kmer
+        {
+            /**
+             * The hash of a k-mer. As each sequence unit is encoded within 5 bits,
+             * a k-mer is firstly packed into an integer, and then hashed.
+             * @since 0.1.1
+             */
+            using hash = uint64_t;
+
+            /*
+             * The k-mer algorithm's configuration parameters and limits. As k-mers
+             * are packed into a hash-sized integer, their length is limited by the
+             * number of units that fit into it. A sketch size of zero means that
+             * all of the sequence's distinct k-mers are kept.
+             */
+            enum : size_t { max_length = 8 * sizeof(hash) / 5 };
+            enum : size_t { default_length = 5 };
+            enum : size_t { default_sketch = 1000 };
+
+            /**
+             * The sketch of a sequence. A sketch is the sorted set of the smallest
+             * hashes of all k-mers within a sequence, which allows the fraction of
+             * k-mers shared by a pair of sequences to be estimated.
+             * @since 0.1.1
+             */
+            using sketch = std::vector<hash>;
+
+            extern auto make(const sequence&, size_t, size_t) -> sketch;
+            extern auto compare(const sketch&, const sketch&, size_t, size_t) -> score;
+
+            /*
+             * The list of all available k-mer algorithm implementations.
+             */
+            extern auto sequential() -> pairwise::algorithm *;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Anchored implementation for the pairwise module's needleman algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <vector>
+#include <cstdint>
+
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
+
+#include "pairwise/pairwise.cuh"
+#include "pairwise/anchor/anchor.cuh"
+#include "pairwise/needleman/kernel.hpp"
+#include "pairwise/needleman/needleman.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    using needleman::policy::score_only;
+
+    /**
+     * Aligns two sequences by anchoring their longest exact matches, so only the
+     * segments between consecutive anchors must be aligned. Sequences too short to
+     * be worth anchoring are aligned as a single segment.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param table The scoring table used to compare both sequences.
+     * @return The alignment score.
+     */
+    static score align_pair(sequence_ref one, sequence_ref two, const scoring_table& table)
+    {
+        thread_local std::vector<encoder::unit> decoded[2];
+
+        decoded[0].resize(one.length()); one.unpack(decoded[0].data());
+        decoded[1].resize(two.length()); two.unpack(decoded[1].data());
+
+        const encoder::unit *first = decoded[0].data();
+        const encoder::unit *second = decoded[1].data();
+        const size_t n = one.unpadded(), m = two.unpadded();
+
+        const auto chain = n >= anchor::threshold && m >= anchor::threshold
+            ? anchor::find(first, n, second, m, anchor::default_length)
+            : anchor::chain {};
+
+        score result = 0;
+        size_t i = 0, j = 0;
+
+        for(const auto& seed : chain) {
+            result += needleman::align<score_only>(first + i, seed.one - i, second + j, seed.two - j, table);
+
+            for(size_t k = 0; k < seed.length; ++k)
+                result += table[{first[seed.one + k], second[seed.two + k]}];
+
+            i = seed.one + seed.length;
+            j = seed.two + seed.length;
+        }
+
+        return result + needleman::align<score_only>(first + i, n - i, second + j, m - j, table);
+    }
+
+    /**
+     * Executes the anchored Needleman-Wunsch algorithm for the pairs given to the
+     * current node. The pairs are split among the node's host threads, if more than one.
+     * @param pairs The workpairs to align in the current node.
+     * @param db The sequences available for alignment.
+     * @param table The scoring table to use.
+     * @return The score of aligned pairs.
+     */
+    static auto align(const buffer<pair>& pairs, const database& db, const scoring_table& table)
+    -> buffer<score>
+    {
+        const size_t count = pairs.size();
+        auto result = buffer<score>::make(count);
+
+        parallel::foreach(count, [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i)
+                result[i] = align_pair(db[pairs[i].first].contents, db[pairs[i].second].contents, table);
+        });
+
+        return result;
+    }
+
+    /**
+     * The anchored needleman algorithm object. This algorithm is meant for long
+     * and closely related sequences, such as whole genomes, whose alignments are
+     * mostly made of long exact matches. As whole genomes' lengths vary greatly,
+     * pairs are handed out to slaves on demand.
+     * @since 0.1.1
+     */
+    struct anchored : public needleman::algorithm
+    {
+        /**
+         * Executes the anchored needleman algorithm for the pairwise step.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            return this->schedule(ctx, align);
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Instantiates a new anchored needleman instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::needleman::anchored() -> pairwise::algorithm *
+    {
+        return new ::anchored;
+    }
+}
@@ -0,0 +1,286 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Banded implementation for the pairwise module's needleman algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
+
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
+
+#include "pairwise/pairwise.cuh"
+#include "pairwise/needleman/needleman.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    /*
+     * The score given to cells outside of the alignment band. This value must be
+     * low enough to never be picked, but still leave room for penalties.
+     */
+    constexpr score unreachable = -FLT_MAX / 4;
+
+    /**
+     * Sequentially aligns two sequences using Needleman-Wunsch algorithm, but only
+     * calculating the cells within a band of diagonals around the main diagonal.
+     * The band's lines are stored by diagonal, so each line needs only as much
+     * memory as the band's width, independently of the sequences' lengths.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param table The scoring table used to compare both sequences.
+     * @param width The band's half-width beyond the sequences' length difference.
+     * @return The alignment score within the band.
+     */
+    static score align_band(
+            needleman::gap::linear
+        ,   sequence_ref one
+        ,   sequence_ref two
+        ,   const scoring_table& table
+        ,   size_t width
+        )
+    {
+        const ptrdiff_t height = one.unpadded();
+        const ptrdiff_t length = two.unpadded();
+        const ptrdiff_t band   = utils::min<ptrdiff_t>(width, utils::max(height, length));
+
+        // The band is given by the range of diagonals, that is the difference
+        // between a cell's column and line, which must be calculated. Each line
+        // has one sentinel cell on each side, so no bound checks are needed.
+        const ptrdiff_t lower = utils::min<ptrdiff_t>(0, length - height) - band;
+        const ptrdiff_t upper = utils::max<ptrdiff_t>(0, length - height) + band;
+
+        std::vector<score> previous (upper - lower + 3, unreachable);
+        std::vector<score> current (upper - lower + 3, unreachable);
+
+        // Both sequences are decoded in bulk before aligning them, so their units
+        // can be directly read by the inner loop, without dividing and shifting.
+        thread_local std::vector<encoder::unit> decoded[2];
+        decoded[0].resize(one.length()); one.unpack(decoded[0].data());
+        decoded[1].resize(two.length()); two.unpack(decoded[1].data());
+
+        const encoder::unit *first = decoded[0].data();
+        const encoder::unit *second = decoded[1].data();
+
+        // Filling 0-th line with penalties. Only the cells within the band need
+        // to be initialized, as the others are unreachable.
+        for(ptrdiff_t j = 0; j <= utils::min(length, upper); ++j)
+            previous[j - lower + 1] = j * -table.penalty();
+
+        for(ptrdiff_t i = 1; i <= height; ++i) {
+            const score *row = table.row(first[i - 1]);
+            std::fill(current.begin(), current.end(), unreachable);
+
+            // The 0-th column value is only reachable if it is within the band.
+            // It is initialized with penalties, in the same manner as the 0-th line.
+            if(-i >= lower)
+                current[-i - lower + 1] = i * -table.penalty();
+
+            const ptrdiff_t first = utils::max<ptrdiff_t>(1, i + lower);
+            const ptrdiff_t last  = utils::min<ptrdiff_t>(length, i + upper);
+
+            // Iterate over the second sequence's band, calculating the best alignment
+            // possible for each of its characters. On the previous line, the cell
+            // right above the current one is on the next diagonal.
+            for(ptrdiff_t j = first; j <= last; ++j) {
+                const ptrdiff_t k = j - i - lower + 1;
+
+                const auto insertd = current[k - 1] - table.penalty();
+                const auto removed = previous[k + 1] - table.penalty();
+                const auto matched = previous[k] + row[second[j - 1]];
+
+                current[k] = utils::max(matched, utils::max(insertd, removed));
+            }
+
+            previous.swap(current);
+        }
+
+        return previous[length - height - lower + 1];
+    }
+
+    /**
+     * Sequentially aligns two sequences with affine gaps, only calculating the cells
+     * within a band of diagonals around the main diagonal. Besides the band's score
+     * lines, the lines of best scores ending in a gap on the second sequence are
+     * also stored by diagonal, while the best score ending in a gap on the first
+     * sequence is carried along each line.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param table The scoring table used to compare both sequences.
+     * @param width The band's half-width beyond the sequences' length difference.
+     * @return The alignment score within the band.
+     */
+    static score align_band(
+            needleman::gap::affine
+        ,   sequence_ref one
+        ,   sequence_ref two
+        ,   const scoring_table& table
+        ,   size_t width
+        )
+    {
+        const ptrdiff_t height = one.unpadded();
+        const ptrdiff_t length = two.unpadded();
+        const ptrdiff_t band   = utils::min<ptrdiff_t>(width, utils::max(height, length));
+
+        const ptrdiff_t lower = utils::min<ptrdiff_t>(0, length - height) - band;
+        const ptrdiff_t upper = utils::max<ptrdiff_t>(0, length - height) + band;
+
+        const score open = table.penalty();
+        const score extend = table.extend();
+
+        std::vector<score> previous (upper - lower + 3, unreachable);
+        std::vector<score> current (upper - lower + 3, unreachable);
+        std::vector<score> removed[2] = {previous, current};
+
+        thread_local std::vector<encoder::unit> decoded[2];
+        decoded[0].resize(one.length()); one.unpack(decoded[0].data());
+        decoded[1].resize(two.length()); two.unpack(decoded[1].data());
+
+        const encoder::unit *first = decoded[0].data();
+        const encoder::unit *second = decoded[1].data();
+
+        // Filling 0-th line with the penalties of a single gap growing along it.
+        // No cell of the 0-th line can end in a gap on the second sequence.
+        for(ptrdiff_t j = 0; j <= utils::min(length, upper); ++j)
+            previous[j - lower + 1] = j ? -open - (j - 1) * extend : 0;
+
+        for(ptrdiff_t i = 1; i <= height; ++i) {
+            const score *row = table.row(first[i - 1]);
+            std::fill(current.begin(), current.end(), unreachable);
+            std::fill(removed[1].begin(), removed[1].end(), unreachable);
+
+            if(-i >= lower)
+                current[-i - lower + 1] = -open - (i - 1) * extend;
+
+            const ptrdiff_t first = utils::max<ptrdiff_t>(1, i + lower);
+            const ptrdiff_t last  = utils::min<ptrdiff_t>(length, i + upper);
+
+            score insertd = unreachable;
+
+            for(ptrdiff_t j = first; j <= last; ++j) {
+                const ptrdiff_t k = j - i - lower + 1;
+
+                insertd = utils::max(current[k - 1] - open, insertd - extend);
+                removed[1][k] = utils::max(previous[k + 1] - open, removed[0][k + 1] - extend);
+
+                const auto matched = previous[k] + row[second[j - 1]];
+                current[k] = utils::max(matched, utils::max(insertd, removed[1][k]));
+            }
+
+            previous.swap(current);
+            removed[0].swap(removed[1]);
+        }
+
+        return previous[length - height - lower + 1];
+    }
+
+    /**
+     * Aligns two sequences with a banded Needleman-Wunsch algorithm. The band is
+     * widened until the alignment's score can be proven to be optimal. Thus, similar
+     * sequences are aligned with very narrow bands, and very few cells calculated.
+     * @tparam G The gap model's type.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param table The scoring table used to compare both sequences.
+     * @param match The scoring table's best match score.
+     * @return The alignment score.
+     */
+    template <typename G>
+    static score align_pair(sequence_ref one, sequence_ref two, const scoring_table& table, score match)
+    {
+        const size_t height = one.unpadded();
+        const size_t length = two.unpadded();
+        const score penalty = needleman::band::penalty(table);
+
+        // If the band's score cannot be proven optimal, the band is widened to
+        // the width needed for proving the current score. As the score cannot
+        // decrease with the band's width, the next alignment is always optimal.
+        for(size_t width = needleman::band::initial; ; ) {
+            const score result = align_band(G {}, one, two, table, width);
+            const size_t needed = needleman::band::required(result, height, length, match, penalty);
+
+            if(width >= needed) return result;
+            else width = needed;
+        }
+    }
+
+    /**
+     * Executes the banded Needleman-Wunsch algorithm for the pairwise step.
+     * The pairs are split among the node's host threads, if more than one.
+     * @param pairs The workpairs to align in the current node.
+     * @param db The sequences available for alignment.
+     * @param table The scoring table to use.
+     * @return The score of aligned pairs.
+     */
+    static auto align(const buffer<pair>& pairs, const database& db, const scoring_table& table)
+    -> buffer<score>
+    {
+        const size_t count = pairs.size();
+        const score match = needleman::band::bound(table);
+
+        auto result = buffer<score>::make(count);
+
+        parallel::foreach(count, [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i) {
+                const sequence_ref one = db[pairs[i].first].contents;
+                const sequence_ref two = db[pairs[i].second].contents;
+
+                result[i] = table.affine()
+                    ? align_pair<needleman::gap::affine>(one, two, table, match)
+                    : align_pair<needleman::gap::linear>(one, two, table, match);
+            }
+        });
+
+        return result;
+    }
+
+    /**
+     * The sequential banded needleman algorithm object. This algorithm uses no GPU,
+     * and only calculates the cells within an adaptive band around the alignment
+     * matrix's main diagonal, thus it is best for very similar sequences.
+     * @since 0.1.1
+     */
+    struct sequential_banded : public needleman::algorithm
+    {
+        /**
+         * Executes the banded needleman algorithm for the pairwise step. This method is
+         * responsible for distributing and gathering workload from different cluster nodes.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            buffer<score> result;
+            size_t nsequences = ctx.db.count();
+
+            onlyslaves {
+                auto pairs = this->generate(ctx);
+                result = align(pairs, ctx.db, ctx.table);
+            }
+
+            return distance_matrix {this->gather(result), nsequences};
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Instantiates a new sequential banded needleman instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::needleman::sequential_banded() -> pairwise::algorithm *
+    {
+        return new ::sequential_banded;
+    }
+}
@@ -6,19 +6,30 @@
  */
 #include <map>
 #include <set>
+#include <deque>
+#include <limits>
+#include <string>
 #include <vector>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include <cfloat>
 #include <cstdint>
 
 #include "cuda.cuh"
+#include "cuda/tuning.cuh"
 #include "node.hpp"
 #include "utils.hpp"
 #include "buffer.hpp"
 #include "encoder.hpp"
+#include "museqa.hpp"
+#include "trace.hpp"
 #include "pointer.hpp"
 #include "database.hpp"
 #include "sequence.hpp"
 #include "exception.hpp"
 
+#include "stream.hpp"
 #include "pairwise/database.cuh"
 #include "pairwise/pairwise.cuh"
 #include "pairwise/needleman/needleman.cuh"
@@ -28,6 +39,9 @@ namespace
     using namespace museqa;
     using namespace pairwise;
 
+    using needleman::gap::linear;
+    using needleman::gap::affine;
+
     /**
      * Identifies a pair of sequences to process as a unit.
      * @since 0.1.1
@@ -53,9 +67,14 @@ namespace
      * Algorithm configuration parameters. These values interfere directly into
      * the algorithm's execution, thus, they shall be modified with caution.
      */
-    enum : size_t { num_batch = 15 };
-    enum : size_t { block_size = cuda::warp_size * 5 };
-    enum : size_t { batch_size = cuda::warp_size * num_batch };
+    enum : size_t { warp_count = 4 };
+    enum : size_t { device_streams = 2 };
+
+    /*
+     * The score given to cells outside of an alignment band. This value must be
+     * low enough to never be picked, but still leave room for penalties.
+     */
+    constexpr score unreachable = -FLT_MAX / 4;
 
     /*
      * Dynamically allocated shared memory pointer. This variable has its contents
@@ -65,16 +84,19 @@ namespace
 
     /**
      * Aligns a sequence to a slice of the other one.
+     * @tparam B The number of columns in the slice.
      * @param offset The slice's first column offset.
      * @param column The columns' cache input and output.
      * @param one The sequence to be aligned with slice.
      * @param two The decoded target sequence slice to align.
      * @param table The scoring table to use.
      */
+    template <size_t B>
     __device__ void align_slice(
-            int offset
+            linear
+        ,   int offset
         ,   score *__restrict__ column
-        ,   const sequence_view& one
+        ,   const sequence_ref& one
         ,   const encoder::unit *two
         ,   const scoring_table& table
         )
@@ -91,13 +113,16 @@ namespace
 
             encoder::unit unit[2];
             score done, left, value;
+            const score *row;
 
             // Checks whether the currently selected line is valid and initializes
-            // the variables for its processing.
+            // the variables for its processing. The line's unit is compared to every
+            // column of the slice, so its scoring table row is fetched only once.
             if(current_line < one.length()) {
                 done = current_line ? column[current_line - 1] : line[0] + table.penalty();
                 left = column[current_line];
                 unit[0] = one[current_line];
+                row = table.row(unit[0]);
             }
 
             __syncthreads();
@@ -113,10 +138,10 @@ namespace
             // in a diagonal fashion upon the line. The size of processing batches
             // shall be large enough so the waiting times at the start and finish
             // of the method become minimal or negligible.
-            for(size_t slice_offset = 0; slice_offset < batch_size + blockDim.x; ++slice_offset) {
+            for(size_t slice_offset = 0; slice_offset < B + blockDim.x; ++slice_offset) {
                 const size_t current_column = slice_offset - threadIdx.x;
 
-                if(current_line < one.length() && 0 <= current_column && current_column < batch_size) {
+                if(current_line < one.length() && 0 <= current_column && current_column < B) {
                     // If the column to be processed at the moment represents the
                     // end of sequence, then there is nothing left to do.
                     if((unit[1] = two[current_column]) != sequence::padding) {
@@ -129,7 +154,7 @@ namespace
                         if(unit[0] != sequence::padding) {
                             const auto insertd = left - table.penalty();
                             const auto removed = value - table.penalty();
-                            const auto matched = done + table[{unit[0], unit[1]}];
+                            const auto matched = done + row[unit[1]];
                             value = utils::max(matched, utils::max(insertd, removed));
                         }
 
@@ -154,22 +179,116 @@ namespace
         }
     }
 
+    /**
+     * Aligns a sequence to a slice of the other one with affine gaps. Right after
+     * the shared score line, the line of best scores ending in a gap on the slice
+     * is kept, and the columns' cache is followed by the best scores ending in a
+     * gap on the sequence, so both gap states are carried between slices.
+     * @tparam B The number of columns in the slice.
+     * @param offset The slice's first column offset.
+     * @param column The columns' cache input and output.
+     * @param one The sequence to be aligned with slice.
+     * @param two The decoded target sequence slice to align.
+     * @param table The scoring table to use.
+     */
+    template <size_t B>
+    __device__ void align_slice(
+            affine
+        ,   int offset
+        ,   score *__restrict__ column
+        ,   const sequence_ref& one
+        ,   const encoder::unit *two
+        ,   const scoring_table& table
+        )
+    {
+        const score open = table.penalty();
+        const score extend = table.extend();
+
+        score *__restrict__ insertion = column + one.length();
+        volatile score *removed = line + B;
+
+        score last_value, last_gap;
+        size_t last_line = static_cast<size_t>(~0);
+
+        for(size_t line_offset = 0; line_offset < one.length(); line_offset += blockDim.x) {
+            const size_t current_line = line_offset + threadIdx.x;
+
+            encoder::unit unit[2];
+            score done, left, value, insertd;
+            const score *row;
+
+            if(current_line < one.length()) {
+                done = current_line ? column[current_line - 1] : offset ? -open - (offset - 1) * extend : 0;
+                left = column[current_line];
+                insertd = insertion[current_line];
+                unit[0] = one[current_line];
+                row = table.row(unit[0]);
+            }
+
+            __syncthreads();
+
+            if(last_line < one.length()) {
+                column[last_line] = last_value;
+                insertion[last_line] = last_gap;
+            }
+
+            for(size_t slice_offset = 0; slice_offset < B + blockDim.x; ++slice_offset) {
+                const size_t current_column = slice_offset - threadIdx.x;
+
+                if(current_line < one.length() && 0 <= current_column && current_column < B) {
+                    if((unit[1] = two[current_column]) != sequence::padding) {
+                        value = line[current_column];
+                        score gap = removed[current_column];
+
+                        // Each cell's gap states are either opened from a neighbour's
+                        // score or extended from the neighbour's own gap state.
+                        if(unit[0] != sequence::padding) {
+                            insertd = utils::max(left - open, insertd - extend);
+                            gap = utils::max(value - open, gap - extend);
+
+                            const auto matched = done + row[unit[1]];
+                            value = utils::max(matched, utils::max(insertd, gap));
+                        }
+
+                        done = line[current_column];
+                        left = line[current_column] = value;
+                        removed[current_column] = gap;
+                    }
+                }
+
+                __syncthreads();
+            }
+
+            last_line = current_line;
+            last_value = value;
+            last_gap = insertd;
+        }
+
+        if(last_line < one.length()) {
+            column[last_line] = last_value;
+            insertion[last_line] = last_gap;
+        }
+    }
+
     /**
      * Aligns two sequences using Needleman-Wunsch algorithm.
+     * @tparam B The number of columns in each of the slices.
      * @param one The first sequence to align.
      * @param two The second sequence to align.
      * @param table The scoring table to use.
      * @param column A global memory cache for storing column values.
      * @return The alignment score.
      */
+    template <size_t B>
     __device__ score align_pair(
-            const sequence_view& one
-        ,   const sequence_view& two
+            linear
+        ,   const sequence_ref& one
+        ,   const sequence_ref& two
         ,   const scoring_table& table
         ,   score *__restrict__ column
         )
     {
-        __shared__ encoder::unit decoded[batch_size];
+        __shared__ encoder::unit decoded[B];
 
         // The 0-th column and line of the alignment matrix must be initialized
         // by using successive gap penalties. As the columns will not be recalculated
@@ -182,14 +301,14 @@ namespace
         // Iterates over the shortest sequence. Using the classic Needleman-Wunsch
         // table drawing as an analogy, this sequence will be put in the horizontal
         // axis, and thus, its elements' indeces are the table's columns'.
-        for(size_t column_offset = 0; column_offset < two.length(); column_offset += batch_size) {
+        for(size_t column_offset = 0; column_offset < two.length(); column_offset += B) {
 
             // For each slice, we need to set up the 0-th line of the alignment matrix.
             // We achieve this by calculating the penalties represented in the line.
             // Also, as we are already iterating over the line, we decode the slice
             // of the sequence that will be processed in this iteration.
             #pragma unroll
-            for(size_t i = threadIdx.x; i < batch_size; i += blockDim.x) {
+            for(size_t i = threadIdx.x; i < B; i += blockDim.x) {
                 decoded[i] = (column_offset + i) < two.length()
                     ? two[column_offset + i]
                     : sequence::padding;
@@ -202,7 +321,7 @@ namespace
             // the second sequence. The 0-th column of each slice will be obtained
             // from the last column of the previous slice. For the first slice, the
             // 0-th column was previously calculated.
-            align_slice(column_offset, column, one, decoded, table);
+            align_slice<B>(linear {}, column_offset, column, one, decoded, table);
 
             __syncthreads();
         }
@@ -213,13 +332,70 @@ namespace
         return threadIdx.x == 0 ? column[one.length() - 1] : 0;
     }
 
+    /**
+     * Aligns two sequences using Needleman-Wunsch algorithm with affine gaps.
+     * @tparam B The number of columns in each of the slices.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param table The scoring table to use.
+     * @param column A global memory cache for storing both columns' gap states.
+     * @return The alignment score.
+     */
+    template <size_t B>
+    __device__ score align_pair(
+            affine
+        ,   const sequence_ref& one
+        ,   const sequence_ref& two
+        ,   const scoring_table& table
+        ,   score *__restrict__ column
+        )
+    {
+        __shared__ encoder::unit decoded[B];
+
+        const score open = table.penalty();
+        const score extend = table.extend();
+        volatile score *removed = line + B;
+
+        // The 0-th column is a single gap growing along the first sequence, and
+        // none of its cells can end in a gap on the second sequence.
+        for(size_t line_offset = threadIdx.x; line_offset < one.length(); line_offset += blockDim.x) {
+            column[line_offset] = -open - line_offset * extend;
+            column[one.length() + line_offset] = unreachable;
+        }
+
+        __syncthreads();
+
+        for(size_t column_offset = 0; column_offset < two.length(); column_offset += B) {
+            #pragma unroll
+            for(size_t i = threadIdx.x; i < B; i += blockDim.x) {
+                decoded[i] = (column_offset + i) < two.length()
+                    ? two[column_offset + i]
+                    : sequence::padding;
+                line[i] = -open - (column_offset + i) * extend;
+                removed[i] = unreachable;
+            }
+
+            __syncthreads();
+
+            align_slice<B>(affine {}, column_offset, column, one, decoded, table);
+
+            __syncthreads();
+        }
+
+        return threadIdx.x == 0 ? column[one.length() - 1] : 0;
+    }
+
     /**
      * Performs the Needleman-Wunsch sequence aligment algorithm in parallel.
+     * @tparam G The gap model's type.
+     * @tparam T The number of threads in each block.
+     * @tparam B The number of columns in each of the alignment's slices.
      * @param in The input data requested by the algorithm.
      * @param out The output data produced by the algorithm.
      * @param table The scoring table to use in alignment.
      */
-    __launch_bounds__(block_size)
+    template <typename G, size_t T, size_t B>
+    __launch_bounds__(T)
     __global__ void align_kernel(input in, buffer<score> out, const scoring_table table)
     {
         __shared__ scoring_table::raw_type mem_table;
@@ -230,14 +406,15 @@ namespace
         new (&shared_table) scoring_table {pointer<decltype(mem_table)>::weak(&mem_table), table};
 
         for(size_t i = blockIdx.x; i < in.jobs.size(); i += gridDim.x) {
-            const sequence_view& one = in.db[in.jobs[i].payload.id[0]];
-            const sequence_view& two = in.db[in.jobs[i].payload.id[1]];
+            const sequence_ref one = in.db[in.jobs[i].payload.id[0]];
+            const sequence_ref two = in.db[in.jobs[i].payload.id[1]];
 
             // We must make sure that, if the sequences have different lengths,
             // the first sequence is bigger than the second. This will allow the
             // alignment method to fully use its allocated cache.
-            auto result = align_pair(
-                    one.size() > two.size() ? one : two
+            auto result = align_pair<B>(
+                    G {}
+                ,   one.size() > two.size() ? one : two
                 ,   one.size() > two.size() ? two : one
                 ,   shared_table
                 ,   &in.cache[in.jobs[i].cache_offset]
@@ -251,12 +428,294 @@ namespace
         }
     }
 
+    /**
+     * Aligns two sequences using Needleman-Wunsch algorithm with a single warp.
+     * The alignment matrix is processed in strips of one line per warp lane. Within
+     * a strip, the lanes sweep the columns in an anti-diagonal wavefront, keeping
+     * their cells in registers and passing them down through warp shuffles. Only
+     * the strip's last line is written to memory, as the next strip's first border.
+     * Optionally, only the cells within a band of diagonals are calculated, and
+     * any cell outside of the band is considered unreachable.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param table The scoring table to use.
+     * @param border A global memory cache for storing a strip's border line.
+     * @param band The band's half-width beyond the sequences' length difference.
+     * @return The alignment score, valid on the warp's first lane only.
+     */
+    __device__ score align_pair_warp(
+            linear
+        ,   const sequence_ref& one
+        ,   const sequence_ref& two
+        ,   const scoring_table& table
+        ,   score *__restrict__ border
+        ,   int band
+        )
+    {
+        constexpr unsigned mask = ~0U;
+        const int lane = threadIdx.x % cuda::warp_size;
+
+        const int height = (int) one.length();
+        const int width  = (int) two.length();
+        const score penalty = table.penalty();
+
+        // The band is given by the range of diagonals, that is the difference
+        // between a cell's column and line, which must be calculated. As the first
+        // sequence is the longest, the band is always shifted below the main diagonal.
+        const int lower = (width - height) - utils::min(band, height);
+        const int upper = utils::min(band, width);
+
+        score result = 0;
+
+        // The 0-th line of the alignment matrix is initialized by using successive
+        // gap penalties, and it is used as the border line for the first strip.
+        for(int j = lane; j < width; j += cuda::warp_size)
+            border[j] = (j + 1) * -penalty;
+
+        __syncwarp();
+
+        for(int offset = 0; offset < height; offset += cuda::warp_size) {
+            const int line = offset + lane;
+            const encoder::unit unit = line < height ? one[line] : sequence::padding;
+            const score *row = table.row(unit);
+
+            // The strip only needs to sweep the columns within its lines' bands.
+            // The cells of the 0-th column are only reachable within the band.
+            const int first = utils::max(offset + lower, 0);
+            const int last  = utils::min(offset + (int) cuda::warp_size + upper, width);
+
+            // The diagonal predecessor of the first lane's first cell is the 0-th
+            // column's gap score only if the strip starts at the 0-th column. If
+            // the band's lower edge has already moved right, it is the border
+            // line's cell right before the strip's first column instead.
+            score done = lane == 0 && first > 0
+                ? border[first - 1]
+                : (-line >= lower ? line * -penalty : unreachable);
+
+            score left = -line - 1 >= lower ? (line + 1) * -penalty : unreachable;
+            score value = left;
+            encoder::unit other = sequence::padding;
+
+            // At each step, the warp's first lane reads the next column from the
+            // border line, while every other lane gets the value just calculated
+            // by the lane right above it. Thus, every lane walks a single column
+            // per step, one column behind the lane above it.
+            for(int step = first; step < last + (int) cuda::warp_size - 1; ++step) {
+                const int column = step - lane;
+
+                score above = __shfl_up_sync(mask, value, 1);
+                other = __shfl_up_sync(mask, other, 1);
+
+                if(lane == 0 && step < width) {
+                    above = step < offset + upper ? border[step] : unreachable;
+                    other = two[step];
+                }
+
+                if(line < height && 0 <= column && column < width) {
+                    // If the column represents the end of sequence, the line's value
+                    // is simply copied. Likewise, if the line represents the end
+                    // of sequence, the value from the line above is copied.
+                    if(column - line < lower || column - line > upper) {
+                        value = unreachable;
+                    } else if(other == sequence::padding) {
+                        value = left;
+                    } else if(unit == sequence::padding) {
+                        value = above;
+                    } else {
+                        const auto insertd = left - penalty;
+                        const auto removed = above - penalty;
+                        const auto matched = done + row[other];
+                        value = utils::max(matched, utils::max(insertd, removed));
+                    }
+
+                    done = above;
+                    left = value;
+
+                    if(lane == cuda::warp_size - 1)
+                        border[column] = value;
+
+                    if(line == height - 1 && column == width - 1)
+                        result = value;
+                }
+            }
+
+            __syncwarp();
+        }
+
+        // The final result is held by the lane which processed the last line of
+        // the alignment matrix, so it must be sent to the warp's first lane.
+        return __shfl_sync(mask, result, (height - 1) % cuda::warp_size);
+    }
+
+    /**
+     * Aligns two sequences using Needleman-Wunsch algorithm with affine gaps and
+     * a single warp. Besides its cell's score, each lane keeps the best scores of
+     * its cell ending in a gap on either sequence, and the one ending in a gap on
+     * the second sequence is passed down along with the score. Thus, the strips'
+     * border is followed by the border line's gap states.
+     * @param one The first sequence to align.
+     * @param two The second sequence to align.
+     * @param table The scoring table to use.
+     * @param border A global memory cache for storing a strip's border lines.
+     * @param band The band's half-width beyond the sequences' length difference.
+     * @return The alignment score, valid on the warp's first lane only.
+     */
+    __device__ score align_pair_warp(
+            affine
+        ,   const sequence_ref& one
+        ,   const sequence_ref& two
+        ,   const scoring_table& table
+        ,   score *__restrict__ border
+        ,   int band
+        )
+    {
+        constexpr unsigned mask = ~0U;
+        const int lane = threadIdx.x % cuda::warp_size;
+
+        const int height = (int) one.length();
+        const int width  = (int) two.length();
+        const score open = table.penalty();
+        const score extend = table.extend();
+
+        const int lower = (width - height) - utils::min(band, height);
+        const int upper = utils::min(band, width);
+
+        score *__restrict__ removed = border + width;
+        score result = 0;
+
+        for(int j = lane; j < width; j += cuda::warp_size) {
+            border[j] = -open - j * extend;
+            removed[j] = unreachable;
+        }
+
+        __syncwarp();
+
+        for(int offset = 0; offset < height; offset += cuda::warp_size) {
+            const int line = offset + lane;
+            const encoder::unit unit = line < height ? one[line] : sequence::padding;
+            const score *row = table.row(unit);
+
+            const int first = utils::max(offset + lower, 0);
+            const int last  = utils::min(offset + (int) cuda::warp_size + upper, width);
+
+            // Just as with linear gaps, the first lane's diagonal predecessor is
+            // taken from the border line once the band has left the 0-th column.
+            // Its left neighbour is then outside of the band, so the gap state
+            // on the second sequence starts unreachable, while the gap state on
+            // the first sequence comes from the border's own gap line.
+            const bool inside = lane == 0 && first > 0;
+
+            score done = inside
+                ? border[first - 1]
+                : (-line >= lower ? (line ? -open - (line - 1) * extend : 0) : unreachable);
+
+            score left = !inside && -line - 1 >= lower ? -open - line * extend : unreachable;
+            score value = left, gap = unreachable, insertd = unreachable;
+            encoder::unit other = sequence::padding;
+
+            for(int step = first; step < last + (int) cuda::warp_size - 1; ++step) {
+                const int column = step - lane;
+
+                score above = __shfl_up_sync(mask, value, 1);
+                score closed = __shfl_up_sync(mask, gap, 1);
+                other = __shfl_up_sync(mask, other, 1);
+
+                if(lane == 0 && step < width) {
+                    above = step < offset + upper ? border[step] : unreachable;
+                    closed = step < offset + upper ? removed[step] : unreachable;
+                    other = two[step];
+                }
+
+                if(line < height && 0 <= column && column < width) {
+                    if(column - line < lower || column - line > upper) {
+                        value = gap = insertd = unreachable;
+                    } else if(other == sequence::padding) {
+                        value = left;
+                        gap = unreachable;
+                    } else if(unit == sequence::padding) {
+                        value = above;
+                        gap = closed;
+                    } else {
+                        insertd = utils::max(left - open, insertd - extend);
+                        gap = utils::max(above - open, closed - extend);
+
+                        const auto matched = done + row[other];
+                        value = utils::max(matched, utils::max(insertd, gap));
+                    }
+
+                    done = above;
+                    left = value;
+
+                    if(lane == cuda::warp_size - 1) {
+                        border[column] = value;
+                        removed[column] = gap;
+                    }
+
+                    if(line == height - 1 && column == width - 1)
+                        result = value;
+                }
+            }
+
+            __syncwarp();
+        }
+
+        return __shfl_sync(mask, result, (height - 1) % cuda::warp_size);
+    }
+
+    /**
+     * Performs the Needleman-Wunsch sequence aligment algorithm in parallel, with
+     * each warp independently aligning a different pair.
+     * @tparam G The gap model's type.
+     * @param in The input data requested by the algorithm.
+     * @param out The output data produced by the algorithm.
+     * @param table The scoring table to use in alignment.
+     * @param band The band's half-width, in number of diagonals.
+     */
+    template <typename G>
+    __launch_bounds__(cuda::warp_size * warp_count)
+    __global__ void wavefront_kernel(input in, buffer<score> out, const scoring_table table, int band)
+    {
+        __shared__ scoring_table::raw_type mem_table;
+        __shared__ scoring_table shared_table;
+
+        // As with the usual kernel, the scoring table is copied into shared memory.
+        // This is the only block-level barrier needed by this kernel, as each warp
+        // works independently on its own pair from here on.
+        new (&shared_table) scoring_table {pointer<decltype(mem_table)>::weak(&mem_table), table};
+
+        __syncthreads();
+
+        const size_t warp = threadIdx.x / cuda::warp_size;
+        const size_t stride = gridDim.x * warp_count;
+
+        for(size_t i = blockIdx.x * warp_count + warp; i < in.jobs.size(); i += stride) {
+            const sequence_ref one = in.db[in.jobs[i].payload.id[0]];
+            const sequence_ref two = in.db[in.jobs[i].payload.id[1]];
+
+            // We put the longest sequence on the lines, so the shortest one is
+            // the one swept by the wavefront, with its border fitting the cache.
+            auto result = align_pair_warp(
+                    G {}
+                ,   one.size() > two.size() ? one : two
+                ,   one.size() > two.size() ? two : one
+                ,   shared_table
+                ,   &in.cache[in.jobs[i].cache_offset]
+                ,   band
+                );
+
+            if(threadIdx.x % cuda::warp_size == 0) {
+                out[i] = result;
+            }
+        }
+    }
+
     /**
      * Calculates the memory usage for a given work case.
      * @param db The sequences available for alignment.
      * @param used The map of already "loaded" sequences.
      * @param target The work case's target pair.
      * @param pair_cache The cache size required by the work case.
+     * @param resident Are all sequences already resident in device?
      * @return The total memory requested for this work case execution.
      */
     static size_t required_memory(
@@ -264,6 +723,7 @@ namespace
         ,   const std::set<ptrdiff_t>& used
         ,   const pair& target
         ,   size_t pair_cache
+        ,   bool resident
         )
     {
         // Calculating the total amount of memory required for cache while processing
@@ -272,14 +732,14 @@ namespace
 
         // The amount of memory required by the sequences themselves are defined
         // by their sizes and whether they are already "loaded" or not.
-        total_mem += sizeof(encoder::block) * (
+        if(!resident) total_mem += sizeof(encoder::block) * (
                 (used.find(target.id[0]) == used.end()) * db[target.id[0]].contents.size()
             +   (used.find(target.id[1]) == used.end()) * db[target.id[1]].contents.size()
             );
 
         // Besides the cache and the sequences, a work pair also requires memory
         // for its final result and describing structures' instances.
-        return total_mem + 2 * sizeof(sequence_view) + sizeof(job) + sizeof(score);
+        return total_mem + 2 * sizeof(sequence_ref) + sizeof(job) + sizeof(score);
     }
 
     /**
@@ -287,11 +747,17 @@ namespace
      * @param cache_size The amount of cache allocated previously for the block.
      * @param db The sequences available for alignment.
      * @param target The work case's target pair.
+     * @param lines The number of cached lines needed by the gap model.
      * @return The additional amount of cache needed for processing the pair.
      */
-    static size_t needed_cache(const size_t cache_size, const museqa::database& db, const pair& target)
+    static size_t needed_cache(
+            const size_t cache_size
+        ,   const museqa::database& db
+        ,   const pair& target
+        ,   const size_t lines
+        )
     {
-        auto total = utils::max(db[target.id[0]].contents.length(), db[target.id[1]].contents.length());
+        auto total = lines * utils::max(db[target.id[0]].contents.length(), db[target.id[1]].contents.length());
         return utils::max(total - cache_size, 0UL);
     }
 
@@ -301,6 +767,7 @@ namespace
      * @param used The map of already "loaded" sequences.
      * @param jobs The batch's target jobs.
      * @param cache_size The total cache size these jobs require.
+     * @param resident The device-resident database, if any.
      * @return The new loaded input instance.
      */
     static input load_input(
@@ -308,11 +775,26 @@ namespace
         ,   const std::set<ptrdiff_t>& used
         ,   const buffer<job>& jobs
         ,   const size_t cache_size
+        ,   const pairwise::database& resident
         )
     {
+        trace::scope span {"needleman::load_input"};
+
         input target;
         const size_t count = jobs.size();
 
+        // If the whole database is already resident in device, the jobs can simply
+        // point to their sequences with their original identifiers.
+        if(resident.count()) {
+            target.db = resident;
+            target.jobs = buffer<job>::make(cuda::allocator::device, count);
+            target.cache = buffer<score>::make(cuda::allocator::device, cache_size);
+
+            cuda::memory::copy(target.jobs.raw(), jobs.raw(), count);
+
+            return target;
+        }
+
         std::map<ptrdiff_t, seqref> transform;
         auto jobs_buffer = buffer<job>::copy(jobs);
         seqref index = 0;
@@ -326,7 +808,7 @@ namespace
             ,   transform[jobs[i].payload.id[1]]
             };
 
-        target.db = pairwise::database(db.only(used)).to_device();
+        target.db = pairwise::database(db, std::vector<ptrdiff_t> (used.begin(), used.end())).to_device();
         target.jobs = buffer<job>::make(cuda::allocator::device, count);
         target.cache = buffer<score>::make(cuda::allocator::device, cache_size);
 
@@ -336,40 +818,91 @@ namespace
     }
 
     /**
-     * Prepares the input for the algorithm's device kernel.
+     * Informs the number of cache slots to be shared by a batch's jobs. Each kernel
+     * executor, either a block or a warp, aligns its pairs one after the other,
+     * so no more slots are needed than there can be warps resident on the device.
+     * The number of slots is kept a multiple of the wavefront kernel's warps per
+     * block, so the wavefront grid's warps map one-to-one onto the slots.
+     * @param jobs The number of jobs in the batch.
+     * @return The number of cache slots for the batch.
+     */
+    static size_t slots(size_t jobs)
+    {
+        const size_t resident = utils::max<size_t>(cuda::device::warps() / warp_count, 1) * warp_count;
+        return utils::min(jobs, resident);
+    }
+
+    /**
+     * Orders the pairs from the longest to the shortest. As the kernels' executors
+     * take their pairs in order, this sorts the grid so that it does not end on
+     * a long tail, and each cache slot is first given its longest pair, thus its
+     * cache is sized by that pair and never has to grow for the pairs which follow.
+     * @param pairs The sequence pairs to align.
+     * @param db The sequences available for alignment.
+     * @return The pairs' indeces, from the longest pair to the shortest.
+     */
+    static auto plan(const buffer<pair>& pairs, const museqa::database& db) -> std::vector<size_t>
+    {
+        auto order = std::vector<size_t> (pairs.size());
+        auto length = [&](size_t i) {
+            const size_t one = db[pairs[i].id[0]].contents.length();
+            const size_t two = db[pairs[i].id[1]].contents.length();
+            return std::make_pair(utils::max(one, two), utils::min(one, two));
+        };
+
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return length(a) > length(b); });
+
+        return order;
+    }
+
+    /**
+     * Prepares the input for the algorithm's device kernel. The jobs are dealt
+     * among the batch's cache slots in turns, so job i always runs on slot i modulo
+     * the number of slots, and each slot's cache is sized to its longest pair.
      * @param pairs The sequence pairs to align.
      * @param db The sequences available for alignment.
      * @param done The number of already processed pairs.
+     * @param mem_limit The amount of device memory available for the input.
+     * @param resident The device-resident database, if any.
+     * @param lines The number of cached lines needed by the gap model.
      * @return Input object instance with the selected pairs.
      */
-    static input make_input(const buffer<pair>& pairs, const museqa::database& db, const size_t done)
+    static input make_input(
+            const buffer<pair>& pairs
+        ,   const museqa::database& db
+        ,   const size_t done
+        ,   size_t mem_limit
+        ,   const pairwise::database& resident
+        ,   const size_t lines
+        )
     {
         const size_t count = pairs.size();
 
         size_t job_count  = 0;
-        size_t mem_limit  = cuda::device::free_memory();
-        size_t max_blocks = cuda::device::blocks(count);
+        size_t max_slots  = slots(count - done);
 
         auto sequences    = std::set<ptrdiff_t>();
-        auto block_cache  = std::vector<size_t>(max_blocks);
+        auto slot_cache   = std::vector<size_t>(max_slots);
 
-        for(size_t i = done, n = 0; i < count; ++i, n = (n + 1) % max_blocks) {
-            // As this block might have already been used to calculate a previous
-            // pair, we should try reusing its old cache.
-            size_t pair_cache = needed_cache(block_cache[n], db, pairs[i]);
-            size_t pair_mem = required_memory(db, sequences, pairs[i], pair_cache);
+        for(size_t i = done, n = 0; i < count; ++i, n = (n + 1) % max_slots) {
+            // As this slot might have already been used to calculate a previous
+            // pair, we should try reusing its old cache. As the pairs are sorted,
+            // only the first pair of each slot should ever need any new cache.
+            size_t pair_cache = needed_cache(slot_cache[n], db, pairs[i], lines);
+            size_t pair_mem = required_memory(db, sequences, pairs[i], pair_cache, resident.count());
 
             // If the amount of memory requested by the current pair is not available,
-            // then our input is already in its full capacity. We assume sequences
-            // are roughly the same size, so trying to find another pair that might
-            // fit in the remaining space will be mostly unsuccessful.
+            // then our input is already in its full capacity. As the pairs are sorted,
+            // the pairs left are shorter, but they must be kept in order so that
+            // the next batch can still start by its longest pairs.
             if(pair_mem > mem_limit)
                 break;
 
             sequences.insert(pairs[i].id[0]);
             sequences.insert(pairs[i].id[1]);
 
-            block_cache[n] += pair_cache;
+            slot_cache[n] += pair_cache;
             mem_limit -= pair_mem;
             ++job_count;
         }
@@ -377,52 +910,526 @@ namespace
         size_t cache_offset = 0;
         auto jobs = buffer<job>::make(job_count);
 
-        // Calculates the cache offset for each kernel block's use. This is essential
-        // to avoid cache collisions while processing pairs simultaneously.
-        for(size_t i = 0; i < max_blocks; ++i) {
-            auto length = block_cache[i];
-            block_cache[i] = cache_offset;
+        // Calculates the cache offset for each slot's use. This is essential to
+        // avoid cache collisions while processing pairs simultaneously.
+        for(size_t i = 0; i < max_slots; ++i) {
+            auto length = slot_cache[i];
+            slot_cache[i] = cache_offset;
             cache_offset += length;
         }
 
         // Builds the jobs instances, by assigning each job a pair to process and
-        // a cache offset to work with, which relates to the block it'll run in.
+        // a cache offset to work with, which relates to the slot it'll run in.
         for(size_t i = 0; i < job_count; ++i)
-            jobs[i] = {pairs[done + i], block_cache[i]};
+            jobs[i] = {pairs[done + i], slot_cache[i % max_slots]};
 
-        return load_input(db, sequences, jobs, cache_offset);
+        return load_input(db, sequences, jobs, cache_offset, resident);
+    }
+
+    /**
+     * The type of the usual alignment kernel's launchers. Each of the kernel's
+     * configurations is launched by its own launcher instance.
+     * @since 0.1.1
+     */
+    using launcher = void (*)(const input&, buffer<score>&, const scoring_table&, const cuda::stream&);
+
+    /**
+     * Launches the usual alignment kernel with one of its configurations, with a
+     * whole block per pair.
+     * @tparam W The number of warps in each block.
+     * @tparam N The number of warps' widths in each of the alignment's slices.
+     * @param in The input data requested by the algorithm.
+     * @param out The output data produced by the algorithm.
+     * @param table The scoring table to use in alignment.
+     * @param stream The stream to launch the kernel into.
+     */
+    template <size_t W, size_t N>
+    static void launch_shape(
+            const input& in
+        ,   buffer<score>& out
+        ,   const scoring_table& table
+        ,   const cuda::stream& stream
+        )
+    {
+        enum : size_t { block_size = cuda::warp_size * W };
+        enum : size_t { batch_size = cuda::warp_size * N };
+
+        size_t blocks = cuda::device::blocks(slots(in.jobs.size()));
+        trace::kernel span {"needleman::align_kernel", stream};
+
+        // Here, we call our kernel and allocate our Needleman-Wunsch line buffer
+        // in shared memory. We recommend that the batch size be a multiple
+        // of both the number of characters in an encoded sequence block and
+        // the number of threads in a warp. With affine gaps, the line of gap
+        // states is also kept in shared memory, right after the line.
+        if(!table.affine()) align_kernel<linear, block_size, batch_size><<<blocks, block_size, sizeof(score) * batch_size, stream>>>(in, out, table);
+        else align_kernel<affine, block_size, batch_size><<<blocks, block_size, 2 * sizeof(score) * batch_size, stream>>>(in, out, table);
+    }
+
+    /**
+     * Prefers shared memory over the L1 cache for one of the usual alignment
+     * kernel's configurations, on the currently selected device.
+     * @tparam W The number of warps in each block.
+     * @tparam N The number of warps' widths in each of the alignment's slices.
+     */
+    template <size_t W, size_t N>
+    static void prefer_shape()
+    {
+        cuda::kernel::preference(align_kernel<linear, cuda::warp_size * W, cuda::warp_size * N>, cuda::cache::shared);
+        cuda::kernel::preference(align_kernel<affine, cuda::warp_size * W, cuda::warp_size * N>, cuda::cache::shared);
+    }
+
+    /**
+     * Describes one of the usual alignment kernel's configurations.
+     * @since 0.1.1
+     */
+    struct shape
+    {
+        const char *name;       /// The configuration's name, as warps per block and per slice.
+        launcher launch;        /// The configuration's kernel launcher.
+        void (*prefer)();       /// The configuration's cache preference setter.
+    };
+
+    /*
+     * The usual alignment kernel's configurations. These are the ones timed when
+     * the kernel is tuned for a device, as different architectures are best fit
+     * by different block and slice sizes. The slices' sizes are all multiples of
+     * both the warp size and the number of characters in an encoded block.
+     */
+    static const shape shapes[] = {
+        {"4x12", launch_shape<4, 12>, prefer_shape<4, 12>}
+    ,   {"4x15", launch_shape<4, 15>, prefer_shape<4, 15>}
+    ,   {"4x18", launch_shape<4, 18>, prefer_shape<4, 18>}
+    ,   {"5x12", launch_shape<5, 12>, prefer_shape<5, 12>}
+    ,   {"5x15", launch_shape<5, 15>, prefer_shape<5, 15>}
+    ,   {"5x18", launch_shape<5, 18>, prefer_shape<5, 18>}
+    ,   {"8x12", launch_shape<8, 12>, prefer_shape<8, 12>}
+    ,   {"8x15", launch_shape<8, 15>, prefer_shape<8, 15>}
+    ,   {"8x18", launch_shape<8, 18>, prefer_shape<8, 18>}
+    };
+
+    /*
+     * The usual alignment kernel's default configuration, used whenever the kernel
+     * has not been tuned for the current device.
+     */
+    enum : size_t { default_shape = 4 };
+
+    /**
+     * Launches the usual alignment kernel, with a whole block per pair. The kernel
+     * is launched with the configuration tuned for the current device. If it has
+     * not been tuned yet, the configurations are timed on the batch's first wave
+     * of pairs, which are the longest ones, so the kernel is tuned on real work.
+     * @param in The input data requested by the algorithm.
+     * @param out The output data produced by the algorithm.
+     * @param table The scoring table to use in alignment.
+     * @param stream The stream to launch the kernel into.
+     */
+    static void launch_block(
+            const input& in
+        ,   buffer<score>& out
+        ,   const scoring_table& table
+        ,   const cuda::stream& stream
+        )
+    {
+        static const auto labels = []() {
+            std::vector<std::string> names;
+            for(const auto& current : shapes)
+                names.push_back(current.name);
+            return names;
+        }();
+
+        const auto kernel = table.affine() ? "needleman::align_kernel<affine>" : "needleman::align_kernel<linear>";
+
+        const size_t chosen = cuda::tuning::pick(kernel, labels, default_shape, [&](size_t i) {
+            // The first wave's jobs are each given a different cache slot, so they
+            // can be aligned on their own without ever sharing their caches.
+            auto sample = in;
+            sample.jobs = buffer<job> {sample.jobs.offset(0), slots(sample.jobs.size())};
+            shapes[i].launch(sample, out, table, stream);
+        }, stream);
+
+        shapes[chosen].launch(in, out, table, stream);
+    }
+
+    /**
+     * Launches the wavefront alignment kernel within a band of diagonals.
+     * @param in The input data requested by the algorithm.
+     * @param out The output data produced by the algorithm.
+     * @param table The scoring table to use in alignment.
+     * @param stream The stream to launch the kernel into.
+     * @param band The band's half-width, in number of diagonals.
+     */
+    static void launch_band(
+            const input& in
+        ,   buffer<score>& out
+        ,   const scoring_table& table
+        ,   const cuda::stream& stream
+        ,   int band
+        )
+    {
+        size_t blocks = cuda::device::blocks((slots(in.jobs.size()) + warp_count - 1) / warp_count);
+        trace::kernel span {"needleman::wavefront_kernel", stream};
+
+        if(!table.affine()) wavefront_kernel<linear><<<blocks, cuda::warp_size * warp_count, 0, stream>>>(in, out, table, band);
+        else wavefront_kernel<affine><<<blocks, cuda::warp_size * warp_count, 0, stream>>>(in, out, table, band);
+    }
+
+    /**
+     * Launches the wavefront alignment kernel, with a single warp per pair.
+     * @param in The input data requested by the algorithm.
+     * @param out The output data produced by the algorithm.
+     * @param table The scoring table to use in alignment.
+     * @param stream The stream to launch the kernel into.
+     */
+    static void launch_wavefront(
+            const input& in
+        ,   buffer<score>& out
+        ,   const scoring_table& table
+        ,   const cuda::stream& stream
+        )
+    {
+        launch_band(in, out, table, stream, std::numeric_limits<int>::max());
+    }
+
+    /**
+     * Represents one of the devices' execution queues, in which batches of pairs
+     * are processed. A queue keeps its batch's data alive until it is finished.
+     * @since 0.1.1
+     */
+    struct queue
+    {
+        const cuda::device::id device;  /// The device on which the queue runs.
+        const cuda::stream stream;      /// The stream to which the queue's batches are sent.
+        const scoring_table table;      /// The device's scoring table instance.
+        const pairwise::database db;    /// The device-resident database, if any.
+        const size_t mem_limit;         /// The amount of device memory available to the queue.
+        input in;                       /// The input of the queue's current batch.
+        buffer<score> out;              /// The output of the queue's current batch.
+
+        /**
+         * Initializes a new execution queue on the given device.
+         * @param device The device on which the queue runs.
+         * @param table The device's scoring table instance.
+         * @param db The device-resident database, if any.
+         * @param mem_limit The amount of device memory available to the queue.
+         */
+        inline queue(
+                cuda::device::id device
+            ,   const scoring_table& table
+            ,   const pairwise::database& db
+            ,   size_t mem_limit
+            )
+        :   device {device}
+        ,   stream {cudaStreamNonBlocking}
+        ,   table {table}
+        ,   db {db}
+        ,   mem_limit {mem_limit}
+        {}
+    };
+
+    /**
+     * Keeps a database resident on a device, so it does not need to be uploaded
+     * again for every batch or every set of pairs scheduled to the current node.
+     * @since 0.1.1
+     */
+    struct residency
+    {
+        const museqa::database *source; /// The host database which has been uploaded.
+        pairwise::database db;          /// The device-resident database, if it fits.
+    };
+
+    /*
+     * The databases currently resident on each of the node's devices. Resident
+     * databases are kept for as long as the algorithm is running.
+     */
+    static std::map<cuda::device::id, residency> residents;
+
+    /**
+     * Releases all device-resident databases when the algorithm is finished, as
+     * device memory must be freed before the device runtime is shut down. The
+     * devices' pooled memory is also given back, as the devices may be shared
+     * with other nodes running on the same host.
+     * @since 0.1.1
+     */
+    struct residency_scope
+    {
+        inline ~residency_scope()
+        {
+            const auto first = cuda::device::current();
+            auto devices = std::vector<cuda::device::id> {};
+
+            for(const auto& entry : residents)
+                devices.push_back(entry.first);
+
+            residents.clear();
+
+            for(const auto device : devices) {
+                cuda::device::select(device);
+                cuda::memory::trim();
+            }
+
+            cuda::device::select(first);
+        }
+    };
+
+    /**
+     * Retrieves the given database resident on the currently selected device. The
+     * database is uploaded at its first use, but only if it fits within at most
+     * half of the device's free memory, as the rest is needed by the batches.
+     * @param db The host database to be kept resident.
+     * @return The device-resident database, or an empty one if it does not fit.
+     */
+    static auto resident(const museqa::database& db) -> const pairwise::database&
+    {
+        const auto device = cuda::device::current();
+        const auto found = residents.find(device);
+
+        if(found != residents.end() && found->second.source == &db)
+            return found->second.db;
+
+        size_t total_blocks = 0;
+
+        for(const auto& entry : db)
+            total_blocks += entry.contents.size();
+
+        const size_t required = sizeof(encoder::block) * total_blocks + sizeof(sequence_ref) * db.count();
+        auto& target = residents[device] = residency {&db, pairwise::database {}};
+
+        if(required <= cuda::device::free_memory() / 2) {
+            #if !defined(__museqa_runtime_cython)
+                stream::await(db.count());
+            #endif
+            target.db = pairwise::database(db).to_device();
+        }
+
+        return target.db;
+    }
+
+    /**
+     * Creates the execution queues for all devices driven by the current node. The
+     * node's devices are the ones following the node's selected device.
+     * @param db The sequences available for alignment.
+     * @param table The scoring table to use.
+     * @return The list of execution queues.
+     */
+    static auto make_queues(const museqa::database& db, const scoring_table& table) -> std::deque<queue>
+    {
+        std::deque<queue> queues;
+
+        const auto first = cuda::device::current();
+        const auto count = utils::max(global_state.local_devices, 1);
+
+        for(int i = 0; i < global_state.node_devices; ++i) {
+            const cuda::device::id device = (first + i) % count;
+
+            cuda::device::select(device);
+
+            for(const auto& current : shapes)
+                current.prefer();
+
+            // The device's free memory is evenly split among its queues. Thus,
+            // a batch may be uploaded while the previous one is still running.
+            const auto device_table = table.to_device();
+            const auto& device_db = resident(db);
+            const size_t mem_limit = cuda::device::free_memory() / device_streams;
+
+            for(size_t j = 0; j < device_streams; ++j)
+                queues.emplace_back(device, device_table, device_db, mem_limit);
+        }
+
+        cuda::device::select(first);
+        return queues;
+    }
+
+    /*
+     * The execution queues shared by all chunks of pairs scheduled to the current
+     * node, if any. The queues are only shared while the dynamic scheduler runs.
+     */
+    static std::deque<queue> *shared = nullptr;
+
+    /**
+     * Keeps the execution queues alive while chunks of pairs are scheduled to the
+     * current node. Thus, the queues, their streams and the scoring tables are
+     * created for the scheduler's first chunk and then reused by all others.
+     * @since 0.1.1
+     */
+    struct queue_scope
+    {
+        std::deque<queue> queues;       /// The queues shared by the node's chunks.
+
+        inline queue_scope() { shared = &queues; }
+        inline ~queue_scope() { shared = nullptr; }
+    };
+
+    /**
+     * Executes the hybrid Needleman-Wunsch algorithm for the pairwise step. The
+     * batches of pairs are handed out to the node's devices' queues in turns, so
+     * the next batch is planned and uploaded while the previous ones are running.
+     * @tparam L The kernel launcher type.
+     * @param pairs The sequence pairs to align in the current node.
+     * @param db The sequences available for alignment.
+     * @param table The scoring table to use.
+     * @param launch The kernel launcher to align the batches with.
+     * @return The score of aligned pairs.
+     */
+    template <typename L>
+    static auto align(
+            const buffer<pair>& pairs
+        ,   const museqa::database& db
+        ,   const scoring_table& table
+        ,   const L& launch
+        )
+    -> buffer<score>
+    {
+        const size_t count = pairs.size();
+        const auto first = cuda::device::current();
+        const auto order = plan(pairs, db);
+
+        auto sorted = buffer<pair>::make(count);
+
+        for(size_t i = 0; i < count; ++i)
+            sorted[i] = pairs[order[i]];
+
+        // The results are copied back from devices asynchronously, thus they
+        // must be written to pinned memory, otherwise the host would be blocked.
+        auto result = buffer<score>::make(cuda::allocator::pinned, count);
+        auto local = shared ? std::deque<queue> {} : make_queues(db, table);
+
+        if(shared && shared->empty())
+            *shared = make_queues(db, table);
+
+        auto& queues = shared ? *shared : local;
+
+        // The device kernels with affine gaps must cache the gap states as well as
+        // the scores, so the pairs need twice as much cache as with linear gaps.
+        const size_t lines = table.affine() ? 2 : 1;
+
+        size_t done = 0, running = 0;
+
+        for(size_t i = 0; done < count || running > 0; i = (i + 1) % queues.size()) {
+            auto& current = queues[i];
+
+            if(current.device != cuda::device::current())
+                cuda::device::select(current.device);
+
+            // Before reusing a queue, its previous batch must be finished. As queues
+            // are used in turns, the queue's batch is always the oldest one running.
+            if(current.in.jobs.size()) {
+                trace::scope span {"needleman::wait"};
+
+                current.stream.barrier();
+                current.in = input {};
+                current.out = buffer<score> {};
+                --running;
+            }
+
+            if(done < count) {
+                current.in = make_input(sorted, db, done, current.mem_limit, current.db, lines);
+
+                const size_t jobs = current.in.jobs.size();
+                enforce(jobs, "not enough memory in device");
+
+                current.out = buffer<score>::make(cuda::allocator::device, jobs);
+
+                launch(current.in, current.out, current.table, current.stream);
+
+                {
+                    trace::kernel span {"needleman::copy", current.stream};
+                    cuda::memory::copy(result.raw() + done, current.out.raw(), jobs, current.stream);
+                }
+
+                done += jobs;
+                ++running;
+            }
+        }
+
+        if(first != cuda::device::current())
+            cuda::device::select(first);
+
+        auto scores = buffer<score>::make(count);
+
+        for(size_t i = 0; i < count; ++i)
+            scores[order[i]] = result[i];
+
+        return scores;
     }
 
     /**
      * Executes the hybrid Needleman-Wunsch algorithm for the pairwise step.
+     * @tparam L The kernel launcher to align the batches with.
      * @param pairs The sequence pairs to align in the current node.
      * @param db The sequences available for alignment.
      * @param table The scoring table to use.
      * @return The score of aligned pairs.
      */
+    template <void (*L)(const input&, buffer<score>&, const scoring_table&, const cuda::stream&)>
     static auto align(const buffer<pair>& pairs, const museqa::database& db, const scoring_table& table)
     -> buffer<score>
     {
-        const size_t count = pairs.size();
-        auto result = buffer<score>::make(count);
+        return align(pairs, db, table, L);
+    }
 
-        cuda::kernel::preference(align_kernel, cuda::cache::shared);
+    /**
+     * Executes the banded Needleman-Wunsch algorithm for the pairwise step. All
+     * pairs are firstly aligned within a narrow band, which is then widened and
+     * realigned only for the pairs whose scores cannot be proven to be optimal.
+     * @param pairs The sequence pairs to align in the current node.
+     * @param db The sequences available for alignment.
+     * @param table The scoring table to use.
+     * @return The score of aligned pairs.
+     */
+    static auto align_banded(const buffer<pair>& pairs, const museqa::database& db, const scoring_table& table)
+    -> buffer<score>
+    {
+        const size_t count = pairs.size();
+        const score match = needleman::band::bound(table);
+        const score penalty = needleman::band::penalty(table);
 
-        for(size_t done = 0; done < count; ) {
-            input in = make_input(pairs, db, done);
-            auto out = buffer<score>::make(cuda::allocator::device, in.jobs.size());
+        auto result = buffer<score>::make(count);
+        auto pending = std::vector<size_t> (count);
 
-            enforce(in.jobs.size(), "not enough memory in device");
-            size_t blocks = cuda::device::blocks(in.jobs.size());
+        for(size_t i = 0; i < count; ++i)
+            pending[i] = i;
+
+        // The device aligns the sequences with their padding, which might shift
+        // the band by a few diagonals. Thus, the band's width must be grown by
+        // the same amount to hold the band needed by the unpadded sequences.
+        const size_t slack = encoder::block_size - 1;
+
+        for(size_t width = needleman::band::initial; !pending.empty(); ) {
+            const int band = (int) utils::min<size_t>(width + slack, std::numeric_limits<int>::max());
+            auto selected = buffer<pair>::make(pending.size());
+
+            for(size_t i = 0; i < pending.size(); ++i)
+                selected[i] = pairs[pending[i]];
+
+            auto scores = align(selected, db, table, [band](
+                    const input& in
+                ,   buffer<score>& out
+                ,   const scoring_table& device_table
+                ,   const cuda::stream& stream
+                ) { launch_band(in, out, device_table, stream, band); });
+
+            // The pairs whose scores could not be proven optimal are realigned
+            // with the widest band needed among them, so a single round is needed.
+            std::vector<size_t> retry;
+            size_t widest = 0;
+
+            for(size_t i = 0; i < pending.size(); ++i) {
+                const size_t one = db[selected[i].first].contents.unpadded();
+                const size_t two = db[selected[i].second].contents.unpadded();
+                const size_t needed = needleman::band::required(scores[i], one, two, match, penalty);
+
+                result[pending[i]] = scores[i];
+
+                if(width < needed) {
+                    widest = utils::max(widest, needed);
+                    retry.push_back(pending[i]);
+                }
+            }
 
-            // Here, we call our kernel and allocate our Needleman-Wunsch line buffer
-            // in shared memory. We recommend that the batch size be a multiple
-            // of both the number of characters in an encoded sequence block and
-            // the number of threads in a warp. You can change the block size by
-            // tweaking the *block_size* configuration value.
-            align_kernel<<<blocks, block_size, sizeof(score) * batch_size>>>(in, out, table);
-            cuda::memory::copy(result.raw() + done, out.raw(), in.jobs.size());
-            done += in.jobs.size();
+            pending.swap(retry);
+            width = widest;
         }
 
         return result;
@@ -447,9 +1454,87 @@ namespace
             size_t nsequences = ctx.db.count();
 
             onlyslaves {
-                auto pairs = this->generate(nsequences);
-                const scoring_table table = ctx.table.to_device();
-                result = align(pairs, ctx.db, table);
+                residency_scope scope;
+                auto pairs = this->generate(ctx);
+                result = align<launch_block>(pairs, ctx.db, ctx.table);
+            }
+
+            return distance_matrix {this->gather(result), nsequences};
+        }
+    };
+
+    /**
+     * The hybrid needleman algorithm object with dynamic pairs scheduling. Instead
+     * of a fixed slice, pairs are handed out to slaves on demand.
+     * @since 0.1.1
+     */
+    struct hybrid_dynamic : public needleman::algorithm
+    {
+        /**
+         * Executes the hybrid needleman algorithm for the pairwise step, with the
+         * workload being dynamically distributed among cluster nodes.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            residency_scope scope;
+            queue_scope queues;
+            return this->schedule(ctx, align<launch_block>);
+        }
+    };
+
+    /**
+     * The wavefront needleman algorithm object. This algorithm uses the same hybrid
+     * parallelism, but aligns each pair with a single warp instead of a whole block.
+     * @since 0.1.1
+     */
+    struct wavefront : public needleman::algorithm
+    {
+        /**
+         * Executes the wavefront needleman algorithm for the pairwise step. This method is
+         * responsible for distributing and gathering workload from different cluster nodes.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            buffer<score> result;
+            size_t nsequences = ctx.db.count();
+
+            onlyslaves {
+                residency_scope scope;
+                auto pairs = this->generate(ctx);
+                result = align<launch_wavefront>(pairs, ctx.db, ctx.table);
+            }
+
+            return distance_matrix {this->gather(result), nsequences};
+        }
+    };
+
+    /**
+     * The banded needleman algorithm object. This algorithm uses the same hybrid
+     * parallelism, but only calculates the cells within an adaptive band around
+     * the alignment matrix's main diagonal, thus it is best for similar sequences.
+     * @since 0.1.1
+     */
+    struct banded : public needleman::algorithm
+    {
+        /**
+         * Executes the banded needleman algorithm for the pairwise step. This method is
+         * responsible for distributing and gathering workload from different cluster nodes.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            buffer<score> result;
+            size_t nsequences = ctx.db.count();
+
+            onlyslaves {
+                residency_scope scope;
+                auto pairs = this->generate(ctx);
+                result = align_banded(pairs, ctx.db, ctx.table);
             }
 
             return distance_matrix {this->gather(result), nsequences};
@@ -467,4 +1552,31 @@ namespace museqa
     {
         return new ::hybrid;
     }
+
+    /**
+     * Instantiates a new dynamically scheduled hybrid needleman instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::needleman::hybrid_dynamic() -> pairwise::algorithm *
+    {
+        return new ::hybrid_dynamic;
+    }
+
+    /**
+     * Instantiates a new wavefront needleman instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::needleman::wavefront() -> pairwise::algorithm *
+    {
+        return new ::wavefront;
+    }
+
+    /**
+     * Instantiates a new banded needleman instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::needleman::banded() -> pairwise::algorithm *
+    {
+        return new ::banded;
+    }
 }
@@ -4,14 +4,18 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2018-present Rodrigo Siqueira
  */
+#include <vector>
 #include <cstdint>
 
 #include "node.hpp"
 #include "buffer.hpp"
+#include "encoder.hpp"
 #include "database.hpp"
+#include "parallel.hpp"
 #include "sequence.hpp"
 
 #include "pairwise/pairwise.cuh"
+#include "pairwise/needleman/kernel.hpp"
 #include "pairwise/needleman/needleman.cuh"
 
 namespace
@@ -20,55 +24,33 @@ namespace
     using namespace pairwise;
 
     /**
-     * Sequentially aligns two sequences using Needleman-Wunsch algorithm.
+     * Sequentially aligns two sequences using Needleman-Wunsch algorithm. Only the
+     * alignment's score is needed, so the kernel keeps nothing but its score line.
      * @param one The first sequence to align.
      * @param two The second sequence to align.
      * @param table The scoring table used to compare both sequences.
      * @return The alignment score.
      */
-    static score align_pair(const sequence& one, const sequence& two, const scoring_table& table)
+    static score align_pair(sequence_ref one, sequence_ref two, const scoring_table& table)
     {
-        auto line = buffer<score>::make(two.length() + 1);
-
-        // Filling 0-th line with penalties. This is the only initialization needed
-        // for sequential algorithm.
-        for(size_t i = 0; i <= two.length(); ++i)
-            line[i] = i * -table.penalty();
-
-        for(size_t i = 0; i < one.length(); ++i) {
-            // If the current line is at sequence end, then we can already finish
-            // the algorithm, as no changes are expected to occur after the end
-            // of sequence.
-            if(one[i] == sequence::padding)
-                break;
-
-            // Initialize the 0-th column values. It will always be initialized
-            // with penalties, in the same manner as the 0-th line.
-            score done = line[0];
-            line[0] = (i + 1) * -table.penalty();
-
-            // Iterate over the second sequence, calculating the best alignment
-            // possible for each of its characters.
-            for(size_t j = 1; j <= two.length(); ++j) {
-                score value = line[j - 1];
-
-                if(two[j - 1] != sequence::padding) {
-                    const auto insertd = value - table.penalty();
-                    const auto removed = line[j] - table.penalty();
-                    const auto matched = done + table[{one[i], two[j - 1]}];
-                    value = utils::max(matched, utils::max(insertd, removed));
-                }
-
-                done = line[j];
-                line[j] = value;
-            }
-        }
-
-        return line[two.length()];
+        // Both sequences are decoded in bulk before aligning them, so their units
+        // can be directly read by the inner loop, without dividing and shifting.
+        thread_local std::vector<encoder::unit> decoded[2];
+        decoded[0].resize(one.length()); one.unpack(decoded[0].data());
+        decoded[1].resize(two.length()); two.unpack(decoded[1].data());
+
+        // As no changes are expected to occur after the end of either sequence,
+        // their padding units are simply left out of the alignment.
+        return needleman::align<needleman::policy::score_only>(
+                decoded[0].data(), one.unpadded()
+            ,   decoded[1].data(), two.unpadded()
+            ,   table
+            );
     }
 
     /**
      * Executes the sequential Needleman-Wunsch algorithm for the pairwise step.
+     * The pairs are split among the node's host threads, if more than one.
      * @param pairs The workpairs to align in the current node.
      * @param db The sequences available for alignment.
      * @param table The scoring table to use.
@@ -80,16 +62,18 @@ namespace
         const size_t count = pairs.size();
         auto result = buffer<score>::make(count);
 
-        for(size_t i = 0; i < count; ++i) {
-            const sequence& one = db[pairs[i].first].contents;
-            const sequence& two = db[pairs[i].second].contents;
+        parallel::foreach(count, [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i) {
+                const sequence_ref one = db[pairs[i].first].contents;
+                const sequence_ref two = db[pairs[i].second].contents;
 
-            result[i] = align_pair(
-                    one.size() > two.size() ? one : two
-                ,   one.size() > two.size() ? two : one
-                ,   table
-                );
-        }
+                result[i] = align_pair(
+                        one.size() > two.size() ? one : two
+                    ,   one.size() > two.size() ? two : one
+                    ,   table
+                    );
+            }
+        });
 
         return result;
     }
@@ -114,13 +98,32 @@ namespace
             size_t nsequences = ctx.db.count();
 
             onlyslaves {
-                auto pairs = this->generate(nsequences);
+                auto pairs = this->generate(ctx);
                 result = align(pairs, ctx.db, ctx.table);
             }
 
             return distance_matrix {this->gather(result), nsequences};
         }
     };
+
+    /**
+     * The sequential needleman algorithm object with dynamic pairs scheduling.
+     * Instead of a fixed slice, pairs are handed out to slaves on demand.
+     * @since 0.1.1
+     */
+    struct sequential_dynamic : public needleman::algorithm
+    {
+        /**
+         * Executes the sequential needleman algorithm for the pairwise step, with
+         * the workload being dynamically distributed among cluster nodes.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            return this->schedule(ctx, align);
+        }
+    };
 }
 
 namespace museqa
@@ -133,4 +136,13 @@ namespace museqa
     {
         return new ::sequential;
     }
+
+    /**
+     * Instantiates a new dynamically scheduled sequential needleman instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::needleman::sequential_dynamic() -> pairwise::algorithm *
+    {
+        return new ::sequential_dynamic;
+    }
 }
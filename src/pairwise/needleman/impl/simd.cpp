@@ -0,0 +1,533 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Vectorized implementation for the pairwise module's needleman algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "parallel.hpp"
+#include "sequence.hpp"
+#include "environment.h"
+
+#include "pairwise/pairwise.cuh"
+#include "pairwise/needleman/needleman.cuh"
+
+/*
+ * When compiling with GCC for x86-64 targets, the vectorized kernel is cloned
+ * for each of the most common instruction sets. The best clone available in the
+ * current host will then be picked at runtime, with no need for specific flags.
+ * The kernel's body must then be inlined into each one of the clones.
+ */
+#if defined(__museqa_compiler_gcc) && defined(__x86_64__)
+  #define __museqa_simd_clones __attribute__((target_clones("avx512f", "avx2", "default")))
+  #define __museqa_simd_inline inline __attribute__((always_inline))
+#else
+  #define __museqa_simd_clones
+  #define __museqa_simd_inline inline
+#endif
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    using needleman::gap::linear;
+    using needleman::gap::affine;
+
+    /*
+     * Algorithm configuration parameters. The vector width indicates the number
+     * of bytes processed by each vector operation, thus the number of pairs aligned
+     * in lockstep depends on the cell type. A 64-byte vector fills up an AVX-512
+     * register, two AVX2 registers or four SSE registers.
+     */
+    enum : size_t { width = 64 };
+    enum : size_t { alphabet = 25 };
+
+    /**
+     * Describes a vector of alignment cells, one for each pair being aligned in
+     * lockstep. Narrower cell types allow more pairs to be aligned at once.
+     * @tparam T The type of each of the vector's cells.
+     * @since 0.1.1
+     */
+    template <typename T>
+    struct cell
+    {
+        enum : size_t { lanes = width / sizeof(T) };
+        typedef T vector __attribute__((vector_size(sizeof(T) * lanes)));
+    };
+
+    /*
+     * The maximum number of pairs which may be aligned in lockstep. This is the
+     * number of lanes of the narrowest cell type available.
+     */
+    enum : size_t { max_lanes = cell<int16_t>::lanes };
+
+    /**
+     * A sequence fully decoded to its units, without any padding.
+     * @since 0.1.1
+     */
+    using decoded = std::vector<encoder::unit>;
+
+    /**
+     * Decodes a sequence into its units, so they can be accessed directly within
+     * the alignment's inner loop, without the encoding's division and shifting.
+     * @param seq The sequence to be decoded.
+     * @return The decoded sequence units.
+     */
+    static auto decode(const sequence& seq) -> decoded
+    {
+        decoded result (seq.length());
+        seq.unpack(result.data());
+
+        result.erase(std::remove(result.begin(), result.end(), sequence::padding), result.end());
+        return result;
+    }
+
+    /**
+     * Checks whether the scoring table can be exactly represented with integers.
+     * If not, the alignment must always be performed with floating-point cells.
+     * @param table The scoring table to be checked.
+     * @return Can the table be used with integral cells?
+     */
+    static bool integral(const scoring_table& table)
+    {
+        if(score(int16_t(table.penalty())) != table.penalty())
+            return false;
+
+        if(score(int16_t(table.extend())) != table.extend())
+            return false;
+
+        for(size_t i = 0; i < alphabet; ++i)
+            for(size_t j = 0; j < alphabet; ++j) {
+                const score value = table[{encoder::unit(i), encoder::unit(j)}];
+                if(score(int16_t(value)) != value) return false;
+            }
+
+        return true;
+    }
+
+    /**
+     * Calculates the largest change in score between two neighbouring cells of
+     * the alignment matrix. Any cell is at most this far from its neighbours.
+     * @param table The scoring table used to compare the sequences.
+     * @return The maximum score step.
+     */
+    static auto max_step(const scoring_table& table) -> score
+    {
+        score result = utils::max(table.penalty(), -table.penalty());
+        result = utils::max(result, utils::max(table.extend(), -table.extend()));
+
+        for(size_t i = 0; i < alphabet; ++i)
+            for(size_t j = 0; j < alphabet; ++j) {
+                const score value = table[{encoder::unit(i), encoder::unit(j)}];
+                result = utils::max(result, utils::max(value, -value));
+            }
+
+        return result;
+    }
+
+    /**
+     * Checks whether the alignment of a pair of sequences is guaranteed to fit
+     * within the given cell type. As any cell is at most a step away from each
+     * of its neighbours, a cell's magnitude is bounded by the number of steps
+     * needed to reach it from the matrix's origin.
+     * @tparam T The alignment matrix cells' type.
+     * @param one The first sequence's length.
+     * @param two The second sequence's length.
+     * @param step The maximum score step between neighbouring cells.
+     * @return Is the alignment guaranteed not to overflow?
+     */
+    template <typename T>
+    inline bool fits(size_t one, size_t two, score step)
+    {
+        return !std::is_integral<T>::value
+            || double(one + two + 1) * step < double(std::numeric_limits<T>::max());
+    }
+
+    /**
+     * Aligns a query sequence against up to a lane-width number of sequences in
+     * lockstep, using the Needleman-Wunsch algorithm. Each vector lane holds the
+     * alignment of a different pair. For every column sequences' position, a profile
+     * with the scores of every possible query unit is built from the scoring table,
+     * thus the inner loop needs a single vector load per cell.
+     * @tparam T The alignment matrix cells' type.
+     * @param query The sequence shared by all pairs.
+     * @param target The list of sequences to align the query against.
+     * @param count The number of target sequences.
+     * @param table The scoring table used to compare the sequences.
+     * @param result The alignment scores output.
+     */
+    template <typename T>
+    __museqa_simd_inline void align_lanes(
+            linear
+        ,   const decoded& query
+        ,   const decoded *target[]
+        ,   size_t count
+        ,   const scoring_table& table
+        ,   score *result
+        )
+    {
+        using lane = typename cell<T>::vector;
+        enum : size_t { lanes = cell<T>::lanes };
+
+        const size_t length = query.size();
+        const T penalty = static_cast<T>(table.penalty());
+
+        size_t longest = 0;
+        lane profile[alphabet], done, value;
+
+        // The line buffer is not guaranteed to be aligned to the vector's width,
+        // thus all loads and stores to it must be done via memory copies, which
+        // are then turned into unaligned vector loads and stores by the compiler.
+        std::vector<T> storage ((length + 1) * lanes);
+        T *line = storage.data();
+
+        for(size_t l = 0; l < count; ++l)
+            longest = utils::max(longest, target[l]->size());
+
+        // Filling 0-th line with penalties. As all pairs share the query sequence,
+        // the 0-th line is the same for all lanes.
+        for(size_t j = 0; j <= length; ++j)
+            for(size_t l = 0; l < lanes; ++l)
+                line[j * lanes + l] = static_cast<T>(score(j) * -table.penalty());
+
+        for(size_t l = 0; l < count; ++l)
+            result[l] = line[length * lanes + l];
+
+        for(size_t i = 0; i < longest; ++i) {
+            // Builds the profile for the current line. Lanes whose sequences have
+            // already ended are filled with zeroes, and their results are ignored.
+            for(size_t c = 0; c < alphabet; ++c)
+                for(size_t l = 0; l < lanes; ++l)
+                    profile[c][l] = (l < count && i < target[l]->size())
+                        ? static_cast<T>(table[{(*target[l])[i], encoder::unit(c)}])
+                        : T {0};
+
+            lane insertd = lane {} - static_cast<T>(score(i + 1) * table.penalty());
+
+            std::memcpy(&done, line, sizeof(lane));
+            std::memcpy(line, &insertd, sizeof(lane));
+
+            for(size_t j = 1; j <= length; ++j) {
+                lane removed;
+                std::memcpy(&removed, line + j * lanes, sizeof(lane));
+
+                const lane matched = done + profile[query[j - 1]];
+                done = removed;
+
+                insertd = insertd - penalty;
+                removed = removed - penalty;
+
+                value = matched > insertd ? matched : insertd;
+                value = value > removed ? value : removed;
+
+                std::memcpy(line + j * lanes, &value, sizeof(lane));
+                insertd = value;
+            }
+
+            for(size_t l = 0; l < count; ++l)
+                if(i + 1 == target[l]->size())
+                    result[l] = line[length * lanes + l];
+        }
+    }
+
+    /**
+     * Aligns a query sequence against up to a lane-width number of sequences in
+     * lockstep, with affine gaps. Besides the score line, the line of best scores
+     * ending in a gap on the query is also kept, and the best score ending in a
+     * gap on the lanes' sequences is carried along the line. Cells which cannot
+     * end in a gap start at half of the cell type's lowest value, so the pairs
+     * aligned with integral cells must leave room for it.
+     * @tparam T The alignment matrix cells' type.
+     * @param query The sequence shared by all pairs.
+     * @param target The list of sequences to align the query against.
+     * @param count The number of target sequences.
+     * @param table The scoring table used to compare the sequences.
+     * @param result The alignment scores output.
+     */
+    template <typename T>
+    __museqa_simd_inline void align_lanes(
+            affine
+        ,   const decoded& query
+        ,   const decoded *target[]
+        ,   size_t count
+        ,   const scoring_table& table
+        ,   score *result
+        )
+    {
+        using lane = typename cell<T>::vector;
+        enum : size_t { lanes = cell<T>::lanes };
+
+        const size_t length = query.size();
+        const T open = static_cast<T>(table.penalty());
+        const T extend = static_cast<T>(table.extend());
+        const T unreachable = std::numeric_limits<T>::lowest() / 2;
+
+        size_t longest = 0;
+        lane profile[alphabet], done, value;
+
+        std::vector<T> storage ((length + 1) * lanes);
+        std::vector<T> gaps ((length + 1) * lanes, unreachable);
+        T *line = storage.data();
+        T *removed = gaps.data();
+
+        for(size_t l = 0; l < count; ++l)
+            longest = utils::max(longest, target[l]->size());
+
+        // Filling 0-th line with the penalties of a single gap growing along it.
+        // No cell of the 0-th line can end in a gap on the query sequence.
+        for(size_t j = 0; j <= length; ++j)
+            for(size_t l = 0; l < lanes; ++l)
+                line[j * lanes + l] = j ? static_cast<T>(-table.penalty() - score(j - 1) * table.extend()) : T {0};
+
+        for(size_t l = 0; l < count; ++l)
+            result[l] = line[length * lanes + l];
+
+        for(size_t i = 0; i < longest; ++i) {
+            for(size_t c = 0; c < alphabet; ++c)
+                for(size_t l = 0; l < lanes; ++l)
+                    profile[c][l] = (l < count && i < target[l]->size())
+                        ? static_cast<T>(table[{(*target[l])[i], encoder::unit(c)}])
+                        : T {0};
+
+            lane left = lane {} + static_cast<T>(-table.penalty() - score(i) * table.extend());
+            lane insertd = lane {} + unreachable;
+
+            std::memcpy(&done, line, sizeof(lane));
+            std::memcpy(line, &left, sizeof(lane));
+
+            for(size_t j = 1; j <= length; ++j) {
+                lane above, gap;
+                std::memcpy(&above, line + j * lanes, sizeof(lane));
+                std::memcpy(&gap, removed + j * lanes, sizeof(lane));
+
+                const lane matched = done + profile[query[j - 1]];
+                done = above;
+
+                const lane opened = left - open;
+                const lane closed = above - open;
+
+                insertd = insertd - extend;
+                gap = gap - extend;
+
+                insertd = opened > insertd ? opened : insertd;
+                gap = closed > gap ? closed : gap;
+
+                value = matched > insertd ? matched : insertd;
+                value = value > gap ? value : gap;
+
+                std::memcpy(line + j * lanes, &value, sizeof(lane));
+                std::memcpy(removed + j * lanes, &gap, sizeof(lane));
+                left = value;
+            }
+
+            for(size_t l = 0; l < count; ++l)
+                if(i + 1 == target[l]->size())
+                    result[l] = line[length * lanes + l];
+        }
+    }
+
+    /*
+     * Instantiates the lockstep alignment for each of the available cell types.
+     * As templates cannot be reliably cloned, each instantiation is wrapped by a
+     * concrete function overload, so it can be compiled for every instruction set.
+     */
+    #define __museqa_simd_lockstep(T, G)                                            \
+        __museqa_simd_clones static void lockstep(                                  \
+                T, G, const decoded& query, const decoded *target[], size_t count   \
+            ,   const scoring_table& table, score *result                           \
+            )                                                                       \
+        {                                                                           \
+            align_lanes<T>(G {}, query, target, count, table, result);              \
+        }
+
+    __museqa_simd_lockstep(int16_t, linear)
+    __museqa_simd_lockstep(int32_t, linear)
+    __museqa_simd_lockstep(score, linear)
+    __museqa_simd_lockstep(int16_t, affine)
+    __museqa_simd_lockstep(int32_t, affine)
+    __museqa_simd_lockstep(score, affine)
+
+    #undef __museqa_simd_lockstep
+
+    /**
+     * Aligns a query sequence against a group of sequences with the given cell
+     * type. The caller must guarantee none of the pairs may overflow the type.
+     * @tparam G The gap model's type.
+     * @tparam T The alignment matrix cells' type.
+     * @param query The sequence shared by all pairs.
+     * @param target The list of sequences to align the query against.
+     * @param count The number of target sequences.
+     * @param table The scoring table used to compare the sequences.
+     * @param result The alignment scores output.
+     */
+    template <typename G, typename T>
+    static void align_group(
+            const decoded& query
+        ,   const decoded *target[]
+        ,   size_t count
+        ,   const scoring_table& table
+        ,   score *result
+        )
+    {
+        for(size_t offset = 0; offset < count; offset += cell<T>::lanes) {
+            const size_t n = utils::min<size_t>(count - offset, cell<T>::lanes);
+            lockstep(T {}, G {}, query, target + offset, n, table, result + offset);
+        }
+    }
+
+    /**
+     * Aligns a query sequence against a group of sequences, using the narrowest
+     * cell type in which each pair is guaranteed not to overflow. The pairs which
+     * might overflow are then aligned using the next wider cell type. With affine
+     * gaps, half of the cell type's range is kept for unreachable gap states.
+     * @tparam G The gap model's type.
+     * @tparam T The narrowest cell type to try.
+     * @tparam U The next wider cell types.
+     * @param query The sequence shared by all pairs.
+     * @param target The list of sequences to align the query against.
+     * @param count The number of target sequences.
+     * @param table The scoring table used to compare the sequences.
+     * @param result The alignment scores output.
+     */
+    template <typename G, typename T, typename U, typename ...R>
+    static void align_group(
+            const decoded& query
+        ,   const decoded *target[]
+        ,   size_t count
+        ,   const scoring_table& table
+        ,   score *result
+        )
+    {
+        const decoded *narrow[max_lanes], *wide[max_lanes];
+        score narrow_result[max_lanes], wide_result[max_lanes];
+        size_t narrow_count = 0, wide_count = 0;
+
+        const score step = max_step(table) * (std::is_same<G, affine>::value ? 2 : 1);
+
+        // Overflowing pairs are expected to be rare, as they only happen when
+        // aligning very long sequences. Thus, pairs are split between the cell
+        // types, so most of them can still benefit from the narrowest one.
+        for(size_t l = 0; l < count; ++l)
+            if(fits<T>(query.size(), target[l]->size(), step))
+                narrow[narrow_count++] = target[l];
+            else
+                wide[wide_count++] = target[l];
+
+        align_group<G, T>(query, narrow, narrow_count, table, narrow_result);
+        align_group<G, U, R...>(query, wide, wide_count, table, wide_result);
+
+        for(size_t l = 0, i = 0, j = 0; l < count; ++l)
+            result[l] = fits<T>(query.size(), target[l]->size(), step)
+                ? narrow_result[i++]
+                : wide_result[j++];
+    }
+
+    /**
+     * Executes the vectorized Needleman-Wunsch algorithm for the pairwise step.
+     * Consecutive pairs sharing their first sequence are aligned in lockstep, and
+     * the pairs are split among the node's host threads, if more than one.
+     * @param pairs The workpairs to align in the current node.
+     * @param db The sequences available for alignment.
+     * @param table The scoring table to use.
+     * @return The score of aligned pairs.
+     */
+    static auto align(const buffer<pair>& pairs, const database& db, const scoring_table& table)
+    -> buffer<score>
+    {
+        const size_t count = pairs.size();
+        auto result = buffer<score>::make(count);
+
+        std::vector<decoded> cache (db.count());
+        std::vector<bool> used (db.count(), false);
+
+        // If the scoring table only has integral scores, the narrowest cell type
+        // may be used, halving the memory traffic and doubling the number of lanes.
+        // Otherwise, the alignment can only be performed with floating-point cells.
+        // The gap model is picked once, so the kernels are specialized for it.
+        const auto group = table.affine()
+            ? (integral(table) ? align_group<affine, int16_t, int32_t, score> : align_group<affine, score>)
+            : (integral(table) ? align_group<linear, int16_t, int32_t, score> : align_group<linear, score>);
+
+        // Each sequence is decoded only once, before any alignment, as sequences
+        // are used by many pairs on the current node.
+        for(size_t i = 0; i < count; ++i)
+            used[pairs[i].first] = used[pairs[i].second] = true;
+
+        parallel::foreach(db.count(), [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i)
+                if(used[i]) cache[i] = decode(db[i].contents);
+        });
+
+        parallel::foreach(count, [&](const range<size_t>& partition, size_t) {
+            const size_t last = partition.offset + partition.total;
+
+            for(size_t i = partition.offset; i < last; ) {
+                const decoded *target[max_lanes];
+                const decoded& query = cache[pairs[i].first];
+
+                size_t n = 0;
+
+                while(n < max_lanes && i + n < last && pairs[i + n].first == pairs[i].first) {
+                    target[n] = &cache[pairs[i + n].second];
+                    ++n;
+                }
+
+                group(query, target, n, table, result.raw() + i);
+                i += n;
+            }
+        });
+
+        return result;
+    }
+
+    /**
+     * The vectorized needleman algorithm object. This algorithm uses no GPU, but
+     * aligns many pairs at once using the host's vector instructions.
+     * @since 0.1.1
+     */
+    struct simd : public needleman::algorithm
+    {
+        /**
+         * Executes the vectorized needleman algorithm for the pairwise step. This method is
+         * responsible for distributing and gathering workload from different cluster nodes.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> distance_matrix override
+        {
+            buffer<score> result;
+            size_t nsequences = ctx.db.count();
+
+            onlyslaves {
+                auto pairs = this->generate(ctx);
+                result = align(pairs, ctx.db, ctx.table);
+            }
+
+            return distance_matrix {this->gather(result), nsequences};
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Instantiates a new vectorized needleman instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pairwise::needleman::simd() -> pairwise::algorithm *
+    {
+        return new ::simd;
+    }
+}
@@ -0,0 +1,326 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the needleman algorithm's host kernel output policies.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+
+#include "pairwise/pairwise.cuh"
+#include "pairwise/needleman/kernel.hpp"
+#include "pairwise/needleman/needleman.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    using needleman::policy::operation;
+
+    /*
+     * The most cells whose traceback may be kept in memory, when aligning with
+     * affine gaps. Each cell's traceback takes up a single byte.
+     */
+    enum : size_t { max_cells = 1 << 24 };
+
+    /*
+     * The bits of a cell's traceback. The cell's origin is kept on the lowest bits,
+     * followed by whether each of the gap states has been extended or opened.
+     */
+    enum : uint8_t { extended_deletion = 0x04, extended_insertion = 0x08 };
+
+    /**
+     * Keeps the state of a linear-space traceback. Both sequences are also kept
+     * reversed, so the kernel may fill the matrix from the sequences' ends, when
+     * looking for the checkpoint at which an optimal alignment crosses a line.
+     * @since 0.1.1
+     */
+    struct hirschberg
+    {
+        const encoder::unit *one;                   /// The first sequence's units.
+        const encoder::unit *two;                   /// The second sequence's units.
+        const size_t n, m;                          /// The sequences' lengths.
+        const scoring_table& table;                 /// The scoring table being used.
+        std::vector<encoder::unit> reversed[2];     /// The sequences' reversed units.
+        std::vector<score> forward;                 /// The forward checkpoint line.
+        std::vector<score> reverse;                 /// The reverse checkpoint line.
+        std::vector<operation> script;              /// The alignment's edition script.
+
+        /**
+         * Aligns a single unit of the first sequence to a segment of the second.
+         * The unit is either matched to the segment's best unit, or to a gap if
+         * that is not worth the gap it spares.
+         * @param i The first sequence's unit.
+         * @param b0 The segment's beginning on the second sequence.
+         * @param b1 The segment's end on the second sequence.
+         */
+        void single(size_t i, size_t b0, size_t b1)
+        {
+            score best = -2 * table.penalty();
+            size_t chosen = b1;
+
+            for(size_t j = b0; j < b1; ++j)
+                if(table[{one[i], two[j]}] > best) {
+                    best = table[{one[i], two[j]}];
+                    chosen = j;
+                }
+
+            if(chosen == b1)
+                script.push_back(operation::deletion);
+
+            for(size_t j = b0; j < b1; ++j)
+                script.push_back(j == chosen ? operation::match : operation::insertion);
+        }
+
+        /**
+         * Aligns a segment of each sequence. The first segment is split in half,
+         * and the column at which an optimal alignment crosses the split is found
+         * by joining the halves' checkpoint lines, filled from opposite ends.
+         * @param a0 The first segment's beginning.
+         * @param a1 The first segment's end.
+         * @param b0 The second segment's beginning.
+         * @param b1 The second segment's end.
+         */
+        void divide(size_t a0, size_t a1, size_t b0, size_t b1)
+        {
+            if(a0 == a1 || b0 == b1) {
+                script.insert(script.end(), a1 - a0, operation::deletion);
+                script.insert(script.end(), b1 - b0, operation::insertion);
+                return;
+            }
+
+            if(a1 - a0 == 1)
+                return single(a0, b0, b1);
+
+            const size_t middle = (a0 + a1) / 2;
+            const size_t width = b1 - b0;
+            needleman::policy::score_only observer;
+            size_t split = 0;
+
+            needleman::fill(one + a0, middle - a0, two + b0, width, table, forward.data(), observer);
+            needleman::fill(
+                    reversed[0].data() + (n - a1), a1 - middle
+                ,   reversed[1].data() + (m - b1), width
+                ,   table, reverse.data(), observer
+                );
+
+            for(size_t j = 1; j <= width; ++j)
+                if(forward[j] + reverse[width - j] > forward[split] + reverse[width - split])
+                    split = j;
+
+            divide(a0, middle, b0, b0 + split);
+            divide(middle, a1, b0 + split, b1);
+        }
+    };
+
+    /**
+     * Aligns two sequences with affine gaps, keeping the whole matrix's traceback.
+     * For each cell, the origin of its best score and whether its gap states have
+     * been extended or opened are kept, so the edition script can be walked back
+     * from the matrix's last cell while switching between the three states.
+     * @param one The first sequence's units.
+     * @param n The first sequence's length.
+     * @param two The second sequence's units.
+     * @param m The second sequence's length.
+     * @param table The scoring table used to compare both sequences.
+     * @return The alignment's edition script.
+     */
+    static auto gotoh(
+            const encoder::unit *one, size_t n
+        ,   const encoder::unit *two, size_t m
+        ,   const scoring_table& table
+        ) -> std::vector<operation>
+    {
+        const score open = table.penalty();
+        const score extend = table.extend();
+        const score unreachable = -std::numeric_limits<score>::max() / 4;
+
+        std::vector<uint8_t> trace ((n + 1) * (m + 1));
+        std::vector<score> line (m + 1), removed (m + 1, unreachable);
+        std::vector<operation> script;
+
+        for(size_t j = 1; j <= m; ++j) {
+            line[j] = -open - (j - 1) * extend;
+            trace[j] = operation::insertion | (j > 1 ? extended_insertion : 0);
+        }
+
+        for(size_t i = 1; i <= n; ++i) {
+            uint8_t *cell = &trace[i * (m + 1)];
+            score done = line[0], insertd = unreachable;
+
+            line[0] = -open - (i - 1) * extend;
+            cell[0] = operation::deletion | (i > 1 ? extended_deletion : 0);
+
+            for(size_t j = 1; j <= m; ++j) {
+                const auto matched = done + table[{one[i - 1], two[j - 1]}];
+                uint8_t origin = operation::match;
+
+                const bool insertion = insertd - extend > line[j - 1] - open;
+                const bool deletion = removed[j] - extend > line[j] - open;
+
+                insertd = insertion ? insertd - extend : line[j - 1] - open;
+                removed[j] = deletion ? removed[j] - extend : line[j] - open;
+                done = line[j];
+
+                line[j] = matched;
+
+                if(removed[j] > line[j]) { line[j] = removed[j]; origin = operation::deletion; }
+                if(insertd > line[j]) { line[j] = insertd; origin = operation::insertion; }
+
+                cell[j] = origin | (insertion ? extended_insertion : 0) | (deletion ? extended_deletion : 0);
+            }
+        }
+
+        // The script is walked back from the matrix's last cell. A gap state is
+        // left as soon as the cell its gap has been opened at is reached.
+        uint8_t state = operation::match;
+
+        for(size_t i = n, j = m; i > 0 || j > 0; ) {
+            const uint8_t cell = trace[i * (m + 1) + j];
+
+            if(state == operation::match)
+                state = cell & 0x03;
+
+            script.push_back(operation(state));
+
+            if(state == operation::match) {
+                --i; --j;
+            } else if(state == operation::deletion) {
+                state = (cell & extended_deletion) ? state : operation::match; --i;
+            } else {
+                state = (cell & extended_insertion) ? state : operation::match; --j;
+            }
+        }
+
+        std::reverse(script.begin(), script.end());
+        return script;
+    }
+}
+
+namespace museqa
+{
+    /**
+     * Aligns two sequences, producing only their alignment's score.
+     * @param one The first sequence's units.
+     * @param n The first sequence's length.
+     * @param two The second sequence's units.
+     * @param m The second sequence's length.
+     * @param table The scoring table used to compare both sequences.
+     * @return The alignment's score.
+     */
+    auto pairwise::needleman::policy::score_only::run(
+            const encoder::unit *one, size_t n
+        ,   const encoder::unit *two, size_t m
+        ,   const scoring_table& table
+        ) -> result_type
+    {
+        thread_local std::vector<score> line;
+        score_only observer;
+
+        if(!table.affine()) {
+            line.resize(m + 1);
+            fill(one, n, two, m, table, line.data(), observer);
+        } else {
+            line.resize(2 * (m + 1));
+            fill<gap::affine>(one, n, two, m, table, line.data(), observer);
+        }
+
+        return line[m];
+    }
+
+    /**
+     * Aligns two sequences, producing their alignment's score and end coordinates.
+     * The last column's cells are seen along the way, and the last line's at once.
+     * @param one The first sequence's units.
+     * @param n The first sequence's length.
+     * @param two The second sequence's units.
+     * @param m The second sequence's length.
+     * @param table The scoring table used to compare both sequences.
+     * @return The alignment's score and end coordinates.
+     */
+    auto pairwise::needleman::policy::score_end::run(
+            const encoder::unit *one, size_t n
+        ,   const encoder::unit *two, size_t m
+        ,   const scoring_table& table
+        ) -> result_type
+    {
+        thread_local std::vector<score> line;
+        score_end observer;
+
+        if(!table.affine()) {
+            line.resize(m + 1);
+            fill(one, n, two, m, table, line.data(), observer);
+        } else {
+            line.resize(2 * (m + 1));
+            fill<gap::affine>(one, n, two, m, table, line.data(), observer);
+        }
+
+        for(size_t j = 0; j < m; ++j)
+            if(line[j] > observer.result.best)
+                observer.result = {0, line[j], n, j};
+
+        observer.result.value = line[m];
+        return observer.result;
+    }
+
+    /**
+     * Aligns two sequences, producing their alignment's edition script.
+     * @param one The first sequence's units.
+     * @param n The first sequence's length.
+     * @param two The second sequence's units.
+     * @param m The second sequence's length.
+     * @param table The scoring table used to compare both sequences.
+     * @return The alignment's score and edition script.
+     */
+    auto pairwise::needleman::policy::traceback::run(
+            const encoder::unit *one, size_t n
+        ,   const encoder::unit *two, size_t m
+        ,   const scoring_table& table
+        ) -> result_type
+    {
+        result_type result {0, {}};
+
+        if(table.affine() && (n + 1) * (m + 1) <= max_cells) {
+            result.script = gotoh(one, n, two, m, table);
+        } else {
+            hirschberg state {one, two, n, m, table};
+
+            state.reversed[0].assign(one, one + n);
+            state.reversed[1].assign(two, two + m);
+            std::reverse(state.reversed[0].begin(), state.reversed[0].end());
+            std::reverse(state.reversed[1].begin(), state.reversed[1].end());
+
+            state.forward.resize(m + 1);
+            state.reverse.resize(m + 1);
+            state.script.reserve(n + m);
+            state.divide(0, n, 0, m);
+
+            result.script = std::move(state.script);
+        }
+
+        // The script's score is calculated from its operations. A gap is opened
+        // whenever its operation differs from the previous one's.
+        for(size_t i = 0, j = 0, k = 0; k < result.script.size(); ++k) {
+            if(result.script[k] == operation::match) {
+                result.value += table[{one[i++], two[j++]}];
+            } else {
+                const bool extended = k > 0 && result.script[k - 1] == result.script[k];
+                result.value -= extended ? table.extend() : table.penalty();
+                result.script[k] == operation::deletion ? ++i : ++j;
+            }
+        }
+
+        // A linear script may not be optimal when gaps are affine, so the score
+        // given by the alignment's matrix is preferred instead.
+        if(table.affine() && (n + 1) * (m + 1) > max_cells)
+            result.value = score_only::run(one, n, two, m, table);
+
+        return result;
+    }
+}
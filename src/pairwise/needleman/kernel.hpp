@@ -0,0 +1,282 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the needleman algorithm's host kernel and its output policies.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+
+#include "pairwise/pairwise.cuh"
+#include "pairwise/needleman/needleman.cuh"
+
+namespace museqa
+{
+    namespace pairwise
+    {
+        namespace needleman
+        {
+            /**
+             * Fills the Needleman-Wunsch matrix between two sequences, one line at
+             * a time, keeping only the current line in memory. The policy is shown
+             * every line as soon as it is done, so it decides what must be kept
+             * from the matrix, and thus how much the alignment costs.
+             * @tparam P The output policy's type.
+             * @param one The first sequence's units, along the lines.
+             * @param n The first sequence's length.
+             * @param two The second sequence's units, along the columns.
+             * @param m The second sequence's length.
+             * @param table The scoring table used to compare both sequences.
+             * @param line The score line, with room for the second sequence's units.
+             * @param policy The output policy observing the matrix's lines.
+             */
+            template <typename P>
+            inline void fill(
+                    gap::linear
+                ,   const encoder::unit *one, size_t n
+                ,   const encoder::unit *two, size_t m
+                ,   const scoring_table& table
+                ,   score *line
+                ,   P& policy
+                )
+            {
+                const score penalty = table.penalty();
+
+                for(size_t j = 0; j <= m; ++j)
+                    line[j] = j * -penalty;
+
+                policy.line(0, line, m);
+
+                for(size_t i = 0; i < n; ++i) {
+                    const score *row = table.row(one[i]);
+
+                    score done = line[0];
+                    line[0] = (i + 1) * -penalty;
+
+                    for(size_t j = 1; j <= m; ++j) {
+                        const auto insertd = line[j - 1] - penalty;
+                        const auto removed = line[j] - penalty;
+                        const auto matched = done + row[two[j - 1]];
+
+                        done = line[j];
+                        line[j] = utils::max(matched, utils::max(insertd, removed));
+                    }
+
+                    policy.line(i + 1, line, m);
+                }
+            }
+
+            /**
+             * Fills the Needleman-Wunsch matrix between two sequences with affine
+             * gaps, as by Gotoh. Right after the score line, the kernel keeps the
+             * line of best scores ending in a gap on the second sequence, while the
+             * best score ending in a gap on the first one is carried along the line.
+             * The policy is only shown the score line, just as with linear gaps.
+             * @tparam P The output policy's type.
+             * @param one The first sequence's units, along the lines.
+             * @param n The first sequence's length.
+             * @param two The second sequence's units, along the columns.
+             * @param m The second sequence's length.
+             * @param table The scoring table used to compare both sequences.
+             * @param line The score and gap lines, with room for twice the second sequence's units.
+             * @param policy The output policy observing the matrix's lines.
+             */
+            template <typename P>
+            inline void fill(
+                    gap::affine
+                ,   const encoder::unit *one, size_t n
+                ,   const encoder::unit *two, size_t m
+                ,   const scoring_table& table
+                ,   score *line
+                ,   P& policy
+                )
+            {
+                const score open = table.penalty();
+                const score extend = table.extend();
+                const score unreachable = -std::numeric_limits<score>::max() / 4;
+
+                score *removed = line + (m + 1);
+
+                line[0] = 0;
+                removed[0] = unreachable;
+
+                for(size_t j = 1; j <= m; ++j) {
+                    line[j] = -open - (j - 1) * extend;
+                    removed[j] = unreachable;
+                }
+
+                policy.line(0, line, m);
+
+                for(size_t i = 0; i < n; ++i) {
+                    const score *row = table.row(one[i]);
+
+                    score done = line[0];
+                    score insertd = unreachable;
+                    line[0] = -open - i * extend;
+
+                    for(size_t j = 1; j <= m; ++j) {
+                        insertd = utils::max(line[j - 1] - open, insertd - extend);
+                        removed[j] = utils::max(line[j] - open, removed[j] - extend);
+
+                        const auto matched = done + row[two[j - 1]];
+
+                        done = line[j];
+                        line[j] = utils::max(matched, utils::max(insertd, removed[j]));
+                    }
+
+                    policy.line(i + 1, line, m);
+                }
+            }
+
+            /**
+             * Fills the Needleman-Wunsch matrix between two sequences, with the kernel
+             * specialized for the given gap model.
+             * @tparam G The gap model's type.
+             * @tparam P The output policy's type.
+             * @param one The first sequence's units, along the lines.
+             * @param n The first sequence's length.
+             * @param two The second sequence's units, along the columns.
+             * @param m The second sequence's length.
+             * @param table The scoring table used to compare both sequences.
+             * @param line The kernel's lines, with room for as many as the model needs.
+             * @param policy The output policy observing the matrix's lines.
+             */
+            template <typename G = gap::linear, typename P>
+            inline void fill(
+                    const encoder::unit *one, size_t n
+                ,   const encoder::unit *two, size_t m
+                ,   const scoring_table& table
+                ,   score *line
+                ,   P& policy
+                )
+            {
+                fill(G {}, one, n, two, m, table, line, policy);
+            }
+
+            namespace policy
+            {
+                /**
+                 * The edition operations produced by a traceback. As the first
+                 * sequence is laid along the lines, a gap inserted into the second
+                 * sequence is called a deletion, and an insertion otherwise.
+                 * @since 0.1.1
+                 */
+                enum operation : uint8_t { match = 0, deletion = 1, insertion = 2 };
+
+                /**
+                 * Only the alignment's score is produced. Nothing but the kernel's
+                 * own score line is ever kept, so this is the cheapest policy.
+                 * @since 0.1.1
+                 */
+                struct score_only
+                {
+                    using result_type = score;
+
+                    inline void line(size_t, const score *, size_t) noexcept {}
+
+                    static auto run(const encoder::unit *, size_t, const encoder::unit *, size_t, const scoring_table&)
+                        -> result_type;
+                };
+
+                /**
+                 * The alignment's score is produced together with its end coordinates,
+                 * that is, the best cell on the matrix's last line or column. That is
+                 * where the alignment ends if the gaps trailing either of the sequences
+                 * come for free, as between overlapping reads or seeded segments.
+                 * @since 0.1.1
+                 */
+                struct score_end
+                {
+                    /**
+                     * The result of an alignment with its end coordinates. The global
+                     * alignment's end always competes, and is preferred on ties.
+                     * @since 0.1.1
+                     */
+                    struct result_type
+                    {
+                        score value;                    /// The global alignment's score.
+                        score best;                     /// The score at the alignment's end.
+                        size_t one;                     /// The end's line on the first sequence.
+                        size_t two;                     /// The end's column on the second sequence.
+                    };
+
+                    result_type result {0, 0, 0, 0};
+
+                    /**
+                     * Keeps the line's last cell, if it's the best seen so far.
+                     * @param i The line's index.
+                     * @param line The line's score cells.
+                     * @param m The line's last column.
+                     */
+                    inline void line(size_t i, const score *line, size_t m) noexcept
+                    {
+                        if(i == 0 || line[m] >= result.best) {
+                            result.best = line[m];
+                            result.one = i;
+                            result.two = m;
+                        }
+                    }
+
+                    static auto run(const encoder::unit *, size_t, const encoder::unit *, size_t, const scoring_table&)
+                        -> result_type;
+                };
+
+                /**
+                 * The alignment is produced as a whole, by the edition script which
+                 * turns the first sequence into the second. The matrix is never kept:
+                 * Hirschberg's algorithm recursively checkpoints the matrix's middle
+                 * line, from both sequences' ends, so memory grows only linearly.
+                 * With affine gaps, the matrix's traceback is kept instead, as long
+                 * as it is small enough. Otherwise, the script is checkpointed as if
+                 * gaps were linear, while its score is still found with affine gaps.
+                 * @since 0.1.1
+                 */
+                struct traceback
+                {
+                    /**
+                     * The result of an alignment with its traceback.
+                     * @since 0.1.1
+                     */
+                    struct result_type
+                    {
+                        score value;                    /// The alignment's score.
+                        std::vector<operation> script;  /// The alignment's edition script.
+                    };
+
+                    inline void line(size_t, const score *, size_t) noexcept {}
+
+                    static auto run(const encoder::unit *, size_t, const encoder::unit *, size_t, const scoring_table&)
+                        -> result_type;
+                };
+            }
+
+            /**
+             * Aligns two sequences, producing whatever the output policy requires.
+             * Each call site picks the policy it needs, and thus pays only for it.
+             * @tparam P The output policy's type.
+             * @param one The first sequence's units.
+             * @param n The first sequence's length.
+             * @param two The second sequence's units.
+             * @param m The second sequence's length.
+             * @param table The scoring table used to compare both sequences.
+             * @return The alignment's result, as given by the policy.
+             */
+            template <typename P>
+            inline auto align(
+                    const encoder::unit *one, size_t n
+                ,   const encoder::unit *two, size_t m
+                ,   const scoring_table& table
+                ) -> typename P::result_type
+            {
+                return P::run(one, n, two, m, table);
+            }
+        }
+    }
+}
@@ -4,18 +4,516 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2018-present Rodrigo Siqueira
  */
+#include <map>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
 #include "museqa.hpp"
 
 #include "mpi.hpp"
 #include "oeis.hpp"
 #include "utils.hpp"
 #include "buffer.hpp"
+#include "encoder.hpp"
+#include "database.hpp"
+#include "trace.hpp"
 #include "exception.hpp"
 #include "environment.h"
 
+#include "stream.hpp"
+
 #include "pairwise/pairwise.cuh"
 #include "pairwise/needleman/needleman.cuh"
 
+namespace
+{
+    using namespace museqa;
+    using namespace pairwise;
+
+    #if !defined(__museqa_runtime_cython)
+        /**
+         * Represents a contiguous range of pairs on the linear pair space.
+         * @since 0.1.1
+         */
+        using chunk = museqa::range<size_t>;
+
+        /*
+         * Pair scheduler configuration parameters. At each request, a slave receives
+         * a chunk worth a fraction of the remaining work, thus chunks shrink as the
+         * work is consumed. The granularity value bounds how small a chunk can get.
+         */
+        enum : size_t { chunk_factor = 2 };
+        enum : size_t { chunk_granularity = 64 };
+        enum : mpi::tag { schedule_tag = 0x5c };
+
+        /*
+         * Definitions of the scheduler's progress file format. The file is laid out
+         * as its header, followed by the scores of the pair space's received prefix.
+         * As scores are only ever appended, a run killed while saving leaves at most
+         * a partial score at the file's end, which is simply ignored when resuming.
+         */
+        static constexpr char magic[8] = {'M', 'U', 'S', 'E', 'Q', 'A', 'P', 'P'};
+        enum : uint64_t { version = 1 };
+
+        /**
+         * The scheduler's progress file header.
+         * @since 0.1.1
+         */
+        struct header
+        {
+            char magic[8];                      /// The file's magic number.
+            uint64_t version;                   /// The file format's version.
+            uint64_t count;                     /// The number of sequences being aligned.
+            uint64_t key;                       /// The digest of the run the scores belong to.
+        };
+
+        /**
+         * Generates the pairs within a contiguous range of the linear pair space.
+         * A pair will always be at the same offset, independently of the partition.
+         * @param range The range of pairs to be generated.
+         * @return The generated sequence pairs.
+         */
+        static auto expand(const chunk& range) -> buffer<pair>
+        {
+            auto pairs = buffer<pair>::make(range.total);
+
+            size_t i = oeis::a002024(range.offset + 1);
+            size_t j = range.offset - utils::nchoose(i);
+
+            for(size_t c = 0; c < range.total; ++i, j = 0)
+                while(c < range.total && j < i)
+                    pairs[c++] = pair {seqref(i), seqref(j++)};
+
+            return pairs;
+        }
+
+        /**
+         * Informs the range of pairs to be aligned within a context. If the pairs
+         * are explicitly listed, offsets refer to the list rather than to the linear
+         * pair space, on which the pairs among the known sequences are skipped.
+         * @param ctx The algorithm's context.
+         * @return The range of pairs to be aligned.
+         */
+        static auto space(const context& ctx) -> chunk
+        {
+            const size_t first = utils::nchoose(ctx.known);
+
+            return ctx.pairs.size()
+                ? chunk {0, ctx.pairs.size()}
+                : chunk {first, utils::nchoose(ctx.db.count()) - first};
+        }
+
+        /**
+         * Fetches the pairs within a range of the context's pair space, and waits
+         * for the sequences they involve to be available.
+         * @param ctx The algorithm's context.
+         * @param range The range of pairs to be fetched.
+         * @return The fetched sequence pairs.
+         */
+        static auto fetch(const context& ctx, const chunk& range) -> buffer<pair>
+        {
+            if(ctx.pairs.size()) {
+                stream::await(ctx.db.count());
+                return buffer<pair>::copy(ctx.pairs.raw() + range.offset, range.total);
+            }
+
+            stream::await(oeis::a002024(range.offset + range.total) + 1);
+            return expand(range);
+        }
+
+        /**
+         * Estimates the cost of aligning the pairs on the linear pair space. The
+         * cost of a pair is estimated by the product of its sequences' lengths, thus
+         * the cost of a row segment is given by the row sequence's weight times the
+         * sum of the column sequences' weights, which can be found in constant time.
+         * If the pairs are explicitly listed, their cumulative costs are kept instead.
+         * @since 0.1.1
+         */
+        class workload
+        {
+            protected:
+                std::vector<double> m_weight;       /// The estimated cost weight of each sequence.
+                std::vector<double> m_prefix;       /// The weights' prefix sums.
+                std::vector<double> m_rows;         /// The cumulative cost of all pairs before each row.
+                std::vector<double> m_listed;       /// The cumulative cost of the listed pairs.
+
+            public:
+                /**
+                 * Estimates the workload of aligning the pairs within a context.
+                 * @param ctx The algorithm's context.
+                 */
+                inline workload(const context& ctx)
+                :   m_weight (ctx.db.count())
+                ,   m_prefix (ctx.db.count() + 1, 0)
+                ,   m_rows (ctx.db.count() + 1, 0)
+                {
+                    for(size_t i = 0, n = ctx.db.count(); i < n; ++i) {
+                        m_weight[i] = double(ctx.db[i].contents.length() + 1);
+                        m_prefix[i + 1] = m_prefix[i] + m_weight[i];
+                        m_rows[i + 1] = m_rows[i] + m_weight[i] * m_prefix[i];
+                    }
+
+                    if(ctx.pairs.size()) {
+                        m_listed.resize(ctx.pairs.size() + 1, 0);
+
+                        for(size_t i = 0; i < ctx.pairs.size(); ++i)
+                            m_listed[i + 1] = m_listed[i] + m_weight[ctx.pairs[i].first] * m_weight[ctx.pairs[i].second];
+                    }
+                }
+
+                /**
+                 * Informs the cumulative cost of all pairs before the given offset.
+                 * @param offset The offset of the pair to be inspected.
+                 * @return The estimated cost of the preceding pairs.
+                 */
+                inline auto cost(size_t offset) const -> double
+                {
+                    if(!m_listed.empty())
+                        return m_listed[utils::min(offset, m_listed.size() - 1)];
+
+                    if(offset >= utils::nchoose(m_weight.size()))
+                        return total();
+
+                    const size_t i = oeis::a002024(offset + 1);
+                    const size_t j = offset - utils::nchoose(i);
+
+                    return m_rows[i] + m_weight[i] * m_prefix[j];
+                }
+
+                /**
+                 * Finds the offset of the first pair at which the cumulative cost
+                 * of its preceding pairs reaches the given target cost.
+                 * @param target The target cumulative cost.
+                 * @return The offset of the first pair reaching the given cost.
+                 */
+                inline auto locate(double target) const -> size_t
+                {
+                    const size_t count = m_weight.size();
+
+                    if(!m_listed.empty())
+                        return std::lower_bound(m_listed.begin(), m_listed.end() - 1, target) - m_listed.begin();
+
+                    if(target >= total())
+                        return utils::nchoose(count);
+
+                    const size_t i = std::upper_bound(m_rows.begin(), m_rows.end(), target) - m_rows.begin() - 1;
+                    const double needed = (target - m_rows[i]) / m_weight[i];
+                    const size_t j = std::lower_bound(m_prefix.begin(), m_prefix.begin() + i + 1, needed) - m_prefix.begin();
+
+                    return utils::nchoose(i) + j;
+                }
+
+                /**
+                 * Informs the total estimated cost of aligning all pairs.
+                 * @return The workload's total cost.
+                 */
+                inline auto total() const noexcept -> double
+                {
+                    return m_listed.empty() ? m_rows.back() : m_listed.back();
+                }
+        };
+
+        /**
+         * Splits the linear pair space into chunks of similar estimated cost. Each
+         * chunk is worth a fraction of the remaining work, thus the chunks shrink
+         * as the work is consumed and do not hold the same number of pairs.
+         * @since 0.1.1
+         */
+        class chunker
+        {
+            protected:
+                const workload m_load;              /// The pairs' estimated workload.
+                const size_t m_total;               /// The offset past the last pair.
+                const size_t m_workers;             /// The number of workers requesting chunks.
+                size_t m_offset;                    /// The offset of the next pair.
+
+            public:
+                /**
+                 * Initializes a new chunker for the pairs within a context. The pairs
+                 * before the given offset are not handed out, as they are already known.
+                 * @param ctx The algorithm's context.
+                 * @param workers The number of workers requesting chunks.
+                 * @param start The offset of the first pair to be handed out.
+                 */
+                inline chunker(const context& ctx, size_t workers, size_t start = 0)
+                :   m_load {ctx}
+                ,   m_total {::space(ctx).offset + ::space(ctx).total}
+                ,   m_workers {workers}
+                ,   m_offset {utils::max(::space(ctx).offset, start)}
+                {}
+
+                /**
+                 * Hands out the next chunk of pairs to be processed. An empty chunk
+                 * is returned when all pairs have already been handed out.
+                 * @return The next chunk of pairs.
+                 */
+                inline auto next() -> chunk
+                {
+                    const double done = m_load.cost(m_offset);
+                    const double minimum = m_load.total() / (m_workers * chunk_granularity);
+                    const double target = utils::max((m_load.total() - done) / (chunk_factor * m_workers), minimum);
+
+                    const size_t start = m_offset;
+                    m_offset = utils::min(utils::max(m_load.locate(done + target), start + 1), m_total);
+
+                    return {start, m_offset - start};
+                }
+        };
+
+        /**
+         * Sums the distances of each sequence while the scores stream in from the
+         * slaves, so the phylogeny module need not sum the whole matrix again. The
+         * chunks may arrive in any order, but a row is only summed once all rows
+         * before it are complete. Thus, every sequence's distances are added up in
+         * the order a row sweep over the full matrix would add them, and the sums
+         * are exactly the ones the phylogeny module would have found by itself.
+         * @since 0.1.1
+         */
+        class accumulator
+        {
+            protected:
+                std::map<size_t, size_t> m_ahead;   /// The chunks received past the frontier.
+                std::vector<double> m_sums;         /// The sums of each sequence's distances.
+                size_t m_frontier = 0;              /// The offset past the received prefix.
+                size_t m_row = 0;                   /// The next row to be summed.
+
+            public:
+                /**
+                 * Initializes a new accumulator for the pairs within a context. The
+                 * sums can only be found if all of the matrix's pairs are aligned.
+                 * @param ctx The algorithm's context.
+                 */
+                inline accumulator(const context& ctx)
+                :   m_sums (!ctx.known && !ctx.pairs.size() ? ctx.db.count() : 0, 0.)
+                {}
+
+                /**
+                 * Registers the arrival of a chunk's scores, and sums all rows that
+                 * have thereby been completed.
+                 * @param range The chunk of pairs whose scores have arrived.
+                 * @param scores The scores of all pairs, indexed by their offsets.
+                 */
+                inline void arrive(const chunk& range, const score *scores)
+                {
+                    if(m_sums.empty() || !range.total) return;
+
+                    m_ahead[range.offset] = range.offset + range.total;
+
+                    while(!m_ahead.empty() && m_ahead.begin()->first == m_frontier) {
+                        m_frontier = m_ahead.begin()->second;
+                        m_ahead.erase(m_ahead.begin());
+                    }
+
+                    for( ; m_row < m_sums.size() && utils::nchoose(m_row + 1) <= m_frontier; ++m_row) {
+                        const score *line = scores + utils::nchoose(m_row);
+
+                        for(size_t j = 0; j < m_row; ++j) {
+                            m_sums[m_row] += line[j];
+                            m_sums[j] += line[j];
+                        }
+                    }
+                }
+
+                /**
+                 * Informs the offset past the prefix of pairs whose scores have all
+                 * arrived. The prefix is only tracked if the sums can be found.
+                 * @return The offset past the received prefix.
+                 */
+                inline auto frontier() const noexcept -> size_t
+                {
+                    return m_frontier;
+                }
+
+                /**
+                 * Retrieves the sums of each sequence's distances, if all of them
+                 * could be found from the arrived scores.
+                 * @return The sums of each sequence's distances, if known.
+                 */
+                inline auto sums() const -> buffer<double>
+                {
+                    return m_sums.size() && m_row == m_sums.size()
+                        ? buffer<double>::copy(m_sums)
+                        : buffer<double> {};
+                }
+        };
+
+        /**
+         * Saves the scores of the pair space's received prefix while the pairs are
+         * scheduled, so an interrupted run can resume from them rather than aligning
+         * them all over again. Progress is only saved when all pairs are aligned.
+         * @since 0.1.1
+         */
+        class journal
+        {
+            protected:
+                std::string m_filename;             /// The name of the progress file.
+                std::ofstream m_file;               /// The progress file, if progress is saved.
+                size_t m_saved = 0;                 /// The offset past the saved prefix.
+
+            public:
+                /**
+                 * Opens the progress file for the pairs within a context, and loads
+                 * the scores saved by a previous run of the same pairs, if any.
+                 * @param ctx The algorithm's context.
+                 * @param scores The scores of all pairs, indexed by their offsets.
+                 */
+                inline journal(const context& ctx, score *scores)
+                :   m_filename {ctx.known || ctx.pairs.size() ? std::string {} : ctx.saved.filename}
+                {
+                    if(m_filename.empty()) return;
+
+                    const size_t count = ctx.db.count();
+                    const size_t total = utils::nchoose(count);
+
+                    std::ifstream previous (m_filename, std::ifstream::binary);
+                    header head;
+
+                    if(previous.read(reinterpret_cast<char *>(&head), sizeof(head))) {
+                        enforce(!memcmp(head.magic, magic, sizeof(magic)), "file is not a valid pairwise progress '%s'", m_filename);
+
+                        if(head.version == version && head.count == count && head.key == ctx.saved.key) {
+                            previous.read(reinterpret_cast<char *>(scores), total * sizeof(score));
+                            m_saved = previous.gcount() / sizeof(score);
+                        }
+                    }
+
+                    previous.close();
+
+                    // The file is rewritten with only the complete scores found, so
+                    // any partial score left at its end is not appended to.
+                    const auto partial = m_filename + ".tmp";
+                    std::ofstream file (partial, std::ofstream::binary | std::ofstream::trunc);
+                    enforce(!file.fail(), "file cannot be written '%s'", partial);
+
+                    memcpy(head.magic, magic, sizeof(head.magic));
+
+                    head.version = version;
+                    head.count   = count;
+                    head.key     = ctx.saved.key;
+
+                    file.write(reinterpret_cast<const char *>(&head), sizeof(head));
+                    file.write(reinterpret_cast<const char *>(scores), m_saved * sizeof(score));
+
+                    file.close();
+                    enforce(!file.fail(), "file cannot be written '%s'", partial);
+                    enforce(!std::rename(partial.c_str(), m_filename.c_str()), "file cannot be written '%s'", m_filename);
+
+                    m_file.open(m_filename, std::ofstream::binary | std::ofstream::app);
+                    enforce(!m_file.fail(), "file cannot be written '%s'", m_filename);
+                }
+
+                /**
+                 * Appends the scores which have arrived since the last save.
+                 * @param frontier The offset past the received prefix.
+                 * @param scores The scores of all pairs, indexed by their offsets.
+                 */
+                inline void save(size_t frontier, const score *scores)
+                {
+                    if(!m_file.is_open() || frontier <= m_saved) return;
+
+                    m_file.write(reinterpret_cast<const char *>(scores + m_saved), (frontier - m_saved) * sizeof(score));
+                    m_file.flush();
+
+                    enforce(!m_file.fail(), "file cannot be written '%s'", m_filename);
+                    m_saved = frontier;
+                }
+
+                /**
+                 * Removes the progress file, once all scores are known. From then
+                 * on, the scores are saved by the module's own checkpoint, if any.
+                 */
+                inline void finish()
+                {
+                    if(!m_file.is_open()) return;
+
+                    m_file.close();
+                    std::remove(m_filename.c_str());
+                }
+
+                /**
+                 * Informs the offset past the prefix of pairs saved by a previous run.
+                 * @return The offset past the saved prefix.
+                 */
+                inline auto saved() const noexcept -> size_t
+                {
+                    return m_saved;
+                }
+        };
+
+        /**
+         * Coordinates the pair scheduling from the master node. The master hands
+         * out a new chunk of pairs to every slave that reports back the scores
+         * of its last chunk, until there are no more pairs to be processed. While
+         * the slaves are busy, the master sums the rows the scores have completed,
+         * and saves the scores received so far, so an interrupted run can resume.
+         * @param ctx The algorithm's context.
+         * @return The scores of all pairs to be aligned, indexed by the pairs' offsets.
+         */
+        static auto coordinate(const context& ctx) -> distance_matrix
+        {
+            const size_t workers = node::count - 1;
+            const auto pending = ::space(ctx);
+
+            auto result = buffer<score>::make(pending.total);
+            auto assigned = std::vector<chunk> (node::count, chunk {0, 0});
+
+            journal progress {ctx, result.raw()};
+            chunker scheduler {ctx, workers, progress.saved()};
+            accumulator rows {ctx};
+
+            rows.arrive(chunk {0, progress.saved()}, result.raw());
+
+            for(size_t active = workers; active > 0; ) {
+                stream::progress();
+
+                const auto source = mpi::probe(mpi::any, schedule_tag).source();
+                auto scores = mpi::receive<score>(source, schedule_tag);
+
+                enforce(scores.size() == assigned[source].total, "unexpected number of scores received");
+                std::copy(scores.begin(), scores.end(), result.raw() + assigned[source].offset - pending.offset);
+                rows.arrive(assigned[source], result.raw());
+                progress.save(rows.frontier(), result.raw());
+
+                assigned[source] = scheduler.next();
+                active -= !assigned[source].total;
+
+                size_t message[] = {assigned[source].offset, assigned[source].total};
+                mpi::send(message, 2, source, schedule_tag);
+            }
+
+            progress.finish();
+            return distance_matrix {result, ctx.db.count(), rows.sums()};
+        }
+
+        /**
+         * Processes chunks of pairs handed out by the master node. Every time a
+         * chunk is finished, its scores are sent back along with a new request.
+         * @param ctx The algorithm's context.
+         * @param fn The function responsible for aligning the pairs.
+         */
+        static void work(const context& ctx, const needleman::aligner& fn)
+        {
+            buffer<score> scores;
+
+            for(chunk current = {0, 1}; current.total > 0; ) {
+                mpi::send(scores, node::master, schedule_tag);
+                auto message = mpi::receive<size_t>(node::master, schedule_tag);
+
+                if((current = chunk {message[0], message[1]}).total > 0) {
+                    trace::scope span {"needleman::chunk"};
+                    scores = fn(::fetch(ctx, current), ctx.db, ctx.table);
+                }
+            }
+        }
+    #endif
+}
+
 namespace museqa
 {
     namespace pairwise
@@ -36,35 +534,163 @@ namespace museqa
                     const auto total = utils::nchoose(num);
                     const auto range = utils::partition(total, node::count - 1, node::rank - 1);
 
-                    auto pairs = buffer<pair>::make(range.total);
-                    
-                    size_t i = oeis::a002024(range.offset + 1);
-                    size_t j = range.offset - utils::nchoose(i);
+                    stream::await(oeis::a002024(range.offset + range.total) + 1);
+                    return expand(range);
+                #else
+                    return pairwise::algorithm::generate(num);
+                #endif
+            }
+
+            /**
+             * Generates the working pairs that will be processed by the current node
+             * rank according to the context's partitioning strategy. The balanced
+             * strategy gives every slave a contiguous slice of the pair space with
+             * roughly the same estimated work, rather than the same number of pairs.
+             * In either strategy, only the pairs still to be aligned are partitioned.
+             * @param ctx The algorithm's context.
+             * @return The generated sequence pairs.
+             */
+            auto algorithm::generate(const context& ctx) const -> buffer<pair>
+            {
+                #if !defined(__museqa_runtime_cython)
+                    enforce(node::rank >= 1, "master node must not generate pairs");
+
+                    const size_t workers = node::count - 1;
+                    const auto pending = ::space(ctx);
+
+                    if(ctx.partition != "balanced") {
+                        const auto range = utils::partition(pending.total, workers, node::rank - 1);
+                        return ::fetch(ctx, {pending.offset + range.offset, range.total});
+                    }
+
+                    const ::workload load {ctx};
+                    const double done = load.cost(pending.offset);
+                    const double left = load.total() - done;
 
-                    for(size_t c = 0; c < range.total; ++i, j = 0)
-                        while(c < range.total && j < i)
-                            pairs[c++] = pair {seqref(i), seqref(j++)};
+                    const size_t start = utils::max(load.locate(done + left * (node::rank - 1) / workers), pending.offset);
+                    const size_t end   = utils::max(load.locate(done + left * (node::rank - 0) / workers), start);
 
-                    return pairs;
+                    return ::fetch(ctx, {start, end - start});
                 #else
-                    return pairwise::algorithm::generate(num);
+                    return pairwise::algorithm::generate(ctx);
                 #endif
             }
 
             /**
-             * Gathers all calculated scores from all processes to master.
+             * Gathers all calculated scores from all processes to master. Only the
+             * master keeps the whole matrix, as the phylogeny step sends each node
+             * no more of it than what the node's chosen algorithm needs.
              * @param input The buffer with the current node's results.
-             * @return The gathered score from all processes.
+             * @return The gathered score from all processes, on the master node.
+             * @see phylogeny::algorithm::share
              */
             auto algorithm::gather(buffer<score>& input) const -> buffer<score>
             {
+                trace::scope span {"needleman::gather"};
+
                 #if !defined(__museqa_runtime_cython)
-                    return mpi::allgather(input);
+                    // Only a host's first node completes the database stream for the
+                    // whole host. Thus, the stream must be completed before the node
+                    // is blocked by the gather, as the host's other nodes might still
+                    // be waiting for sequences the node itself did not need.
+                    stream::complete();
+                    return mpi::gather(input);
                 #else
                     return input;
                 #endif
             }
 
+            /**
+             * Schedules pairs dynamically among the slave nodes. Rather than a fixed
+             * slice of the pair space, each slave is handed cost-weighted chunks
+             * of pairs on demand, so faster nodes naturally process more pairs.
+             * As chunks are reported back while others are still being aligned, the
+             * scores arrive at the master along with the work, not after it, and so
+             * do the sums of the sequences' distances, for the phylogeny module.
+             * @param ctx The algorithm's context.
+             * @param fn The function responsible for aligning the pairs.
+             * @return The distance matrix of all pairs to be aligned, on the master node.
+             * @see needleman::algorithm::gather
+             */
+            auto algorithm::schedule(const context& ctx, const aligner& fn) const -> distance_matrix
+            {
+                trace::scope span {"needleman::schedule"};
+
+                #if !defined(__museqa_runtime_cython)
+                    enforce(node::count > 1, "dynamic scheduling requires at least one slave node");
+
+                    auto result = distance_matrix {buffer<score> {}, ctx.db.count()};
+
+                    onlymaster result = ::coordinate(ctx);
+                    onlyslaves ::work(ctx, fn);
+
+                    return result;
+                #else
+                    return distance_matrix {fn(pairwise::algorithm::generate(ctx), ctx.db, ctx.table), ctx.db.count()};
+                #endif
+            }
+
+            /**
+             * Finds the best score any two units can be given when matched. This
+             * is the most a single diagonal step can add to an alignment's score.
+             * @param table The scoring table used to compare the sequences.
+             * @return The best match score.
+             */
+            auto band::bound(const scoring_table& table) -> score
+            {
+                score result = 0;
+
+                for(size_t i = 0; i < 25; ++i)
+                    for(size_t j = 0; j < 25; ++j)
+                        result = utils::max(result, table[{encoder::unit(i), encoder::unit(j)}]);
+
+                return result;
+            }
+
+            /**
+             * Finds the least penalty any gap residue can be charged. With affine
+             * gaps, a gap is never cheaper than if all its residues were extensions.
+             * @param table The scoring table used to compare the sequences.
+             * @return The least gap residue penalty.
+             */
+            auto band::penalty(const scoring_table& table) -> score
+            {
+                return utils::min(table.penalty(), table.extend());
+            }
+
+            /**
+             * Calculates the narrowest band in which a score is proven optimal. An
+             * alignment path leaving a band of half-width w must have at least w + 1
+             * gaps to get out of the band, and as many to come back. The score of
+             * any such path is thus bounded, and if a band's score is not lower than
+             * this bound, no path outside of the band can beat it. As widening a
+             * band never lowers its score, the returned width is always enough
+             * for proving the score of a wider band's alignment.
+             * @param result The score found within a band.
+             * @param one The first sequence's length.
+             * @param two The second sequence's length.
+             * @param match The best match score.
+             * @param penalty The least gap residue penalty.
+             * @return The band's half-width needed for the score to be optimal.
+             */
+            auto band::required(score result, size_t one, size_t two, score match, score penalty) -> size_t
+            {
+                const size_t shortest = utils::min(one, two);
+                const size_t difference = utils::max(one, two) - shortest;
+
+                // The bound for a half-width w is given by the expression below,
+                // which must not be greater than the band's score for it to hold:
+                // match * (shortest - w - 1) - penalty * (2 * w + 2 + difference).
+                const double slope = double(match) + 2 * double(penalty);
+                const double excess = double(match) * (double(shortest) - 1)
+                    - double(penalty) * (double(difference) + 2) - double(result);
+
+                if(slope <= 0 || excess / slope >= double(shortest))
+                    return shortest;
+
+                return excess > 0 ? static_cast<size_t>(std::ceil(excess / slope)) : 0;
+            }
+
             /**
              * Picks the default needleman algorithm instance according to the executions's
              * global state conditions and devices availability.
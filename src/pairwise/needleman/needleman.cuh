@@ -7,6 +7,9 @@
 #pragma once
 
 #include "buffer.hpp"
+#include "functor.hpp"
+#include "database.hpp"
+
 #include "pairwise/pairwise.cuh"
 
 namespace museqa
@@ -15,6 +18,14 @@ namespace museqa
     {
         namespace needleman
         {
+            /**
+             * The function responsible for aligning a list of pairs on the current
+             * node. This is the unit of work handed out by the pair scheduler.
+             * @see needleman::algorithm::schedule
+             * @since 0.1.1
+             */
+            using aligner = functor<buffer<score>(const buffer<pair>&, const museqa::database&, const scoring_table&)>;
+
             /**
              * Represents a general needleman algorithm for solving the heuristic's
              * pairwise alignment step.
@@ -23,17 +34,71 @@ namespace museqa
             struct algorithm : public pairwise::algorithm
             {
                 auto generate(size_t) const -> buffer<pair> override;
+                auto generate(const context&) const -> buffer<pair> override;
 
-                virtual auto gather(buffer<score>&) const -> buffer<score>;            
+                virtual auto gather(buffer<score>&) const -> buffer<score>;
+                virtual auto schedule(const context&, const aligner&) const -> distance_matrix;
                 virtual auto run(const context&) const -> distance_matrix = 0;
             };
 
+            /**
+             * The gap models the needleman kernels can be specialized for. As the
+             * model is picked at compile-time, the linear kernels never keep the
+             * extra state needed by affine gaps, nor pay for updating it.
+             * @since 0.1.1
+             */
+            namespace gap
+            {
+                /**
+                 * Every gap residue is charged the table's penalty, so each cell
+                 * of the alignment matrix needs a single score state.
+                 * @since 0.1.1
+                 */
+                struct linear {};
+
+                /**
+                 * A gap's first residue is charged the table's opening penalty, and
+                 * each following residue, its extension penalty. Besides their score,
+                 * cells keep the best scores ending in a gap on either sequence, as
+                 * in Gotoh's algorithm.
+                 * @since 0.1.1
+                 */
+                struct affine {};
+            }
+
+            /**
+             * Groups the functions shared by the banded needleman implementations.
+             * A banded alignment only calculates the cells within a range of diagonals
+             * around the main one, which must be widened until its score can be
+             * proven to be the same as if the whole alignment matrix was calculated.
+             * @since 0.1.1
+             */
+            namespace band
+            {
+                /*
+                 * The band's initial half-width, in number of diagonals beyond the
+                 * sequences' length difference.
+                 */
+                enum : size_t { initial = 32 };
+
+                extern auto bound(const scoring_table&) -> score;
+                extern auto penalty(const scoring_table&) -> score;
+                extern auto required(score, size_t, size_t, score, score) -> size_t;
+            }
+
             /*
              * The list of all available needleman algorithm implementations.
              */
             extern auto best() -> pairwise::algorithm *;
+            extern auto simd() -> pairwise::algorithm *;
+            extern auto banded() -> pairwise::algorithm *;
             extern auto hybrid() -> pairwise::algorithm *;
+            extern auto anchored() -> pairwise::algorithm *;
             extern auto sequential() -> pairwise::algorithm *;
+            extern auto wavefront() -> pairwise::algorithm *;
+            extern auto hybrid_dynamic() -> pairwise::algorithm *;
+            extern auto sequential_dynamic() -> pairwise::algorithm *;
+            extern auto sequential_banded() -> pairwise::algorithm *;
         }
     }
 }
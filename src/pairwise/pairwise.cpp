@@ -6,6 +6,7 @@
  */
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include "utils.hpp"
 #include "buffer.hpp"
@@ -13,6 +14,7 @@
 #include "dispatcher.hpp"
 
 #include "pairwise/pairwise.cuh"
+#include "pairwise/kmer/kmer.cuh"
 #include "pairwise/needleman/needleman.cuh"
 
 namespace museqa
@@ -24,16 +26,41 @@ namespace museqa
          * @since 0.1.1
          */
         static const dispatcher<factory> factory_dispatcher = {
-            {"default",               needleman::best}
-        ,   {"needleman",             needleman::best}
-        ,   {"hybrid",                needleman::hybrid}
-        ,   {"needleman-hybrid",      needleman::hybrid}
-        ,   {"sequential",            needleman::sequential}
-        ,   {"distributed",           needleman::sequential}
-        ,   {"needleman-sequential",  needleman::sequential}
-        ,   {"needleman-distributed", needleman::sequential}
+            {"default",                      needleman::best}
+        ,   {"needleman",                    needleman::best}
+        ,   {"anchored",                     needleman::anchored}
+        ,   {"needleman-anchored",           needleman::anchored}
+        ,   {"kmer",                         kmer::sequential}
+        ,   {"kmer-sequential",              kmer::sequential}
+        ,   {"hybrid",                       needleman::hybrid}
+        ,   {"needleman-hybrid",             needleman::hybrid}
+        ,   {"simd",                         needleman::simd}
+        ,   {"needleman-simd",               needleman::simd}
+        ,   {"sequential",                   needleman::sequential}
+        ,   {"distributed",                  needleman::sequential}
+        ,   {"needleman-sequential",         needleman::sequential}
+        ,   {"needleman-distributed",        needleman::sequential}
+        ,   {"wavefront",                    needleman::wavefront}
+        ,   {"needleman-wavefront",          needleman::wavefront}
+        ,   {"banded",                       needleman::banded}
+        ,   {"needleman-banded",             needleman::banded}
+        ,   {"sequential-banded",            needleman::sequential_banded}
+        ,   {"needleman-sequential-banded",  needleman::sequential_banded}
+        ,   {"dynamic",                      needleman::sequential_dynamic}
+        ,   {"hybrid-dynamic",               needleman::hybrid_dynamic}
+        ,   {"sequential-dynamic",           needleman::sequential_dynamic}
+        ,   {"needleman-hybrid-dynamic",     needleman::hybrid_dynamic}
+        ,   {"needleman-sequential-dynamic", needleman::sequential_dynamic}
         };
 
+        /**
+         * Keeps the list of available strategies for partitioning the pairs among
+         * the cluster nodes. The uniform partitioning gives each node the same number
+         * of pairs, while the balanced one gives each node the same estimated work.
+         * @since 0.1.1
+         */
+        static const std::vector<std::string> partition_list = {"uniform", "balanced"};
+
         /**
          * Informs whether a given factory name exists in dispatcher.
          * @param name The name of algorithm to check existance of.
@@ -65,6 +92,25 @@ namespace museqa
             return factory_dispatcher.list();
         }
 
+        /**
+         * Informs whether a given pairs partitioning strategy exists.
+         * @param name The name of strategy to check existance of.
+         * @return Does the chosen strategy exist?
+         */
+        auto algorithm::partitionable(const std::string& name) -> bool
+        {
+            return std::find(partition_list.begin(), partition_list.end(), name) != partition_list.end();
+        }
+
+        /**
+         * Informs the names of all available pairs partitioning strategies.
+         * @return The list of available strategies.
+         */
+        auto algorithm::partitions() noexcept -> const std::vector<std::string>&
+        {
+            return partition_list;
+        }
+
         /**
          * Generates all working pairs for a given number of elements.
          * @param num The total number of elements.
@@ -83,5 +129,27 @@ namespace museqa
 
             return pairs;
         }
+
+        /**
+         * Generates all working pairs for the sequences within a context. Unless
+         * overriden, the partitioning strategy is ignored and all pairs listed or,
+         * if none are listed, all pairs not yet known are generated.
+         * @param ctx The algorithm's context.
+         * @return The generated sequence pairs.
+         */
+        auto algorithm::generate(const context& ctx) const -> buffer<pair>
+        {
+            if(ctx.pairs.size())
+                return ctx.pairs;
+
+            const size_t num = ctx.db.count();
+            auto pairs = buffer<pair>::make(utils::nchoose(num) - utils::nchoose(ctx.known));
+
+            for(size_t i = ctx.known, c = 0; i < num; ++i)
+                for(size_t j = 0; j < i; ++j, ++c)
+                    pairs[c] = pair {seqref(i), seqref(j)};
+
+            return pairs;
+        }
     }
 }
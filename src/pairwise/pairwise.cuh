@@ -61,6 +61,7 @@ namespace museqa
 
             protected:
                 size_t m_count;                     /// The number of sequences represented in the matrix.
+                buffer<double> m_sums;              /// The sums of each sequence's distances, if known.
 
             public:
                 inline distance_matrix() noexcept = default;
@@ -78,6 +79,19 @@ namespace museqa
                 ,   m_count {count}
                 {}
 
+                /**
+                 * Instantiates a new distance matrix along with the sums of each
+                 * sequence's distances, accumulated while its scores were arriving.
+                 * @param buf The linear buffer of pairwise distances.
+                 * @param count The total number of sequences represented.
+                 * @param sums The sums of each sequence's distances.
+                 */
+                inline distance_matrix(const underlying_type& buf, size_t count, const buffer<double>& sums) noexcept
+                :   underlying_type {buf}
+                ,   m_count {count}
+                ,   m_sums {sums}
+                {}
+
                 /**
                  * Instantiates a new distance matrix from a vector containing the
                  * pairwise distances between all sequences.
@@ -106,6 +120,28 @@ namespace museqa
                         : element_type {0};
                 }
 
+                /**
+                 * Gives access to the matrix's pairwise distances, linearly laid
+                 * out by their pairs' offsets.
+                 * @return The linear buffer of pairwise distances.
+                 */
+                inline auto linear() const noexcept -> const underlying_type&
+                {
+                    return *this;
+                }
+
+                /**
+                 * Gives access to the sums of each sequence's distances. The sums
+                 * are only known if they could be accumulated while the scores were
+                 * streaming in, and are otherwise left empty for whoever needs them
+                 * to compute them from the distances.
+                 * @return The sums of each sequence's distances, if known.
+                 */
+                inline auto sums() const noexcept -> const buffer<double>&
+                {
+                    return m_sums;
+                }
+
                 /**
                  * Informs the total number of pairwise aligned sequences.
                  * @return The number of sequences processed by the module.
@@ -119,6 +155,9 @@ namespace museqa
         /**
          * An aminoacid or nucleotide substitution table. This table is used to
          * calculate the match value between two aminoacid or nucleotide characters.
+         * Gaps are penalized either linearly, or by affine opening and extension
+         * penalties, in which case the penalty is charged to a gap's first residue
+         * and the extension to each of the following ones.
          * @since 0.1.1
          */
         class scoring_table
@@ -131,6 +170,7 @@ namespace museqa
             protected:
                 pointer_type m_contents;                    /// The table's contents.
                 element_type m_penalty;                     /// The table's penalty value.
+                element_type m_extend;                      /// The table's gap extension penalty.
 
             public:
                 inline scoring_table() noexcept = default;
@@ -148,6 +188,23 @@ namespace museqa
                     ) noexcept
                 :   m_contents {ptr}
                 ,   m_penalty {penalty}
+                ,   m_extend {penalty}
+                {}
+
+                /**
+                 * Creates a new scoring table instance with affine gap penalties.
+                 * @param ptr The scoring table's pointer.
+                 * @param penalty The penalty for opening a gap.
+                 * @param extend The penalty for extending a gap.
+                 */
+                __host__ __device__ inline scoring_table(
+                        const pointer_type& ptr
+                    ,   const element_type& penalty
+                    ,   const element_type& extend
+                    ) noexcept
+                :   m_contents {ptr}
+                ,   m_penalty {penalty}
+                ,   m_extend {extend}
                 {}
 
                 __device__ scoring_table(const pointer_type&, const scoring_table&) noexcept;
@@ -165,6 +222,18 @@ namespace museqa
                     return (*m_contents)[offset.x][offset.y];
                 }
 
+                /**
+                 * Gives access to one of the table's rows. A row can be fetched once
+                 * for a unit which is compared to many others, so that each of the
+                 * comparisons is a single indexed load off the row.
+                 * @param unit The unit whose row is requested.
+                 * @return The pointer to the table row's first element.
+                 */
+                __host__ __device__ inline auto row(uint8_t unit) const noexcept -> const element_type *
+                {
+                    return (*m_contents)[unit];
+                }
+
                 /**
                  * Gives access to the table's penalty value.
                  * @return The table's penalty value.
@@ -174,6 +243,25 @@ namespace museqa
                     return m_penalty;
                 }
 
+                /**
+                 * Gives access to the table's gap extension penalty. For linear
+                 * gaps, this is the same as the table's penalty.
+                 * @return The table's gap extension penalty.
+                 */
+                __host__ __device__ inline auto extend() const noexcept -> element_type
+                {
+                    return m_extend;
+                }
+
+                /**
+                 * Informs whether the table's gaps must be penalized as affine.
+                 * @return Are the opening and extension penalties different?
+                 */
+                __host__ __device__ inline bool affine() const noexcept
+                {
+                    return m_extend != m_penalty;
+                }
+
                 scoring_table to_device() const;
 
                 static auto has(const std::string&) -> bool;
@@ -182,13 +270,35 @@ namespace museqa
         };
 
         /**
-         * Represents a common pairwise algorithm context.
+         * Locates where the scores aligned so far are saved while the module runs,
+         * so an interrupted run can resume from them. If no file name is given, the
+         * module's progress is not saved at all.
+         * @since 0.1.1
+         */
+        struct progress
+        {
+            std::string filename;           /// The name of the progress file, if any.
+            uint64_t key;                   /// The digest of the run the scores belong to.
+        };
+
+        /**
+         * Represents a common pairwise algorithm context. The pairs among the context's
+         * leading known sequences are already known and must not be aligned again,
+         * thus an algorithm only aligns and returns the pairs from the linear offset
+         * of the first pair involving any other sequence onwards. If the pairs to
+         * be aligned are explicitly listed, only they are aligned, in the given order.
          * @since 0.1.1
          */
         struct context
         {
             const museqa::database& db;
             const scoring_table& table;
+            const std::string& partition;
+            const size_t kmer;              /// The k-mer length for alignment-free algorithms.
+            const size_t sketch;            /// The sketch size for alignment-free algorithms.
+            const size_t known;             /// The number of leading sequences whose pairs are known.
+            const buffer<pair> pairs;       /// The pairs to be aligned, if not all unknown pairs.
+            const progress saved;           /// Where the scores aligned so far are saved, if anywhere.
         };
 
         /**
@@ -214,11 +324,15 @@ namespace museqa
             inline algorithm& operator=(algorithm&&) = default;
 
             virtual auto generate(size_t) const -> buffer<pair>;
+            virtual auto generate(const context&) const -> buffer<pair>;
             virtual auto run(const context&) const -> distance_matrix = 0;
 
             static auto has(const std::string&) -> bool;
             static auto make(const std::string&) -> const factory&;
             static auto list() noexcept -> const std::vector<std::string>&;
+
+            static auto partitionable(const std::string&) -> bool;
+            static auto partitions() noexcept -> const std::vector<std::string>&;
         };
 
         /**
@@ -226,21 +340,49 @@ namespace museqa
          * @param db The database of sequences to align.
          * @param table The chosen scoring table.
          * @param algorithm The chosen pairwise algorithm.
-         * @return The chosen algorithm's resulting distance matrix.
+         * @param partition The chosen pairs partitioning strategy.
+         * @param kmer The k-mer length, or zero for the algorithm's default.
+         * @param sketch The sketch size, or zero for keeping all k-mers.
+         * @param saved Where the scores aligned so far are saved, if anywhere.
+         * @return The chosen algorithm's resulting distance matrix, on the master node.
          */
         inline distance_matrix run(
                 const museqa::database& db
             ,   const scoring_table& table
             ,   const std::string& algorithm = "default"
+            ,   const std::string& partition = "uniform"
+            ,   size_t kmer = 0
+            ,   size_t sketch = 0
+            ,   const progress& saved = {}
             )
         {
             auto lambda = pairwise::algorithm::make(algorithm);
             
             const pairwise::algorithm *worker = lambda ();
-            auto result = worker->run({db, table});
+            auto result = worker->run({db, table, partition, kmer, sketch, 0, {}, saved});
             
             delete worker;
             return result;
         }
+
+        extern auto incremental(
+                const std::string&
+            ,   const museqa::database&
+            ,   const scoring_table&
+            ,   const std::string& = "default"
+            ,   const std::string& = "uniform"
+            ,   size_t = 0
+            ,   size_t = 0
+            ) -> distance_matrix;
+
+        extern auto cached(
+                const std::string&
+            ,   const museqa::database&
+            ,   const scoring_table&
+            ,   const std::string& = "default"
+            ,   const std::string& = "uniform"
+            ,   size_t = 0
+            ,   size_t = 0
+            ) -> distance_matrix;
     }
 }
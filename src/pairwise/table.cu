@@ -4,6 +4,8 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2018-present Rodrigo Siqueira
  */
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -13,6 +15,7 @@
 #include "exception.hpp"
 #include "dispatcher.hpp"
 
+#include "io/loader/table.hpp"
 #include "pairwise/pairwise.cuh"
 
 namespace museqa
@@ -271,7 +274,7 @@ namespace museqa
             const pairwise::scoring_table::pointer_type& ptr
         ,   const pairwise::scoring_table& other
         ) noexcept
-    :   scoring_table {ptr, other.penalty()}
+    :   scoring_table {ptr, other.penalty(), other.extend()}
     {
         uint16_t x, y;
         constexpr uint16_t total = 25 * 25;
@@ -286,38 +289,66 @@ namespace museqa
     }
 
     /**
-     * Transfers the selected scoring table into device memory.
+     * The tables already transferred into each device's memory, keyed by their
+     * devices and contents. As many jobs may run within a single process, each
+     * table is only ever transferred once into each device. Just as the memory
+     * pools, the cache is never destroyed, so it is never released after the
+     * devices have already been torn down at the process's exit.
+     * @since 0.1.1
+     */
+    static auto& uploaded = *new std::map<std::string, pointer<table_type>>;
+    static std::mutex uploaded_lock;
+
+    /**
+     * Transfers the selected scoring table into device memory. A table that has
+     * already been transferred into the current device is reused.
      * @return The new scoring table instance.
      */
     auto pairwise::scoring_table::to_device() const -> pairwise::scoring_table
     {
-        auto ptr = pointer<table_type>::make(cuda::allocator::device);
-        cuda::memory::copy(&ptr, &m_contents);
-        
-        return {ptr, m_penalty};
+        const auto device = cuda::device::current();
+
+        auto key = std::string {reinterpret_cast<const char *>(&device), sizeof(device)};
+        key.append(reinterpret_cast<const char *>(&m_contents), sizeof(table_type));
+
+        std::lock_guard<std::mutex> guard {uploaded_lock};
+        auto& ptr = uploaded[key];
+
+        if(!ptr) {
+            ptr = pointer<table_type>::make(cuda::allocator::device);
+            cuda::memory::copy(&ptr, &m_contents);
+        }
+
+        return {ptr, m_penalty, m_extend};
     }
 
     /**
-     * Checks whether a scoring table if the given name exists.
+     * Checks whether a scoring table if the given name exists. Any name which is
+     * not a builtin table's may still be the name of a table file to be loaded.
      * @param name The name of selected scoring table.
      * @return Does the requested scoring table exist?
      */
     auto pairwise::scoring_table::has(const std::string& name) -> bool
     {
-        return table_dispatcher.has(name);
+        return table_dispatcher.has(name) || io::loader<scoring_table>{}.validate(name);
     }
 
     /**
-     * Selects a scoring table from its name.
+     * Selects a scoring table from its name, or loads it from a file.
      * @param name The name of selected scoring table.
      * @return The pointer to selected table.
      */
     auto pairwise::scoring_table::make(const std::string& name) -> pairwise::scoring_table
-    try {
-        const local_table& selected = table_dispatcher[name];
-        return {pointer<table_type>::weak(selected.data), selected.penalty};
-    } catch(const exception& e) {
-        throw exception("unknown pairwise scoring table '%s'", name);
+    {
+        if(!table_dispatcher.has(name) && io::loader<scoring_table>{}.validate(name))
+            return io::loader<scoring_table>{}.load(name);
+
+        try {
+            const local_table& selected = table_dispatcher[name];
+            return {pointer<table_type>::weak(selected.data), selected.penalty};
+        } catch(const exception& e) {
+            throw exception("unknown pairwise scoring table '%s'", name);
+        }
     }
 
     /**
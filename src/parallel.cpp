@@ -0,0 +1,136 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the fork-join host threads pool.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+#include "parallel.hpp"
+
+namespace museqa
+{
+    /**
+     * The pool of threads shared by all modules running on the current node.
+     * The pool is only created when first used or explicitly initialized.
+     * @see parallel::init
+     */
+    static std::unique_ptr<parallel::pool> global_pool;
+
+    /**
+     * Spawns the pool's background threads.
+     * @param count The total number of threads in the pool, counting the caller's.
+     */
+    parallel::pool::pool(size_t count)
+    {
+        for(size_t id = 1; id < count; ++id)
+            m_workers.emplace_back(&pool::work, this, id);
+    }
+
+    /**
+     * Stops and joins all of the pool's background threads.
+     */
+    parallel::pool::~pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_stopping = true;
+        }
+
+        m_wakeup.notify_all();
+
+        for(auto& worker : m_workers)
+            worker.join();
+    }
+
+    /**
+     * Executes a task in all of the pool's threads, and blocks until all threads
+     * have finished it. The calling thread runs the task as the pool's thread zero.
+     * The pool runs a single task at a time, so if it is already busy with another
+     * caller's task, the calling thread runs all of the task's threads by itself,
+     * rather than waiting for the pool. This lets independent host threads, such
+     * as the ones driving the Python bindings, run their tasks at once.
+     * @param fn The task to be executed.
+     */
+    void parallel::pool::run(const task& fn)
+    {
+        std::unique_lock<std::mutex> dispatch {m_dispatch, std::try_to_lock};
+
+        if(!dispatch.owns_lock()) {
+            for(size_t id = 0; id < size(); ++id)
+                fn(id);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            m_pending = size() - 1;
+            m_task = &fn;
+            ++m_generation;
+        }
+
+        m_wakeup.notify_all();
+        fn(0);
+
+        std::unique_lock<std::mutex> lock {m_mutex};
+        m_finished.wait(lock, [this]() { return m_pending == 0; });
+        m_task = nullptr;
+    }
+
+    /**
+     * The main loop of the pool's background threads. Each thread waits until a
+     * new task has been dispatched, and notifies the caller when it is done.
+     * @param id The thread's index within the pool.
+     */
+    void parallel::pool::work(size_t id)
+    {
+        size_t generation = 0;
+
+        while(true) {
+            const task *current;
+
+            {
+                std::unique_lock<std::mutex> lock {m_mutex};
+                m_wakeup.wait(lock, [&]() { return m_stopping || m_generation != generation; });
+
+                if(m_stopping) return;
+
+                generation = m_generation;
+                current = m_task;
+            }
+
+            (*current)(id);
+
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                if(--m_pending == 0) m_finished.notify_one();
+            }
+        }
+    }
+
+    /**
+     * Initializes the global pool with the given number of threads. If the pool
+     * had already been created, its threads are joined and a new pool is spawned.
+     * @param count The total number of threads on the global pool.
+     */
+    void parallel::init(size_t count)
+    {
+        global_pool.reset();
+        global_pool.reset(new parallel::pool {utils::max<size_t>(count, 1)});
+    }
+
+    /**
+     * Retrieves the global pool of threads for the current node.
+     * @return The global pool instance.
+     */
+    auto parallel::global() -> pool&
+    {
+        if(!global_pool) parallel::init(1);
+        return *global_pool;
+    }
+}
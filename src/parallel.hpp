@@ -0,0 +1,99 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements a fork-join host threads pool for node-local parallelism.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <condition_variable>
+
+#include "trace.hpp"
+#include "utils.hpp"
+
+namespace museqa
+{
+    namespace parallel
+    {
+        /**
+         * The task to be executed by each thread in a pool. Every thread receives
+         * its own index within the pool, so the workload can be split between them.
+         * @since 0.1.1
+         */
+        using task = std::function<void(size_t)>;
+
+        /**
+         * A pool of host threads for fork-join parallelism. Tasks are executed
+         * by all threads at once and the caller is blocked until all of them have
+         * finished. The calling thread itself is used as the pool's first thread.
+         * @since 0.1.1
+         */
+        class pool
+        {
+            protected:
+                std::vector<std::thread> m_workers;         /// The pool's background threads.
+                std::mutex m_mutex;                         /// The pool's synchronization mutex.
+                std::mutex m_dispatch;                      /// Held by the task's caller while it runs.
+                std::condition_variable m_wakeup;           /// Wakes workers up for a new task.
+                std::condition_variable m_finished;         /// Notifies the task is finished.
+
+                const task *m_task = nullptr;               /// The task currently being executed.
+                size_t m_generation = 0;                    /// The number of tasks dispatched so far.
+                size_t m_pending = 0;                       /// The number of workers yet to finish.
+                bool m_stopping = false;                    /// Is the pool being destroyed?
+
+            public:
+                explicit pool(size_t = 1);
+                ~pool();
+
+                pool(const pool&) = delete;
+                pool& operator=(const pool&) = delete;
+
+                void run(const task&);
+
+                /**
+                 * Informs the total number of threads in the pool.
+                 * @return The pool's number of threads.
+                 */
+                inline auto size() const noexcept -> size_t
+                {
+                    return m_workers.size() + 1;
+                }
+
+            protected:
+                void work(size_t);
+        };
+
+        extern auto global() -> pool&;
+        extern void init(size_t);
+
+        /**
+         * Splits a range of elements among the threads of the global pool and runs
+         * the given function over each of the threads' partitions.
+         * @tparam F The partition function type.
+         * @param total The total number of elements to be split.
+         * @param lambda The function to execute over each partition.
+         */
+        template <typename F>
+        inline void foreach(size_t total, F&& lambda)
+        {
+            auto& workers = parallel::global();
+            const size_t count = utils::max<size_t>(utils::min(workers.size(), total), 1);
+
+            if(count > 1) {
+                workers.run([&](size_t id) {
+                    trace::scope span {"parallel::foreach"};
+                    if(id < count) lambda(utils::partition(total, count, id), id);
+                });
+            } else {
+                lambda(range<size_t> {0, total}, size_t(0));
+            }
+        }
+    }
+}
@@ -5,10 +5,12 @@
  * @copyright 2020-present Rodrigo Siqueira
  */
 #include "io.hpp"
+#include "node.hpp"
 #include "pipeline.hpp"
 #include "exception.hpp"
 
 #include "pgalign.cuh"
+#include "io/dumper/alignment.hpp"
 
 namespace museqa
 {
@@ -25,10 +27,15 @@ namespace museqa
         auto pgalign::run(const io::manager& io, pipeline::pipe& pipe) const -> pipeline::pipe
         {
             auto algoname = io.cmd.get("pgalign", "default");
+            auto tablename = io.cmd.get("scoring-table", "default");
             auto previous = pipeline::convert<pgalign::previous>(pipe);
 
-            auto result = pa::run(previous->db, previous->tree, previous->total, algoname);
-            auto ptr = new pgalign::conduit {result};
+            auto table = museqa::pairwise::scoring_table::make(tablename);
+            auto result = pa::run(previous->db, previous->tree, table, previous->total, algoname, &previous->library);
+            auto ptr = new pgalign::conduit {previous->db, previous->tree, result};
+
+            onlymaster if(io.cmd.has("output") && !io.cmd.has("refine"))
+                enforce(io.dump(*ptr, io.cmd.get("output")), "could not dump alignment");
 
             return pipeline::pipe {ptr};
         }
@@ -48,21 +48,33 @@ namespace museqa
 
         /**
          * Defines the module's conduit. This conduit is composed of the final alignment
-         * of all sequences according to the given phylogenetic tree.
+         * of all sequences according to the given phylogenetic tree, along with the
+         * database the alignment's sequences and their descriptions come from.
          * @since 0.1.1
          */
         struct pgalign::conduit : public pipeline::conduit
         {
+            typedef museqa::phylogeny::guidetree guidetree;
             typedef museqa::pgalign::alignment alignment;
 
-            alignment aligned;
+            database db;                    /// The aligned sequences' database.
+            guidetree tree;                 /// The alignment's guiding tree.
+            alignment aligned;              /// The sequences' multiple alignment.
 
             inline conduit() noexcept = delete;
             inline conduit(const conduit&) = default;
             inline conduit(conduit&&) = default;
 
-            inline conduit(alignment& alignment)
-            :   aligned {std::move(alignment)}
+            /**
+             * Instantiates a new conduit.
+             * @param mdb The database of the aligned sequences.
+             * @param gtree The tree which has guided the alignment.
+             * @param alignment The sequences' multiple alignment.
+             */
+            inline conduit(database& mdb, guidetree& gtree, alignment& alignment)
+            :   db {std::move(mdb)}
+            ,   tree {std::move(gtree)}
+            ,   aligned {std::move(alignment)}
             {}
 
             inline conduit& operator=(const conduit&) = delete;
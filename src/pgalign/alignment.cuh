@@ -32,9 +32,11 @@ namespace museqa
             private:
                 using sequence_type = sequence;             /// The alignment's sequence type.
                 using buffer_type = buffer<sequence_type>;  /// The alignment's sequence buffer type.
+                using origin_type = buffer<uint32_t>;       /// The alignment's origin buffer type.
 
             private:
                 buffer_type m_buffer;                       /// The internal buffer of sequences.
+                origin_type m_origin;                       /// The database index of each sequence.
 
             public:
                 inline alignment() noexcept = default;
@@ -44,14 +46,51 @@ namespace museqa
                 /**
                  * Instantiates a new alignment from a buffer of sequences.
                  * @param buffer The list of sequences to create the alignment with.
+                 * @param origin The database index of each of the given sequences.
                  */
-                inline alignment(const buffer_type& buffer) noexcept
+                inline alignment(const buffer_type& buffer, const origin_type& origin) noexcept
                 :   m_buffer {buffer}
+                ,   m_origin {origin}
                 {}
 
                 inline alignment& operator=(const alignment&) = default;
                 inline alignment& operator=(alignment&&) = default;
 
+                /**#@+
+                 * Gives access to one of the alignment's sequences.
+                 * @param offset The requested sequence's offset on the alignment.
+                 * @return The requested sequence.
+                 */
+                inline sequence_type& operator[](ptrdiff_t offset)
+                {
+                    return m_buffer[offset];
+                }
+
+                inline const sequence_type& operator[](ptrdiff_t offset) const
+                {
+                    return m_buffer[offset];
+                }
+                /**#@-*/
+
+                /**
+                 * Informs the database index of one of the alignment's sequences.
+                 * @param offset The requested sequence's offset on the alignment.
+                 * @return The sequence's index on its original database.
+                 */
+                inline auto origin(ptrdiff_t offset) const -> uint32_t
+                {
+                    return m_origin[offset];
+                }
+
+                /**
+                 * Informs the number of sequences in the alignment.
+                 * @return The alignment's number of sequences.
+                 */
+                inline auto count() const noexcept -> size_t
+                {
+                    return m_buffer.size();
+                }
+
                 /**
                  * Creates a sub-alignment by selecting a slice of the alignment.
                  * @param displ The slice displament in relation to the alignment.
@@ -59,7 +98,10 @@ namespace museqa
                  */
                 inline alignment slice(ptrdiff_t displ, size_t size)
                 {
-                    return buffer_slice<sequence_type> {m_buffer, displ, size};
+                    return alignment {
+                            buffer_slice<sequence_type> {m_buffer, displ, size}
+                        ,   buffer_slice<uint32_t> {m_origin, displ, size}
+                        };
                 }
 
             private:
@@ -68,9 +110,11 @@ namespace museqa
                  * sequence. This allows the creation of sub-alignments from an
                  * already existing alignment instance.
                  * @param slice An alignment slice.
+                 * @param origin The slice's sequences' database indeces.
                  */
-                inline alignment(buffer_slice<sequence_type>&& slice)
+                inline alignment(buffer_slice<sequence_type>&& slice, buffer_slice<uint32_t>&& origin)
                 :   m_buffer {std::move(slice)}
+                ,   m_origin {std::move(origin)}
                 {}
         };
     }
@@ -0,0 +1,472 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the profile-aligner module's myers-miller profile aligner.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+#include "pairwise.cuh"
+
+#include "pairwise/anchor/anchor.cuh"
+
+#include "pgalign/sequence.cuh"
+#include "pgalign/alignment.cuh"
+#include "pgalign/myers/aligner.hpp"
+
+namespace museqa
+{
+    namespace pgalign
+    {
+        namespace myers
+        {
+            /**
+             * Builds the profile of a group of aligned sequences. All sequences in
+             * the group must have the same length, gaps included.
+             * @param group The group of aligned sequences.
+             * @param table The scoring table to align the profile with.
+             * @return The group's profile.
+             */
+            auto make_profile(const alignment& group, const pairwise::scoring_table& table) -> profile
+            {
+                profile result;
+
+                const size_t count = group.count();
+                const size_t length = group[0].length();
+
+                std::vector<uint32_t> counter (length * alphabet, 0);
+                std::vector<encoder::unit> units;
+                std::vector<pgalign::sequence::index_type> columns;
+
+                for(size_t s = 0; s < count; ++s) {
+                    const auto& current = group[s];
+                    const size_t residues = current.residues();
+
+                    units.resize(residues + encoder::block_size);
+                    columns.resize(residues);
+
+                    current.unpack(units.data());
+                    current.columns(columns.data());
+
+                    for(size_t r = 0; r < residues; ++r)
+                        if(units[r] < alphabet)
+                            ++counter[columns[r] * alphabet + units[r]];
+                }
+
+                result.length = length;
+                result.offset.resize(length + 1);
+                result.gaps.resize(length);
+                result.penalty.resize(length);
+
+                for(size_t c = 0; c < length; ++c) {
+                    size_t residues = 0;
+                    result.offset[c] = (uint32_t) result.entries.size();
+
+                    for(size_t u = 0; u < alphabet; ++u)
+                        if(counter[c * alphabet + u] > 0) {
+                            result.entries.push_back({encoder::unit(u), score(counter[c * alphabet + u]) / count});
+                            residues += counter[c * alphabet + u];
+                        }
+
+                    result.gaps[c] = score(count - residues) / count;
+                    result.penalty[c] = -table.penalty() * (1 - result.gaps[c]);
+                }
+
+                result.offset[length] = (uint32_t) result.entries.size();
+                return result;
+            }
+
+            /**
+             * Prepares the alignment of two profiles. Each of the second profile's
+             * columns is weighted by the scoring table, into the score of aligning
+             * the column to each possible unit, so a pair of columns can be scored
+             * from the first column's sparse frequencies alone.
+             * @param one The first profile to be aligned.
+             * @param two The second profile to be aligned.
+             * @param table The scoring table to align the profiles with.
+             * @param extension The columns' consistency bonus, if any.
+             */
+            aligner::aligner(
+                    const profile& one
+                ,   const profile& two
+                ,   const pairwise::scoring_table& table
+                ,   const bonus *extension
+                )
+            :   m_one {one}
+            ,   m_two {two}
+            ,   m_weight (two.length * alphabet, score {0})
+            ,   m_forward (two.length + 1)
+            ,   m_reverse (two.length + 1)
+            ,   m_bonus {extension}
+            ,   m_extra (two.length, score {0})
+            {
+                for(size_t c = 0; c < two.length; ++c)
+                    for(size_t u = 0; u < alphabet; ++u) {
+                        score value = -table.penalty() * two.gaps[c];
+
+                        for(uint32_t e = two.offset[c]; e < two.offset[c + 1]; ++e)
+                            value += two.entries[e].value * table[{encoder::unit(u), two.entries[e].unit}];
+
+                        m_weight[c * alphabet + u] = value;
+                    }
+
+                m_script.reserve(one.length + two.length);
+            }
+
+            /**
+             * Aligns the profiles and produces the alignment's edition script. The
+             * anchors' columns are matched as given, so only the segments between
+             * them are aligned, each one by its own divide-and-conquer.
+             * @param anchors The runs of columns forced to be matched, in order.
+             * @return The operations aligning the profiles' columns.
+             */
+            auto aligner::run(const std::vector<anchor>& anchors) -> const std::vector<operation>&
+            {
+                size_t i = 0, j = 0;
+
+                for(const auto& current : anchors) {
+                    divide(i, current.one, j, current.two);
+                    m_script.insert(m_script.end(), current.length, operation::match);
+
+                    i = current.one + current.length;
+                    j = current.two + current.length;
+                }
+
+                divide(i, m_one.length, j, m_two.length);
+                return m_script;
+            }
+
+            /**
+             * Scores an edition script between the profiles, by the same objective
+             * maximized by the aligner. Thus, the script produced by the aligner
+             * is never outscored by any other script between the same profiles.
+             * @param script The operations aligning the profiles' columns.
+             * @return The script's alignment score.
+             */
+            auto aligner::evaluate(const std::vector<operation>& script) const -> score
+            {
+                score result = 0;
+
+                for(size_t k = 0, i = 0, j = 0; k < script.size(); ++k) {
+                    if(script[k] == operation::match)          { result += pair(i, j) + extra(i, j); ++i; ++j; }
+                    else if(script[k] == operation::deletion)  result += m_one.penalty[i++];
+                    else                                       result += m_two.penalty[j++];
+                }
+
+                return result;
+            }
+
+            /**
+             * Calculates the last line of scores for aligning a block of the first
+             * profile's columns against all prefixes of a block of the second's.
+             * @param a0 The first profile's block start.
+             * @param a1 The first profile's block end.
+             * @param b0 The second profile's block start.
+             * @param b1 The second profile's block end.
+             */
+            void aligner::forward(size_t a0, size_t a1, size_t b0, size_t b1)
+            {
+                const score *dense = m_extra.data();
+                score *line = m_forward.data();
+                line[0] = 0;
+
+                for(size_t j = 1; j <= b1 - b0; ++j)
+                    line[j] = line[j - 1] + m_two.penalty[b0 + j - 1];
+
+                for(size_t i = a0; i < a1; ++i) {
+                    score diagonal = line[0];
+                    line[0] += m_one.penalty[i];
+                    scatter(i);
+
+                    for(size_t j = 1; j <= b1 - b0; ++j) {
+                        const score matched = diagonal + pair(i, b0 + j - 1) + dense[b0 + j - 1];
+                        const score deleted = line[j] + m_one.penalty[i];
+                        const score inserted = line[j - 1] + m_two.penalty[b0 + j - 1];
+
+                        diagonal = line[j];
+                        line[j] = utils::max(matched, utils::max(deleted, inserted));
+                    }
+
+                    scatter(i, true);
+                }
+            }
+
+            /**
+             * Calculates the first line of scores for aligning a block of the first
+             * profile's columns against all suffixes of a block of the second's.
+             * @param a0 The first profile's block start.
+             * @param a1 The first profile's block end.
+             * @param b0 The second profile's block start.
+             * @param b1 The second profile's block end.
+             */
+            void aligner::reverse(size_t a0, size_t a1, size_t b0, size_t b1)
+            {
+                const size_t m = b1 - b0;
+                const score *dense = m_extra.data();
+                score *line = m_reverse.data();
+                line[m] = 0;
+
+                for(size_t j = m; j-- > 0; )
+                    line[j] = line[j + 1] + m_two.penalty[b0 + j];
+
+                for(size_t i = a1; i-- > a0; ) {
+                    score diagonal = line[m];
+                    line[m] += m_one.penalty[i];
+                    scatter(i);
+
+                    for(size_t j = m; j-- > 0; ) {
+                        const score matched = diagonal + pair(i, b0 + j) + dense[b0 + j];
+                        const score deleted = line[j] + m_one.penalty[i];
+                        const score inserted = line[j + 1] + m_two.penalty[b0 + j];
+
+                        diagonal = line[j];
+                        line[j] = utils::max(matched, utils::max(deleted, inserted));
+                    }
+
+                    scatter(i, true);
+                }
+            }
+
+            /**
+             * Aligns a single column of the first profile against a block of the
+             * second's. The column is either matched to one of the block's columns
+             * or to a gap, while all other columns of the block are matched to gaps.
+             * @param i The first profile's column.
+             * @param b0 The second profile's block start.
+             * @param b1 The second profile's block end.
+             */
+            void aligner::single(size_t i, size_t b0, size_t b1)
+            {
+                size_t chosen = b1;
+                score best = m_one.penalty[i];
+
+                for(size_t j = b0; j < b1; ++j) {
+                    const score value = pair(i, j) + extra(i, j) - m_two.penalty[j];
+                    if(value > best) { best = value; chosen = j; }
+                }
+
+                if(chosen == b1)
+                    m_script.push_back(operation::deletion);
+
+                for(size_t j = b0; j < b1; ++j)
+                    m_script.push_back(j == chosen ? operation::match : operation::insertion);
+            }
+
+            /**
+             * Recursively aligns a block of each profile. The first profile's block
+             * is split in half, and the second's block is split wherever the best
+             * alignment crosses the first block's middle line.
+             * @param a0 The first profile's block start.
+             * @param a1 The first profile's block end.
+             * @param b0 The second profile's block start.
+             * @param b1 The second profile's block end.
+             */
+            void aligner::divide(size_t a0, size_t a1, size_t b0, size_t b1)
+            {
+                if(a0 == a1 || b0 == b1) {
+                    m_script.insert(m_script.end(), a1 - a0, operation::deletion);
+                    m_script.insert(m_script.end(), b1 - b0, operation::insertion);
+                    return;
+                }
+
+                if(a1 - a0 == 1)
+                    return single(a0, b0, b1);
+
+                const size_t middle = (a0 + a1) / 2;
+                size_t split = 0;
+
+                forward(a0, middle, b0, b1);
+                reverse(middle, a1, b0, b1);
+
+                for(size_t j = 1; j <= b1 - b0; ++j)
+                    if(m_forward[j] + m_reverse[j] > m_forward[split] + m_reverse[split])
+                        split = j;
+
+                divide(a0, middle, b0, b0 + split);
+                divide(middle, a1, b0 + split, b1);
+            }
+
+            /**
+             * Builds the consistency bonus between two groups of aligned sequences.
+             * Every library match between residues of sequences on different groups
+             * supports matching the residues' columns. The bonus is averaged over all
+             * pairs of sequences between the groups just like the columns' scores,
+             * and scaled to the table's best score, so both are on the same scale.
+             * @param one The first group of aligned sequences.
+             * @param two The second group of aligned sequences.
+             * @param library The sequences' consistency library.
+             * @param table The scoring table to align the groups with.
+             * @return The bonus of matching the groups' columns.
+             */
+            auto make_bonus(
+                    const alignment& one
+                ,   const alignment& two
+                ,   const pairwise::consistency::library& library
+                ,   const pairwise::scoring_table& table
+                ) -> bonus
+            {
+                using entry = std::pair<uint64_t, score>;
+
+                const size_t length = one[0].length();
+                const size_t sequences = library.origin.size() - 1;
+
+                std::vector<std::vector<pgalign::sequence::index_type>> columns (two.count());
+                std::vector<int64_t> member (sequences, -1);
+                std::vector<pgalign::sequence::index_type> current;
+                std::vector<entry> entries;
+
+                for(size_t k = 0; k < two.count(); ++k) {
+                    columns[k].resize(two[k].residues());
+                    two[k].columns(columns[k].data());
+                    member[two.origin(k)] = int64_t(k);
+                }
+
+                score best = 0;
+
+                for(size_t u = 0; u < alphabet; ++u)
+                    best = utils::max(best, table[{encoder::unit(u), encoder::unit(u)}]);
+
+                const score scale = best / score(one.count() * two.count());
+
+                for(size_t k = 0; k < one.count(); ++k) {
+                    const uint32_t first = library.origin[one.origin(k)];
+
+                    current.resize(one[k].residues());
+                    one[k].columns(current.data());
+
+                    for(size_t r = 0; r < current.size(); ++r)
+                        for(uint32_t e = library.offset[first + r]; e < library.offset[first + r + 1]; ++e) {
+                            const uint32_t other = library.column[e];
+                            const size_t owner = library.owner(other);
+
+                            if(member[owner] >= 0) {
+                                const uint64_t j = columns[member[owner]][other - library.origin[owner]];
+                                entries.push_back({uint64_t(current[r]) << 32 | j, library.weight[e] * scale});
+                            }
+                        }
+                }
+
+                std::sort(entries.begin(), entries.end());
+
+                bonus result;
+                result.offset.assign(length + 1, 0);
+
+                for(size_t k = 0; k < entries.size(); ++k) {
+                    if(k > 0 && entries[k].first == entries[k - 1].first) {
+                        result.value.back() += entries[k].second;
+                        continue;
+                    }
+
+                    result.column.push_back(uint32_t(entries[k].first));
+                    result.value.push_back(entries[k].second);
+                    ++result.offset[(entries[k].first >> 32) + 1];
+                }
+
+                for(size_t c = 0; c < length; ++c)
+                    result.offset[c + 1] += result.offset[c];
+
+                return result;
+            }
+
+            /**
+             * Finds the anchors between two groups of aligned sequences. The groups'
+             * longest sequences are anchored to each other, and the anchors' residues
+             * are then mapped onto their columns. Anchored residues whose columns are
+             * not consecutive on both groups are split into separate runs. Groups too
+             * short to be worth anchoring are left unanchored.
+             * @param one The first group of aligned sequences.
+             * @param two The second group of aligned sequences.
+             * @return The runs of columns to be matched between the groups' profiles.
+             */
+            auto anchors(const alignment& one, const alignment& two) -> std::vector<anchor>
+            {
+                std::vector<anchor> result;
+
+                if(one[0].length() < pairwise::anchor::threshold || two[0].length() < pairwise::anchor::threshold)
+                    return result;
+
+                const alignment *group[2] = {&one, &two};
+                std::vector<encoder::unit> units[2];
+                std::vector<pgalign::sequence::index_type> columns[2];
+
+                for(int side = 0; side < 2; ++side) {
+                    size_t longest = 0;
+
+                    for(size_t s = 1; s < group[side]->count(); ++s)
+                        if((*group[side])[s].residues() > (*group[side])[longest].residues())
+                            longest = s;
+
+                    const auto& current = (*group[side])[longest];
+
+                    units[side].resize(current.residues() + encoder::block_size);
+                    columns[side].resize(current.residues());
+
+                    current.unpack(units[side].data());
+                    current.columns(columns[side].data());
+                }
+
+                const auto chain = pairwise::anchor::find(
+                        units[0].data(), columns[0].size()
+                    ,   units[1].data(), columns[1].size()
+                    ,   pairwise::anchor::default_length
+                    );
+
+                for(const auto& seed : chain)
+                    for(size_t r = 0; r < seed.length; ++r) {
+                        const size_t i = columns[0][seed.one + r];
+                        const size_t j = columns[1][seed.two + r];
+
+                        if(!result.empty() && result.back().one + result.back().length == i
+                            && result.back().two + result.back().length == j)
+                            ++result.back().length;
+                        else
+                            result.push_back({i, j, 1});
+                    }
+
+                return result;
+            }
+
+            /**
+             * Merges two groups of aligned sequences by an edition script aligning
+             * their profiles. The script is turned into the runs of gaps to be
+             * inserted into each group, which are then merged into every sequence's
+             * own runs, never touching any of their residues.
+             * @param one The first group of aligned sequences.
+             * @param two The second group of aligned sequences.
+             * @param script The operations aligning the groups' profiles' columns.
+             */
+            void expand(alignment& one, alignment& two, const std::vector<aligner::operation>& script)
+            {
+                using run = pgalign::sequence::run;
+                using index_type = pgalign::sequence::index_type;
+
+                std::vector<run> runs_one, runs_two;
+                index_type i = 0, j = 0;
+
+                auto insert = [](std::vector<run>& runs, index_type column) {
+                    if(!runs.empty() && runs.back().position == column) ++runs.back().total;
+                    else runs.push_back({column, (runs.empty() ? 0 : runs.back().total) + 1});
+                };
+
+                for(const auto op : script) {
+                    if(op == aligner::insertion) insert(runs_one, i);
+                    else ++i;
+
+                    if(op == aligner::deletion) insert(runs_two, j);
+                    else ++j;
+                }
+
+                for(size_t s = 0; s < one.count(); ++s)
+                    one[s].expand(runs_one.data(), runs_one.size());
+
+                for(size_t s = 0; s < two.count(); ++s)
+                    two[s].expand(runs_two.data(), runs_two.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,187 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the profile-aligner module's myers-miller profile aligner.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "encoder.hpp"
+#include "pairwise.cuh"
+
+#include "pgalign/alignment.cuh"
+
+namespace museqa
+{
+    namespace pgalign
+    {
+        namespace myers
+        {
+            /*
+             * Aligner configuration parameters. The alphabet indicates the number
+             * of different units which can be scored by the scoring table.
+             */
+            enum : size_t { alphabet = 25 };
+
+            /**
+             * A run of columns which are forced to be matched between two profiles.
+             * Anchors split the profiles into segments which are aligned apart.
+             * @since 0.1.1
+             */
+            struct anchor
+            {
+                size_t one;                     /// The run's first column on the first profile.
+                size_t two;                     /// The run's first column on the second profile.
+                size_t length;                  /// The run's number of columns.
+            };
+
+            /**
+             * The frequency of a unit within one of a profile's columns.
+             * @since 0.1.1
+             */
+            struct frequency
+            {
+                encoder::unit unit;             /// The unit whose frequency is informed.
+                score value;                    /// The unit's frequency on the column.
+            };
+
+            /**
+             * The profile of a group of aligned sequences. Each column's residues
+             * are kept as a sparse list of their frequencies, as a column seldom has
+             * more than a few different residues. The gaps' frequencies are kept apart.
+             * @since 0.1.1
+             */
+            struct profile
+            {
+                std::vector<uint32_t> offset;   /// The offset of each column's frequencies.
+                std::vector<frequency> entries; /// The residues' frequencies of all columns.
+                std::vector<score> gaps;        /// The gaps' frequency on each column.
+                std::vector<score> penalty;     /// The score of aligning each column to a gap.
+                size_t length;                  /// The profile's number of columns.
+            };
+
+            /**
+             * The consistency bonus of matching two profiles' columns. The bonus is
+             * given by the consistency library's weights between the residues on
+             * both columns, and kept as a sparse matrix along the first profile's
+             * columns, as only a few pairs of columns are ever supported by the library.
+             * @since 0.1.1
+             */
+            struct bonus
+            {
+                std::vector<uint32_t> offset;   /// The offset of each of the first profile's columns.
+                std::vector<uint32_t> column;   /// The second profile's column of each entry.
+                std::vector<score> value;       /// The bonus of matching both entry's columns.
+            };
+
+            /**
+             * Aligns two profiles with the Myers-Miller divide-and-conquer algorithm.
+             * The score of aligning two columns is the average score of all pairs of
+             * symbols between them, and aligning a column to a gap costs its residues'
+             * penalties. Only a pair of score lines, as long as the second profile,
+             * are ever needed, so memory grows only linearly with the profiles' lengths.
+             * @since 0.1.1
+             */
+            class aligner
+            {
+                public:
+                    /**
+                     * The edition operations produced by the alignment. As the first
+                     * profile's columns are laid along the lines, a gap inserted into
+                     * the second profile is called a deletion, and an insertion otherwise.
+                     * @since 0.1.1
+                     */
+                    enum operation : uint8_t { match = 0, deletion = 1, insertion = 2 };
+
+                protected:
+                    const profile& m_one;                   /// The first profile, along the lines.
+                    const profile& m_two;                   /// The second profile, along the columns.
+                    std::vector<score> m_weight;            /// The second profile's columns weighted by the table.
+                    std::vector<score> m_forward;           /// The forward score line.
+                    std::vector<score> m_reverse;           /// The reverse score line.
+                    std::vector<operation> m_script;        /// The alignment's edition script.
+                    const bonus *m_bonus = nullptr;         /// The columns' consistency bonus, if any.
+                    std::vector<score> m_extra;             /// The current line's dense bonus.
+
+                public:
+                    aligner(const profile&, const profile&, const pairwise::scoring_table&, const bonus * = nullptr);
+                    virtual ~aligner() = default;
+
+                    aligner(const aligner&) = delete;
+                    aligner& operator=(const aligner&) = delete;
+
+                    auto run(const std::vector<anchor>& = {}) -> const std::vector<operation>&;
+                    auto evaluate(const std::vector<operation>&) const -> score;
+
+                protected:
+                    /**
+                     * Scores the alignment between a column of each profile.
+                     * @param i The first profile's column.
+                     * @param j The second profile's column.
+                     * @return The columns' alignment score.
+                     */
+                    inline auto pair(size_t i, size_t j) const noexcept -> score
+                    {
+                        const score *weight = m_weight.data() + j * alphabet;
+                        score value = m_one.gaps[i] * m_two.penalty[j];
+
+                        for(uint32_t e = m_one.offset[i]; e < m_one.offset[i + 1]; ++e)
+                            value += m_one.entries[e].value * weight[m_one.entries[e].unit];
+
+                        return value;
+                    }
+
+                    /**
+                     * Looks the consistency bonus of matching two columns up.
+                     * @param i The first profile's column.
+                     * @param j The second profile's column.
+                     * @return The columns' consistency bonus.
+                     */
+                    inline auto extra(size_t i, size_t j) const noexcept -> score
+                    {
+                        if(!m_bonus) return 0;
+
+                        const auto begin = m_bonus->column.begin();
+                        const auto it = std::lower_bound(begin + m_bonus->offset[i], begin + m_bonus->offset[i + 1], j);
+
+                        return it != begin + m_bonus->offset[i + 1] && *it == j ? m_bonus->value[it - begin] : 0;
+                    }
+
+                    /**
+                     * Lays out, or clears, the consistency bonus of a line of the
+                     * first profile along the second profile's columns.
+                     * @param i The first profile's column.
+                     * @param clear Must the line's bonus be cleared instead?
+                     */
+                    inline void scatter(size_t i, bool clear = false) noexcept
+                    {
+                        if(m_bonus)
+                            for(uint32_t e = m_bonus->offset[i]; e < m_bonus->offset[i + 1]; ++e)
+                                m_extra[m_bonus->column[e]] = clear ? 0 : m_bonus->value[e];
+                    }
+
+                    virtual void forward(size_t, size_t, size_t, size_t);
+                    virtual void reverse(size_t, size_t, size_t, size_t);
+
+                    void single(size_t, size_t, size_t);
+                    void divide(size_t, size_t, size_t, size_t);
+            };
+
+            extern auto make_profile(const alignment&, const pairwise::scoring_table&) -> profile;
+            extern auto make_bonus(
+                    const alignment&
+                ,   const alignment&
+                ,   const pairwise::consistency::library&
+                ,   const pairwise::scoring_table&
+                ) -> bonus;
+
+            extern auto anchors(const alignment&, const alignment&) -> std::vector<anchor>;
+            extern void expand(alignment&, alignment&, const std::vector<aligner::operation>&);
+        }
+    }
+}
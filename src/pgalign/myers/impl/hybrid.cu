@@ -0,0 +1,535 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Hybrid implementation for the profile-aligner module's myers-miller algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include "cuda.cuh"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "encoder.hpp"
+#include "pointer.hpp"
+#include "trace.hpp"
+#include "pairwise.cuh"
+
+#include "pgalign/pgalign.cuh"
+#include "pgalign/sequence.cuh"
+#include "pgalign/alignment.cuh"
+#include "pgalign/myers/myers.cuh"
+#include "pgalign/myers/aligner.hpp"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pgalign;
+
+    using myers::alphabet;
+
+    /*
+     * Algorithm configuration parameters. Each tile of the score matrix is computed
+     * by a block with as many threads as the tile's height. Blocks of the score
+     * matrix smaller than the device threshold are computed by the host instead.
+     */
+    enum : int { tile_height = cuda::warp_size * 4 };
+    enum : int { tile_width = cuda::warp_size * 4 };
+    enum : int { block_threads = cuda::warp_size * 8 };
+    enum : size_t { device_threshold = 1 << 22 };
+
+    /**
+     * The type of the columns' indeces within the sequences.
+     * @since 0.1.1
+     */
+    using index_type = pgalign::sequence::index_type;
+
+    /**
+     * Groups the device-side dense profiles of both groups being merged. The first
+     * profile's columns are kept as frequency vectors, while the second's columns
+     * are kept already weighted by the scoring table, so a pair of columns can be
+     * scored by a single dot product between these vectors.
+     * @since 0.1.1
+     */
+    struct input
+    {
+        buffer<score> frequency;        /// The first profile's columns' frequency vectors.
+        buffer<score> gaps;             /// The first profile's columns' gap frequencies.
+        buffer<score> penalty;          /// The first profile's columns' gap penalties.
+        buffer<score> weight;           /// The second profile's weighted columns.
+        buffer<score> other;            /// The second profile's columns' gap penalties.
+    };
+
+    /**
+     * The borders between the score matrix's tiles. The top border holds the last
+     * line computed for every column, and the left border holds, for every strip
+     * of the matrix's lines, the last column computed for each of its lines, right
+     * after the value of the line above the strip on the same column.
+     * @since 0.1.1
+     */
+    struct border
+    {
+        buffer<score> top;              /// The tiles' top border line.
+        buffer<score> left;             /// The tiles' left border columns.
+    };
+
+    /**
+     * Identifies the block of the score matrix to be computed. When reversed, the
+     * block's lines and columns are walked from their ends towards their starts.
+     * @since 0.1.1
+     */
+    struct window
+    {
+        int a0, a1;                     /// The first profile's block range.
+        int b0, b1;                     /// The second profile's block range.
+        bool reversed;                  /// Is the block walked backwards?
+    };
+
+    /**
+     * Counts the residues of a group of sequences into its profile's columns. Each
+     * residue adds up to its column's frequency vector with the given weight.
+     * @param columns The column of each of the group's residues.
+     * @param units The group's residues.
+     * @param frequency The profile's columns' frequency vectors.
+     * @param weight The frequency of a single residue on a column.
+     */
+    __global__ void count_kernel(
+            buffer<index_type> columns
+        ,   buffer<encoder::unit> units
+        ,   buffer<score> frequency
+        ,   score weight
+        )
+    {
+        for(size_t k = blockIdx.x * blockDim.x + threadIdx.x; k < units.size(); k += gridDim.x * blockDim.x)
+            if(units[k] < alphabet)
+                atomicAdd(&frequency[columns[k] * alphabet + units[k]], weight);
+    }
+
+    /**
+     * Finds the gap frequency and gap penalty of each of a profile's columns.
+     * @param frequency The profile's columns' frequency vectors.
+     * @param gaps The profile's columns' gap frequencies.
+     * @param penalty The profile's columns' gap penalties.
+     * @param table The scoring table to align the profiles with.
+     */
+    __global__ void gaps_kernel(
+            buffer<score> frequency
+        ,   buffer<score> gaps
+        ,   buffer<score> penalty
+        ,   const pairwise::scoring_table table
+        )
+    {
+        for(size_t c = blockIdx.x * blockDim.x + threadIdx.x; c < gaps.size(); c += gridDim.x * blockDim.x) {
+            score residues = 0;
+
+            #pragma unroll
+            for(int u = 0; u < alphabet; ++u)
+                residues += frequency[c * alphabet + u];
+
+            gaps[c] = utils::max(score(1) - residues, score(0));
+            penalty[c] = -table.penalty() * (1 - gaps[c]);
+        }
+    }
+
+    /**
+     * Weights each of a profile's columns by the scoring table, into the score of
+     * aligning the column to each possible unit. This is a product between the
+     * profile's frequency matrix and the scoring table.
+     * @param frequency The profile's columns' frequency vectors.
+     * @param gaps The profile's columns' gap frequencies.
+     * @param weight The profile's weighted columns.
+     * @param table The scoring table to align the profiles with.
+     */
+    __global__ void weight_kernel(
+            buffer<score> frequency
+        ,   buffer<score> gaps
+        ,   buffer<score> weight
+        ,   const pairwise::scoring_table table
+        )
+    {
+        __shared__ pairwise::scoring_table::raw_type mem_table;
+        __shared__ pairwise::scoring_table shared_table;
+
+        new (&shared_table) pairwise::scoring_table {pointer<decltype(mem_table)>::weak(&mem_table), table};
+
+        for(size_t k = blockIdx.x * blockDim.x + threadIdx.x; k < weight.size(); k += gridDim.x * blockDim.x) {
+            const size_t c = k / alphabet;
+            const auto row = shared_table.row(encoder::unit(k % alphabet));
+
+            score value = -shared_table.penalty() * gaps[c];
+
+            #pragma unroll
+            for(int v = 0; v < alphabet; ++v)
+                value += frequency[c * alphabet + v] * row[v];
+
+            weight[k] = value;
+        }
+    }
+
+    /**
+     * Computes one tile on each of the score matrix's tiles anti-diagonal. As the
+     * tiles on an anti-diagonal only depend on the tiles on the previous one, they
+     * can all be computed at once. Within a tile, each thread walks a line of the
+     * tile, one column behind the thread above it, so at every step the threads
+     * sweep the tile's anti-diagonals, passing values down through shared memory.
+     * @param in The device-side profiles being aligned.
+     * @param edge The tiles' borders.
+     * @param block The score matrix's block being computed.
+     * @param diagonal The tiles' anti-diagonal to be computed.
+     * @param first The first strip with a tile on the anti-diagonal.
+     */
+    __launch_bounds__(tile_height)
+    __global__ void tile_kernel(input in, border edge, window block, int diagonal, int first)
+    {
+        __shared__ score top[tile_width];
+        __shared__ score penalty[tile_width];
+        __shared__ score weight[tile_width][alphabet];
+        __shared__ score exchange[2][tile_height];
+
+        const int strip = first + blockIdx.x;
+        const int slice = diagonal - strip;
+        const int line = threadIdx.x;
+
+        const int height = utils::min((int) tile_height, block.a1 - block.a0 - strip * tile_height);
+        const int width = utils::min((int) tile_width, block.b1 - block.b0 - slice * tile_width);
+        const int offset = slice * tile_width + 1;
+
+        // The second profile's columns within the tile are loaded into shared
+        // memory, as every thread will need all of them while walking its line.
+        for(int k = line; k < width * alphabet; k += blockDim.x) {
+            const int q = offset + k / alphabet;
+            const int j = block.reversed ? block.b1 - q : block.b0 + q - 1;
+            weight[k / alphabet][k % alphabet] = in.weight[j * alphabet + k % alphabet];
+        }
+
+        for(int k = line; k < width; k += blockDim.x) {
+            const int q = offset + k;
+            const int j = block.reversed ? block.b1 - q : block.b0 + q - 1;
+            top[k] = edge.top[q];
+            penalty[k] = in.other[j];
+        }
+
+        score freq[alphabet];
+        score gap = 0, own = 0, left = 0, done = 0, value = 0;
+
+        const size_t base = size_t(strip) * (tile_height + 1);
+
+        if(line < height) {
+            const int row = strip * tile_height + line;
+            const int i = block.reversed ? block.a1 - 1 - row : block.a0 + row;
+
+            #pragma unroll
+            for(int u = 0; u < alphabet; ++u)
+                freq[u] = in.frequency[i * alphabet + u];
+
+            gap  = in.gaps[i];
+            own  = in.penalty[i];
+            done = edge.left[base + line];
+            left = edge.left[base + line + 1];
+        }
+
+        __syncthreads();
+
+        for(int step = 0; step < width + height - 1; ++step) {
+            const int k = step - line;
+
+            if(line < height && 0 <= k && k < width) {
+                const score above = line ? exchange[(step - 1) & 1][line - 1] : top[k];
+                score matched = done + gap * penalty[k];
+
+                #pragma unroll
+                for(int u = 0; u < alphabet; ++u)
+                    matched += freq[u] * weight[k][u];
+
+                value = utils::max(matched, utils::max(above + own, left + penalty[k]));
+                exchange[step & 1][line] = value;
+
+                done = above;
+                left = value;
+
+                if(line == height - 1)
+                    edge.top[offset + k] = value;
+            }
+
+            __syncthreads();
+        }
+
+        // The tile's last column becomes the next tile's left border, and the
+        // top border's value on the tile's last column becomes its corner.
+        if(line < height)
+            edge.left[base + line + 1] = left;
+
+        if(line == 0)
+            edge.left[base] = top[width - 1];
+    }
+
+    /**
+     * Collects the residues of a group of sequences and their columns, and counts
+     * them into a device-side dense profile.
+     * @param group The group of aligned sequences.
+     * @param frequency The profile's columns' frequency vectors.
+     * @param gaps The profile's columns' gap frequencies.
+     * @param penalty The profile's columns' gap penalties.
+     * @param table The device-side scoring table.
+     * @param stream The stream to launch the kernels into.
+     */
+    static void upload(
+            const alignment& group
+        ,   buffer<score>& frequency
+        ,   buffer<score>& gaps
+        ,   buffer<score>& penalty
+        ,   const pairwise::scoring_table& table
+        ,   const cuda::stream& stream
+        )
+    {
+        const size_t length = group[0].length();
+
+        std::vector<index_type> columns;
+        std::vector<encoder::unit> units;
+
+        for(size_t s = 0; s < group.count(); ++s) {
+            const auto& current = group[s];
+            const size_t residues = current.residues();
+            const size_t done = units.size();
+
+            units.resize(done + residues + encoder::block_size);
+            current.unpack(units.data() + done);
+            units.resize(done + residues);
+
+            columns.resize(done + residues);
+            current.columns(columns.data() + done);
+        }
+
+        auto dcolumns = buffer<index_type>::make(cuda::allocator::device, columns.size());
+        auto dunits = buffer<encoder::unit>::make(cuda::allocator::device, units.size());
+
+        frequency = buffer<score>::make(cuda::allocator::device, length * alphabet);
+        gaps = buffer<score>::make(cuda::allocator::device, length);
+        penalty = buffer<score>::make(cuda::allocator::device, length);
+
+        cuda::memory::copy(dcolumns.raw(), columns.data(), columns.size(), stream);
+        cuda::memory::copy(dunits.raw(), units.data(), units.size(), stream);
+        cuda::check(cudaMemsetAsync(frequency.raw(), 0, sizeof(score) * frequency.size(), stream));
+
+        const score weight = score(1) / group.count();
+        trace::kernel span {"myers::upload", stream};
+
+        count_kernel<<<cuda::device::blocks((units.size() + block_threads - 1) / block_threads), block_threads, 0, stream>>>(
+                dcolumns, dunits, frequency, weight
+            );
+
+        gaps_kernel<<<cuda::device::blocks((length + block_threads - 1) / block_threads), block_threads, 0, stream>>>(
+                frequency, gaps, penalty, table
+            );
+
+        // The host-side staging vectors must outlive the asynchronous copies.
+        stream.barrier();
+    }
+
+    /**
+     * Aligns two profiles with the Myers-Miller algorithm, with the score lines
+     * of the recursion's larger blocks computed by the device. The smaller blocks
+     * are left for the host, as they are too small to pay off a kernel launch.
+     * @since 0.1.1
+     */
+    class device_aligner : public myers::aligner
+    {
+        protected:
+            cuda::stream m_stream;                  /// The stream to which the kernels are sent.
+            input m_input;                          /// The device-side profiles.
+            border m_edge;                          /// The score matrix's tiles' borders.
+
+        public:
+            /**
+             * Prepares the alignment of two groups of sequences on the device. Both
+             * groups' dense profiles are built on the device from their residues.
+             * @param one The first group of aligned sequences.
+             * @param two The second group of aligned sequences.
+             * @param first The first group's host-side profile.
+             * @param second The second group's host-side profile.
+             * @param table The scoring table to align the profiles with.
+             */
+            inline device_aligner(
+                    const alignment& one
+                ,   const alignment& two
+                ,   const myers::profile& first
+                ,   const myers::profile& second
+                ,   const pairwise::scoring_table& table
+                )
+            :   myers::aligner {first, second, table}
+            ,   m_stream {cudaStreamNonBlocking}
+            {
+                const auto device_table = table.to_device();
+                buffer<score> frequency, gaps;
+
+                ::upload(one, m_input.frequency, m_input.gaps, m_input.penalty, device_table, m_stream);
+                ::upload(two, frequency, gaps, m_input.other, device_table, m_stream);
+
+                m_input.weight = buffer<score>::make(cuda::allocator::device, second.length * alphabet);
+
+                weight_kernel<<<cuda::device::blocks((m_input.weight.size() + block_threads - 1) / block_threads), block_threads, 0, m_stream>>>(
+                        frequency, gaps, m_input.weight, device_table
+                    );
+
+                const size_t strips = (first.length + tile_height - 1) / tile_height;
+
+                m_edge.top = buffer<score>::make(cuda::allocator::device, second.length + 1);
+                m_edge.left = buffer<score>::make(cuda::allocator::device, strips * (tile_height + 1));
+
+                m_stream.barrier();
+            }
+
+        protected:
+            /**
+             * Calculates the last line of scores for aligning a block of the first
+             * profile's columns against all prefixes of a block of the second's.
+             * @param a0 The first profile's block start.
+             * @param a1 The first profile's block end.
+             * @param b0 The second profile's block start.
+             * @param b1 The second profile's block end.
+             */
+            void forward(size_t a0, size_t a1, size_t b0, size_t b1) override
+            {
+                if((a1 - a0) * (b1 - b0) < device_threshold)
+                    return myers::aligner::forward(a0, a1, b0, b1);
+
+                const auto line = launch({int(a0), int(a1), int(b0), int(b1), false});
+
+                for(size_t q = 0; q <= b1 - b0; ++q)
+                    m_forward[q] = line[q];
+            }
+
+            /**
+             * Calculates the first line of scores for aligning a block of the first
+             * profile's columns against all suffixes of a block of the second's.
+             * @param a0 The first profile's block start.
+             * @param a1 The first profile's block end.
+             * @param b0 The second profile's block start.
+             * @param b1 The second profile's block end.
+             */
+            void reverse(size_t a0, size_t a1, size_t b0, size_t b1) override
+            {
+                if((a1 - a0) * (b1 - b0) < device_threshold)
+                    return myers::aligner::reverse(a0, a1, b0, b1);
+
+                const auto line = launch({int(a0), int(a1), int(b0), int(b1), true});
+
+                for(size_t q = 0; q <= b1 - b0; ++q)
+                    m_reverse[b1 - b0 - q] = line[q];
+            }
+
+            /**
+             * Computes a block of the score matrix on the device, tile anti-diagonal
+             * by tile anti-diagonal. The borders are initialized with the scores of
+             * aligning the block's lines and columns only to gaps.
+             * @param block The score matrix's block to be computed.
+             * @return The block's last line of scores, in the block's walking order.
+             */
+            auto launch(const window& block) -> std::vector<score>
+            {
+                const int rows = block.a1 - block.a0;
+                const int cols = block.b1 - block.b0;
+                const int strips = (rows + tile_height - 1) / tile_height;
+                const int slices = (cols + tile_width - 1) / tile_width;
+
+                std::vector<score> top (cols + 1, 0);
+                std::vector<score> left (size_t(strips) * (tile_height + 1), 0);
+                std::vector<score> prefix (rows + 1, 0);
+
+                for(int q = 1; q <= cols; ++q)
+                    top[q] = top[q - 1] + m_two.penalty[block.reversed ? block.b1 - q : block.b0 + q - 1];
+
+                for(int r = 1; r <= rows; ++r)
+                    prefix[r] = prefix[r - 1] + m_one.penalty[block.reversed ? block.a1 - r : block.a0 + r - 1];
+
+                for(int s = 0; s < strips; ++s)
+                    for(int k = 0; k <= tile_height; ++k)
+                        left[size_t(s) * (tile_height + 1) + k] = prefix[utils::min(s * (int) tile_height + k, rows)];
+
+                cuda::memory::copy(m_edge.top.raw(), top.data(), top.size(), m_stream);
+                cuda::memory::copy(m_edge.left.raw(), left.data(), left.size(), m_stream);
+
+                {
+                    trace::kernel span {"myers::tile_kernel", m_stream};
+
+                    for(int d = 0; d < strips + slices - 1; ++d) {
+                        const int first = utils::max(0, d - slices + 1);
+                        const int last = utils::min(d, strips - 1);
+                        tile_kernel<<<last - first + 1, tile_height, 0, m_stream>>>(m_input, m_edge, block, d, first);
+                    }
+                }
+
+                cuda::memory::copy(top.data(), m_edge.top.raw(), top.size(), m_stream);
+                m_stream.barrier();
+
+                top[0] = prefix[rows];
+                return top;
+            }
+    };
+
+    /**
+     * Merges two groups of aligned sequences into a single alignment. Merges are
+     * handed to the node's devices in turns, so concurrent merges from different
+     * host threads are spread among all devices. The smallest merges, mostly on
+     * the guide tree's lower levels, are left entirely to the host, as are all
+     * merges scored by a consistency library, which the devices know nothing of.
+     * @param one The first group of aligned sequences.
+     * @param two The second group of aligned sequences.
+     * @param ctx The algorithm's context.
+     */
+    static void merge(alignment& one, alignment& two, const context& ctx)
+    {
+        static std::atomic<size_t> turn {0};
+
+        const auto& table = ctx.table;
+        const auto first = myers::make_profile(one, table);
+        const auto second = myers::make_profile(two, table);
+
+        if(ctx.library || first.length * second.length < device_threshold) {
+            const auto bonus = ctx.library
+                ? myers::make_bonus(one, two, *ctx.library, table)
+                : myers::bonus {};
+
+            myers::aligner worker {first, second, table, ctx.library ? &bonus : nullptr};
+            return myers::expand(one, two, worker.run(myers::anchors(one, two)));
+        }
+
+        cuda::device::select(cuda::device::id(turn++ % cuda::device::count()));
+
+        device_aligner worker {one, two, first, second, table};
+        myers::expand(one, two, worker.run(myers::anchors(one, two)));
+    }
+
+    /**
+     * The hybrid myers-miller algorithm object. This algorithm uses the node's
+     * GPU devices to compute the score lines of the larger merges.
+     * @since 0.1.1
+     */
+    struct hybrid : public myers::algorithm
+    {
+        /**
+         * Executes the hybrid myers-miller algorithm for the profile-aligner step.
+         * Independent merges are scheduled among the cluster's nodes and host
+         * threads, and each host thread forwards its merge to a device.
+         * @param context The algorithm's context.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> alignment override
+        {
+            return this->schedule(ctx, merge);
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Instantiates a new hybrid myers-miller algorithm instance.
+     * @return The new algorithm instance.
+     */
+    extern auto pgalign::myers::hybrid() -> pgalign::algorithm *
+    {
+        return new ::hybrid;
+    }
+}
@@ -4,14 +4,41 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2020-present Rodrigo Siqueira
  */
+#include "pairwise.cuh"
+
 #include "pgalign/pgalign.cuh"
+#include "pgalign/alignment.cuh"
 #include "pgalign/myers/myers.cuh"
+#include "pgalign/myers/aligner.hpp"
 
 namespace
 {
     using namespace museqa;
     using namespace pgalign;
 
+    /**
+     * Merges two groups of aligned sequences into a single alignment. The groups'
+     * profiles are aligned between their anchors, if long enough to have any, and
+     * then gaps are inserted into every sequence by simply merging new runs of
+     * gaps into their own, never copying any residue. If a consistency library
+     * is given, the profiles' columns are also scored by its matches.
+     * @param one The first group of aligned sequences.
+     * @param two The second group of aligned sequences.
+     * @param ctx The algorithm's context.
+     */
+    static void merge(alignment& one, alignment& two, const context& ctx)
+    {
+        const auto first = myers::make_profile(one, ctx.table);
+        const auto second = myers::make_profile(two, ctx.table);
+
+        const auto bonus = ctx.library
+            ? myers::make_bonus(one, two, *ctx.library, ctx.table)
+            : myers::bonus {};
+
+        myers::aligner worker {first, second, ctx.table, ctx.library ? &bonus : nullptr};
+        myers::expand(one, two, worker.run(myers::anchors(one, two)));
+    }
+
     /**
      * The sequential myers-miller algorithm object. This algorithm uses no GPU
      * devices parallelism whatsoever.
@@ -21,14 +48,14 @@ namespace
     {
         /**
          * Executes the sequential myers-miller algorithm for the profile-aligner
-         * step. This method is responsible for distributing and gathering workload
-         * from different cluster nodes.
+         * step. Each merge is done by a single host thread, but independent
+         * merges are scheduled among the cluster's nodes and host threads.
          * @param context The algorithm's context.
          * @return The module's result value.
          */
         auto run(const context& ctx) const -> alignment override
         {
-            return alignment {};
+            return this->schedule(ctx, merge);
         }
     };
 }
@@ -0,0 +1,400 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the profile-aligner module's myers-miller algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <queue>
+#include <tuple>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+#include "mpi.hpp"
+#include "node.hpp"
+#include "museqa.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "parallel.hpp"
+#include "exception.hpp"
+#include "phylogeny.cuh"
+
+#include "pgalign/pgalign.cuh"
+#include "pgalign/sequence.cuh"
+#include "pgalign/alignment.cuh"
+#include "pgalign/myers/myers.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace pgalign;
+
+    /*
+     * Tree scheduler configuration parameters. The guide tree is split into about
+     * as many subtrees as the given factor times the number of slave nodes, so
+     * the subtrees can be evenly distributed even if their costs are uneven.
+     */
+    enum : size_t { subtree_factor = 4 };
+
+    #if !defined(__museqa_runtime_cython)
+        enum : mpi::tag { runs_tag = 0x6d };
+    #endif
+
+    /**
+     * The type of the columns' indeces within the sequences.
+     * @since 0.1.1
+     */
+    using index_type = pgalign::sequence::index_type;
+
+    /**
+     * Lays out the sequences on the alignment according to the guide tree. Every
+     * subtree takes up a contiguous slice of the alignment, so the subtrees can
+     * be merged in place. The cost of merging each subtree is estimated as well.
+     * @since 0.1.1
+     */
+    struct layout
+    {
+        std::vector<size_t> offset;         /// The offset of each node's slice.
+        std::vector<size_t> size;           /// The number of sequences in each node's slice.
+        std::vector<size_t> order;          /// The sequence placed on each of the alignment's slots.
+        std::vector<double> width;          /// The estimated number of columns of each node's profile.
+        std::vector<double> cost;           /// The estimated cost of merging each node's subtree.
+    };
+
+    /**
+     * Lays out the alignment on the guide tree. As a node's children always have
+     * lower references than itself, the nodes can simply be visited in order.
+     * @param ctx The algorithm's context.
+     * @return The alignment's layout.
+     */
+    static auto arrange(const context& ctx) -> layout
+    {
+        const size_t leaves = ctx.count;
+        const size_t nodes = 2 * leaves - 1;
+
+        layout result;
+
+        result.offset.resize(nodes, 0);
+        result.size.resize(nodes, 1);
+        result.order.resize(leaves);
+        result.width.resize(nodes, 0);
+        result.cost.resize(nodes, 0);
+
+        for(size_t i = 0; i < leaves; ++i)
+            result.width[i] = double(ctx.db[i].contents.length());
+
+        for(size_t p = leaves; p < nodes; ++p) {
+            const auto one = ctx.tree[p].child[0];
+            const auto two = ctx.tree[p].child[1];
+
+            result.size[p] = result.size[one] + result.size[two];
+            result.width[p] = utils::max(result.width[one], result.width[two]);
+            result.cost[p] = result.cost[one] + result.cost[two] + result.width[one] * result.width[two];
+        }
+
+        for(size_t p = nodes - 1; p >= leaves; --p) {
+            result.offset[ctx.tree[p].child[0]] = result.offset[p];
+            result.offset[ctx.tree[p].child[1]] = result.offset[p] + result.size[ctx.tree[p].child[0]];
+        }
+
+        for(size_t i = 0; i < leaves; ++i)
+            result.order[result.offset[i]] = i;
+
+        return result;
+    }
+
+    /**
+     * Places a slice of the database's sequences onto the alignment, without
+     * any gaps, so they are ready to be merged.
+     * @param ctx The algorithm's context.
+     * @param plan The alignment's layout.
+     * @param target The alignment to place the sequences on.
+     * @param slot The first alignment slot to be filled.
+     * @param total The number of alignment slots to be filled.
+     */
+    static void place(const context& ctx, const layout& plan, alignment& target, size_t slot, size_t total)
+    {
+        for(size_t k = slot; k < slot + total; ++k)
+            target[k] = pgalign::sequence {ctx.db[plan.order[k]].contents};
+    }
+
+    /**
+     * Merges a set of the guide tree's inner nodes, level by level. The nodes on
+     * the same level never depend on each other, as a merge only ever depends on
+     * the nodes below it, thus each level's nodes are handed to the host threads
+     * on demand, from the costliest to the cheapest.
+     * @param ctx The algorithm's context.
+     * @param plan The alignment's layout.
+     * @param target The alignment to merge the nodes' sequences on.
+     * @param nodes The inner nodes to be merged.
+     * @param fn The function responsible for merging the nodes' children.
+     */
+    static void execute(
+            const context& ctx
+        ,   const layout& plan
+        ,   alignment& target
+        ,   std::vector<phylogeny::oturef> nodes
+        ,   const myers::merger& fn
+        )
+    {
+        std::sort(nodes.begin(), nodes.end(), [&](phylogeny::oturef a, phylogeny::oturef b) {
+            return std::make_tuple(ctx.tree[a].level, plan.cost[b], a)
+                 < std::make_tuple(ctx.tree[b].level, plan.cost[a], b);
+        });
+
+        std::vector<alignment> slices (2 * nodes.size());
+
+        // The slices share their reference counter with the whole alignment, and
+        // thus must all be created and destroyed on the calling thread alone.
+        for(size_t i = 0; i < nodes.size(); ++i)
+            for(size_t k = 0; k < 2; ++k) {
+                const auto child = ctx.tree[nodes[i]].child[k];
+                slices[2 * i + k] = target.slice(plan.offset[child], plan.size[child]);
+            }
+
+        for(size_t first = 0, last = 0; first < nodes.size(); first = last) {
+            while(last < nodes.size() && ctx.tree[nodes[last]].level == ctx.tree[nodes[first]].level)
+                ++last;
+
+            std::atomic<size_t> next {first};
+
+            auto work = [&](size_t) {
+                for(size_t i; (i = next++) < last; )
+                    fn(slices[2 * i], slices[2 * i + 1], ctx);
+            };
+
+            if(last - first > 1) parallel::global().run(work);
+            else work(0);
+        }
+    }
+
+    /**
+     * Collects all inner nodes within a subtree of the guide tree.
+     * @param ctx The algorithm's context.
+     * @param root The subtree's root node.
+     * @param nodes The list to append the subtree's inner nodes to.
+     */
+    static void collect(const context& ctx, phylogeny::oturef root, std::vector<phylogeny::oturef>& nodes)
+    {
+        auto stack = std::vector<phylogeny::oturef> {root};
+
+        while(!stack.empty()) {
+            const auto ref = stack.back();
+            stack.pop_back();
+
+            if(ref >= ctx.count) {
+                nodes.push_back(ref);
+                stack.push_back(ctx.tree[ref].child[0]);
+                stack.push_back(ctx.tree[ref].child[1]);
+            }
+        }
+    }
+
+    /**
+     * Splits the guide tree into independent subtrees, and distributes them among
+     * the slave nodes. The costliest subtree is repeatedly split into its children,
+     * and the subtrees are then greedily handed to the least busy slave. As the
+     * split only depends on the tree, all nodes find the same distribution.
+     * @param ctx The algorithm's context.
+     * @param plan The alignment's layout.
+     * @param workers The number of slave nodes to distribute the subtrees to.
+     * @return The subtrees' roots assigned to each slave.
+     */
+    static auto distribute(const context& ctx, const layout& plan, size_t workers)
+    -> std::vector<std::vector<phylogeny::oturef>>
+    {
+        using entry = std::pair<double, phylogeny::oturef>;
+
+        auto result = std::vector<std::vector<phylogeny::oturef>> (workers);
+        auto frontier = std::priority_queue<entry> {};
+
+        frontier.push({plan.cost[plan.cost.size() - 1], phylogeny::oturef(plan.cost.size() - 1)});
+
+        while(frontier.size() < workers * subtree_factor && frontier.top().second >= ctx.count) {
+            const auto ref = frontier.top().second;
+            frontier.pop();
+
+            for(size_t k = 0; k < 2; ++k)
+                frontier.push({plan.cost[ctx.tree[ref].child[k]], ctx.tree[ref].child[k]});
+        }
+
+        using load = std::pair<double, size_t>;
+        auto busy = std::priority_queue<load, std::vector<load>, std::greater<load>> {};
+
+        for(size_t w = 0; w < workers; ++w)
+            busy.push({0., w});
+
+        for(; !frontier.empty(); frontier.pop()) {
+            auto least = busy.top();
+            busy.pop();
+
+            result[least.second].push_back(frontier.top().second);
+            busy.push({least.first + frontier.top().first, least.second});
+        }
+
+        return result;
+    }
+
+    /**#@+
+     * Packs or unpacks the gap runs of all sequences within a set of subtrees,
+     * so they can be transferred between nodes. As every node has access to the
+     * database, each sequence's residues themselves need not be transferred, and
+     * each sequence is thus packed as its number of runs followed by the runs.
+     * @param plan The alignment's layout.
+     * @param target The alignment to pack the sequences' runs from or into.
+     * @param roots The subtrees' roots.
+     */
+    static auto pack(const layout& plan, alignment& target, const std::vector<phylogeny::oturef>& roots)
+    -> std::vector<index_type>
+    {
+        std::vector<index_type> result;
+
+        for(const auto root : roots)
+            for(size_t k = plan.offset[root]; k < plan.offset[root] + plan.size[root]; ++k) {
+                const auto& runs = target[k].runs();
+                result.push_back((index_type) runs.size());
+
+                for(const auto& current : runs) {
+                    result.push_back(current.position);
+                    result.push_back(current.total);
+                }
+            }
+
+        return result;
+    }
+
+    static void unpack(
+            const layout& plan
+        ,   alignment& target
+        ,   const std::vector<phylogeny::oturef>& roots
+        ,   const buffer<index_type>& packed
+        )
+    {
+        std::vector<pgalign::sequence::run> runs;
+        size_t consumed = 0;
+
+        for(const auto root : roots)
+            for(size_t k = plan.offset[root]; k < plan.offset[root] + plan.size[root]; ++k) {
+                enforce(consumed < packed.size(), "unexpected number of runs received");
+                const size_t count = packed[consumed++];
+
+                enforce(consumed + count * 2 <= packed.size(), "unexpected number of runs received");
+                runs.resize(count);
+
+                for(size_t g = 0; g < count; ++g, consumed += 2)
+                    runs[g] = {packed[consumed], packed[consumed + 1]};
+
+                target[k].assign(runs.data(), count);
+            }
+
+        enforce(consumed == packed.size(), "unexpected number of runs received");
+    }
+    /**#@-*/
+}
+
+namespace museqa
+{
+    namespace pgalign
+    {
+        namespace myers
+        {
+            /**
+             * Schedules the guide tree's merges among the cluster's nodes and the
+             * host threads. Independent subtrees are merged by the slave nodes, and
+             * their sequences' gap runs are then sent to the master node, where the
+             * remaining nodes are merged. On every node, the nodes on each level of
+             * the tree are merged in parallel, as they do not depend on each other.
+             * @param ctx The algorithm's context.
+             * @param fn The function responsible for merging two groups of sequences.
+             * @return The multiple sequence alignment, on the master node.
+             */
+            auto algorithm::schedule(const context& ctx, const merger& fn) const -> alignment
+            {
+                if(ctx.count == 0)
+                    return alignment {};
+
+                const auto plan = ::arrange(ctx);
+                const size_t workers = size_t(node::count - 1);
+
+                auto origin = buffer<uint32_t>::make(ctx.count);
+
+                for(size_t k = 0; k < ctx.count; ++k)
+                    origin[k] = (uint32_t) plan.order[k];
+
+                alignment result {buffer<pgalign::sequence>::make(ctx.count), origin};
+
+                auto assigned = workers > 0 && ctx.count > 1
+                    ? ::distribute(ctx, plan, workers)
+                    : std::vector<std::vector<phylogeny::oturef>> {};
+
+                std::vector<phylogeny::oturef> remaining;
+
+                #if !defined(__museqa_runtime_cython)
+                    onlyslaves {
+                        if(!assigned.empty()) {
+                            const auto& roots = assigned[node::rank - 1];
+
+                            for(const auto root : roots) {
+                                ::place(ctx, plan, result, plan.offset[root], plan.size[root]);
+                                ::collect(ctx, root, remaining);
+                            }
+
+                            ::execute(ctx, plan, result, remaining, fn);
+
+                            auto runs = ::pack(plan, result, roots);
+                            mpi::send(runs, node::master, runs_tag);
+                        }
+
+                        return alignment {};
+                    }
+                #endif
+
+                ::place(ctx, plan, result, 0, ctx.count);
+
+                std::vector<bool> covered (plan.cost.size(), false);
+
+                for(const auto& roots : assigned)
+                    for(const auto root : roots)
+                        covered[root] = true;
+
+                for(size_t p = plan.cost.size(); p-- > ctx.count; ) {
+                    covered[ctx.tree[p].child[0]] = covered[ctx.tree[p].child[0]] || covered[p];
+                    covered[ctx.tree[p].child[1]] = covered[ctx.tree[p].child[1]] || covered[p];
+                    if(!covered[p]) remaining.push_back(phylogeny::oturef(p));
+                }
+
+                #if !defined(__museqa_runtime_cython)
+                    for(size_t w = 0; w < assigned.size(); ++w) {
+                        auto runs = mpi::receive<index_type>(node::id(w + 1), runs_tag);
+                        ::unpack(plan, result, assigned[w], runs);
+                    }
+                #endif
+
+                ::execute(ctx, plan, result, remaining, fn);
+
+                return result;
+            }
+
+            /**
+             * Picks the default myers-miller algorithm instance according to the
+             * execution's global state conditions and devices availability.
+             * @return The picked algorithm instance.
+             */
+            auto best() -> pgalign::algorithm *
+            {
+                if (node::count > 1 || global_state.mpi_running) {
+                    return global_state.use_devices
+                        ? myers::hybrid()
+                        : myers::sequential();
+                } else {
+                    return global_state.local_devices > 0
+                        ? myers::hybrid()
+                        : myers::sequential();
+                }
+            }
+        }
+    }
+}
@@ -6,6 +6,9 @@
  */
 #pragma once
 
+#include "functor.hpp"
+#include "pairwise.cuh"
+
 #include "pgalign/pgalign.cuh"
 #include "pgalign/alignment.cuh"
 
@@ -15,6 +18,15 @@ namespace museqa
     {
         namespace myers
         {
+            /**
+             * The function responsible for merging two groups of aligned sequences
+             * into a single alignment, in place. This is the unit of work handed out
+             * by the tree scheduler, and must be safe to run from many threads at once.
+             * @see myers::algorithm::schedule
+             * @since 0.1.1
+             */
+            using merger = functor<void(alignment&, alignment&, const context&)>;
+
             /**
              * Represents a general k-dim needleman algorithm for solving the heuristic's
              * profile-aligner step.
@@ -22,12 +34,15 @@ namespace museqa
              */
             struct algorithm : public pgalign::algorithm
             {
+                virtual auto schedule(const context&, const merger&) const -> alignment;
                 virtual auto run(const context&) const -> alignment = 0;
             };
 
             /*
              * The list of all available k-dim needleman-wunsch algorithm implementations.
              */
+            extern auto best() -> pgalign::algorithm *;
+            extern auto hybrid() -> pgalign::algorithm *;
             extern auto sequential() -> pgalign::algorithm *;
         }
     }
@@ -22,8 +22,10 @@ namespace museqa
          * @since 0.1.1
          */
         static const dispatcher<factory> factory_dispatcher = {
-            {"default",             myers::sequential}
-        ,   {"myers",               myers::sequential}
+            {"default",             myers::best}
+        ,   {"myers",               myers::best}
+        ,   {"hybrid",              myers::hybrid}
+        ,   {"myers-hybrid",        myers::hybrid}
         ,   {"sequential",          myers::sequential}
         ,   {"myers-sequential",    myers::sequential}
         };
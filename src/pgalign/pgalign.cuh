@@ -12,6 +12,7 @@
 #include "utils.hpp"
 #include "functor.hpp"
 #include "database.hpp"
+#include "pairwise.cuh"
 #include "phylogeny.cuh"
 
 #include "pgalign/sequence.cuh"
@@ -27,9 +28,11 @@ namespace museqa
          */
         struct context
         {
-            const museqa::database& db;         /// The loaded sequences' database.
-            const phylogeny::guidetree& tree;   /// The sequences' alignment guiding tree.
-            const size_t count;                 /// The total number of sequences being aligned.
+            const museqa::database& db;             /// The loaded sequences' database.
+            const phylogeny::guidetree& tree;       /// The sequences' alignment guiding tree.
+            const pairwise::scoring_table& table;   /// The scoring table to align profiles with.
+            const size_t count;                     /// The total number of sequences being aligned.
+            const pairwise::consistency::library *library = nullptr;  /// The consistency library, if any.
         };
 
         /**
@@ -65,21 +68,25 @@ namespace museqa
          * Runs the module when not on a pipeline.
          * @param db The database of sequences to align.
          * @param tree The multiple alignment's guiding tree.
+         * @param table The scoring table to align the sequences' profiles with.
          * @param count The total number of sequences to align.
          * @param algorithm The chosen profile-aligner algorithm.
+         * @param library The sequences' consistency library, if any.
          * @return The chosen algorithm's resulting multiple sequence alignment.
          */
         inline alignment run(
                 const museqa::database& db
             ,   const phylogeny::guidetree& tree
+            ,   const pairwise::scoring_table& table
             ,   const size_t count
             ,   const std::string& algorithm = "default"
+            ,   const pairwise::consistency::library *library = nullptr
             )
         {
             auto lambda = pgalign::algorithm::make(algorithm);
             
             const pgalign::algorithm *worker = lambda ();
-            auto result = worker->run({db, tree, count});
+            auto result = worker->run({db, tree, table, count, library && !library->empty() ? library : nullptr});
             
             delete worker;
             return result;
@@ -5,7 +5,9 @@
  * @copyright 2020-present Rodrigo Siqueira
  */
 #include <string>
+#include <vector>
 #include <cstdint>
+#include <cstring>
 
 #include "buffer.hpp"
 #include "format.hpp"
@@ -16,57 +18,133 @@
 namespace museqa
 {
     /**
-     * Fetches a character from a random offset on the sequence. As the sequence
-     * is stored using the Yale format for sparse matrices, it is not ideal to heavily
-     * rely on this method for accessing the sequence, as a binary search must be
-     * performed every time a new random offset is requested.
+     * Fetches a character from a random offset on the sequence. As only the gap
+     * runs are stored, a binary search must be performed on them every time a new
+     * random offset is requested, thus it is not ideal to heavily rely on this
+     * method for accessing the sequence.
      * @param offset The offset to be fetched from sequence.
      * @return The character found at the fetched offset.
      */
     __host__ __device__ encoder::unit pgalign::sequence::operator[](ptrdiff_t offset) const
     {
-        const auto buffer_size = m_columns.size();
-        const auto sequence_size = m_columns[buffer_size - 1];
-
-        if(sequence_size <= offset) {
+        if(ptrdiff_t(length()) <= offset) {
             return encoder::end;
         }
 
-        ptrdiff_t left = 0, right = buffer_size - 1;
-        ptrdiff_t middle = (offset * buffer_size) / sequence_size;
-        auto current = m_columns[middle];
+        ptrdiff_t left = 0, right = m_runs.size();
+
+        // Looks for the last run whose gaps start at or before the requested offset.
+        // A run's gaps start right after all the gaps and residues before it.
+        while(left < right) {
+            const ptrdiff_t middle = (left + right) / 2;
+            const ptrdiff_t before = middle ? m_runs[middle - 1].total : 0;
 
-        while(current != offset && left <= right) {
-            if(current < offset) { left  = middle + 1; }
-            else                 { right = middle - 1; }
+            if(m_runs[middle].position + before <= offset) left = middle + 1;
+            else right = middle;
+        }
 
-            middle = (left + right) / 2;
-            current = m_columns[middle];
+        if(left && offset < ptrdiff_t(m_runs[left - 1].position + m_runs[left - 1].total)) {
+            return encoder::gap;
         }
 
-        return current == offset
-            ? underlying_type::operator[](middle)
-            : encoder::gap;
+        return underlying_type::operator[](offset - (left ? m_runs[left - 1].total : 0));
     }
 
     /**
-     * Decodes a gapped sequence into a human-readable string.
-     * @return The decoded sequence as a string.
+     * Inserts runs of gaps into the sequence. The given runs are laid out on the
+     * sequence's current columns, and are merged into the sequence's own runs,
+     * so no residue is ever touched. Gaps inserted right next to the sequence's
+     * own gaps are merged into the same run.
+     * @param inserted The runs of gaps to insert, by the column they precede.
+     * @param count The number of runs to insert.
      */
-    std::string pgalign::sequence::decode() const
+    void pgalign::sequence::expand(const run *inserted, size_t count)
     {
-        const auto block_count = underlying_type::size();
-        const auto element_count = m_columns.size() - 1;
+        if(count == 0) {
+            return;
+        }
+
+        std::vector<run> result;
+        result.reserve(m_runs.size() + count);
+
+        index_type own = 0, added = 0, previous = 0;
+        size_t k = 0;
 
-        std::string decoded (m_columns[element_count], encoder::decode(encoder::gap));
+        for(size_t i = 0; i < count; ++i) {
+            const index_type column = inserted[i].position;
+            const index_type total = inserted[i].total - previous;
+            previous = inserted[i].total;
 
-        for(size_t i = 0, n = 0; n < element_count; ++i) {
-            const encoder::block& block = underlying_type::block(i);
+            // The sequence's own runs whose residues lie before the inserted run's
+            // column are kept, and shifted by all gaps inserted before them.
+            for(; k < m_runs.size() && m_runs[k].position + m_runs[k].total < column; ++k) {
+                own = m_runs[k].total;
+                result.push_back({m_runs[k].position, own + added});
+            }
 
-            for(uint8_t j = 0; j < encoder::block_size && n < element_count; ++j, ++n)
-                decoded[m_columns[n]] = encoder::decode(encoder::access(block, j));
+            added += total;
+
+            // If the inserted run's column lies within or right after one of the
+            // sequence's runs, both are merged when the sequence's run is kept.
+            if(k < m_runs.size() && m_runs[k].position + own <= column)
+                continue;
+
+            result.push_back({column - own, own + added});
         }
 
+        for(; k < m_runs.size(); ++k)
+            result.push_back({m_runs[k].position, m_runs[k].total + added});
+
+        m_runs = run_buffer::copy(result);
+    }
+
+    /**
+     * Decodes a window of the gapped sequence's columns straight into the given
+     * buffer. Only the window's first residue is looked for by a binary search
+     * on the gap runs, and the window is then walked along with the runs.
+     * @param out The buffer to write the window's characters to.
+     * @param first The window's first column.
+     * @param last The column right after the window's end.
+     */
+    void pgalign::sequence::decode(char *out, index_type first, index_type last) const
+    {
+        size_t left = 0, right = m_runs.size();
+        memset(out, encoder::decode(encoder::gap), last - first);
+
+        // Looks for the first run whose following residue lies after the window's
+        // first column. All residues after the runs before it lie within the window.
+        while(left < right) {
+            const size_t middle = (left + right) / 2;
+            if(m_runs[middle].position + m_runs[middle].total <= first) left = middle + 1;
+            else right = middle;
+        }
+
+        index_type shift = left ? m_runs[left - 1].total : 0;
+        index_type n = first - shift;
+
+        if(left < m_runs.size() && m_runs[left].position < n)
+            n = m_runs[left].position;
+
+        for(size_t k = left; n < m_residues; ++n) {
+            for(; k < m_runs.size() && m_runs[k].position <= n; ++k)
+                shift = m_runs[k].total;
+
+            if(n + shift >= last)
+                break;
+
+            const encoder::block& block = underlying_type::block(n / encoder::block_size);
+            out[n + shift - first] = encoder::decode(encoder::access(block, n % encoder::block_size));
+        }
+    }
+
+    /**
+     * Decodes a gapped sequence into a human-readable string.
+     * @return The decoded sequence as a string.
+     */
+    std::string pgalign::sequence::decode() const
+    {
+        std::string decoded (length(), encoder::decode(encoder::gap));
+        decode(&decoded[0], 0, static_cast<index_type>(decoded.size()));
         return decoded;
     }
 
@@ -6,6 +6,7 @@
  */
 #pragma once
 
+#include <string>
 #include <cstdint>
 
 #include "buffer.hpp"
@@ -19,7 +20,9 @@ namespace museqa
     {
         /**
          * Represents an extendable sequence, in which gaps can be inserted in between
-         * the sequence's elements.
+         * the sequence's elements. Rather than keeping the column of every single
+         * residue, the sequence only keeps the runs of gaps inserted into it, as
+         * aligned sequences usually have far fewer gap runs than residues.
          * @since 0.1.1
          */
         class sequence : protected museqa::sequence
@@ -27,12 +30,26 @@ namespace museqa
             public:
                 using index_type = uint32_t;                /// The sequence element's index type.
 
+                /**
+                 * A run of gaps inserted into the sequence. Runs are sorted by the
+                 * residue before which their gaps are inserted, and each of them
+                 * accumulates the total number of gaps up to itself, so a residue's
+                 * column can be found by a binary search on the runs.
+                 * @since 0.1.1
+                 */
+                struct run
+                {
+                    index_type position;                    /// The residue preceded by the run.
+                    index_type total;                       /// The number of gaps up to the run's end.
+                };
+
             protected:
                 using underlying_type = museqa::sequence;   /// The underlying sequence type.
-                using index_buffer = buffer<index_type>;    /// The sequence's index buffer type.
+                using run_buffer = buffer<run>;             /// The sequence's gap runs buffer type.
 
             protected:
-                index_buffer m_columns;                     /// The sequence's columns' indeces.
+                run_buffer m_runs;                          /// The sequence's runs of gaps.
+                index_type m_residues = 0;                  /// The sequence's number of residues.
 
             public:
                 inline sequence() noexcept = default;
@@ -44,7 +61,8 @@ namespace museqa
                  * @param original The sequence to create the new instance from.
                  */
                 inline sequence(const underlying_type& original) noexcept
-                :   sequence {original, original.unpadded()}
+                :   underlying_type {original}
+                ,   m_residues {static_cast<index_type>(original.unpadded())}
                 {}
 
                 inline sequence& operator=(const sequence&) = default;
@@ -58,24 +76,97 @@ namespace museqa
                  */
                 __host__ __device__ size_t length() const noexcept
                 {
-                    return m_columns[m_columns.size() - 1];
+                    return m_residues + gaps();
                 }
 
-                std::string decode() const;
+                /**
+                 * Informs the number of residues in the sequence, not counting gaps.
+                 * @return The number of the sequence's residues.
+                 */
+                __host__ __device__ size_t residues() const noexcept
+                {
+                    return m_residues;
+                }
+
+                /**
+                 * Informs the total number of gaps inserted into the sequence.
+                 * @return The number of the sequence's gaps.
+                 */
+                __host__ __device__ size_t gaps() const noexcept
+                {
+                    return m_runs.size() ? m_runs[m_runs.size() - 1].total : 0;
+                }
+
+                /**
+                 * Gives access to the sequence's runs of gaps.
+                 * @return The sequence's gap runs.
+                 */
+                inline auto runs() const noexcept -> const run_buffer&
+                {
+                    return m_runs;
+                }
+
+                /**
+                 * Informs the column at which one of the sequence's residues lies.
+                 * The residue's column is found by a binary search on the gap runs.
+                 * @param offset The residue's offset on the ungapped sequence.
+                 * @return The residue's column on the gapped sequence.
+                 */
+                __host__ __device__ index_type column(ptrdiff_t offset) const noexcept
+                {
+                    ptrdiff_t left = 0, right = m_runs.size();
+
+                    while(left < right) {
+                        const ptrdiff_t middle = (left + right) / 2;
+                        if(m_runs[middle].position <= offset) left = middle + 1;
+                        else right = middle;
+                    }
+
+                    return static_cast<index_type>(offset + (left ? m_runs[left - 1].total : 0));
+                }
+
+                /**
+                 * Informs the columns of all of the sequence's residues at once, by
+                 * walking the residues and the gap runs side by side.
+                 * @param out The buffer to write the residues' columns to.
+                 */
+                inline void columns(index_type *out) const noexcept
+                {
+                    index_type shift = 0;
+
+                    for(size_t r = 0, k = 0; r < m_residues; ++r) {
+                        for(; k < m_runs.size() && m_runs[k].position <= r; ++k)
+                            shift = m_runs[k].total;
+                        out[r] = static_cast<index_type>(r + shift);
+                    }
+                }
+
+                /**
+                 * Replaces the sequence's gap runs with ones laid out elsewhere, as
+                 * when the sequence has been aligned on another node.
+                 * @param runs The sequence's new gap runs.
+                 * @param count The number of gap runs.
+                 */
+                inline void assign(const run *runs, size_t count)
+                {
+                    m_runs = run_buffer::copy(runs, count);
+                }
+
+                void expand(const run *, size_t);
 
-            private:
                 /**
-                 * Builds a new expandable sequence from a basic sequence instance.
-                 * @param sequence The original sequence instance.
-                 * @param length The unpadded sequence length.
+                 * Decodes all of the sequence's residues, in bulk. The given buffer
+                 * must have room for whole encoded blocks, thus for up to a block's
+                 * worth of units more than the sequence's number of residues.
+                 * @param out The buffer to write the sequence's residues to.
                  */
-                inline sequence(const underlying_type& sequence, size_t length)
-                :   underlying_type {sequence}
-                ,   m_columns {index_buffer::make(length + 1)}
+                inline void unpack(encoder::unit *out) const noexcept
                 {
-                    for (size_t i = 0; i <= length; ++i)
-                        m_columns[i] = (index_type) i;
+                    underlying_type::unpack(out);
                 }
+
+                void decode(char *, index_type, index_type) const;
+                std::string decode() const;
         };
     }
 
@@ -4,11 +4,189 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2020-present Rodrigo Siqueira
  */
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
 #include "io.hpp"
+#include "mpi.hpp"
+#include "node.hpp"
+#include "stream.hpp"
 #include "pipeline.hpp"
 #include "exception.hpp"
 
 #include "phylogeny.cuh"
+#include "pairwise/digest.hpp"
+#include "phylogeny/njoining/star.cuh"
+
+namespace
+{
+    using namespace museqa;
+    namespace pg = museqa::phylogeny;
+
+    /**
+     * The joins a guide tree is made of. Each of the tree's inner nodes is given
+     * by its two children and their distances to it, in the order they are joined.
+     * @since 0.1.1
+     */
+    struct joins
+    {
+        std::vector<uint32_t> children;                 /// The children of each inner node.
+        std::vector<pg::otu::distance_type> distances;  /// The children's distances to their parents.
+    };
+
+    /*
+     * Definitions of the phylogeny checkpoint file format. The file is laid out as
+     * its header, followed by the tree's children and then by their distances.
+     */
+    static constexpr char magic[8] = {'M', 'U', 'S', 'E', 'Q', 'A', 'G', 'C'};
+    enum : uint64_t { version = 1 };
+
+    /**
+     * The phylogeny checkpoint file's header.
+     * @since 0.1.1
+     */
+    struct header
+    {
+        char magic[8];                      /// The file's magic number.
+        uint64_t version;                   /// The file format's version.
+        uint64_t count;                     /// The number of joins in file.
+        uint64_t key;                       /// The digest of the run the tree belongs to.
+    };
+
+    /**
+     * Lists the joins a guide tree is made of.
+     * @param tree The guide tree to be listed.
+     * @return The tree's joins.
+     */
+    static auto flatten(const pg::guidetree& tree) -> joins
+    {
+        const size_t leaves = tree.leaves().size();
+        joins result;
+
+        for(size_t p = leaves; p + 1 < 2 * leaves; ++p)
+            for(const auto child : tree[(pg::oturef) p].child) {
+                result.children.push_back((uint32_t) child);
+                result.distances.push_back(tree[child].distance);
+            }
+
+        return result;
+    }
+
+    /**
+     * Shares the joins known by the master node with all other nodes.
+     * @param list The joins to be shared, known by the master node.
+     */
+    static void share(joins& list)
+    {
+        #if !defined(__museqa_runtime_cython)
+            std::vector<uint32_t> rchildren = mpi::broadcast(list.children);
+            std::vector<pg::otu::distance_type> rdistances = mpi::broadcast(list.distances);
+            onlyslaves list.children = rchildren;
+            onlyslaves list.distances = rdistances;
+        #endif
+    }
+
+    /**
+     * Rebuilds a guide tree from the joins it is made of.
+     * @param list The tree's joins.
+     * @return The rebuilt guide tree.
+     */
+    static auto rebuild(const joins& list) -> pg::guidetree
+    {
+        const size_t leaves = list.children.size() ? list.children.size() / 2 + 1 : 0;
+        auto tree = pg::njoining::star::make((uint32_t) leaves);
+
+        for(size_t i = 0; i < list.children.size(); i += 2)
+            tree.join(
+                    (pg::oturef) (leaves + i / 2)
+                ,   {(pg::oturef) list.children[i + 0], list.distances[i + 0]}
+                ,   {(pg::oturef) list.children[i + 1], list.distances[i + 1]}
+                );
+
+        return pg::guidetree {tree};
+    }
+
+    /**
+     * Digests the distance matrix and the algorithm a guide tree is built from.
+     * A checkpoint is only resumed from if it has been saved with the same digest.
+     * @param io The pipeline's IO service instance.
+     * @param matrix The tree's distance matrix, on the master node.
+     * @return The run's digest.
+     */
+    static auto key(const io::manager& io, const pairwise::distance_matrix& matrix) -> uint64_t
+    {
+        auto algoname = io.cmd.get("phylogeny", "default");
+        const auto& scores = matrix.linear();
+
+        auto value = pairwise::digest::fnv(algoname.data(), algoname.size());
+        return pairwise::digest::fnv(scores.raw(), scores.size() * sizeof(pairwise::score), value);
+    }
+
+    /**
+     * Loads the joins saved into a checkpoint file. If the file does not exist
+     * or has been saved for a different run, no joins are loaded.
+     * @param filename The name of the checkpoint file.
+     * @param count The number of sequences being aligned.
+     * @param expected The digest of the current run.
+     * @return The loaded joins, if any.
+     */
+    static auto restore(const std::string& filename, size_t count, uint64_t expected) -> joins
+    {
+        std::ifstream file (filename, std::ifstream::binary);
+        joins result;
+        header head;
+
+        if(!file.read(reinterpret_cast<char *>(&head), sizeof(head)))
+            return result;
+
+        enforce(!memcmp(head.magic, magic, sizeof(magic)), "file is not a valid phylogeny checkpoint '%s'", filename);
+
+        if(head.version != version || head.count + 1 != count || head.key != expected)
+            return result;
+
+        result.children.resize(2 * head.count);
+        result.distances.resize(2 * head.count);
+
+        file.read(reinterpret_cast<char *>(result.children.data()), result.children.size() * sizeof(uint32_t));
+        file.read(reinterpret_cast<char *>(result.distances.data()), result.distances.size() * sizeof(pg::otu::distance_type));
+
+        enforce(!file.fail(), "corrupted phylogeny checkpoint '%s'", filename);
+        return result;
+    }
+
+    /**
+     * Saves the joins into a checkpoint file. The file is first written aside and
+     * then moved into place, so a run killed while saving leaves no broken file.
+     * @param filename The name of the checkpoint file.
+     * @param key The digest of the current run.
+     * @param list The guide tree's joins.
+     */
+    static void save(const std::string& filename, uint64_t key, const joins& list)
+    {
+        const auto partial = filename + ".tmp";
+        std::ofstream file (partial, std::ofstream::binary | std::ofstream::trunc);
+        enforce(!file.fail(), "file cannot be written '%s'", partial);
+
+        header head;
+        memcpy(head.magic, magic, sizeof(head.magic));
+
+        head.version = version;
+        head.count   = list.children.size() / 2;
+        head.key     = key;
+
+        file.write(reinterpret_cast<const char *>(&head), sizeof(head));
+        file.write(reinterpret_cast<const char *>(list.children.data()), list.children.size() * sizeof(uint32_t));
+        file.write(reinterpret_cast<const char *>(list.distances.data()), list.distances.size() * sizeof(pg::otu::distance_type));
+
+        file.close();
+        enforce(!file.fail(), "file cannot be written '%s'", partial);
+        enforce(!std::rename(partial.c_str(), filename.c_str()), "file cannot be written '%s'", filename);
+    }
+}
 
 namespace museqa
 {
@@ -28,7 +206,72 @@ namespace museqa
             auto previous = pipeline::convert<phylogeny::previous>(pipe);
 
             auto result = pg::run(previous->distances, previous->count, algoname);
-            auto ptr = new phylogeny::conduit {previous->db, result};
+
+            onlymaster if(io.cmd.has("dump-tree"))
+                enforce(io.dump(result, io.cmd.get("dump-tree")), "could not dump guide tree");
+
+            auto ptr = new phylogeny::conduit {previous->db, result, previous->library};
+
+            return pipeline::pipe {ptr};
+        }
+
+        /**
+         * Saves the module's guide tree into a checkpoint, on the master node. The
+         * tree is saved along with the digest of the matrix it has been built from.
+         * @param io The pipeline's IO service instance.
+         * @param previous The previous module's conduit.
+         * @param result The module's resulting conduit.
+         * @param filename The name of the module's checkpoint file.
+         */
+        void phylogeny::checkpoint(
+                const io::manager& io
+            ,   pipeline::pipe& previous
+            ,   pipeline::pipe& result
+            ,   const std::string& filename
+            ) const
+        {
+            auto source = pipeline::convert<phylogeny::previous>(previous);
+            auto current = pipeline::convert<phylogeny>(result);
+
+            onlymaster if(current->total > 1)
+                ::save(filename, ::key(io, source->distances), ::flatten(current->tree));
+        }
+
+        /**
+         * Resumes the module from its checkpoint. The checkpoint is only read by
+         * the master node, and then shared with all other nodes by its joins.
+         * @param io The pipeline's IO service instance.
+         * @param pipe The previous module's conduit.
+         * @param filename The name of the module's checkpoint file.
+         * @return The resumed conduit, or an empty pipe if it cannot be resumed.
+         */
+        auto phylogeny::resume(const io::manager& io, pipeline::pipe& pipe, const std::string& filename) const
+        -> pipeline::pipe
+        {
+            auto previous = pipeline::convert<phylogeny::previous>(pipe);
+
+            ::joins list;
+            size_t resumed = 0;
+
+            onlymaster if(previous->count > 1) {
+                list = ::restore(filename, previous->count, ::key(io, previous->distances));
+                resumed = !list.children.empty();
+            }
+
+            #if !defined(__museqa_runtime_cython)
+                resumed = mpi::broadcast(&resumed);
+            #endif
+
+            if(!resumed)
+                return pipeline::pipe {};
+
+            ::share(list);
+            auto result = ::rebuild(list);
+
+            onlymaster if(io.cmd.has("dump-tree"))
+                enforce(io.dump(result, io.cmd.get("dump-tree")), "could not dump guide tree");
+
+            auto ptr = new phylogeny::conduit {previous->db, result, previous->library};
 
             return pipeline::pipe {ptr};
         }
@@ -45,5 +288,47 @@ namespace museqa
 
             return true;
         }
+
+        /**
+         * Loads a precomputed guide tree when on a pipeline. The tree is only read
+         * by the master node, and then shared with all other nodes by its joins.
+         * @param io The pipeline's IO service instance.
+         * @param pipe The previous module's conduit.
+         * @return A conduit with the module's processed results.
+         */
+        auto treeloader::run(const io::manager& io, pipeline::pipe& pipe) const -> pipeline::pipe
+        {
+            auto previous = pipeline::convert<treeloader::previous>(pipe);
+
+            ::joins list;
+
+            onlymaster list = ::flatten(io::load<pg::guidetree>(io.cmd.get("load-tree")));
+            ::share(list);
+
+            const size_t leaves = list.children.size() ? list.children.size() / 2 + 1 : 0;
+            const size_t expected = previous->total > 1 ? previous->total : 0;
+
+            enforce(leaves == expected, "guide tree has %llu leaves but %llu sequences were given", leaves, previous->total);
+
+            auto result = ::rebuild(list);
+            stream::complete();
+
+            auto ptr = new phylogeny::conduit {previous->db, result};
+
+            return pipeline::pipe {ptr};
+        }
+
+        /**
+         * Checks whether command line arguments produce a valid module state.
+         * @param io The pipeline's IO service instance.
+         * @return Are the given command line arguments valid?
+         */
+        auto treeloader::check(const io::manager& io) const -> bool
+        {
+            auto filename = io.cmd.get("load-tree", "");
+            enforce(io::loader<pg::guidetree>{}.validate(filename), "unknown guide tree file format: '%s'", filename);
+
+            return true;
+        }
     }
 }
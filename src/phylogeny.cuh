@@ -11,6 +11,7 @@
 #include "database.hpp"
 #include "pipeline.hpp"
 #include "pairwise.cuh"
+#include "bootstrap.hpp"
 
 /*
  * The heuristic's phylogeny and guiding-tree building module.
@@ -20,6 +21,8 @@
  */
 
 #include "phylogeny/phylogeny.cuh"
+#include "io/dumper/guidetree.hpp"
+#include "io/loader/guidetree.hpp"
 
 namespace museqa
 {
@@ -46,6 +49,9 @@ namespace museqa
 
             auto run(const io::manager&, pipeline::pipe&) const -> pipeline::pipe override;
             auto check(const io::manager&) const -> bool override;
+
+            void checkpoint(const io::manager&, pipeline::pipe&, pipeline::pipe&, const std::string&) const override;
+            auto resume(const io::manager&, pipeline::pipe&, const std::string&) const -> pipeline::pipe override;
         };
 
         /**
@@ -56,9 +62,11 @@ namespace museqa
         struct phylogeny::conduit : public pipeline::conduit
         {
             typedef museqa::phylogeny::guidetree guidetree;
+            typedef museqa::pairwise::consistency::library library_type;
 
             database db;                    /// The loaded sequences' database.
             guidetree tree;                 /// The sequences' alignment guiding tree.
+            library_type library;           /// The sequences' consistency library, if built.
             const size_t total;             /// The total number of sequences.
 
             inline conduit() noexcept = delete;
@@ -76,9 +84,45 @@ namespace museqa
             ,   total {db.count()}
             {}
 
+            /**
+             * Instantiates a new conduit with a consistency library.
+             * @param mdb The sequence database to transfer to the next module.
+             * @param gtree The alignment guiding tree to transfer to the next module.
+             * @param mlib The sequences' consistency library to transfer to the next module.
+             */
+            inline conduit(database& mdb, guidetree& gtree, library_type& mlib) noexcept
+            :   db {std::move(mdb)}
+            ,   tree {std::move(gtree)}
+            ,   library {std::move(mlib)}
+            ,   total {db.count()}
+            {}
+
             inline conduit& operator=(const conduit&) = delete;
             inline conduit& operator=(conduit&&) = delete;
         };
+
+        /**
+         * Defines the module for loading a precomputed guide tree. When a guide
+         * tree is given, it takes the place of both the pairwise and the phylogeny
+         * modules, so the sequences' alignment starts directly from the tree.
+         * @since 0.1.1
+         */
+        struct treeloader : public phylogeny
+        {
+            typedef museqa::module::bootstrap previous;     /// The expected previous module.
+
+            /**
+             * Returns an string identifying the module's name.
+             * @return The module's name.
+             */
+            inline auto name() const -> const char * override
+            {
+                return "guidetree";
+            }
+
+            auto run(const io::manager&, pipeline::pipe&) const -> pipeline::pipe override;
+            auto check(const io::manager&) const -> bool override;
+        };
     }
 
     namespace phylogeny
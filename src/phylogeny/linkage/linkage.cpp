@@ -0,0 +1,267 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the phylogeny module's hierarchical clustering algorithms.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2019-present Rodrigo Siqueira
+ */
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "pairwise.cuh"
+
+#include "phylogeny/matrix.cuh"
+#include "phylogeny/phylogeny.cuh"
+#include "phylogeny/linkage/linkage.cuh"
+#include "phylogeny/njoining/star.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace phylogeny;
+
+    /**
+     * The algorithm's distance type.
+     * @since 0.1.1
+     */
+    using distance_type = otu::distance_type;
+
+    /**
+     * The matrix type for distances between clusters. As clusters are joined in
+     * place, no line or column is ever removed from the matrix.
+     * @since 0.1.1
+     */
+    using distance_matrix = phylogeny::symmatrix<false>;
+
+    /**
+     * Records the join of two clusters. A cluster is identified by the matrix
+     * line it occupies, which is kept by the joined cluster.
+     * @since 0.1.1
+     */
+    struct merge
+    {
+        oturef one;                         /// The line kept by the joined cluster.
+        oturef two;                         /// The line of the cluster joined into the first one.
+        distance_type distance;             /// The distance between the clusters.
+    };
+
+    namespace policy
+    {
+        /**
+         * The average linkage, also known as UPGMA. A joined cluster's distance
+         * to others is the mean of all its sequences' distances to them.
+         * @since 0.1.1
+         */
+        struct average
+        {
+            inline static auto update(distance_type a, distance_type b, size_t na, size_t nb) noexcept
+            -> distance_type
+            {
+                return (a * na + b * nb) / (na + nb);
+            }
+        };
+
+        /**
+         * The weighted linkage, also known as WPGMA. A joined cluster's distance
+         * to others is the mean of the joined clusters' distances to them.
+         * @since 0.1.1
+         */
+        struct weighted
+        {
+            inline static auto update(distance_type a, distance_type b, size_t, size_t) noexcept
+            -> distance_type
+            {
+                return (a + b) * .5;
+            }
+        };
+
+        /**
+         * The single linkage. A joined cluster's distance to others is the one
+         * of its closest sequences to them. As scores are similarities, the closest
+         * sequences have the highest score.
+         * @since 0.1.1
+         */
+        struct single
+        {
+            inline static auto update(distance_type a, distance_type b, size_t, size_t) noexcept
+            -> distance_type
+            {
+                return utils::max(a, b);
+            }
+        };
+    }
+
+    /**
+     * Finds the whole hierarchy of clusters with the nearest-neighbor chain algorithm.
+     * A chain of clusters, each nearest to its predecessor, is grown until its last
+     * two clusters are each other's nearest neighbors, and thus can be joined. As
+     * the linkages are reducible, the rest of the chain is still valid after the
+     * join, so the hierarchy is found in quadratic time. The joins are, however,
+     * not found in the order a greedy algorithm would have found them.
+     * @tparam P The linkage policy for updating distances.
+     * @param matrix The distance matrix, which is rewritten as clusters are joined.
+     * @param count The total number of sequences to be clustered.
+     * @return The joins found, in the order they have been found.
+     */
+    template <typename P>
+    static auto chain(distance_matrix& matrix, size_t count) -> std::vector<merge>
+    {
+        auto size = std::vector<size_t> (count, 1);
+        auto alive = std::vector<bool> (count, true);
+
+        std::vector<merge> merges;
+        std::vector<oturef> stack;
+
+        merges.reserve(count - 1);
+        stack.reserve(count);
+
+        for(size_t first = 0; merges.size() < count - 1; ) {
+            while(stack.empty() && !alive[first])
+                ++first;
+
+            if(stack.empty())
+                stack.push_back((oturef) first);
+
+            const oturef top = stack.back();
+            const oturef previous = stack.size() > 1 ? stack[stack.size() - 2] : (oturef) undefined;
+
+            // Let's find the chain top's nearest neighbor. The chain's previous
+            // cluster wins any ties, otherwise the chain could grow in circles.
+            oturef nearest = previous;
+            distance_type best = previous != undefined ? matrix[{top, previous}] : distance_type {};
+
+            for(size_t k = 0; k < count; ++k)
+                if(alive[k] && k != top && (nearest == undefined || matrix[{top, k}] > best)) {
+                    best = matrix[{top, k}];
+                    nearest = (oturef) k;
+                }
+
+            if(nearest != previous) {
+                stack.push_back(nearest);
+                continue;
+            }
+
+            // As the chain's last two clusters are reciprocal nearest neighbors,
+            // they can be joined. The joined cluster takes up the lowest line.
+            const oturef one = utils::min(top, previous);
+            const oturef two = utils::max(top, previous);
+
+            for(size_t k = 0; k < count; ++k)
+                if(alive[k] && k != one && k != two)
+                    matrix[{one, k}] = P::update(matrix[{one, k}], matrix[{two, k}], size[one], size[two]);
+
+            merges.push_back({one, two, best});
+            size[one] += size[two];
+            alive[two] = false;
+
+            stack.resize(stack.size() - 2);
+        }
+
+        return merges;
+    }
+
+    /**
+     * Builds the phylogenetic tree from the joins, sorted from the closest to
+     * the farthest one, so the tree is the same as a greedy algorithm would build.
+     * Sequences are equidistant from the tree's leaves, as the branches' lengths
+     * are given by half the joined clusters' score to the closest joined pair.
+     * @param merges The joins found between clusters.
+     * @param count The total number of sequences clustered.
+     * @return The calculated phylogenetic tree.
+     */
+    static auto build_tree(std::vector<merge>& merges, size_t count) -> njoining::star
+    {
+        auto tree = njoining::star::make(count);
+        auto height = std::vector<distance_type> (count, 0);
+        auto node = std::vector<oturef> (count);
+        auto group = std::vector<oturef> (count);
+
+        std::stable_sort(merges.begin(), merges.end(), [](const merge& a, const merge& b) {
+            return a.distance > b.distance;
+        });
+
+        for(size_t i = 0; i < count; ++i)
+            node[i] = group[i] = (oturef) i;
+
+        // Finds the line representing the cluster a line has been joined into.
+        auto find = [&](oturef x) -> oturef {
+            while(group[x] != x)
+                x = group[x] = group[group[x]];
+            return x;
+        };
+
+        const distance_type top = merges.front().distance;
+        oturef parent = (oturef) count;
+
+        for(const auto& current : merges) {
+            const auto one = find(current.one);
+            const auto two = find(current.two);
+            const distance_type level = (top - current.distance) * .5;
+
+            tree.join(parent, {node[one], level - height[one]}, {node[two], level - height[two]});
+
+            group[two] = one;
+            height[one] = level;
+            node[one] = parent++;
+        }
+
+        return tree;
+    }
+
+    /**
+     * The hierarchical clustering algorithm object. As it is much cheaper than
+     * the neighbor-joining algorithm, each node builds the whole tree by itself,
+     * thus no communication between the nodes is needed.
+     * @tparam P The linkage policy for updating distances.
+     * @since 0.1.1
+     */
+    template <typename P>
+    struct clustering : public phylogeny::algorithm
+    {
+        /**
+         * Executes the hierarchical clustering algorithm for the phylogeny step.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> guidetree override
+        {
+            if(ctx.count < 2)
+                return guidetree {};
+
+            auto matrix = distance_matrix {ctx.matrix};
+            auto merges = chain<P>(matrix, ctx.count);
+
+            return build_tree(merges, ctx.count);
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Instantiates a new average linkage, or UPGMA, algorithm instance.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::linkage::average() -> phylogeny::algorithm *
+    {
+        return new ::clustering<::policy::average>;
+    }
+
+    /**
+     * Instantiates a new weighted linkage, or WPGMA, algorithm instance.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::linkage::weighted() -> phylogeny::algorithm *
+    {
+        return new ::clustering<::policy::weighted>;
+    }
+
+    /**
+     * Instantiates a new single linkage algorithm instance.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::linkage::single() -> phylogeny::algorithm *
+    {
+        return new ::clustering<::policy::single>;
+    }
+}
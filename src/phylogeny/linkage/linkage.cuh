@@ -0,0 +1,26 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the phylogeny module's hierarchical clustering algorithms.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2019-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include "phylogeny/phylogeny.cuh"
+
+namespace museqa
+{
+    namespace phylogeny
+    {
+        namespace linkage
+        {
+            /*
+             * The list of all available hierarchical clustering algorithms. These
+             * only differ on how the distance to a newly joined cluster is updated.
+             */
+            extern auto average() -> phylogeny::algorithm *;
+            extern auto weighted() -> phylogeny::algorithm *;
+            extern auto single() -> phylogeny::algorithm *;
+        }
+    }
+}
@@ -7,9 +7,14 @@
 #include <cstdint>
 
 #include "cuda.cuh"
+#include "oeis.hpp"
 #include "point.hpp"
 #include "utils.hpp"
+#include "buffer.hpp"
 #include "matrix.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include "pairwise.cuh"
 
 #include "phylogeny/matrix.cuh"
 
@@ -25,6 +30,8 @@ namespace museqa
         using matrixd = phylogeny::matrix<true>;
         using symmatrixh = phylogeny::symmatrix<false>;
         using symmatrixd = phylogeny::symmatrix<true>;
+        using lazymatrixh = phylogeny::lazymatrix<false>;
+        using lazymatrixd = phylogeny::lazymatrix<true>;
     }
 }
 
@@ -153,6 +160,8 @@ namespace
             // To remove a column from the matrix, we will first shift left all columns
             // located to the right of the column being removed. And then shift
             // up all lines below the one being removed.
+            trace::kernel span {"matrix::remove"};
+
             hmove<<<d::blocks(height), d::threads(left)>>>(dest, src, offset);
             vmove<<<d::blocks(width), d::threads(bottom)>>>(dest, src, offset);
         }
@@ -289,6 +298,10 @@ namespace
             // explicitly create streams as we know this is the most we might use.
             cuda::stream s[3];
 
+            // The span is timed on the default stream, which waits for all other
+            // streams, so its end is only reached when all kernels are done.
+            trace::kernel span {"matrix::remove"};
+
             // Firstly, let's horizontally move the elements which will be kept
             // on from the old matrix to their position on the new one. This step
             // will not need to be performed when removing the first or the last
@@ -460,6 +473,126 @@ namespace
         }
     }
 
+    namespace device
+    {
+        namespace d = cuda::device;
+
+        /**
+         * The side of the square tiles the matrix is inflated by. Each block's
+         * threads walk down its tile's lines, a few lines at a time.
+         * @since 0.1.1
+         */
+        enum : int32_t { tile_side = 32, tile_lines = 8 };
+
+        /**
+         * Inflates a tile of the pairwise module's packed distance triangle into
+         * the given matrix. Each tile is read from the triangle once, and written
+         * to both of its mirrored positions through shared memory, so that both
+         * the reads and the writes are coalesced.
+         * @tparam T The spatial transformation applied to the given matrix.
+         * @param target The matrix to be filled with the triangle's distances.
+         * @param packed The pairwise module's linear buffer of distances.
+         * @param count The total number of sequences represented in the matrix.
+         */
+        template <typename T>
+        __global__ void dinflate(phylogeny::matrix<true, T> target, const buffer<element_type> packed, int32_t count)
+        {
+            __shared__ element_type tile[tile_side][tile_side + 1];
+
+            const int32_t bi = blockIdx.y * tile_side;
+            const int32_t bj = blockIdx.x * tile_side;
+
+            if(bj > bi) return;
+
+            for(int32_t k = threadIdx.y; k < tile_side; k += tile_lines) {
+                const int32_t i = bi + k, j = bj + threadIdx.x;
+
+                if(i < count && j < count) {
+                    const auto value = (i != j)
+                        ? packed[utils::nchoose((size_t) utils::max(i, j)) + utils::min(i, j)]
+                        : element_type {0};
+
+                    tile[k][threadIdx.x] = value;
+                    target[{i, j}] = value;
+                }
+            }
+
+            __syncthreads();
+
+            for(int32_t k = threadIdx.y; k < tile_side; k += tile_lines) {
+                const int32_t j = bj + k, i = bi + threadIdx.x;
+
+                if(i < count && j < count)
+                    target[{j, i}] = tile[threadIdx.x][k];
+            }
+        }
+
+        /**
+         * Inflates the pairwise module's packed distance triangle directly into a
+         * matrix on device memory, so the matrix is never inflated on host memory.
+         * @tparam T The spatial transformation applied to the given matrix.
+         * @param target The matrix to be filled with the triangle's distances.
+         * @param mat The pairwise module's distance matrix.
+         */
+        template <typename T>
+        inline void inflate(phylogeny::matrix<true, T>& target, const pairwise::distance_matrix& mat)
+        {
+            const auto count = (int32_t) mat.count();
+            const auto tiles = (count + tile_side - 1) / tile_side;
+
+            if(count < 2) return;
+
+            trace::kernel span {"matrix::inflate"};
+
+            auto packed = buffer<element_type>::make(cuda::allocator::device, mat.linear().size());
+            cuda::memory::copy(packed.raw(), mat.linear().raw(), packed.size());
+
+            dinflate<<<dim3(tiles, tiles), dim3(tile_side, tile_lines)>>>(target, packed, count);
+        }
+    }
+
+    namespace host
+    {
+        /**
+         * The side of the square tiles the matrix is inflated by.
+         * @since 0.1.1
+         */
+        enum : size_t { tile_side = 64 };
+
+        /**
+         * Inflates the pairwise module's packed distance triangle into the given
+         * matrix on host memory. The triangle is split into square tiles, which are
+         * shared among the host threads. As a tile is small, writing its mirrored
+         * columns does not thrash the cache as a whole matrix column would.
+         * @tparam T The spatial transformation applied to the given matrix.
+         * @param target The matrix to be filled with the triangle's distances.
+         * @param mat The pairwise module's distance matrix.
+         */
+        template <typename T>
+        inline void inflate(phylogeny::matrix<false, T>& target, const pairwise::distance_matrix& mat)
+        {
+            const size_t count = mat.count();
+            const size_t tiles = (count + tile_side - 1) / tile_side;
+            const auto& packed = mat.linear();
+
+            parallel::foreach(utils::nchoose(tiles + 1), [&](const range<size_t>& partition, size_t) {
+                for(size_t t = partition.offset; t < partition.offset + partition.total; ++t) {
+                    const size_t bi = oeis::a002024(t + 1) - 1;
+                    const size_t bj = t - utils::nchoose(bi + 1);
+
+                    for(size_t i = bi * tile_side; i < utils::min((bi + 1) * tile_side, count); ++i) {
+                        const auto line = packed.raw() + utils::nchoose(i);
+
+                        for(size_t j = bj * tile_side; j < utils::min((bj + 1) * tile_side, i); ++j)
+                            target[{i, j}] = target[{j, i}] = line[j];
+
+                        if(bi == bj) target[{i, i}] = element_type {0};
+                    }
+                }
+            });
+        }
+    }
+
     namespace proxy
     {
         /**#@+
@@ -503,6 +636,88 @@ namespace
             ::host::swap(target, a, b);
         }
         /**#@-*/
+        /**#@+
+         * Inflates the pairwise module's distance matrix into a new matrix. This
+         * function is a proxy to the one inflating the matrix on the correct context.
+         * @tparam T The matrix's spacial transformation.
+         * @param target The matrix instance to be created.
+         * @param mat The pairwise module's distance matrix.
+         */
+        template <typename T>
+        inline void inflate(phylogeny::matrix<true, T>& target, const pairwise::distance_matrix& mat)
+        {
+            target = phylogeny::matrix<true, T>::make(cuda::allocator::device, mat.count());
+            ::device::inflate(target, mat);
+        }
+
+        template <typename T>
+        inline void inflate(phylogeny::matrix<false, T>& target, const pairwise::distance_matrix& mat)
+        {
+            target = phylogeny::matrix<false, T>::make(mat.count());
+            ::host::inflate(target, mat);
+        }
+        /**#@-*/
+    }
+
+    namespace lazy
+    {
+        namespace d = cuda::device;
+
+        /**
+         * The type of the lazy matrix's list of active offsets.
+         * @since 0.1.1
+         */
+        using index_type = buffer<uint32_t>;
+
+        /**
+         * Fills a list of active offsets with the identity, which maps each offset
+         * to the line and column with the same physical offset.
+         * @param index The list of active offsets to be filled.
+         */
+        __global__ void iota(index_type index)
+        {
+            for(size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < index.size(); i += gridDim.x * blockDim.x)
+                index[i] = (uint32_t) i;
+        }
+
+        /**
+         * Removes an offset from a list of active offsets, by shifting all offsets
+         * after it into the new list. The lists cannot overlap in memory.
+         * @param dest The new list of active offsets.
+         * @param src The original list of active offsets.
+         * @param x The offset to be removed.
+         */
+        __global__ void shift(index_type dest, const index_type src, uint32_t x)
+        {
+            for(size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < dest.size(); i += gridDim.x * blockDim.x)
+                dest[i] = src[i < x ? i : i + 1];
+        }
+
+        /**
+         * Swaps two offsets on a list of active offsets.
+         * @param index The target list of active offsets.
+         * @param a The first offset to swap.
+         * @param b The second offset to swap.
+         */
+        __global__ void exchange(index_type index, uint32_t a, uint32_t b)
+        {
+            utils::swap(index[a], index[b]);
+        }
+
+        /**
+         * Gathers all active elements of a lazy matrix into a new packed matrix,
+         * in which each offset is stored at its own physical line and column.
+         * @param dest The new packed matrix.
+         * @param src The lazy matrix to be packed.
+         */
+        __global__ void gather(museqa::matrix<element_type> dest, const phylogeny::lazymatrixd src)
+        {
+            const auto side = src.dimension()[0];
+
+            for(size_t i = blockIdx.x; i < side; i += gridDim.x)
+                for(size_t j = threadIdx.x; j < side; j += blockDim.x)
+                    dest[{i, j}] = src[{i, j}];
+        }
     }
 }
 
@@ -555,6 +770,198 @@ namespace museqa
         return instance;
     }
 
+    /**
+     * Inflates the pairwise module's packed distance triangle into a matrix for
+     * the phylogeny module, directly on the matrix's own memory context.
+     * @tparam D Is the matrix stored on device memory?
+     * @tparam T The matrix's spacial transformation.
+     * @param mat The pairwise module's distance matrix.
+     * @return The newly inflated matrix.
+     */
+    template <bool D, typename T>
+    auto phylogeny::matrix<D, T>::inflate(const pairwise::distance_matrix& mat) -> phylogeny::matrix<D, T>
+    {
+        phylogeny::matrix<D, T> target;
+        ::proxy::inflate(target, mat);
+        return target;
+    }
+
+    /**#@+
+     * Creates a new lazy matrix of given side size, in which each offset is stored
+     * at its own physical line and column.
+     * @param allocator The allocator to be used to new matrix.
+     * @param side The new matrix's width and height.
+     * @return The newly created matrix instance.
+     */
+    template <>
+    auto phylogeny::lazymatrixh::make(const museqa::allocator& allocator, size_t side) -> phylogeny::lazymatrixh
+    {
+        auto index = buffer<index_type>::make(allocator, side);
+
+        for(size_t i = 0; i < side; ++i)
+            index[i] = (index_type) i;
+
+        return lazymatrixh {underlying_matrix::make(allocator, {side, side}), index, side};
+    }
+
+    template <>
+    auto phylogeny::lazymatrixd::make(const museqa::allocator& allocator, size_t side) -> phylogeny::lazymatrixd
+    {
+        namespace d = cuda::device;
+        auto index = buffer<index_type>::make(allocator, side);
+
+        if(side > 0)
+            ::lazy::iota<<<d::blocks(side / d::threads() + 1), d::threads(side)>>>(index);
+
+        return lazymatrixd {underlying_matrix::make(allocator, {side, side}), index, side};
+    }
+
+    template <>
+    auto phylogeny::lazymatrixh::make(size_t side) -> phylogeny::lazymatrixh
+    {
+        auto index = buffer<index_type>::make(side);
+
+        for(size_t i = 0; i < side; ++i)
+            index[i] = (index_type) i;
+
+        return lazymatrixh {underlying_matrix::make({side, side}), index, side};
+    }
+
+    template <>
+    auto phylogeny::lazymatrixd::make(size_t side) -> phylogeny::lazymatrixd
+    {
+        return lazymatrixd::make(cuda::allocator::device, side);
+    }
+    /**#@-*/
+
+    /**
+     * Inflates the pairwise module's packed distance triangle into a lazy matrix,
+     * in which each offset is stored at its own physical line and column.
+     * @tparam D Is the matrix stored on device memory?
+     * @param mat The pairwise module's distance matrix.
+     * @return The newly inflated matrix.
+     */
+    template <bool D>
+    auto phylogeny::matrix<D, transform::lazy>::inflate(const pairwise::distance_matrix& mat)
+    -> phylogeny::matrix<D, transform::lazy>
+    {
+        phylogeny::matrix<D, transform::lazy> target;
+        ::proxy::inflate(target, mat);
+        return target;
+    }
+
+    /**
+     * Compacts a lazy matrix, by packing all its active elements into a new matrix
+     * without any tombstones. The list of active offsets becomes the identity.
+     */
+    template <>
+    auto phylogeny::lazymatrixh::compact() -> void
+    {
+        const auto side = m_virtual[0];
+        auto packed = lazymatrixh::make(side);
+
+        for(size_t i = 0; i < side; ++i)
+            for(size_t j = 0; j < side; ++j)
+                packed[{i, j}] = operator[]({i, j});
+
+        this->operator=(packed);
+    }
+
+    template <>
+    auto phylogeny::lazymatrixd::compact() -> void
+    {
+        namespace d = cuda::device;
+        const auto side = m_virtual[0];
+        auto packed = lazymatrixd::make(cuda::allocator::device, side);
+
+        ::lazy::gather<<<d::blocks(side), d::threads(side)>>>(packed, *this);
+
+        this->operator=(packed);
+    }
+
+    /**
+     * Removes a column from a lazy matrix. Instead of moving the matrix's elements,
+     * only the list of active offsets is shifted, so the removed column becomes
+     * a tombstone. The matrix is only compacted when tombstones pile up.
+     * @param x The line and column offset to be removed.
+     */
+    template <>
+    auto phylogeny::lazymatrixh::remove(uint32_t x) -> void
+    {
+        const auto side = m_virtual[0] - 1;
+
+        for(size_t i = x; i < side; ++i)
+            m_index[i] = m_index[i + 1];
+
+        m_virtual = {side, side};
+
+        if(side > 0 && reprdim()[0] >= threshold * side)
+            compact();
+    }
+
+    template <>
+    auto phylogeny::lazymatrixd::remove(uint32_t x) -> void
+    {
+        namespace d = cuda::device;
+        const auto side = m_virtual[0] - 1;
+
+        // As the last offset needs no shifting, removing it is simply a matter
+        // of shrinking the matrix's virtual dimensions. This is the usual case.
+        if(x < side) {
+            auto index = buffer<index_type>::make(cuda::allocator::device, side);
+            ::lazy::shift<<<d::blocks(side / d::threads() + 1), d::threads(side)>>>(index, m_index, x);
+            m_index = index;
+        }
+
+        m_virtual = {side, side};
+
+        if(side > 0 && reprdim()[0] >= threshold * side)
+            compact();
+    }
+
+    /**
+     * Swaps two columns and lines of a lazy matrix with each other, by swapping
+     * their physical offsets on the list of active offsets.
+     * @param a The first column and line offset to swap.
+     * @param b The second column and line offset to swap.
+     */
+    template <>
+    auto phylogeny::lazymatrixh::swap(uint32_t a, uint32_t b) -> void
+    {
+        utils::swap(m_index[a], m_index[b]);
+    }
+
+    template <>
+    auto phylogeny::lazymatrixd::swap(uint32_t a, uint32_t b) -> void
+    {
+        ::lazy::exchange<<<1, 1>>>(m_index, a, b);
+    }
+
+    /**
+     * Copies a lazy matrix to the compute-capable device memory. Only the active
+     * elements are copied, so the device matrix is always compact.
+     * @return The matrix allocated in device memory.
+     */
+    template <>
+    auto phylogeny::lazymatrixh::to_device() const -> phylogeny::lazymatrixd
+    {
+        const auto side = m_virtual[0];
+        auto packed = *this;
+        packed.compact();
+
+        auto instance = phylogeny::lazymatrixd::make(cuda::allocator::device, side);
+        cuda::memory::copy(instance.raw(), packed.raw(), side * side);
+        return instance;
+    }
+
+    template <>
+    auto phylogeny::lazymatrixd::to_device() const -> phylogeny::lazymatrixd
+    {
+        auto instance = *this;
+        instance.compact();
+        return instance;
+    }
+
     /*
      * Explicit template instations for the objects and methods defined above. These
      * declarations allow the linker to find our concrete implementations here.
@@ -563,4 +970,6 @@ namespace museqa
     template class phylogeny::matrix<false>;
     template class phylogeny::matrix<true, transform::symmetric>;
     template class phylogeny::matrix<false, transform::symmetric>;
+    template class phylogeny::matrix<true, transform::lazy>;
+    template class phylogeny::matrix<false, transform::lazy>;
 }
@@ -54,8 +54,8 @@ namespace museqa
                  * Instantiate from a pairwise module's distance matrix.
                  * @param mat The pairwise module's resulting matrix.
                  */
-                inline explicit matrix(const pairwise::distance_matrix& mat) noexcept
-                :   matrix {mat, mat.count()}
+                inline explicit matrix(const pairwise::distance_matrix& mat)
+                :   matrix {inflate(mat)}
                 {}
 
                 __host__ __device__ inline matrix& operator=(const matrix&) = default;
@@ -103,6 +103,27 @@ namespace museqa
                 auto swap(uint32_t, uint32_t) -> void;
                 auto to_device() const -> matrix<true, T>;
 
+                /**
+                 * Creates a new matrix of given side size.
+                 * @param side The new matrix's width and height.
+                 * @return The newly created matrix instance.
+                 */
+                inline static auto make(size_t side) noexcept -> matrix
+                {
+                    return matrix {underlying_matrix::make({side, side}), side};
+                }
+
+                /**
+                 * Creates a new matrix of given side size with an allocator.
+                 * @param allocator The allocator to be used to new matrix.
+                 * @param side The new matrix's width and height.
+                 * @return The newly created matrix instance.
+                 */
+                inline static auto make(const museqa::allocator& allocator, size_t side) -> matrix
+                {
+                    return matrix {underlying_matrix::make(allocator, {side, side}), side};
+                }
+
             protected:
                 /**
                  * Creates a new instance from an underlying matrix instance.
@@ -114,51 +135,136 @@ namespace museqa
                 ,   m_virtual {transform_type::shape(point_type {side, side})}
                 {}
 
+                static auto inflate(const pairwise::distance_matrix&) -> matrix;
+
+            friend class matrix<false, transform_type>;
+        };
+
+        /**
+         * Implements a shrinkable symmetric matrix.
+         * @tparam D Is the matrix stored on device memory?
+         * @since 0.1.1
+         */
+        template <bool D = false>
+        using symmatrix = matrix<D, transform::symmetric>;
+
+        /**
+         * Implements a shrinkable matrix which never physically moves its elements.
+         * The matrix's lines and columns are reached through a list of active offsets,
+         * so swapping or removing offsets only ever touches this list. The removed
+         * lines and columns are left behind as tombstones, and the matrix is only
+         * compacted once most of its memory is taken up by removed offsets.
+         * @tparam D Is the matrix stored on device memory?
+         * @since 0.1.1
+         */
+        template <bool D>
+        class matrix<D, transform::lazy> : public museqa::matrix<pairwise::score>
+        {
+            protected:
+                using underlying_matrix = museqa::matrix<pairwise::score>;
+                using index_type = uint32_t;
+
+            public:
+                static constexpr bool on_device = D;    /// Is matrix data on device memory?
+                static constexpr size_t threshold = 2;  /// The ratio of removed offsets prompting a compaction.
+
+            public:
+                using transform_type = transform::lazy;
+                using element_type = typename underlying_matrix::element_type;
+                using point_type = typename underlying_matrix::point_type;
+
+            protected:
+                buffer<index_type> m_index;             /// The physical line and column of each offset.
+                point_type m_virtual;                   /// The matrix's dynamic space.
+
+            public:
+                __host__ __device__ inline matrix() noexcept = default;
+                __host__ __device__ inline matrix(const matrix&) noexcept = default;
+                __host__ __device__ inline matrix(matrix&&) noexcept = default;
+
                 /**
-                 * Inflates the pairwise module's virtual distance matrix into a
-                 * full-fledged matrix for the phylogeny module.
-                 * @param mat The pairwise module's distance matrix.
-                 * @param count The total number of sequences represented in matrix.
+                 * Instantiate from a pairwise module's distance matrix.
+                 * @param mat The pairwise module's resulting matrix.
+                 */
+                inline explicit matrix(const pairwise::distance_matrix& mat)
+                :   matrix {inflate(mat)}
+                {}
+
+                __host__ __device__ inline matrix& operator=(const matrix&) = default;
+                __host__ __device__ inline matrix& operator=(matrix&&) = default;
+
+                /**
+                 * Gives access to an element in the matrix.
+                 * @param offset The element's offset value.
+                 * @return The requested element.
                  */
-                inline explicit matrix(const pairwise::distance_matrix& mat, size_t count) noexcept
-                :   underlying_matrix {underlying_matrix::make({count, count})}
-                ,   m_virtual {transform_type::shape(point_type {count, count})}
+                __host__ __device__ inline element_type& operator[](const point_type& offset)
                 {
-                    for(size_t i = 0; i < count; ++i)
-                        for(size_t j = 0; j <= i; ++j)
-                            operator[]({i, j}) = operator[]({j, i}) = mat[{i, j}];
+                    return underlying_matrix::operator[]({m_index[offset.x], m_index[offset.y]});
                 }
 
                 /**
-                 * Creates a new matrix of given side size.
-                 * @param side The new matrix's width and height.
-                 * @return The newly created matrix instance.
+                 * Gives access to a const-qualified element in the matrix.
+                 * @param offset The element's offset value.
+                 * @return The requested const-qualified element.
                  */
-                inline static auto make(size_t side) noexcept -> matrix
+                __host__ __device__ inline const element_type& operator[](const point_type& offset) const
                 {
-                    return matrix {underlying_matrix::make({side, side}), side};
+                    return underlying_matrix::operator[]({m_index[offset.x], m_index[offset.y]});
                 }
 
                 /**
-                 * Creates a new matrix of given side size with an allocator.
-                 * @param allocator The allocator to be used to new matrix.
-                 * @param side The new matrix's width and height.
-                 * @return The newly created matrix instance.
+                 * Informs the matrix's projection dimensions.
+                 * @return The matrix's projected size.
                  */
-                inline static auto make(const museqa::allocator& allocator, size_t side) -> matrix
+                __host__ __device__ inline point_type dimension() const noexcept
                 {
-                    return matrix {underlying_matrix::make(allocator, {side, side}), side};
+                    return m_virtual;
+                }
+
+                /**
+                 * Informs the matrix's internal representation dimensions. These
+                 * include the lines and columns which have already been removed.
+                 * @return The matrix's shape in memory.
+                 */
+                __host__ __device__ inline point_type reprdim() const noexcept
+                {
+                    return underlying_matrix::dimension();
                 }
 
+                auto remove(uint32_t) -> void;
+                auto swap(uint32_t, uint32_t) -> void;
+                auto compact() -> void;
+                auto to_device() const -> matrix<true, transform_type>;
+
+                static auto make(size_t) -> matrix;
+                static auto make(const museqa::allocator&, size_t) -> matrix;
+
+            protected:
+                /**
+                 * Creates a new instance from an underlying matrix instance.
+                 * @param mat The base matrix instance to be copied.
+                 * @param index The physical line and column of each offset.
+                 * @param side The matrix's virtual side size.
+                 */
+                inline explicit matrix(const underlying_matrix& mat, const buffer<index_type>& index, size_t side)
+                noexcept
+                :   underlying_matrix {mat}
+                ,   m_index {index}
+                ,   m_virtual {side, side}
+                {}
+
+                static auto inflate(const pairwise::distance_matrix&) -> matrix;
+
             friend class matrix<false, transform_type>;
         };
 
         /**
-         * Implements a shrinkable symmetric matrix.
+         * Implements a shrinkable lazily compacted matrix.
          * @tparam D Is the matrix stored on device memory?
          * @since 0.1.1
          */
         template <bool D = false>
-        using symmatrix = matrix<D, transform::symmetric>;
+        using lazymatrix = matrix<D, transform::lazy>;
     }
 }
@@ -0,0 +1,414 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Distributed implementation for the phylogeny module's neighbor-joining algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2019-present Rodrigo Siqueira
+ */
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "mpi.hpp"
+#include "node.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "parallel.hpp"
+#include "pairwise.cuh"
+#include "environment.h"
+
+#include "phylogeny/phylogeny.cuh"
+#include "phylogeny/njoining/star.cuh"
+#include "phylogeny/njoining/njoining.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace phylogeny;
+
+    /**
+     * The algorithm's distance type.
+     * @since 0.1.1
+     */
+    using distance_type = otu::distance_type;
+
+    /**
+     * The type for mapping an OTU's slot to its reference on the tree.
+     * @since 0.1.1
+     */
+    using map_type = buffer<oturef>;
+
+    /**
+     * Defines a cache for the matrix's rows sums.
+     * @since 0.1.1
+     */
+    using cache_type = buffer<distance_type>;
+
+    #if !defined(__museqa_runtime_cython)
+        /*
+         * The tag of the messages carrying the distance matrix's rows from the
+         * master node to the working nodes owning them.
+         */
+        enum : mpi::tag { rows_tag = 0x7d };
+    #endif
+
+    /**
+     * The distributed neighbor-joining algorithm's data structures' state. The
+     * matrix's rows are dealt cyclically among the working nodes, each of which
+     * holds only its own rows. Every row is as wide as the whole matrix, so all
+     * of a row's distances are on the node owning the row. As the rows sums and
+     * the OTUs' slots are small, these are known by all nodes.
+     * @since 0.1.1
+     */
+    struct state
+    {
+        map_type map;                   /// The OTU references of each matrix slot.
+        cache_type cache;               /// The cache of rows total sums.
+        std::vector<oturef> active;     /// The slots yet to be joined, in ascending order.
+        buffer<distance_type> rows;     /// The node's own rows of the distance matrix.
+        size_t width;                   /// The matrix's total number of slots.
+        size_t workers;                 /// The number of nodes owning matrix rows.
+        size_t id;                      /// The node's index among the working nodes.
+    };
+
+    /**
+     * Informs the working node owning a slot's row.
+     * @param state The algorithm's state data structures.
+     * @param slot The slot to find the owner of.
+     * @return The index of the working node owning the slot's row.
+     */
+    inline auto owner(const state& state, oturef slot) noexcept -> size_t
+    {
+        return slot % state.workers;
+    }
+
+    /**#@+
+     * Gives access to one of the node's own rows of the matrix.
+     * @param state The algorithm's state data structures.
+     * @param slot The slot of the requested row, which must be owned by the node.
+     * @return The pointer to the row's first distance.
+     */
+    inline auto row(state& state, oturef slot) noexcept -> distance_type *
+    {
+        return state.rows.raw() + (slot / state.workers) * state.width;
+    }
+
+    inline auto row(const state& state, oturef slot) noexcept -> const distance_type *
+    {
+        return state.rows.raw() + (slot / state.workers) * state.width;
+    }
+    /**#@-*/
+
+    /**
+     * Lays out the rows of the distance matrix owned by a working node.
+     * @param matrix The pairwise module's distance matrix.
+     * @param count The total number of OTUs to be aligned.
+     * @param workers The number of nodes owning matrix rows.
+     * @param id The index of the working node to lay out the rows of.
+     * @return The working node's rows of the distance matrix.
+     */
+    static auto layout(const pairwise::distance_matrix& matrix, size_t count, size_t workers, size_t id)
+    -> buffer<distance_type>
+    {
+        const size_t local = id < count ? (count - id - 1) / workers + 1 : 0;
+        auto rows = buffer<distance_type>::make(local * count);
+
+        parallel::foreach(local, [&](const range<size_t>& partition, size_t) {
+            for(size_t l = partition.offset; l < partition.offset + partition.total; ++l)
+                for(size_t k = 0; k < count; ++k)
+                    rows[l * count + k] = matrix[{l * workers + id, k}];
+        });
+
+        return rows;
+    }
+
+    /**
+     * Initialize a new algorithm state instance. The master node, which is the
+     * only one knowing the whole matrix, sends each working node its own rows,
+     * and their sums are then combined so all nodes know them.
+     * @param matrix The pairwise module's distance matrix, on the master node.
+     * @param count The total number of OTUs to be aligned.
+     * @return The initialized algorithm state instance.
+     */
+    static auto initialize(const pairwise::distance_matrix& matrix, size_t count) -> state
+    {
+        state state;
+
+        #if !defined(__museqa_runtime_cython)
+            state.workers = utils::max<size_t>(node::count - 1, 1);
+            state.id = node::rank > 0 ? node::rank - 1 : state.workers;
+        #else
+            state.workers = 1;
+            state.id = 0;
+        #endif
+
+        state.width = count;
+        state.map = map_type::make(count);
+        state.cache = cache_type::make(count);
+        state.active.resize(count);
+
+        for(size_t i = 0; i < count; ++i) {
+            state.map[i] = state.active[i] = (oturef) i;
+            state.cache[i] = (distance_type) 0;
+        }
+
+        #if !defined(__museqa_runtime_cython)
+            // The rows are laid out for a single working node at a time, so the
+            // master never holds more than one node's rows besides the matrix.
+            onlymaster for(size_t w = 0; w + 1 < (size_t) node::count; ++w) {
+                auto rows = layout(matrix, count, state.workers, w);
+                mpi::send(rows, (node::id) (w + 1), rows_tag);
+            }
+
+            onlyslaves {
+                buffer<distance_type> received = mpi::receive<distance_type>(node::master, rows_tag);
+                state.rows = received;
+            }
+        #else
+            state.rows = layout(matrix, count, state.workers, state.id);
+        #endif
+
+        onlyslaves {
+            const size_t local = state.rows.size() / count;
+
+            parallel::foreach(local, [&](const range<size_t>& partition, size_t) {
+                for(size_t l = partition.offset; l < partition.offset + partition.total; ++l) {
+                    const auto slot = (oturef) (l * state.workers + state.id);
+                    const auto line = row(state, slot);
+
+                    for(size_t k = 0; k < count; ++k)
+                        state.cache[slot] += line[k];
+                }
+            });
+        }
+
+        #if !defined(__museqa_runtime_cython)
+            cache_type received = mpi::allreduce(state.cache, mpi::op::add);
+            state.cache = received;
+        #endif
+
+        return state;
+    }
+
+    /**
+     * Checks whether a pair beats the chosen candidate. Ties are broken by
+     * whichever pair comes first on the linear pair space, so the same pair is
+     * chosen regardless of how many nodes or threads the search is split among.
+     * @param distance The pair's Q-value.
+     * @param x The pair's first and greatest slot.
+     * @param y The pair's second slot.
+     * @param chosen The currently chosen candidate.
+     * @return Does the pair beat the chosen candidate?
+     */
+    inline auto better(distance_type distance, oturef x, oturef y, const njoining::candidate& chosen) noexcept
+    -> bool
+    {
+        if(distance != chosen.distance)
+            return distance > chosen.distance;
+
+        return chosen.ref[0] == undefined || x < chosen.ref[0]
+            || (x == chosen.ref[0] && y < chosen.ref[1]);
+    }
+
+    /**
+     * Finds the best joinable pair among the node's own rows. A row is only paired
+     * with the slots before it, so every pair is inspected by a single node. As
+     * rows get longer towards the matrix's end, rows are folded before being split
+     * among the node's threads, so each thread gets both short and long rows.
+     * @param state The algorithm's state data structures.
+     * @return The best joinable pair candidate found on the node's rows.
+     */
+    static auto pick_joinable(const state& state) -> njoining::joinable
+    {
+        const size_t count = state.active.size();
+        std::vector<size_t> lines;
+
+        for(size_t a = 0; a < count; ++a)
+            if(owner(state, state.active[a]) == state.id)
+                lines.push_back(a);
+
+        auto candidates = std::vector<njoining::candidate> (parallel::global().size());
+
+        parallel::foreach(lines.size(), [&](const range<size_t>& partition, size_t id) {
+            njoining::candidate chosen;
+
+            for(size_t l = partition.offset; l < partition.offset + partition.total; ++l) {
+                const size_t a = lines[(l % 2) ? lines.size() - 1 - l / 2 : l / 2];
+                const oturef x = state.active[a];
+                const distance_type *line = row(state, x);
+
+                for(size_t b = 0; b < a; ++b) {
+                    const oturef y = state.active[b];
+                    const auto distance = (count - 2) * line[y] - state.cache[x] - state.cache[y];
+
+                    if(better(distance, x, y, chosen))
+                        chosen = njoining::candidate {x, y, distance};
+                }
+            }
+
+            candidates[id] = chosen;
+        });
+
+        njoining::candidate chosen;
+
+        for(const auto& candidate : candidates)
+            if(candidate.ref[0] != undefined && better(candidate.distance, candidate.ref[0], candidate.ref[1], chosen))
+                chosen = candidate;
+
+        if(chosen.ref[0] == undefined)
+            return njoining::joinable {};
+
+        // As only this node has the chosen pair's distance, its deltas must be
+        // calculated right away, before the candidates are reduced.
+        const auto x = chosen.ref[0], y = chosen.ref[1];
+        const auto distance_xy = row(state, x)[y];
+        const auto pairsum = state.cache[x] - state.cache[y];
+
+        const distance_type dx = count > 2
+            ? (.5 * distance_xy) + (pairsum / (2 * (count - 2)))
+            : (.5 * distance_xy);
+
+        return {chosen, dx, distance_xy - dx};
+    }
+
+    /**
+     * Shares a row of the matrix with all nodes, from the node owning it.
+     * @param state The algorithm's state data structures.
+     * @param slot The slot of the row to be shared.
+     * @return The requested row's distances.
+     */
+    static auto share(const state& state, oturef slot) -> buffer<distance_type>
+    {
+        buffer<distance_type> line;
+
+        if(owner(state, slot) == state.id)
+            line = buffer<distance_type>::copy(row(state, slot), state.width);
+
+        #if !defined(__museqa_runtime_cython)
+            buffer<distance_type> received = mpi::broadcast(line, (int) owner(state, slot) + 1);
+            if(owner(state, slot) != state.id) line = received;
+        #endif
+
+        return line;
+    }
+
+    /**
+     * Joins an OTU pair into a new parent OTU. The joined pair's rows are shared
+     * with all nodes, so each node can update its own rows and the rows sums.
+     * @param tree The phylogenetic tree being constructed.
+     * @param parent The parent OTU into which the pair will be joined.
+     * @param state The algorithm's state data structures.
+     * @param join The OTU pair to join.
+     */
+    static void join_pair(njoining::star& tree, oturef parent, state& state, const njoining::joinable& join)
+    {
+        const auto x = join.ref[0];
+        const auto y = join.ref[1];
+
+        tree.join(parent, {state.map[x], join.delta[0]}, {state.map[y], join.delta[1]});
+
+        const auto one = share(state, x);
+        const auto two = share(state, y);
+        const distance_type distance_xy = one[y];
+
+        auto new_distances = buffer<distance_type>::make(state.width);
+        distance_type new_sum = 0;
+
+        state.active.erase(std::lower_bound(state.active.begin(), state.active.end(), y));
+
+        // Let's calculate the distances between the OTU being created and the
+        // others which have not been affected by the current joining operation.
+        for(const auto k : state.active) {
+            const auto previous = one[k] + two[k];
+            const auto updated = (k != x) ? (previous - distance_xy) * .5 : distance_type {0};
+
+            new_distances[k] = updated;
+            state.cache[k] += updated - previous;
+            new_sum += updated;
+        }
+
+        // The new OTU takes up the first OTU's slot. Thus, its distances must now
+        // be copied to the first OTU's row and column on the node's own rows.
+        onlyslaves {
+            for(const auto k : state.active)
+                if(owner(state, k) == state.id)
+                    row(state, k)[x] = new_distances[k];
+
+            if(owner(state, x) == state.id)
+                for(const auto k : state.active)
+                    row(state, x)[k] = new_distances[k];
+        }
+
+        state.cache[x] = new_sum;
+        state.map[x] = parent;
+    }
+
+    /**
+     * The distributed neighbor-joining algorithm object. This algorithm splits
+     * the distance matrix's rows among the working nodes, so no node must ever
+     * hold the whole matrix, and the problem size scales with the nodes' memory.
+     * @since 0.1.1
+     */
+    struct distributed : public njoining::algorithm
+    {
+        /**
+         * Keeps the distance matrix on the master node only. Rather than the whole
+         * matrix, each working node is later sent only the rows it owns.
+         * @param matrix The pairwise module's distance matrix, on the master node.
+         * @return The unchanged distance matrix.
+         */
+        auto share(const pairwise::distance_matrix& matrix, size_t) const -> pairwise::distance_matrix override
+        {
+            return matrix;
+        }
+
+        /**
+         * Builds the pseudo-phylogenetic tree from the given distance matrix.
+         * @param state The algorithm's state data structures.
+         * @return The calculated phylogenetic tree.
+         */
+        auto build_tree(state& state) const -> njoining::star
+        {
+            oturef parent = (oturef) state.width;
+            auto tree = njoining::star::make(state.width);
+
+            while(state.active.size() > 1) {
+                njoining::joinable vote;
+
+                onlyslaves vote = pick_joinable(state);
+                vote = this->reduce(vote);
+
+                join_pair(tree, parent++, state, vote);
+            }
+
+            return tree;
+        }
+
+        /**
+         * Executes the distributed neighbor-joining algorithm for the phylogeny step.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> guidetree override
+        {
+            if(ctx.count < 2)
+                return guidetree {};
+
+            auto state = initialize(ctx.matrix, ctx.count);
+            auto result = build_tree(state);
+
+            return result;
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Instantiates a new distributed neighbor-joining instance.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::distributed() -> phylogeny::algorithm *
+    {
+        return new ::distributed;
+    }
+}
@@ -5,16 +5,23 @@
  * @copyright 2019-present Rodrigo Siqueira
  */
 #include <limits>
+#include <string>
+#include <vector>
 #include <cstdint>
 #include <utility>
+#include <algorithm>
 
 #include "cuda.cuh"
+#include "cuda/reduce.cuh"
+#include "cuda/tuning.cuh"
 #include "node.hpp"
 #include "oeis.hpp"
 #include "utils.hpp"
 #include "buffer.hpp"
 #include "matrix.hpp"
+#include "collective.hpp"
 #include "pairwise.cuh"
+#include "trace.hpp"
 #include "exception.hpp"
 #include "transform.hpp"
 #include "environment.h"
@@ -35,6 +42,15 @@ namespace
      * the algorithm's execution, thus, they shall be modified with caution.
      */
     enum : size_t { reduce_factor = 2 };
+    enum : size_t { batch_factor = 32 };
+    enum : size_t { resync_factor = 64 };
+
+    /*
+     * The caps on the number of threads per block tried when tuning the search for
+     * the best joinable pair. By default, blocks are only capped by the device.
+     */
+    static const uint32_t thread_caps[] = {128, 256, 512, 1024};
+    enum : size_t { default_cap = 3 };
 
     /**
      * The algorithm's distance type. 
@@ -42,6 +58,14 @@ namespace
      */
     using distance_type = otu::distance_type;
 
+    /**
+     * The type of the matrix's rows sums. As the sums are incrementally updated
+     * on every join, they are kept in double precision, so their rounding errors
+     * do not build up enough to change which pair is chosen to be joined.
+     * @since 0.1.1
+     */
+    using sum_type = double;
+
     /**
      * The type for mapping an OTU to its coordinates on the matrix.
      * @since 0.1.1
@@ -52,7 +76,7 @@ namespace
      * Defines a cache for the matrix's columns and row sums.
      * @since 0.1.1
      */
-    using cache_type = buffer<distance_type>;
+    using cache_type = buffer<sum_type>;
 
     /**
      * The point type required by the algorithm's matrices.
@@ -82,18 +106,6 @@ namespace
         size_t count;                   /// The number of OTUs yet to be joined.
     };
 
-    /**
-     * The reduceable interface. This interface's implementations shall be forced
-     * to have a method to reduce two elements at the given offsets together.
-     * @tparam T The type of elements to be reduced.
-     * @since 0.1.1
-     */
-    template <typename T>
-    struct reduceable
-    {
-        __device__ static inline void reduce(volatile T *, size_t, size_t);
-    };
-
     /**
      * Calculates the highest number which is a power of 2 and is smaller than or
      * equal to the given input.
@@ -115,32 +127,6 @@ namespace
       #endif
     }
 
-    /**
-     * Performs a reduce inside a single warp.
-     * @tparam N The number of total elements being reduced.
-     * @tparam T The type of elements being reduced.
-     * @param data The data array being reduced into a single value.
-     * @param offset The current thread's offset to process.
-     */
-    template <typename R, typename T>
-    __device__ inline void reduce(volatile T *data, size_t count, size_t offset)
-    {
-        static_assert(std::is_base_of<reduceable<T>, R>::value, "invalid reduceable type");
-
-        switch(count) {
-            case 1024: if(offset < 512) { R::reduce(data, offset, offset + 512); } __syncthreads();
-            case  512: if(offset < 256) { R::reduce(data, offset, offset + 256); } __syncthreads();
-            case  256: if(offset < 128) { R::reduce(data, offset, offset + 128); } __syncthreads();
-            case  128: if(offset <  64) { R::reduce(data, offset, offset +  64); } __syncthreads();
-            case   64: if(offset <  32) { R::reduce(data, offset, offset +  32); }
-            case   32: if(offset <  16) { R::reduce(data, offset, offset +  16); }
-            case   16: if(offset <   8) { R::reduce(data, offset, offset +   8); }
-            case    8: if(offset <   4) { R::reduce(data, offset, offset +   4); }
-            case    4: if(offset <   2) { R::reduce(data, offset, offset +   2); }
-            case    2: if(offset <   1) { R::reduce(data, offset, offset +   1); }
-        }
-    }
-
     /**
      * Fills the distance matrix's distances sum cache on device memory.
      * @tparam T The algorithm's distance matrix's spatial transformation.
@@ -149,37 +135,31 @@ namespace
     template <typename T>
     __global__ void fill_cache(state<T> state)
     {
-        extern __shared__ distance_type sums[];
+        extern __shared__ sum_type sums[];
 
         // Implements the reduction operation for filling the distance matrix's
         // columns and lines cache. As we are interested on building a cache with
         // the total sum of the matrix's lines and columns, this operation shall
-        // simply accumulate by summing two data offsets into one.
-        using sum = struct : reduceable<distance_type> {
-            __device__ static inline void reduce(volatile distance_type *data, size_t dest, size_t src) {
-                data[dest] += data[src];
-            }
-        };
+        // simply accumulate by summing two values into one.
+        const auto sum = [] (sum_type a, sum_type b) { return a + b; };
 
         // For each of the distance matrix's columns and lines, we must iterate
         // over their elements and sum them all together in order to fill our cache.
         for(int32_t i = blockIdx.x; i < state.count; i += gridDim.x) {
-            sums[threadIdx.x] = 0;
+            sum_type partial = 0;
 
             // As we cannot spawn a thread to every single element of our cache
             // or distance matrix, we must "manually" sum every exceeding element
-            // so that these elements are included when we reduce our shared array.
+            // so that these elements are included when we reduce the block's sums.
             for(int32_t j = threadIdx.x; j < state.count; j += blockDim.x)
-                sums[threadIdx.x] += state.matrix[{i, j}];
-
-            __syncthreads();
+                partial += state.matrix[{i, j}];
 
-            // Now that our shared array is ready to be reduced, and all exceeding
-            // elements have been summed, we can perform our reduce operation.
-            reduce<sum>(sums, blockDim.x, threadIdx.x);
+            // Now that all exceeding elements have been summed, we can reduce the
+            // block's sums. Only each warp's sum goes through shared memory.
+            partial = cuda::reduce::block(partial, sum, sums);
 
             if(threadIdx.x == 0)
-                state.cache[i] = sums[0];
+                state.cache[i] = partial;
         }
     }
 
@@ -196,12 +176,13 @@ namespace
         const auto width  = (int32_t) state.matrix.dimension()[1];
 
         // The number of threads spawned by each block to initialize our cache will
-        // be a power of 2 roughly equal to half the width of our matrix. We force
-        // such specific number in order to take the most out of our reduce kernel.
+        // be a power of 2 roughly equal to half the width of our matrix, so that
+        // every warp is full and takes part in reducing the rows' sums.
         const auto blocks  = d::blocks(height);
         const auto threads = floor_power2(d::threads(width / reduce_factor));
 
-        fill_cache<<<blocks, threads, sizeof(distance_type) * threads>>>(state);
+        trace::kernel span {"njoining::fill_cache"};
+        fill_cache<<<blocks, threads, sizeof(sum_type) * cuda::warp_size>>>(state);
     }
 
     /**
@@ -216,14 +197,22 @@ namespace
     static auto initialize(const pairwise::distance_matrix& matrix, size_t count) -> state<T>
     {
         state<T> state;
-        auto hmatrix = phylogeny::matrix<false, T> {matrix};
 
-        state.matrix = hmatrix.to_device();
+        state.matrix = distance_matrix<T> {matrix};
         state.map = map_type::make(count);
         state.count = count;
 
-        onlyslaves state.cache = cache_type::make(cuda::allocator::device, state.count);
-        onlyslaves cache_init(state);
+        // If the matrix's row sums have already been found by the pairwise module,
+        // while its scores were streaming in, they are simply sent to the device.
+        onlyslaves {
+            state.cache = cache_type::make(cuda::allocator::device, state.count);
+
+            if(matrix.sums().size() == count) {
+                cuda::memory::copy(state.cache.raw(), matrix.sums().raw(), count);
+            } else {
+                cache_init(state);
+            }
+        }
 
         for(size_t i = 0; i < count; ++i)
             state.map[i] = (oturef) i;
@@ -241,7 +230,8 @@ namespace
     template <typename T>
     __device__ inline distance_type q_transform(const state<T>& state, const pair_type& pair)
     {
-        return (state.count - 2) * state.matrix[pair] - state.cache[pair.x] - state.cache[pair.y];
+        return (state.count - 2) * state.matrix[pair]
+            - distance_type(state.cache[pair.x]) - distance_type(state.cache[pair.y]);
     }
 
     /**
@@ -258,7 +248,7 @@ namespace
         )
     {
         const pair_type pair = {chosen.ref[0], chosen.ref[1]};
-        const auto pairsum = state.cache[pair.x] - state.cache[pair.y];
+        const auto pairsum = distance_type(state.cache[pair.x] - state.cache[pair.y]);
 
         const distance_type dx = (.5 * state.matrix[pair]) + (pairsum / (2 * (state.count - 2)));
         const distance_type dy = state.matrix[pair] - dx;
@@ -281,64 +271,131 @@ namespace
         )
     {
         extern __shared__ njoining::candidate list[];
-        new (&list[threadIdx.x]) njoining::candidate {};
+        njoining::candidate chosen;
 
         // Implements a reduction operation for finding the local best OTU pair
         // to be joined next. As we apply the Q-transformation for every pair on
         // the distance matrix, we must find the one with the smallest Q-value.
-        using max = struct : reduceable<njoining::candidate> {
-            __device__ static inline void reduce(volatile njoining::candidate *data, size_t dest, size_t src) {
-                if(data[src].distance > data[dest].distance) data[dest] = data[src];
-            }
+        const auto max = [] (const njoining::candidate& a, const njoining::candidate& b) {
+            return b.distance > a.distance ? b : a;
         };
 
         // As we cannot spawn a thread for every single pair we must calculate,
-        // we have to process the excess before reducing our shared array.
+        // we have to process the excess before reducing the block's candidates.
         for(size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < partition.total; i += gridDim.x * blockDim.x) {
             const size_t x = oeis::a002024(partition.offset + i + 1);
             const size_t y = (partition.offset + i) - utils::nchoose(x);
             const auto distance = q_transform(state, {x, y});
 
-            if(distance > list[threadIdx.x].distance)
-                list[threadIdx.x] = njoining::candidate {x, y, distance};
+            if(distance > chosen.distance)
+                chosen = njoining::candidate {x, y, distance};
         }
 
-        __syncthreads();
-
-        // Reduces the shared list of candidates to find the absolute local best
-        // on the current device. The list has already been reduced to a smaller
+        // Reduces the block's candidates to find the absolute local best on the
+        // current device. The candidates have already been reduced to a smaller
         // amount due to the operation performed above.
-        reduce<max>(list, blockDim.x, threadIdx.x);
+        chosen = cuda::reduce::block(chosen, max, list);
 
         if(threadIdx.x == 0)
-            result[blockIdx.x] = raise_candidate(state, list[0]);
+            result[blockIdx.x] = raise_candidate(state, chosen);
     }
 
     /**
-     * Finds the best joinable pair on the given partition.
+     * Picks the node's vote among the candidates found by each block, so the vote
+     * never has to leave the device. Just as on the host, the first candidate with
+     * the biggest distance is picked.
+     * @param vote The node's picked vote.
+     * @param candidates The candidates found by each block.
+     * @param count The number of candidates found.
+     */
+    __global__ void pick_vote(njoining::joinable *vote, const njoining::joinable *candidates, size_t count)
+    {
+        size_t biggest = 0;
+
+        for(size_t i = 1; i < count; ++i)
+            if(candidates[i].distance > candidates[biggest].distance)
+                biggest = i;
+
+        *vote = candidates[biggest];
+    }
+
+    /**
+     * Elects the globally best joinable pair among the votes of all nodes. The votes
+     * are reduced just as the host collective would, so both paths always agree.
+     * @param elected The elected joinable pair.
+     * @param votes The votes of all nodes.
+     * @param count The number of nodes.
+     */
+    __global__ void pick_closest(njoining::joinable *elected, const njoining::joinable *votes, size_t count)
+    {
+        njoining::joinable result = votes[0];
+
+        for(size_t i = 1; i < count; ++i)
+            result = njoining::closest(result, votes[i]);
+
+        *elected = result;
+    }
+
+    /**
+     * Searches for the best joinable pair on the given partition. The best candidate
+     * found by each block is left on device memory.
      * @tparam T The algorithm's distance matrix's spatial transformation.
      * @param state The algorithm's state data structures.
      * @param partition The local range at which a candidate must be found.
-     * @return The best joinable pair candidate found on the given partition.
+     * @return The candidates found on the given partition, and their number.
      */
     template <typename T>
-    static njoining::joinable pick_joinable(const state<T>& state, const range<size_t>& partition)
+    static auto find_joinable(const state<T>& state, const range<size_t>& partition)
+    -> std::pair<buffer<njoining::joinable>, size_t>
     {
         using namespace cuda::device;
 
+        static const std::vector<std::string> labels = {"128", "256", "512", "1024"};
+
         // The number of threads spawned by each block to find the local best joinable
-        // OTU will be a power of 2 roughly equal to half the partition size. Also,
-        // we only spawn new blocks if all of its threads will be used.
+        // OTU will be a power of 2 roughly equal to half the partition size, up
+        // to the cap tuned for the device. Also, we only spawn new blocks if all
+        // of its threads will be used.
         const size_t total = partition.total / reduce_factor;
-        const auto threads = floor_power2(d::threads(total));
-        const auto blocks  = utils::max(1UL, d::blocks(total / threads));
+
+        auto shape = [&](size_t cap) {
+            const auto threads = floor_power2(d::threads(utils::min<size_t>(total, thread_caps[cap])));
+            return std::make_pair(threads, utils::max(1UL, d::blocks(total / threads)));
+        };
+
+        // The smallest cap spawns the most blocks, so the candidates' buffer is
+        // sized for it, and every configuration may be timed on the same buffer.
+        auto chosen = buffer<njoining::joinable>::make(cuda::allocator::device, shape(0).second);
+
+        auto launch = [&](size_t cap) {
+            const auto config = shape(cap);
+            trace::kernel span {"njoining::find_candidates"};
+            find_candidates<<<config.second, config.first, sizeof(njoining::candidate) * cuda::warp_size>>>(chosen, state, partition);
+        };
+
+        const size_t cap = cuda::tuning::pick("njoining::find_candidates", labels, default_cap, launch);
+        launch(cap);
+
+        return {chosen, shape(cap).second};
+    }
+
+    /**
+     * Finds the best joinable pair on the given partition.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
+     * @param state The algorithm's state data structures.
+     * @param partition The local range at which a candidate must be found.
+     * @return The best joinable pair candidate found on the given partition.
+     */
+    template <typename T>
+    static njoining::joinable pick_joinable(const state<T>& state, const range<size_t>& partition)
+    {
+        const auto found = find_joinable(state, partition);
+        const size_t blocks = found.second;
 
         auto result = buffer<njoining::joinable>::make(blocks);
-        auto chosen = buffer<njoining::joinable>::make(cuda::allocator::device, blocks);
         size_t biggest = 0;
 
-        find_candidates<<<blocks, threads, sizeof(njoining::candidate) * threads>>>(chosen, state, partition);
-        cuda::memory::copy(result.raw(), chosen.raw(), blocks);
+        cuda::memory::copy(result.raw(), found.first.raw(), blocks);
 
         // Now that we reduced the total number of candidates, we can finally apply
         // a small reduction to find the absolute best on this node's partition.
@@ -350,18 +407,73 @@ namespace
     }
 
     /**
-     * Updates the linear star tree's cache structures by removing an OTU.
+     * Elects the globally best joinable pair, exchanging the nodes' votes directly
+     * from device memory. Each node's vote is picked and the votes are reduced on
+     * the devices, so only the elected pair is ever copied into host memory. The
+     * master node, which drives no devices, takes part with host memory instead.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
+     * @param state The algorithm's state data structures.
+     * @param partition The local range at which a candidate must be found.
+     * @param active Has the node been given a partition to search?
+     * @param votes The node's own vote, followed by the votes of all nodes.
+     * @return The globally best joinable pair.
+     */
+    template <typename T>
+    static njoining::joinable elect_joinable(
+            const state<T>& state
+        ,   const range<size_t>& partition
+        ,   bool active
+        ,   buffer<njoining::joinable>& votes
+        )
+    {
+        njoining::joinable result;
+
+        onlyslaves {
+            if(active) {
+                const auto found = find_joinable(state, partition);
+                trace::kernel span {"njoining::pick_vote"};
+                pick_vote<<<1, 1>>>(votes.raw(), found.first.raw(), found.second);
+            } else {
+                cuda::memory::copy(votes.raw(), &result);
+            }
+
+            // The MPI implementation does not wait for any device work, so the
+            // node's vote must have been picked before it can be sent away.
+            cuda::barrier();
+        }
+
+        onlymaster votes[0] = result;
+
+        collective::allgather(votes.raw(), votes.raw() + 1, sizeof(njoining::joinable));
+
+        onlyslaves {
+            trace::kernel span {"njoining::pick_closest"};
+            pick_closest<<<1, 1>>>(votes.raw(), votes.raw() + 1, node::count);
+        }
+
+        onlyslaves cuda::memory::copy(&result, votes.raw());
+        onlymaster for(int32_t i = 0; i < node::count; ++i)
+            result = njoining::closest(result, votes[i + 1]);
+
+        return result;
+    }
+
+    /**
+     * Updates the linear star tree's cache structures by removing an OTU. As the
+     * lazy matrix only moves elements when compacted, it shares the linear layout.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
      * @param state The algorithm's state data structures.
      * @param target The OTU to be removed from the star tree's caches and matrix.
      */
-    static void update_cache(state<transform::linear<2>>& state, oturef target)
+    template <typename T>
+    static void update_cache(state<T>& state, oturef target)
     {
         onlyslaves {
             if(target != state.count - 1)
                 state.matrix.swap(target, state.count - 1);
 
             state.matrix.remove(state.count - 1);
-            state.cache = buffer_slice<distance_type> {state.cache, 0, state.count - 1};
+            state.cache = buffer_slice<sum_type> {state.cache, 0, state.count - 1};
         }
 
         utils::swap(state.map[target], state.map[state.count - 1]);
@@ -380,7 +492,7 @@ namespace
                 state.matrix.swap(0, target);
 
             state.matrix.remove(0);
-            state.cache = buffer_slice<distance_type> {state.cache, 1, state.count - 1};
+            state.cache = buffer_slice<sum_type> {state.cache, 1, state.count - 1};
         }
 
         utils::swap(state.map[0], state.map[target]);
@@ -396,27 +508,27 @@ namespace
     template <typename T>
     __global__ void rebuild(state<T> state, const pair_type pair)
     {
-        __shared__ distance_type distance_xy, new_sum;
+        __shared__ sum_type sums[cuda::warp_size];
         extern __shared__ distance_type new_distances[];
-        
-        if(threadIdx.x == 0) {
-            distance_xy = state.matrix[pair];
-            new_sum = 0;
-        }
 
-        __syncthreads();
+        const distance_type distance_xy = state.matrix[pair];
+        sum_type new_sum = 0;
 
         // Calculate the distances from the new OTU, being created from the join
-        // of the two given OTUs, to all other unmodified OTUs.
+        // of the two given OTUs, to all other unmodified OTUs. The rows sums are
+        // updated in double precision, from the exact distances they have summed.
         for(size_t i = threadIdx.x; i < state.count; i += blockDim.x) {
-            const auto previous = state.matrix[{i, pair.x}] + state.matrix[{i, pair.y}];
-            const auto updated = (previous - distance_xy) * .5;
+            const auto one = state.matrix[{i, pair.x}];
+            const auto two = state.matrix[{i, pair.y}];
+            const distance_type updated = ((one + two) - distance_xy) * .5;
 
             new_distances[i] = updated;
-            state.cache[i] += updated - previous;
-            atomicAdd(&new_sum, updated);
+            state.cache[i] += sum_type(updated) - sum_type(one) - sum_type(two);
+            new_sum += updated;
         }
 
+        new_sum = cuda::reduce::block(new_sum, [] (sum_type a, sum_type b) { return a + b; }, sums);
+
         __syncthreads();
 
         // Copies the new OTU's distances to the global distance matrix. These distances
@@ -461,7 +573,10 @@ namespace
 
         // Let's calculate the distances between the OTU being created and the others
         // which have not been affected by the current joining operation.
-        onlyslaves rebuild<<<1, d::threads(state.count), sizeof(distance_type) * state.count>>>(state, {x, y});
+        onlyslaves {
+            trace::kernel span {"njoining::rebuild"};
+            rebuild<<<1, d::threads(state.count), sizeof(distance_type) * state.count>>>(state, {x, y});
+        }
 
         // Finally, let's take advantage from our data structures' layouts and always remove
         // the cheapest column from our star tree's distance matrix.
@@ -469,6 +584,12 @@ namespace
 
         update_cache(state, y);
         state.count--;
+
+        // Although the rows sums are kept in double precision, they are still
+        // periodically recalculated from scratch, so their rounding errors stay
+        // bounded no matter how many joins there are.
+        if(state.count > 1 && state.count % resync_factor == 0)
+            onlyslaves cache_init(state);
     }
 
     /**
@@ -490,11 +611,22 @@ namespace
             oturef parent = (oturef) state.count;
             auto tree = njoining::star::make(state.count);
 
+            // If the nodes can exchange device buffers directly, their votes are
+            // elected on the devices, without being staged through host memory.
+            const bool direct = collective::device();
+            auto votes = buffer<njoining::joinable> {};
+
+            if(direct) {
+                onlymaster votes = buffer<njoining::joinable>::make(node::count + 1);
+                onlyslaves votes = buffer<njoining::joinable>::make(cuda::allocator::device, node::count + 1);
+            }
+
             // We must keep joining OTU pairs until there are only three OTUs left
             // in our star tree, so all the other OTUs have been joined.
             while(state.count > 1) {
                 range<size_t> partition;
                 njoining::joinable vote;
+                bool active = false;
 
                 onlyslaves if(state.count > node::rank) {
                     const size_t total = utils::nchoose(state.count);
@@ -512,10 +644,13 @@ namespace
 
                     // After finding each compute node's local best joinable candidate,
                     // we must gather the votes and find the best one globally.
-                    vote = pick_joinable(state, partition);
+                    if(!direct) vote = pick_joinable(state, partition);
+                    active = true;
                 }
 
-                vote = this->reduce(vote);
+                vote = direct
+                    ? elect_joinable(state, partition, active, votes)
+                    : this->reduce(vote);
 
                 // At last, we join the selected pair, rebuild our distance matrix
                 // with the newly created OTU, recalculate our sum cache with the
@@ -539,6 +674,299 @@ namespace
             auto state = initialize<T>(ctx.matrix, ctx.count);
             auto result = build_tree(state);
 
+            return result;
+        }
+    };
+    /**
+     * Finds the nearest neighbor of each OTU within the given range of rows. Each
+     * block looks for the pair with the highest Q-value on a row of the matrix.
+     * Ties are broken by the smallest neighbor index, so the nearest neighbors
+     * found are the same regardless of the kernel's launch configuration.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
+     * @param result The kernel's final result buffer.
+     * @param state The algorithm's state data structures.
+     * @param rows The range of rows to find the OTUs' nearest neighbors of.
+     */
+    template <typename T>
+    __global__ void find_neighbors(
+            buffer<njoining::joinable> result
+        ,   const state<T> state
+        ,   const range<size_t> rows
+        )
+    {
+        extern __shared__ njoining::candidate list[];
+
+        // Implements a reduction operation for finding the nearest neighbor of
+        // an OTU. Unlike when looking for the globally best pair, ties must be
+        // broken consistently, as the nearest neighbors of OTUs will be compared.
+        const auto nearest = [] (const njoining::candidate& a, const njoining::candidate& b) {
+            return (b.distance > a.distance || (b.distance == a.distance && b.ref[1] < a.ref[1])) ? b : a;
+        };
+
+        for(size_t r = blockIdx.x; r < rows.total; r += gridDim.x) {
+            const size_t i = rows.offset + r;
+            njoining::candidate chosen;
+
+            // Each thread scans the row's columns in increasing order, so it is
+            // always the smallest neighbor index which is kept on its ties.
+            for(size_t j = threadIdx.x; j < state.count; j += blockDim.x) {
+                if(j == i) continue;
+
+                const auto distance = q_transform(state, {utils::max(i, j), utils::min(i, j)});
+
+                if(distance > chosen.distance)
+                    chosen = njoining::candidate {oturef(i), oturef(j), distance};
+            }
+
+            chosen = cuda::reduce::block(chosen, nearest, list);
+
+            // The pair is kept with its highest index first, as both OTUs of a pair
+            // must always refer to it in the same way as the exhaustive search does.
+            if(threadIdx.x == 0) {
+                const auto x = utils::max(chosen.ref[0], chosen.ref[1]);
+                const auto y = utils::min(chosen.ref[0], chosen.ref[1]);
+                result[r] = raise_candidate(state, njoining::candidate {x, y, chosen.distance});
+            }
+        }
+    }
+
+    /**
+     * Finds the nearest neighbor of each OTU within the current node's share of
+     * the matrix's rows. The rows are split evenly among the compute nodes.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
+     * @param state The algorithm's state data structures.
+     * @return The nearest neighbor of each OTU within the node's rows.
+     */
+    template <typename T>
+    static auto pick_neighbors(const state<T>& state) -> std::vector<njoining::joinable>
+    {
+        using namespace cuda::device;
+        range<size_t> rows {0, state.count};
+
+        #if !defined(__museqa_runtime_cython)
+            const auto workers = utils::min<size_t>(node::count - 1, state.count);
+
+            rows = (size_t(node::rank) <= workers)
+                ? utils::partition(state.count, workers, node::rank - 1)
+                : range<size_t> {0, 0};
+        #endif
+
+        auto result = std::vector<njoining::joinable> (rows.total);
+        if(!rows.total) return result;
+
+        const auto threads = floor_power2(d::threads(utils::max<size_t>(state.count / reduce_factor, 1)));
+        const auto blocks  = d::blocks(rows.total);
+
+        auto chosen = buffer<njoining::joinable>::make(cuda::allocator::device, rows.total);
+
+        {
+            trace::kernel span {"njoining::find_neighbors"};
+            find_neighbors<<<blocks, threads, sizeof(njoining::candidate) * cuda::warp_size>>>(chosen, state, rows);
+        }
+
+        cuda::memory::copy(result.data(), chosen.raw(), rows.total);
+
+        return result;
+    }
+
+    /**
+     * Selects the pairs to be joined on the current iteration. Two OTUs which are
+     * each other's nearest neighbor are joined, as no other pair can be made with
+     * any of them. As the globally best pair is always such a pair, at least one
+     * pair is joined on each iteration, and the best pairs are joined first.
+     * @param nearest The nearest neighbor of every OTU.
+     * @return The independent pairs to be joined.
+     */
+    static auto select_joins(const std::vector<njoining::joinable>& nearest) -> std::vector<njoining::joinable>
+    {
+        std::vector<njoining::joinable> result;
+
+        // As each mutual pair is listed by both of its OTUs, a pair is only taken
+        // from the row of its highest index OTU, to not be joined twice.
+        for(size_t i = 0; i < nearest.size(); ++i) {
+            const auto& current = nearest[i];
+            const auto y = current.ref[1];
+
+            if(current.ref[0] == i && y < i && nearest[y].ref[0] == i && nearest[y].ref[1] == y)
+                result.push_back(current);
+        }
+
+        std::stable_sort(result.begin(), result.end(), [](const njoining::joinable& a, const njoining::joinable& b) {
+            return a.distance > b.distance;
+        });
+
+        if(result.size() > batch_factor)
+            result.resize(batch_factor);
+
+        return result;
+    }
+
+    /**
+     * Rebuilds the star tree's matrix after joining a batch of independent pairs.
+     * The new matrix is built out-of-place, so all joins can be applied at once. A
+     * new OTU takes the position of its pair's first OTU, while the other one is
+     * removed. The distance between two new OTUs is the same as the one that would
+     * be obtained if their pairs had been joined one after the other.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
+     * @param next The matrix to be filled with the star tree's new distances.
+     * @param state The algorithm's state data structures.
+     * @param source The previous matrix index of each new matrix index.
+     * @param partner The other OTU joined with each OTU, if any.
+     */
+    template <typename T>
+    __global__ void rebuild_batch(
+            distance_matrix<T> next
+        ,   const state<T> state
+        ,   const buffer<int32_t> source
+        ,   const buffer<int32_t> partner
+        )
+    {
+        const size_t count = source.size();
+        const size_t total = count * count;
+
+        for(size_t k = blockIdx.x * blockDim.x + threadIdx.x; k < total; k += gridDim.x * blockDim.x) {
+            const size_t a = k / count;
+            const size_t b = k % count;
+
+            const size_t i = source[a], pi = partner[i];
+            const size_t j = source[b], pj = partner[j];
+            const bool fresh_i = partner[i] >= 0, fresh_j = partner[j] >= 0;
+
+            distance_type value = 0;
+
+            if(a == b) {
+                value = 0;
+            } else if(!fresh_i && !fresh_j) {
+                value = state.matrix[{i, j}];
+            } else if(!fresh_j) {
+                value = (state.matrix[{j, i}] + state.matrix[{j, pi}] - state.matrix[{i, pi}]) * .5;
+            } else if(!fresh_i) {
+                value = (state.matrix[{i, j}] + state.matrix[{i, pj}] - state.matrix[{j, pj}]) * .5;
+            } else {
+                const auto cross = state.matrix[{i, j}] + state.matrix[{i, pj}]
+                    + state.matrix[{pi, j}] + state.matrix[{pi, pj}];
+                value = cross * .25 - (state.matrix[{i, pi}] + state.matrix[{j, pj}]) * .5;
+            }
+
+            next[{a, b}] = value;
+        }
+    }
+
+    /**
+     * Joins a batch of independent OTU pairs into new parent OTUs.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
+     * @param tree The phylogenetic tree being constructed.
+     * @param parent The first parent OTU into which the pairs will be joined.
+     * @param state The algorithm's state data structures.
+     * @param joins The OTU pairs to join.
+     */
+    template <typename T>
+    static void join_batch(
+            njoining::star& tree
+        ,   oturef parent
+        ,   state<T>& state
+        ,   const std::vector<njoining::joinable>& joins
+        )
+    {
+        using namespace cuda::device;
+
+        const size_t count = state.count - joins.size();
+
+        auto partner = std::vector<int32_t> (state.count, -1);
+        auto source = std::vector<int32_t> ();
+        auto map = map_type::make(count);
+
+        for(const auto& join : joins) {
+            tree.join(parent, {state.map[join.ref[0]], join.delta[0]}, {state.map[join.ref[1]], join.delta[1]});
+            partner[join.ref[0]] = join.ref[1];
+            partner[join.ref[1]] = -2;
+            state.map[join.ref[0]] = parent++;
+        }
+
+        // The new matrix keeps the OTUs in their previous relative order, only
+        // without the removed OTUs, so the new OTUs' positions are known by all nodes.
+        for(size_t i = 0; i < state.count; ++i)
+            if(partner[i] != -2) {
+                map[source.size()] = state.map[i];
+                source.push_back(i);
+            }
+
+        onlyslaves {
+            auto dsource = buffer<int32_t>::make(cuda::allocator::device, count);
+            auto dpartner = buffer<int32_t>::make(cuda::allocator::device, state.count);
+
+            cuda::memory::copy(dsource.raw(), source.data(), count);
+            cuda::memory::copy(dpartner.raw(), partner.data(), state.count);
+
+            auto next = distance_matrix<T>::make(cuda::allocator::device, count);
+
+            const auto threads = d::threads();
+            const auto blocks  = d::blocks((count * count + threads - 1) / threads);
+
+            trace::kernel span {"njoining::rebuild_batch"};
+            rebuild_batch<<<blocks, threads>>>(next, state, dsource, dpartner);
+
+            state.matrix = next;
+            state.cache = buffer_slice<sum_type> {state.cache, 0, count};
+        }
+
+        state.map = map;
+        state.count = count;
+
+        onlyslaves cache_init(state);
+    }
+
+    /**
+     * The batched neighbor-joining algorithm object. Instead of joining a single
+     * pair per iteration, this algorithm joins every pair of OTUs that are each
+     * other's nearest neighbor, up to a limit. The matrix is then rebuilt for the
+     * whole batch at once, with a multi-block kernel, so each iteration needs a
+     * single round trip between the host and the device.
+     * @tparam T The matrix spatial transformation to use within the algorithm.
+     * @since 0.1.1
+     */
+    template <typename T>
+    struct batched : public hybrid<T>
+    {
+        /**
+         * Builds the pseudo-phylogenetic tree from the given distance matrix.
+         * @param state The algorithm's state data structures.
+         * @return The calculated phylogenetic tree.
+         */
+        auto build_tree(state<T>& state) const -> njoining::star
+        {
+            oturef parent = (oturef) state.count;
+            auto tree = njoining::star::make(state.count);
+
+            // The nearest neighbors found by each compute node are shared with all
+            // others, so every node selects the same pairs to be joined.
+            while(state.count > 1) {
+                std::vector<njoining::joinable> nearest;
+
+                onlyslaves nearest = pick_neighbors(state);
+                nearest = this->gather(nearest);
+
+                const auto joins = select_joins(nearest);
+
+                join_batch(tree, parent, state, joins);
+                parent += joins.size();
+            }
+
+            return tree;
+        }
+
+        /**
+         * Executes the batched neighbor-joining algorithm for the phylogeny step.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> guidetree override
+        {
+            if (ctx.count < 2)
+                return guidetree {};
+
+            auto state = initialize<T>(ctx.matrix, ctx.count);
+            auto result = build_tree(state);
+
             return result;
         }
     };
@@ -563,4 +991,31 @@ namespace museqa
     {
         return new ::hybrid<transform::symmetric>;
     }
+
+    /**
+     * Instantiates a new hybrid neighbor-joining instance using a lazy matrix.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::hybrid_lazy() -> phylogeny::algorithm *
+    {
+        return new ::hybrid<transform::lazy>;
+    }
+
+    /**
+     * Instantiates a new batched neighbor-joining instance using a simple matrix.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::batched_linear() -> phylogeny::algorithm *
+    {
+        return new ::batched<transform::linear<2>>;
+    }
+
+    /**
+     * Instantiates a new batched neighbor-joining instance using a symmatrix.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::batched_symmetric() -> phylogeny::algorithm *
+    {
+        return new ::batched<transform::symmetric>;
+    }
 }
@@ -0,0 +1,495 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Vectorized and multithreaded implementation for the phylogeny module's neighbor-joining algorithm.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2019-present Rodrigo Siqueira
+ */
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+#include "node.hpp"
+#include "oeis.hpp"
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "parallel.hpp"
+#include "pairwise.cuh"
+#include "environment.h"
+
+#include "phylogeny/phylogeny.cuh"
+#include "phylogeny/njoining/star.cuh"
+#include "phylogeny/njoining/njoining.cuh"
+
+/*
+ * When compiling with GCC for x86-64 targets, the vectorized kernels are cloned
+ * for each of the most common instruction sets. The best clone available in the
+ * current host will then be picked at runtime, with no need for specific flags.
+ */
+#if defined(__museqa_compiler_gcc) && defined(__x86_64__)
+  #define __museqa_simd_clones __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+  #define __museqa_simd_clones
+#endif
+
+namespace
+{
+    using namespace museqa;
+    using namespace phylogeny;
+
+    /*
+     * Algorithm configuration parameters. The vector width indicates the number
+     * of bytes processed by each vector operation. The Q-matrix is scanned by
+     * square tiles of the given side, so a tile's distances and the rows sums
+     * its columns need are kept in cache while the tile is scanned.
+     */
+    enum : size_t { width = 64 };
+    enum : size_t { tile = 64 };
+    enum : size_t { resync_factor = 64 };
+
+    /**
+     * The algorithm's distance type.
+     * @since 0.1.1
+     */
+    using distance_type = otu::distance_type;
+
+    /**
+     * The type of the matrix's rows sums. As the sums are incrementally updated
+     * on every join, they are kept in double precision.
+     * @since 0.1.1
+     */
+    using sum_type = double;
+
+    /**
+     * The number of distances processed by each vector operation.
+     * @since 0.1.1
+     */
+    enum : size_t { lanes = width / sizeof(distance_type) };
+
+    /**
+     * Describes a vector of distances.
+     * @since 0.1.1
+     */
+    typedef distance_type lane __attribute__((vector_size(width)));
+
+    /**
+     * The type for mapping an OTU's slot to its reference on the tree.
+     * @since 0.1.1
+     */
+    using map_type = buffer<oturef>;
+
+    /**
+     * Defines a cache for the matrix's rows sums.
+     * @since 0.1.1
+     */
+    using cache_type = buffer<sum_type>;
+
+    /**
+     * The parallel neighbor-joining algorithm's data structures' state. The whole
+     * matrix is kept as a dense square, whose rows are padded to the vector width,
+     * so every row is contiguous and can be streamed through vector operations.
+     * Just as the linear sequential algorithm does, whenever an OTU is removed,
+     * the matrix's last slot takes its place, so all slots are kept contiguous.
+     * @since 0.1.1
+     */
+    struct state
+    {
+        map_type map;                       /// The OTU references of each matrix slot.
+        cache_type cache;                   /// The cache of rows total sums.
+        std::vector<distance_type> sums;    /// The rows sums as used by the Q-transform.
+        buffer<distance_type> rows;         /// The distance matrix's dense rows.
+        size_t stride;                      /// The distance between two consecutive rows.
+        size_t count;                       /// The number of OTUs yet to be joined.
+    };
+
+    /**#@+
+     * Gives access to one of the matrix's rows.
+     * @param state The algorithm's state data structures.
+     * @param slot The slot of the requested row.
+     * @return The pointer to the row's first distance.
+     */
+    inline auto row(state& state, size_t slot) noexcept -> distance_type *
+    {
+        return state.rows.raw() + slot * state.stride;
+    }
+
+    inline auto row(const state& state, size_t slot) noexcept -> const distance_type *
+    {
+        return state.rows.raw() + slot * state.stride;
+    }
+    /**#@-*/
+
+    /**
+     * Finds the greatest Q-value of a row's segment. The Q-values are calculated
+     * by the same operations as the sequential algorithm, so both agree on them.
+     * @param line The row segment's distances.
+     * @param sums The rows sums of the segment's columns.
+     * @param sum The row's own sum.
+     * @param factor The Q-transform's distance factor.
+     * @param count The number of distances in the segment.
+     * @return The greatest Q-value within the segment.
+     */
+    __museqa_simd_clones static auto row_max(
+            const distance_type *line
+        ,   const distance_type *sums
+        ,   distance_type sum
+        ,   distance_type factor
+        ,   size_t count
+        ) -> distance_type
+    {
+        lane best = lane {} - njoining::infinity;
+        distance_type result = -njoining::infinity;
+        size_t j = 0;
+
+        for( ; j + lanes <= count; j += lanes) {
+            lane distance, others;
+            memcpy(&distance, line + j, sizeof(lane));
+            memcpy(&others, sums + j, sizeof(lane));
+
+            const lane value = (factor * distance - sum) - others;
+            best = value > best ? value : best;
+        }
+
+        for(size_t l = 0; l < lanes; ++l)
+            result = utils::max(result, best[l]);
+
+        for( ; j < count; ++j)
+            result = utils::max(result, (factor * line[j] - sum) - sums[j]);
+
+        return result;
+    }
+
+    /**
+     * Calculates the distances from a newly joined OTU to all others, and updates
+     * the rows sums accordingly.
+     * @param result The new OTU's distances output.
+     * @param one The first joined OTU's distances.
+     * @param two The second joined OTU's distances.
+     * @param cache The rows sums cache.
+     * @param distance_xy The distance between the joined OTUs.
+     * @param count The number of OTUs in the matrix.
+     */
+    __museqa_simd_clones static void combine(
+            distance_type *result
+        ,   const distance_type *one
+        ,   const distance_type *two
+        ,   sum_type *cache
+        ,   distance_type distance_xy
+        ,   size_t count
+        )
+    {
+        size_t i = 0;
+
+        for( ; i + lanes <= count; i += lanes) {
+            lane x, y;
+            memcpy(&x, one + i, sizeof(lane));
+            memcpy(&y, two + i, sizeof(lane));
+
+            const lane updated = ((x + y) - distance_xy) * distance_type(.5);
+            memcpy(result + i, &updated, sizeof(lane));
+        }
+
+        for( ; i < count; ++i)
+            result[i] = ((one[i] + two[i]) - distance_xy) * distance_type(.5);
+
+        for(i = 0; i < count; ++i)
+            cache[i] += sum_type(result[i]) - sum_type(one[i]) - sum_type(two[i]);
+    }
+
+    /**
+     * Builds the cache for the sums of all rows from the matrix. Each row is
+     * summed as a whole by a single host thread, in double precision.
+     * @param state The algorithm's state instance to initialize the sum cache of.
+     */
+    static void cache_init(state& state)
+    {
+        parallel::foreach(state.count, [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i) {
+                const distance_type *line = row(state, i);
+                sum_type sum = 0;
+
+                for(size_t j = 0; j < state.count; ++j)
+                    sum += line[j];
+
+                state.cache[i] = sum;
+            }
+        });
+    }
+
+    /**
+     * Initialize a new algorithm state instance, copying the pairwise module's
+     * distances into the algorithm's dense matrix. The matrix's row sums are
+     * only computed if they have not already been found by the pairwise module.
+     * @param matrix The pairwise module's distance matrix.
+     * @param count The total number of OTUs to be aligned.
+     * @return The initialized algorithm state instance.
+     */
+    static auto initialize(const pairwise::distance_matrix& matrix, size_t count) -> state
+    {
+        state state;
+
+        state.count = count;
+        state.stride = ((count + lanes - 1) / lanes) * lanes;
+        state.map = map_type::make(count);
+
+        for(size_t i = 0; i < count; ++i)
+            state.map[i] = (oturef) i;
+
+        onlyslaves {
+            state.rows = buffer<distance_type>::make(count * state.stride);
+            state.cache = cache_type::make(count);
+            state.sums.resize(state.stride);
+
+            parallel::foreach(count, [&](const range<size_t>& partition, size_t) {
+                for(size_t i = partition.offset; i < partition.offset + partition.total; ++i) {
+                    distance_type *line = row(state, i);
+
+                    for(size_t j = 0; j < count; ++j)
+                        line[j] = matrix[{i, j}];
+
+                    for(size_t j = count; j < state.stride; ++j)
+                        line[j] = distance_type {0};
+                }
+            });
+
+            if(matrix.sums().size() == count) {
+                std::copy(matrix.sums().begin(), matrix.sums().end(), state.cache.begin());
+            } else {
+                cache_init(state);
+            }
+        }
+
+        return state;
+    }
+
+    /**
+     * Checks whether a pair beats the chosen candidate. Ties are broken by
+     * whichever pair comes first on the linear pair space, so the same pair is
+     * chosen regardless of how the tiles are split among nodes and threads.
+     * @param distance The pair's Q-value.
+     * @param x The pair's first and greatest slot.
+     * @param y The pair's second slot.
+     * @param chosen The currently chosen candidate.
+     * @return Does the pair beat the chosen candidate?
+     */
+    inline auto better(distance_type distance, size_t x, size_t y, const njoining::candidate& chosen) noexcept
+    -> bool
+    {
+        if(distance != chosen.distance)
+            return distance > chosen.distance;
+
+        return chosen.ref[0] == undefined || x < chosen.ref[0]
+            || (x == chosen.ref[0] && y < chosen.ref[1]);
+    }
+
+    /**
+     * Scans a tile of the Q-matrix's lower triangle for its best pair. Each row's
+     * segment is first reduced by vector operations, and only a segment which
+     * may beat the chosen candidate is scanned again for its pair's position.
+     * @param state The algorithm's state data structures.
+     * @param bi The tile's row index.
+     * @param bj The tile's column index.
+     * @param chosen The currently chosen candidate.
+     */
+    static void scan_tile(const state& state, size_t bi, size_t bj, njoining::candidate& chosen)
+    {
+        const distance_type factor = distance_type(state.count - 2);
+        const size_t last = utils::min<size_t>((bi + 1) * tile, state.count);
+
+        for(size_t i = bi * tile; i < last; ++i) {
+            const size_t first = bj * tile;
+            const size_t limit = utils::min<size_t>((bj + 1) * tile, i);
+
+            if(first >= limit)
+                continue;
+
+            const distance_type *line = row(state, i);
+            const distance_type sum = state.sums[i];
+
+            if(row_max(line + first, state.sums.data() + first, sum, factor, limit - first) < chosen.distance)
+                continue;
+
+            for(size_t j = first; j < limit; ++j) {
+                const distance_type distance = (factor * line[j] - sum) - state.sums[j];
+
+                if(better(distance, i, j, chosen))
+                    chosen = njoining::candidate {oturef(i), oturef(j), distance};
+            }
+        }
+    }
+
+    /**
+     * Finds the best joinable pair among the given tiles of the Q-matrix. The
+     * tiles are split among the node's host threads, each of which keeps its own
+     * best candidate, so threads need not synchronize while scanning.
+     * @param state The algorithm's state data structures.
+     * @param partition The range of tiles at which a candidate must be found.
+     * @return The best joinable pair candidate found on the given tiles.
+     */
+    static auto pick_joinable(state& state, const range<size_t>& partition) -> njoining::joinable
+    {
+        auto candidates = std::vector<njoining::candidate> (parallel::global().size());
+
+        for(size_t i = 0; i < state.count; ++i)
+            state.sums[i] = distance_type(state.cache[i]);
+
+        parallel::foreach(partition.total, [&](const range<size_t>& local, size_t id) {
+            njoining::candidate chosen;
+
+            for(size_t t = partition.offset + local.offset; t < partition.offset + local.offset + local.total; ++t) {
+                const size_t bi = oeis::a002024(t + 1) - 1;
+                const size_t bj = t - utils::nchoose(bi + 1);
+                scan_tile(state, bi, bj, chosen);
+            }
+
+            candidates[id] = chosen;
+        });
+
+        njoining::candidate chosen;
+
+        for(const auto& candidate : candidates)
+            if(candidate.ref[0] != undefined && better(candidate.distance, candidate.ref[0], candidate.ref[1], chosen))
+                chosen = candidate;
+
+        if(chosen.ref[0] == undefined)
+            return njoining::joinable {};
+
+        const auto x = chosen.ref[0], y = chosen.ref[1];
+        const auto distance_xy = row(state, x)[y];
+        const auto pairsum = distance_type(state.cache[x] - state.cache[y]);
+
+        const distance_type dx = state.count > 2
+            ? (.5 * distance_xy) + (pairsum / (2 * (state.count - 2)))
+            : (.5 * distance_xy);
+
+        return {chosen, dx, distance_xy - dx};
+    }
+
+    /**
+     * Joins an OTU pair into a new parent OTU. The new OTU takes up the first
+     * OTU's slot, and the matrix's last slot is moved into the second OTU's.
+     * @param tree The phylogenetic tree being constructed.
+     * @param parent The parent OTU into which the pair will be joined.
+     * @param state The algorithm's state data structures.
+     * @param join The OTU pair to join.
+     */
+    static void join_pair(njoining::star& tree, oturef parent, state& state, const njoining::joinable& join)
+    {
+        const auto x = join.ref[0];
+        const auto y = join.ref[1];
+        const size_t last = state.count - 1;
+
+        tree.join(parent, {state.map[x], join.delta[0]}, {state.map[y], join.delta[1]});
+
+        onlyslaves {
+            auto new_distances = std::vector<distance_type> (state.count);
+            sum_type new_sum = 0;
+
+            combine(new_distances.data(), row(state, x), row(state, y), state.cache.raw(), row(state, x)[y], state.count);
+
+            for(size_t i = 0; i < state.count; ++i)
+                new_sum += new_distances[i];
+
+            memcpy(row(state, x), new_distances.data(), sizeof(distance_type) * state.count);
+
+            for(size_t i = 0; i < state.count; ++i)
+                row(state, i)[x] = new_distances[i];
+
+            state.cache[x] = new_sum;
+
+            if(y != last) {
+                memcpy(row(state, y), row(state, last), sizeof(distance_type) * state.count);
+
+                for(size_t i = 0; i < state.count; ++i)
+                    row(state, i)[y] = row(state, i)[last];
+
+                state.cache[y] = state.cache[last];
+            }
+        }
+
+        state.map[x] = parent;
+        state.map[y] = state.map[last];
+        state.count--;
+
+        // Although the rows sums are kept in double precision, they are still
+        // periodically recalculated from scratch, so their rounding errors stay
+        // bounded no matter how many joins there are.
+        if(state.count > 1 && state.count % resync_factor == 0)
+            onlyslaves cache_init(state);
+    }
+
+    /**
+     * The vectorized neighbor-joining algorithm object. This algorithm uses no GPU
+     * whatsoever, but scans the Q-matrix with all of the host's threads and
+     * vector units. It joins the same pairs as the linear sequential algorithm.
+     * @since 0.1.1
+     */
+    struct vectorized : public njoining::algorithm
+    {
+        /**
+         * Builds the pseudo-phylogenetic tree from the given distance matrix.
+         * @param state The algorithm's state data structures.
+         * @return The calculated phylogenetic tree.
+         */
+        auto build_tree(state& state) const -> njoining::star
+        {
+            oturef parent = (oturef) state.count;
+            auto tree = njoining::star::make(state.count);
+
+            while(state.count > 1) {
+                njoining::joinable vote;
+
+                onlyslaves {
+                    const size_t blocks = (state.count + tile - 1) / tile;
+                    const size_t total = utils::nchoose(blocks + 1);
+
+                    // The Q-matrix's tiles are split among the compute nodes. Each
+                    // node must then pick its local best joinable candidate.
+                    #if !defined(__museqa_runtime_cython)
+                        const auto workers = utils::min<size_t>(node::count - 1, total);
+                        const auto partition = size_t(node::rank - 1) < workers
+                            ? utils::partition(total, workers, node::rank - 1)
+                            : range<size_t> {0, 0};
+                    #else
+                        const auto partition = range<size_t> {0, total};
+                    #endif
+
+                    vote = pick_joinable(state, partition);
+                }
+
+                vote = this->reduce(vote);
+                join_pair(tree, parent++, state, vote);
+            }
+
+            return tree;
+        }
+
+        /**
+         * Executes the parallel neighbor-joining algorithm for the phylogeny step.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> guidetree override
+        {
+            if(ctx.count < 2)
+                return guidetree {};
+
+            auto state = initialize(ctx.matrix, ctx.count);
+            auto result = build_tree(state);
+
+            return result;
+        }
+    };
+}
+
+namespace museqa
+{
+    /**
+     * Instantiates a new vectorized and multithreaded neighbor-joining instance.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::sequential_parallel() -> phylogeny::algorithm *
+    {
+        return new ::vectorized;
+    }
+}
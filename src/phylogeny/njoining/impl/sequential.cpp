@@ -4,14 +4,19 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2019-present Rodrigo Siqueira
  */
+#include <cmath>
+#include <memory>
+#include <vector>
 #include <cstdint>
 #include <utility>
+#include <algorithm>
 
 #include "node.hpp"
 #include "oeis.hpp"
 #include "utils.hpp"
 #include "buffer.hpp"
 #include "matrix.hpp"
+#include "parallel.hpp"
 #include "pairwise.cuh"
 #include "exception.hpp"
 #include "environment.h"
@@ -26,12 +31,26 @@ namespace
     using namespace museqa;
     using namespace phylogeny;
 
+    /*
+     * Algorithm configuration parameters. These values interfere directly into
+     * the algorithm's execution, thus, they shall be modified with caution.
+     */
+    enum : size_t { resync_factor = 64 };
+
     /**
      * The algorithm's distance type. 
      * @since 0.1.1
      */
     using distance_type = otu::distance_type;
 
+    /**
+     * The type of the matrix's rows sums. As the sums are incrementally updated
+     * on every join, they are kept in double precision, so their rounding errors
+     * do not build up enough to change which pair is chosen to be joined.
+     * @since 0.1.1
+     */
+    using sum_type = double;
+
     /**
      * The type for mapping an OTU to its coordinates on the matrix.
      * @since 0.1.1
@@ -42,7 +61,7 @@ namespace
      * Defines a cache for the matrix's columns and row sums.
      * @since 0.1.1
      */
-    using cache_type = buffer<distance_type>;
+    using cache_type = buffer<sum_type>;
 
     /**
      * The point type required by the algorithm's matrices.
@@ -74,28 +93,29 @@ namespace
 
     /**
      * Builds a cache for the sum of all elements from a matrix's columns and rows.
+     * Each row is summed as a whole by a single host thread, in double precision.
      * @tparam T The algorithm's distance matrix's spatial transformation.
      * @param state The algorithm's state instance to initialize the sum cache of.
      */
     template <typename T>
     static void cache_init(state<T>& state)
     {
-        for(size_t i = 0; i < state.count - 1; ++i) {
-            state.cache[i] = (distance_type) 0;
-        }
+        parallel::foreach(state.count, [&](const range<size_t>& partition, size_t) {
+            for(size_t i = partition.offset; i < partition.offset + partition.total; ++i) {
+                sum_type sum = 0;
+
+                for(size_t j = 0; j < state.count; ++j)
+                    sum += state.matrix[{i, j}];
 
-        for(size_t i = 0; i < state.count - 1; ++i) {
-            for(size_t j = i + 1; j < state.count; ++j) {
-                const auto current = state.matrix[{i, j}];
-                state.cache[i] += current;
-                state.cache[j] += current;
+                state.cache[i] = sum;
             }
-        }
+        });
     }
 
     /**
      * Initialize a new algorithm state instance, and builds all data structures
-     * needed for a fast neighbor-joining execution.
+     * needed for a fast neighbor-joining execution. The matrix's row sums are
+     * only computed if they have not already been found by the pairwise module.
      * @tparam T The algorithm's distance matrix's spatial transformation.
      * @param matrix The pairwise module's distance matrix.
      * @param count The total number of OTUs to be aligned.
@@ -110,8 +130,14 @@ namespace
         state.map = map_type::make(count);
         state.count = count;
 
-        onlyslaves state.cache = cache_type::make(count);
-        onlyslaves cache_init(state);
+        onlyslaves {
+            if(matrix.sums().size() == count) {
+                state.cache = cache_type::copy(matrix.sums());
+            } else {
+                state.cache = cache_type::make(count);
+                cache_init(state);
+            }
+        }
 
         for(size_t i = 0; i < count; ++i)
             state.map[i] = (oturef) i;
@@ -129,7 +155,8 @@ namespace
     template <typename T>
     inline distance_type q_transform(const state<T>& state, const pair_type& pair)
     {
-        return (state.count - 2) * state.matrix[pair] - state.cache[pair.x] - state.cache[pair.y];
+        return (state.count - 2) * state.matrix[pair]
+            - distance_type(state.cache[pair.x]) - distance_type(state.cache[pair.y]);
     }
 
     /**
@@ -143,7 +170,7 @@ namespace
     static njoining::joinable raise_candidate(const state<T>& state, const njoining::candidate& chosen)
     {
         const pair_type pair = {chosen.ref[0], chosen.ref[1]};
-        const auto pairsum = state.cache[pair.x] - state.cache[pair.y];
+        const auto pairsum = distance_type(state.cache[pair.x] - state.cache[pair.y]);
 
         const distance_type dx = (.5 * state.matrix[pair]) + (pairsum / (2 * (state.count - 2)));
         const distance_type dy = state.matrix[pair] - dx;
@@ -152,7 +179,8 @@ namespace
     }
 
     /**
-     * Finds the best joinable pair on the given partition.
+     * Finds the best joinable pair on the given partition. The partition is further
+     * split among the node's host threads, each finding its own best candidate.
      * @tparam T The algorithm's distance matrix's spatial transformation.
      * @param state The algorithm's state data structures.
      * @param partition The local range at which a candidate must be found.
@@ -161,20 +189,36 @@ namespace
     template <typename T>
     static njoining::joinable pick_joinable(const state<T>& state, const range<size_t>& partition)
     {
+        auto candidates = std::vector<njoining::candidate> (parallel::global().size());
+
+        parallel::foreach(partition.total, [&](const range<size_t>& local, size_t id) {
+            njoining::candidate chosen;
+            const size_t offset = partition.offset + local.offset;
+
+            size_t i = oeis::a002024(offset + 1);
+            size_t j = offset - utils::nchoose(i);
+
+            // Let's iterate over the partition by calculating each partition element's
+            // Q-value and picking the one with the lowest value. The point with the
+            // lowest Q-value is then selected to be returned.
+            for(size_t c = 0; c < local.total; ++i, j = 0)
+                for( ; c < local.total && j < i; ++c, ++j) {
+                    const auto distance = q_transform(state, {i, j});
+
+                    if(distance > chosen.distance)
+                        chosen = njoining::candidate {oturef(i), oturef(j), distance};
+                }
+
+            candidates[id] = chosen;
+        });
+
+        // As the threads' partitions are ordered, picking the first best candidate
+        // among them yields the same candidate as a single-threaded search would.
         njoining::candidate chosen;
-        size_t i = oeis::a002024(partition.offset + 1);
-        size_t j = partition.offset - utils::nchoose(i);
-
-        // Let's iterate over the partition by calculating each partition element's
-        // Q-value and picking the one with the lowest value. The point with the
-        // lowest Q-value is then selected to be returned.
-        for(size_t c = 0; c < partition.total; ++i, j = 0)
-            for( ; c < partition.total && j < i; ++c, ++j) {
-                const auto distance = q_transform(state, {i, j});
-
-                if(distance > chosen.distance)
-                    chosen = njoining::candidate {oturef(i), oturef(j), distance};
-            }
+
+        for(const auto& candidate : candidates)
+            if(candidate.distance > chosen.distance)
+                chosen = candidate;
 
         /// Now that we have our partition's best candidate, we must calculate its
         /// deltas, as the other nodes will not figure it out by themselves.
@@ -182,11 +226,14 @@ namespace
     }
 
     /**
-     * Updates the linear star tree's cache structures by removing an OTU.
+     * Updates the linear star tree's cache structures by removing an OTU. As the
+     * lazy matrix only moves elements when compacted, it shares the linear layout.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
      * @param state The algorithm's state data structures.
      * @param target The OTU to be removed from the star tree's caches and matrix.
      */
-    static void update_cache(state<transform::linear<2>>& state, oturef target)
+    template <typename T>
+    static void update_cache(state<T>& state, oturef target)
     {
         onlyslaves {
             if(target != state.count - 1) {
@@ -195,7 +242,7 @@ namespace
             }
 
             state.matrix.remove(state.count - 1);
-            state.cache = buffer_slice<distance_type> {state.cache, 0, state.count - 1};
+            state.cache = buffer_slice<sum_type> {state.cache, 0, state.count - 1};
         }
 
         utils::swap(state.map[target], state.map[state.count - 1]);
@@ -216,7 +263,7 @@ namespace
             }
 
             state.matrix.remove(0);
-            state.cache = buffer_slice<distance_type> {state.cache, 1, state.count - 1};
+            state.cache = buffer_slice<sum_type> {state.cache, 1, state.count - 1};
         }
 
         utils::swap(state.map[0], state.map[target]);
@@ -237,7 +284,7 @@ namespace
         const auto x = join.ref[0];
         const auto y = join.ref[1];
 
-        distance_type new_sum = 0;
+        sum_type new_sum = 0;
 
         // As updating the star tree is a computationally expensive task, we optimize
         // it by reusing one of the joined OTU's column and row on the matrix to
@@ -251,11 +298,12 @@ namespace
             // Let's calculate the distances between the OTU being created and the
             // others which have not been affected by the current joining operation.
             for(size_t i = 0; i < state.count; ++i) {
-                const auto previous = state.matrix[{i, x}] + state.matrix[{i, y}];
-                const auto updated = (previous - distance_xy) * .5;
+                const auto one = state.matrix[{i, x}];
+                const auto two = state.matrix[{i, y}];
+                const distance_type updated = ((one + two) - distance_xy) * .5;
 
                 new_distances[i] = updated;
-                state.cache[i] += updated - previous;
+                state.cache[i] += sum_type(updated) - sum_type(one) - sum_type(two);
                 new_sum += updated;
             }
 
@@ -274,6 +322,12 @@ namespace
 
         update_cache(state, y);
         state.count--;
+
+        // Although the rows sums are kept in double precision, they are still
+        // periodically recalculated from scratch, so their rounding errors stay
+        // bounded no matter how many joins there are.
+        if(state.count > 1 && state.count % resync_factor == 0)
+            onlyslaves cache_init(state);
     }
 
     /**
@@ -345,6 +399,310 @@ namespace
             return result;
         }
     };
+
+    /**
+     * Keeps the rows of the distance matrix sorted by distance, so the search for
+     * the best joinable pair can skip the rest of a row as soon as an upper bound
+     * for its remaining Q-values cannot beat the best Q-value already found. Each
+     * OTU's row holds its distances to the OTUs which already existed when it was
+     * created, thus every pair of alive OTUs is found in exactly one row. The rows
+     * of OTUs joined into a parent are never updated, their entries are simply
+     * skipped and eventually dropped. Rows are split among the compute nodes.
+     * @since 0.1.1
+     */
+    class sorted_rows
+    {
+        protected:
+            /**
+             * An entry of a sorted row, with the distance to one of the row's OTU
+             * neighbors, referenced by the neighbor's OTU reference.
+             * @since 0.1.1
+             */
+            struct entry
+            {
+                distance_type distance;     /// The distance between the OTUs.
+                oturef id;                  /// The neighbor OTU's reference.
+            };
+
+        protected:
+            std::vector<std::vector<entry>> m_rows; /// The sorted row of each OTU.
+            std::vector<oturef> m_position;         /// The current matrix index of each OTU.
+            std::vector<distance_type> m_smallest;  /// The smallest sum among each OTU's older OTUs.
+            size_t m_workers = 1;                   /// The number of nodes sharing the rows.
+            size_t m_id = 0;                        /// The current node's rows share.
+            size_t m_compacted = 0;                 /// The number of OTUs at the last compaction.
+
+        public:
+            /**
+             * Sorts the initial rows of the current node's share of the matrix.
+             * @tparam T The algorithm's distance matrix's spatial transformation.
+             * @param state The algorithm's state data structures.
+             */
+            template <typename T>
+            inline explicit sorted_rows(const state<T>& state)
+            :   m_rows (2 * state.count - 1)
+            ,   m_position (2 * state.count - 1, undefined)
+            ,   m_smallest (2 * state.count - 1)
+            ,   m_compacted {state.count}
+            {
+                #if !defined(__museqa_runtime_cython)
+                    m_workers = node::count - 1;
+                    m_id = node::rank - 1;
+                #endif
+
+                for(size_t i = 0; i < state.count; ++i)
+                    m_position[state.map[i]] = (oturef) i;
+
+                for(size_t i = 0; i < state.count; ++i)
+                    if(owns(state.map[i]))
+                        fill(state, i, i);
+            }
+
+            /**
+             * Finds the best joinable pair within the current node's rows. Rows are
+             * visited in decreasing order of their best pair's upper bound, and a
+             * row is scanned until the upper bound of its next pair's Q-value falls
+             * below the best Q-value found so far. As in an exhaustive search, ties
+             * are broken by the pairs' matrix indeces.
+             * @tparam T The algorithm's distance matrix's spatial transformation.
+             * @param state The algorithm's state data structures.
+             * @return The best joinable pair candidate found on the node's rows.
+             */
+            template <typename T>
+            auto pick(const state<T>& state) -> njoining::joinable
+            {
+                njoining::candidate chosen;
+                distance_type running = njoining::infinity;
+                std::vector<std::pair<double, size_t>> order;
+
+                // As a row only holds the OTUs created before the row's own OTU,
+                // the smallest sum among these older OTUs bounds the row's pairs.
+                for(size_t id = 0; id < m_position.size(); ++id)
+                    if(m_position[id] != undefined) {
+                        m_smallest[id] = running;
+                        running = utils::min(running, distance_type(state.cache[m_position[id]]));
+                    }
+
+                const distance_type factor = distance_type(state.count - 2);
+
+                for(size_t i = 0; i < state.count; ++i) {
+                    const auto id = state.map[i];
+                    if(!owns(id)) continue;
+
+                    for(const auto& current : m_rows[id])
+                        if(m_position[current.id] != undefined) {
+                            order.push_back({bound(factor * current.distance, distance_type(state.cache[i]), m_smallest[id]), i});
+                            break;
+                        }
+                }
+
+                std::sort(order.begin(), order.end(), [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+                    return a.first > b.first;
+                });
+
+                for(const auto& row : order) {
+                    const size_t i = row.second;
+                    const auto sum = distance_type(state.cache[i]);
+                    const auto smallest = m_smallest[state.map[i]];
+
+                    if(row.first < chosen.distance)
+                        break;
+
+                    for(const auto& current : m_rows[state.map[i]]) {
+                        const oturef j = m_position[current.id];
+                        if(j == undefined) continue;
+
+                        if(bound(factor * current.distance, sum, smallest) < chosen.distance)
+                            break;
+
+                        // The Q-value is calculated by the same operations as in the
+                        // exhaustive search, so both searches agree on every pair.
+                        const pair_type pair = {utils::max<size_t>(i, j), utils::min<size_t>(i, j)};
+                        const distance_type distance = (state.count - 2) * current.distance
+                            - distance_type(state.cache[pair.x]) - distance_type(state.cache[pair.y]);
+
+                        if(better(distance, pair, chosen))
+                            chosen = njoining::candidate {oturef(pair.x), oturef(pair.y), distance};
+                    }
+                }
+
+                return chosen.ref[0] != undefined
+                    ? raise_candidate(state, chosen)
+                    : njoining::joinable {};
+            }
+
+            /**
+             * Updates the rows after a pair of OTUs has been joined into a parent.
+             * The parent's row is sorted with its distances to all alive OTUs.
+             * @tparam T The algorithm's distance matrix's spatial transformation.
+             * @param state The algorithm's state data structures, after the join.
+             * @param one The first joined OTU.
+             * @param two The second joined OTU.
+             * @param parent The newly created parent OTU.
+             */
+            template <typename T>
+            void update(const state<T>& state, oturef one, oturef two, oturef parent)
+            {
+                m_position[one] = m_position[two] = undefined;
+                std::vector<entry>().swap(m_rows[one]);
+                std::vector<entry>().swap(m_rows[two]);
+
+                for(size_t i = 0; i < state.count; ++i)
+                    m_position[state.map[i]] = (oturef) i;
+
+                if(owns(parent))
+                    fill(state, m_position[parent], state.count);
+
+                if(2 * state.count <= m_compacted)
+                    compact(state);
+            }
+
+        protected:
+            /**
+             * Informs whether an OTU's row belongs to the current node.
+             * @param id The OTU to be checked.
+             * @return Does the current node own the OTU's row?
+             */
+            inline auto owns(oturef id) const noexcept -> bool
+            {
+                return id % m_workers == m_id;
+            }
+
+            /**
+             * Bounds a pair's Q-value from above, regardless of the order its sums
+             * are subtracted in. The bound is loosened by a tiny margin, so it
+             * holds no matter how the Q-value's floating point operations round.
+             * @param scaled The pair's distance already scaled by the Q-transform.
+             * @param sum The row OTU's sum of distances.
+             * @param smallest The smallest sum of distances among the row's OTUs.
+             * @return The pair's Q-value upper bound.
+             */
+            inline static auto bound(distance_type scaled, distance_type sum, distance_type smallest) noexcept
+            -> double
+            {
+                const double value = double(scaled) - double(sum) - double(smallest);
+                const double margin = (std::fabs(scaled) + std::fabs(sum) + std::fabs(smallest)) * 1e-6;
+                return value + margin;
+            }
+
+            /**
+             * Checks whether a pair beats the chosen candidate. Ties are broken by
+             * whichever pair comes first on the linear pair space.
+             * @param distance The pair's Q-value.
+             * @param pair The pair's matrix indeces.
+             * @param chosen The currently chosen candidate.
+             * @return Does the pair beat the chosen candidate?
+             */
+            inline static auto better(distance_type distance, const pair_type& pair, const njoining::candidate& chosen)
+            noexcept -> bool
+            {
+                if(distance != chosen.distance)
+                    return distance > chosen.distance;
+
+                return chosen.ref[0] == undefined || pair.x < chosen.ref[0]
+                    || (pair.x == chosen.ref[0] && pair.y < chosen.ref[1]);
+            }
+
+            /**
+             * Fills and sorts an OTU's row with its distances to other OTUs.
+             * @tparam T The algorithm's distance matrix's spatial transformation.
+             * @param state The algorithm's state data structures.
+             * @param index The OTU's matrix index.
+             * @param limit The number of leading matrix indeces to be listed.
+             */
+            template <typename T>
+            void fill(const state<T>& state, size_t index, size_t limit)
+            {
+                auto& row = m_rows[state.map[index]];
+                row.reserve(limit);
+
+                for(size_t j = 0; j < limit; ++j)
+                    if(j != index)
+                        row.push_back(entry {state.matrix[{index, j}], state.map[j]});
+
+                std::sort(row.begin(), row.end(), [](const entry& a, const entry& b) {
+                    return a.distance > b.distance;
+                });
+            }
+
+            /**
+             * Drops all entries of already joined OTUs from the node's rows.
+             * @tparam T The algorithm's distance matrix's spatial transformation.
+             * @param state The algorithm's state data structures.
+             */
+            template <typename T>
+            void compact(const state<T>& state)
+            {
+                for(size_t i = 0; i < state.count; ++i) {
+                    auto& row = m_rows[state.map[i]];
+
+                    row.erase(std::remove_if(row.begin(), row.end(), [&](const entry& e) {
+                        return m_position[e.id] == undefined;
+                    }), row.end());
+
+                    row.shrink_to_fit();
+                }
+
+                m_compacted = state.count;
+            }
+    };
+
+    /**
+     * The rapid neighbor-joining algorithm object. This algorithm produces the same
+     * tree as the exhaustive sequential algorithm does, but keeps the distance
+     * matrix's rows sorted, so most pairs need not be inspected at each iteration.
+     * @tparam T The algorithm's distance matrix's spatial transformation.
+     * @since 0.1.1
+     */
+    template <typename T>
+    struct rapid : public sequential<T>
+    {
+        /**
+         * Builds the pseudo-phylogenetic tree from the given distance matrix.
+         * @param state The algorithm's state data structures.
+         * @return The calculated phylogenetic tree.
+         */
+        auto build_tree(state<T>& state) const -> njoining::star
+        {
+            oturef parent = (oturef) state.count;
+            auto tree = njoining::star::make(state.count);
+
+            std::unique_ptr<sorted_rows> rows;
+            onlyslaves rows.reset(new sorted_rows {state});
+
+            while(state.count > 1) {
+                njoining::joinable vote;
+
+                onlyslaves vote = rows->pick(state);
+                vote = this->reduce(vote);
+
+                const auto one = state.map[vote.ref[0]];
+                const auto two = state.map[vote.ref[1]];
+
+                join_pair(tree, parent, state, vote);
+                onlyslaves rows->update(state, one, two, parent);
+
+                ++parent;
+            }
+
+            return tree;
+        }
+
+        /**
+         * Executes the rapid neighbor-joining algorithm for the phylogeny step.
+         * @return The module's result value.
+         */
+        auto run(const context& ctx) const -> guidetree override
+        {
+            if(ctx.count < 2)
+                return guidetree {};
+
+            auto state = initialize<T>(ctx.matrix, ctx.count);
+            auto result = build_tree(state);
+
+            return result;
+        }
+    };
 }
 
 namespace museqa
@@ -366,4 +724,31 @@ namespace museqa
     {
         return new ::sequential<transform::symmetric>;
     }
+
+    /**
+     * Instantiates a new sequential neighbor-joining instance using a lazy matrix.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::sequential_lazy() -> phylogeny::algorithm *
+    {
+        return new ::sequential<transform::lazy>;
+    }
+
+    /**
+     * Instantiates a new rapid neighbor-joining instance using a simple matrix.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::rapid_linear() -> phylogeny::algorithm *
+    {
+        return new ::rapid<transform::linear<2>>;
+    }
+
+    /**
+     * Instantiates a new rapid neighbor-joining instance using a symmatrix.
+     * @return The new algorithm instance.
+     */
+    extern auto phylogeny::njoining::rapid_symmetric() -> phylogeny::algorithm *
+    {
+        return new ::rapid<transform::symmetric>;
+    }
 }
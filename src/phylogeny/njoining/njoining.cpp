@@ -4,6 +4,8 @@
  * @author Rodrigo Siqueira <rodriados@gmail.com>
  * @copyright 2019-present Rodrigo Siqueira
  */
+#include <vector>
+
 #include "museqa.hpp"
 
 #include "mpi.hpp"
@@ -18,24 +20,6 @@ namespace museqa
     {
         namespace njoining
         {
-            /**
-             * The operator for reducing a list of join pair candidates. This operator
-             * will always return the candidate with the closest nodes.
-             * @param a The first join pair candidate to compare.
-             * @param b The second join pair candidate to compare.
-             * @return The candidate with the minimum distance.
-             */
-            static auto closest(const joinable& a, const joinable& b) -> joinable
-            {
-                if(a.distance != b.distance) {
-                    return a.distance > b.distance ? a : b;
-                } else if(a.ref[0] != b.ref[0]) {
-                    return a.ref[0] < b.ref[0] ? a : b;
-                } else {
-                    return a.ref[1] < b.ref[1] ? a : b;
-                }
-            }
-
             /**
              * Reduces join pair candidates from all nodes and returns the one with
              * the minimum distance to master and all working nodes.
@@ -52,6 +36,21 @@ namespace museqa
                 #endif
             }
 
+            /**
+             * Gathers the join pair candidates found by every node, so all nodes
+             * know the candidates of all nodes, in the order of the nodes' ranks.
+             * @param candidates The current working node's join pair candidates.
+             * @return The join pair candidates of all nodes.
+             */
+            auto algorithm::gather(std::vector<joinable>& candidates) const -> std::vector<joinable>
+            {
+                #if !defined(__museqa_runtime_cython)
+                    return mpi::allgather(candidates);
+                #else
+                    return candidates;
+                #endif
+            }
+
             /**
              * Picks the module's default algorithm according to the program's global
              * state conditions and devices availability.
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <limits>
+#include <vector>
 
 #include "utils.hpp"
 #include "pairwise.cuh"
@@ -79,6 +80,7 @@ namespace museqa
             struct algorithm : public phylogeny::algorithm
             {
                 virtual auto reduce(joinable&) const -> joinable;
+                virtual auto gather(std::vector<joinable>&) const -> std::vector<joinable>;
                 virtual auto run(const context&) const -> guidetree = 0;
             };
 
@@ -88,8 +90,16 @@ namespace museqa
             extern auto best() -> phylogeny::algorithm *;
             extern auto hybrid_linear() -> phylogeny::algorithm *;
             extern auto hybrid_symmetric() -> phylogeny::algorithm *;
+            extern auto hybrid_lazy() -> phylogeny::algorithm *;
+            extern auto distributed() -> phylogeny::algorithm *;
+            extern auto batched_linear() -> phylogeny::algorithm *;
+            extern auto batched_symmetric() -> phylogeny::algorithm *;
+            extern auto rapid_linear() -> phylogeny::algorithm *;
+            extern auto rapid_symmetric() -> phylogeny::algorithm *;
             extern auto sequential_linear() -> phylogeny::algorithm *;
             extern auto sequential_symmetric() -> phylogeny::algorithm *;
+            extern auto sequential_lazy() -> phylogeny::algorithm *;
+            extern auto sequential_parallel() -> phylogeny::algorithm *;
 
             /**
              * Instantiates a new candidate pair from its internal values.
@@ -114,6 +124,24 @@ namespace museqa
             ,   distance {can.distance}
             {}
 
+            /**
+             * The operator for reducing a list of join pair candidates. This operator
+             * will always return the candidate with the closest nodes.
+             * @param a The first join pair candidate to compare.
+             * @param b The second join pair candidate to compare.
+             * @return The candidate with the minimum distance.
+             */
+            __host__ __device__ inline auto closest(const joinable& a, const joinable& b) -> joinable
+            {
+                if(a.distance != b.distance) {
+                    return a.distance > b.distance ? a : b;
+                } else if(a.ref[0] != b.ref[0]) {
+                    return a.ref[0] < b.ref[0] ? a : b;
+                } else {
+                    return a.ref[1] < b.ref[1] ? a : b;
+                }
+            }
+
             /**
              * Implements a volatile-qualified copy operator.
              * @param other The volatile-qualified candidate to be copied.
@@ -9,10 +9,16 @@
 
 #include "museqa.hpp"
 
+#include "mpi.hpp"
+#include "node.hpp"
+#include "trace.hpp"
+#include "buffer.hpp"
 #include "exception.hpp"
 #include "dispatcher.hpp"
+#include "environment.h"
 
 #include "phylogeny/phylogeny.cuh"
+#include "phylogeny/linkage/linkage.cuh"
 #include "phylogeny/njoining/njoining.cuh"
 
 namespace museqa
@@ -27,17 +33,34 @@ namespace museqa
             {"default",                     njoining::best}
         ,   {"njoining",                    njoining::best}
         ,   {"hybrid",                      njoining::hybrid_symmetric}
+        ,   {"batched",                     njoining::batched_symmetric}
         ,   {"linear",                      njoining::hybrid_linear}
         ,   {"symmetric",                   njoining::hybrid_symmetric}
+        ,   {"lazy",                        njoining::hybrid_lazy}
         ,   {"njoining-hybrid",             njoining::hybrid_symmetric}
         ,   {"njoining-linear",             njoining::hybrid_linear}
         ,   {"njoining-symmetric",          njoining::hybrid_symmetric}
+        ,   {"njoining-lazy",               njoining::hybrid_lazy}
+        ,   {"njoining-batched",            njoining::batched_symmetric}
+        ,   {"njoining-batched-linear",     njoining::batched_linear}
         ,   {"sequential",                  njoining::sequential_symmetric}
-        ,   {"distributed",                 njoining::sequential_symmetric}
+        ,   {"distributed",                 njoining::distributed}
         ,   {"njoining-sequential",         njoining::sequential_symmetric}
         ,   {"njoining-sequential-linear",  njoining::sequential_linear}
-        ,   {"njoining-distributed",        njoining::sequential_symmetric}
-        ,   {"njoining-distributed-linear", njoining::sequential_linear}
+        ,   {"njoining-sequential-lazy",    njoining::sequential_lazy}
+        ,   {"sequential-parallel",         njoining::sequential_parallel}
+        ,   {"njoining-sequential-parallel", njoining::sequential_parallel}
+        ,   {"njoining-distributed",        njoining::distributed}
+        ,   {"njoining-distributed-linear", njoining::distributed}
+        ,   {"rapid",                       njoining::rapid_symmetric}
+        ,   {"njoining-rapid",              njoining::rapid_symmetric}
+        ,   {"njoining-rapid-linear",       njoining::rapid_linear}
+        ,   {"upgma",                       linkage::average}
+        ,   {"wpgma",                       linkage::weighted}
+        ,   {"single",                      linkage::single}
+        ,   {"linkage-average",             linkage::average}
+        ,   {"linkage-weighted",            linkage::weighted}
+        ,   {"linkage-single",              linkage::single}
         };
 
         /**
@@ -62,6 +85,36 @@ namespace museqa
             throw exception("unknown phylogeny algorithm '%s'", name);
         }
 
+        /**
+         * Shares the distance matrix with the nodes that need it. The pairwise step
+         * only leaves the whole matrix on the master node, and by default all nodes
+         * are sent the whole of it, along with its distances' sums, if known.
+         * Algorithms needing only parts of the matrix on each node must rather
+         * send those parts themselves.
+         * @param matrix The pairwise module's distance matrix, on the master node.
+         * @param count The total number of OTUs to be aligned.
+         * @return The distance matrix, on all nodes.
+         */
+        auto algorithm::share(const pairwise::distance_matrix& matrix, size_t count) const
+        -> pairwise::distance_matrix
+        {
+            #if !defined(__museqa_runtime_cython)
+                trace::scope span {"phylogeny::share"};
+
+                // On the master node, the broadcast payload only references the
+                // matrix's memory, thus the matrix itself must be returned.
+                auto linear = matrix.linear();
+                auto sums = matrix.sums();
+
+                buffer<pairwise::score> received = mpi::broadcast(linear);
+                buffer<double> rsums = mpi::broadcast(sums);
+
+                return node::rank == node::master ? matrix : pairwise::distance_matrix {received, count, rsums};
+            #else
+                return matrix;
+            #endif
+        }
+
         /**
          * Informs the names of all available algorithms.
          * @return The list of available algorithms.
@@ -71,7 +71,9 @@ namespace museqa
         enum : oturef { undefined = guidetree::undefined };
 
         /**
-         * Represents a common phylogeny algorithm context.
+         * Represents a common phylogeny algorithm context. When running on a cluster,
+         * the matrix holds whatever the algorithm has had shared with each node.
+         * @see phylogeny::algorithm::share
          * @since 0.1.1
          */
         struct context
@@ -102,6 +104,7 @@ namespace museqa
             inline algorithm& operator=(const algorithm&) = default;
             inline algorithm& operator=(algorithm&&) = default;
 
+            virtual auto share(const pairwise::distance_matrix&, size_t) const -> pairwise::distance_matrix;
             virtual auto run(const context&) const -> guidetree = 0;
 
             static auto has(const std::string&) -> bool;
@@ -111,7 +114,7 @@ namespace museqa
 
         /**
          * Runs the module when not on a pipeline.
-         * @param matrix The distance matrix between sequences.
+         * @param matrix The distance matrix between sequences, on the master node.
          * @param count The total number of sequences to align.
          * @param algorithm The chosen phylogeny algorithm.
          * @return The chosen algorithm's resulting phylogenetic tree.
@@ -125,7 +128,7 @@ namespace museqa
             auto lambda = phylogeny::algorithm::make(algorithm);
             
             const phylogeny::algorithm *worker = lambda ();
-            auto result = worker->run({matrix, count});
+            auto result = worker->run({worker->share(matrix, count), count});
             
             delete worker;
             return result;
@@ -87,7 +87,8 @@ namespace museqa
                  */
                 inline auto leaves() const noexcept -> const buffer_slice<node_type>
                 {
-                    return buffer_slice<node_type> {m_buffer, 0, m_leaves};
+                    auto nodes = m_buffer;
+                    return m_leaves ? buffer_slice<node_type> {nodes, 0, m_leaves} : buffer_slice<node_type> {};
                 }
 
             protected:
@@ -6,6 +6,7 @@
  */
 #pragma once
 
+#include <string>
 #include <utility>
 
 #include "io.hpp"
@@ -53,7 +54,8 @@ namespace museqa
          * pipeline must inherit from this struct. Also, they all must indicate
          * which module they expect to be its previous. To run, a module must implement
          * the `run` function, which will always take the command line manager instance
-         * and the previous module's conduit.
+         * and the previous module's conduit. A module may also save its conduit into
+         * a checkpoint, so a later run can resume from it rather than running again.
          * @since 0.1.1
          */
         struct module
@@ -64,6 +66,30 @@ namespace museqa
             virtual auto check(const io::manager&) const -> bool = 0;
             virtual auto run(const io::manager&, pipe&) const -> pipe = 0;
             virtual auto name() const -> const char * = 0;
+
+            /**
+             * Saves the module's resulting conduit into a checkpoint file. By default,
+             * modules cannot be checkpointed, and thus must always run.
+             * @param io The pipeline's IO service instance.
+             * @param previous The previous module's conduit.
+             * @param result The module's resulting conduit.
+             * @param filename The name of the module's checkpoint file.
+             */
+            inline virtual void checkpoint(const io::manager&, pipe&, pipe&, const std::string&) const
+            {}
+
+            /**
+             * Resumes the module from its checkpoint file. If there is no usable
+             * checkpoint, an empty pipe is returned and the module must be run.
+             * @param io The pipeline's IO service instance.
+             * @param pipe The previous module's conduit.
+             * @param filename The name of the module's checkpoint file.
+             * @return The module's resumed conduit, if any.
+             */
+            inline virtual auto resume(const io::manager&, pipe&, const std::string&) const -> pipe
+            {
+                return pipe {};
+            }
         };
 
         /**
@@ -245,7 +271,9 @@ namespace museqa
                 }
 
                 /**
-                 * Executes the pipeline's module in sequence.
+                 * Executes the pipeline's module in sequence. If a checkpoint directory
+                 * is given, each module is first resumed from its checkpoint, and only
+                 * runs if it could not be, in which case a new checkpoint is saved.
                  * @param modules The list of pipeline's modules instances.
                  * @param io The pipeline's IO service instance.
                  * @return The pipeline's final module's result.
@@ -253,9 +281,24 @@ namespace museqa
                 inline virtual pipe execute(const module *modules[], const io::manager& io) const
                 {
                     auto pipe = pipeline::pipe {};
+                    auto directory = io.cmd.get("checkpoint", "");
 
-                    for(size_t i = 0; i < count; ++i)
-                        pipe = std::move(modules[i]->run(io, pipe));
+                    for(size_t i = 0; i < count; ++i) {
+                        if(directory.empty()) {
+                            pipe = std::move(modules[i]->run(io, pipe));
+                            continue;
+                        }
+
+                        const auto filename = directory + "/" + modules[i]->name() + ".ckpt";
+                        auto resumed = modules[i]->resume(io, pipe, filename);
+
+                        if(!resumed) {
+                            resumed = modules[i]->run(io, pipe);
+                            modules[i]->checkpoint(io, pipe, resumed, filename);
+                        }
+
+                        pipe = std::move(resumed);
+                    }
 
                     return pipe;
                 }
@@ -20,7 +20,9 @@ namespace museqa
         namespace pointer
         {
             /**
-             * Keeps track of the number of references to a given memory pointer.
+             * Keeps track of the number of references to a given memory pointer. In
+             * the Python bindings, the GIL is released while the C++ side runs, so
+             * pointers may be shared among threads and must be counted atomically.
              * @since 0.1.1
              */
             struct metadata
@@ -70,7 +72,12 @@ namespace museqa
                  */
                 __host__ __device__ static inline metadata *acquire(metadata *meta) noexcept
                 {
-                    if(meta) ++meta->use_count;
+                    #if defined(__museqa_runtime_cython) && defined(__museqa_runtime_host)
+                        if(meta) __atomic_add_fetch(&meta->use_count, 1, __ATOMIC_RELAXED);
+                    #else
+                        if(meta) ++meta->use_count;
+                    #endif
+
                     return meta;
                 }
 
@@ -81,7 +88,10 @@ namespace museqa
                  */
                 __host__ __device__ static inline void release(metadata *meta)
                 {
-                    #if defined(__museqa_runtime_host)
+                    #if defined(__museqa_runtime_cython) && defined(__museqa_runtime_host)
+                        if(meta && __atomic_sub_fetch(&meta->use_count, 1, __ATOMIC_ACQ_REL) <= 0)
+                            delete meta;
+                    #elif defined(__museqa_runtime_host)
                         if(meta && --meta->use_count <= 0)
                             delete meta;
                     #endif
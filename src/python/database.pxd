@@ -15,8 +15,11 @@
     cdef cppclass c_database "museqa::database":
         ctypedef c_sequence element_type
 
+        cppclass description_type:
+            string str()
+
         cppclass entry_type:
-            string description
+            description_type description
             element_type contents
 
         c_database()
@@ -43,7 +46,13 @@
 
 cdef extern from "io/loader/database.hpp" namespace "museqa::io" nogil:
     # Imports the IO loader's specialization for databases. This will allow us to
-    # use the exactly same loader we do in C++.
+    # use the exactly same loader we do in C++, also for parsing the contents
+    # of FASTA files already held in memory, such as memory-mapped files.
+    c_database c_parse_fasta "museqa::io::parser::fasta" (const char *, size_t) except +RuntimeError
+
+cdef extern from "io/dumper/database.hpp" namespace "museqa::io" nogil:
+    # Imports the IO dumper's specialization for databases. This will allow us to
+    # write databases into files with exactly the same dumper we do in C++.
     pass
 
 # Database wrapper. This class is responsible for interfacing all interactions between
@@ -5,13 +5,15 @@
 # @copyright 2018-present Rodrigo Siqueira
 from libcpp.set cimport set
 from libcpp.string cimport string
-from database cimport c_database
+from libcpp.vector cimport vector
+from database cimport c_database, c_parse_fasta
 from sequence cimport c_sequence, Sequence
 from sequence import Sequence
-from io cimport c_loader
+from io cimport c_loader, c_dumper
 
 from collections import namedtuple
 from functools import singledispatch
+from mmap import mmap
 
 __all__ = ["Database"]
 
@@ -35,17 +37,19 @@ def overload(value):
         @overload.register(int)
         def from_offset(int value):
             cdef c_database.entry_type entry = self.thisptr.at(value)
-            return Database.entry(entry.description.decode(), Sequence.wrap(entry.contents))
+            return Database.entry(entry.description.str().decode(), Sequence.wrap(entry.contents))
 
         @overload.register(bytes)
         def from_key(bytes value):
             cdef c_database.entry_type entry = self.thisptr.at(value)
-            return Database.entry(entry.description.decode(), Sequence.wrap(entry.contents))
+            return Database.entry(entry.description.str().decode(), Sequence.wrap(entry.contents))
 
         overload.register(str, lambda value: from_key(value.encode()))
         return overload(key)
 
-    # Adds new sequences to database.
+    # Adds new sequences to database. A list of sequences is added in bulk, and
+    # any other bytes-like object, such as a memory-mapped file, is parsed in place
+    # as the contents of a FASTA file. The GIL is released while they are added.
     # @param target The new sequence to add to database.
     def add(self, target):
         @singledispatch
@@ -70,7 +74,39 @@ def from_dict(dict value):
         def from_sequence(Sequence value):
             self.thisptr.add(value.c_get())
 
-        overload.register(list, lambda value: [overload(i) for i in value])
+        @overload.register(list)
+        def from_list(list value):
+            cdef vector[c_sequence] batch
+            cdef string contents
+
+            if not all(type(item) is bytes or type(item) is str for item in value):
+                for item in value:
+                    overload(item)
+                return
+
+            batch.reserve(len(value))
+
+            for item in value:
+                contents = item if type(item) is bytes else item.encode('ascii')
+                batch.push_back(c_sequence(contents))
+
+            with nogil:
+                self.thisptr.add(batch)
+
+        @overload.register(mmap)
+        @overload.register(bytearray)
+        @overload.register(memoryview)
+        def from_buffer(value):
+            cdef const unsigned char[::1] view = value
+            cdef c_database parsed
+
+            if view.shape[0] == 0:
+                return
+
+            with nogil:
+                parsed = c_parse_fasta(<const char *> &view[0], view.shape[0])
+                self.thisptr.merge(parsed)
+
         overload.register(str,  lambda value: from_bytes(value.encode('ascii')))
         overload(target)
 
@@ -116,6 +152,15 @@ def load(*filenames):
 
         return Database.wrap(result)
 
+    # Dumps the database into a file. The file's format is picked by its extension.
+    # @param filename The name of the file to dump the database into.
+    def dump(self, str filename):
+        cdef c_dumper[c_database] dumper
+        cdef string name = filename.encode()
+
+        if not dumper.dump(self.thisptr, name):
+            raise RuntimeError("file cannot be written '%s'" % filename)
+
     # Informs the number of sequences in database.
     # @return int The total number of sequences in database.
     @property
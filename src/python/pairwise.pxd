@@ -9,11 +9,17 @@
 from database cimport c_database
 from point cimport c_point2
 
-cdef extern from "pairwise/pairwise.cuh" namespace "museqa::pairwise":
+cdef extern from "pairwise/pairwise.cuh" namespace "museqa::pairwise" nogil:
     # The score of a sequence pair alignment.
     # @since 0.1.1
     ctypedef float c_score "museqa::pairwise::score"
 
+    # The buffer of scores a distance matrix is linearly laid out on.
+    # @since 0.1.1
+    cdef cppclass c_score_buffer "museqa::buffer<museqa::pairwise::score>":
+        const c_score *raw() const
+        size_t size() const
+
     # Represents a pairwise distance matrix. At last, this object represents
     # the pairwise module's execution's final result.
     # @since 0.1.1
@@ -27,6 +33,7 @@
         c_dist_matrix& operator=(c_dist_matrix&)
         element_type at "operator[]" (c_point2[size_t]&) except +RuntimeError
 
+        const c_score_buffer& linear() const
         size_t count()
 
     # The aminoacid substitution tables. These tables are stored contiguously
@@ -62,6 +69,8 @@
 # @since 0.1.1
 cdef class DistanceMatrix:
     cdef c_dist_matrix thisptr
+    cdef Py_ssize_t c_shape[1]
+    cdef Py_ssize_t c_strides[1]
 
     # Sets the underlying C++ object to the given target instance.
     # @param target The target object to use as underlying instance.
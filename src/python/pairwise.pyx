@@ -4,23 +4,68 @@
 # @author Rodrigo Siqueira <rodriados@gmail.com>
 # @copyright 2018-present Rodrigo Siqueira
 from libc.stdint cimport *
+from libc.string cimport memcpy
 from libcpp.string cimport string
 from libcpp.vector cimport vector
 from database cimport Database
 from encoder cimport c_encode
 from point cimport c_point2
 from pairwise cimport *
+from cpython.buffer cimport PyBUF_WRITABLE
 
 # Exposes the module's resulting distance matrix.
 # @since 0.1.1
 cdef class DistanceMatrix:
-    # Instantiates a new distance matrix from a list of pairwise sequence scores.
-    # @param score The list of pair distances.
+    # Instantiates a new distance matrix from pairwise sequence scores. The scores
+    # may be given by any object exposing a contiguous buffer of floats, such as
+    # a NumPy array, in which case they are copied in bulk.
+    # @param score The list or buffer of pair distances.
     # @param count The total number of sequences represented.
-    def __cinit__(self, list score = [], int count = 0):
-        cdef vector[c_score] buf = score
+    def __cinit__(self, score = [], int count = 0):
+        cdef vector[c_score] buf
+        cdef const c_score[::1] view
+
+        if isinstance(score, list):
+            buf = score
+        else:
+            view = score
+            buf.resize(view.shape[0])
+            if view.shape[0] > 0:
+                memcpy(buf.data(), &view[0], view.shape[0] * sizeof(c_score))
+
         self.thisptr = c_dist_matrix(buf, count)
 
+    # Exposes the matrix's scores through the buffer protocol, so they can be
+    # viewed by NumPy without any copies. The scores are laid out linearly by
+    # their pairs' offsets, thus the pair (i, j), with i > j, is found at the
+    # offset i * (i - 1) / 2 + j. The view keeps the matrix alive.
+    # @param view The buffer view to be filled.
+    # @param flags The buffer request flags.
+    def __getbuffer__(self, Py_buffer *view, int flags):
+        if flags & PyBUF_WRITABLE:
+            raise BufferError("distance matrix is read-only")
+
+        self.c_shape[0] = self.thisptr.linear().size()
+        self.c_strides[0] = sizeof(c_score)
+
+        view.buf = <void *> self.thisptr.linear().raw()
+        view.obj = self
+        view.len = self.c_shape[0] * sizeof(c_score)
+        view.readonly = 1
+        view.itemsize = sizeof(c_score)
+        view.format = 'f'
+        view.ndim = 1
+        view.shape = self.c_shape
+        view.strides = self.c_strides
+        view.suboffsets = NULL
+        view.internal = NULL
+
+    # Releases a buffer view. As the view only references the matrix's scores,
+    # there is nothing to be released.
+    # @param view The buffer view to be released.
+    def __releasebuffer__(self, Py_buffer *view):
+        pass
+
     # Accesses a value on the distance matrix.
     # @param offset The requested matrix position to access.
     # @return The score of given position.
@@ -80,7 +125,9 @@ def list():
     return [elem.decode() for elem in result]
 
 # Aligns every sequence in given database pairwise, thus calculating a similarity
-# score for every different permutation of sequence pairs.
+# score for every different permutation of sequence pairs. The GIL is released
+# while the pairs are aligned, so runs over different databases can be driven
+# by different Python threads at once.
 # @param db The database to be processed.
 # @param table The chosen scoring table.
 # @param algorithm The pairwise algorithm to use.
@@ -90,9 +137,16 @@ def run(Database db, **kwargs):
     algorithm = kwargs.pop('algorithm', 'default')
 
     cdef ScoringTable s_table = table if type(table) is ScoringTable else ScoringTable(table)
+    cdef c_dist_matrix result
+    cdef string name
 
     if type(algorithm) is str:
-        return DistanceMatrix.wrap(c_run(db.thisptr, s_table.thisptr, algorithm.encode('ascii')))
+        name = algorithm.encode('ascii')
+
+        with nogil:
+            result = c_run(db.thisptr, s_table.thisptr, name)
+
+        return DistanceMatrix.wrap(result)
 
     cdef DistanceMatrix matrix = algorithm(db, table = s_table)
     return matrix
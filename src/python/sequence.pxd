@@ -25,6 +25,9 @@
         string decode() except +RuntimeError
         size_t length()
 
+        const c_block *raw() const
+        size_t size() const
+
     # Manages a slice of a sequence. The sequence must have already been initialized
     # and will have boundaries checked according to view pointers.
     # @since 0.1.1
@@ -45,6 +48,8 @@
 # @since 0.1.1
 cdef class Sequence:
     cdef c_sequence thisptr
+    cdef Py_ssize_t c_shape[1]
+    cdef Py_ssize_t c_strides[1]
 
     # Sets the underlying C++ object to the given target instance.
     # @param target The target object to use as underlying instance.
@@ -4,8 +4,9 @@
 # @author Rodrigo Siqueira <rodriados@gmail.com>
 # @copyright 2018-present Rodrigo Siqueira
 from libcpp.string cimport string
-from encoder cimport c_unit, c_encode, c_decode, c_end
+from encoder cimport c_unit, c_block, c_encode, c_decode, c_end
 from sequence cimport c_sequence
+from cpython.buffer cimport PyBUF_WRITABLE
 
 from functools import singledispatch
 
@@ -45,6 +46,36 @@ def __getitem__(self, int offset):
         cdef c_unit result = self.thisptr.at(offset)
         return chr(c_decode(result))
 
+    # Exposes the sequence's encoded blocks through the buffer protocol, so they
+    # can be viewed by NumPy without any copies. Each block is an unsigned 16-bit
+    # integer packing three units. The view keeps the sequence alive.
+    # @param view The buffer view to be filled.
+    # @param flags The buffer request flags.
+    def __getbuffer__(self, Py_buffer *view, int flags):
+        if flags & PyBUF_WRITABLE:
+            raise BufferError("sequence is read-only")
+
+        self.c_shape[0] = self.thisptr.size()
+        self.c_strides[0] = sizeof(c_block)
+
+        view.buf = <void *> self.thisptr.raw()
+        view.obj = self
+        view.len = self.c_shape[0] * sizeof(c_block)
+        view.readonly = 1
+        view.itemsize = sizeof(c_block)
+        view.format = 'H'
+        view.ndim = 1
+        view.shape = self.c_shape
+        view.strides = self.c_strides
+        view.suboffsets = NULL
+        view.internal = NULL
+
+    # Releases a buffer view. As the view only references the sequence's blocks,
+    # there is nothing to be released.
+    # @param view The buffer view to be released.
+    def __releasebuffer__(self, Py_buffer *view):
+        pass
+
     # Transforms the sequence into a string.
     # @return The sequence representation as a string.
     def __str__(self):
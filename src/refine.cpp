@@ -0,0 +1,59 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the heuristic's iterative refinement module.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include "io.hpp"
+#include "node.hpp"
+#include "pipeline.hpp"
+#include "exception.hpp"
+
+#include "refine.cuh"
+#include "io/dumper/alignment.hpp"
+
+namespace museqa
+{
+    namespace module
+    {
+        namespace rf = museqa::refine;
+
+        /**
+         * Execute the module's task when on a pipeline. The alignment is only
+         * known by the master node, thus it is refined by the master node alone.
+         * @param io The pipeline's IO service instance.
+         * @param pipe The previous module's conduit.
+         * @return A conduit with the module's processed results.
+         */
+        auto refine::run(const io::manager& io, pipeline::pipe& pipe) const -> pipeline::pipe
+        {
+            auto previous = pipeline::convert<refine::previous>(pipe);
+
+            onlymaster if(io.cmd.has("refine")) {
+                auto budget = io.cmd.get<double>("refine", 0);
+                auto tablename = io.cmd.get("scoring-table", "default");
+
+                auto table = museqa::pairwise::scoring_table::make(tablename);
+                rf::run(previous->aligned, {previous->tree, table, budget});
+
+                if(io.cmd.has("output"))
+                    enforce(io.dump(*previous, io.cmd.get("output")), "could not dump alignment");
+            }
+
+            return pipe;
+        }
+
+        /**
+         * Checks whether command line arguments produce a valid module state.
+         * @param io The pipeline's IO service instance.
+         * @return Are the given command line arguments valid?
+         */
+        auto refine::check(const io::manager& io) const -> bool
+        {
+            auto budget = io.cmd.get<double>("refine", 0);
+            enforce(budget >= 0, "the refinement's time budget cannot be negative");
+
+            return true;
+        }
+    }
+}
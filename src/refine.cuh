@@ -0,0 +1,64 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Exposes an interface for the heuristics' iterative refinement module.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include "io.hpp"
+#include "pipeline.hpp"
+#include "pgalign.cuh"
+
+/*
+ * The heuristic's optional refinement stage.
+ * This module is responsible for improving the global alignment, by realigning
+ * the groups of sequences split by the guide tree's edges, for a given amount of time.
+ */
+
+#include "refine/refine.cuh"
+
+namespace museqa
+{
+    namespace module
+    {
+        /**
+         * Defines the module's pipeline manager. This object will be the one responsible
+         * for checking and managing the module's execution when on a pipeline. The
+         * module simply hands its previous conduit over when no refinement is requested.
+         * @since 0.1.1
+         */
+        struct refine : public pipeline::module
+        {
+            typedef museqa::module::pgalign::conduit conduit;   /// The module's conduit type.
+            typedef museqa::module::pgalign previous;           /// The expected previous module.
+
+            /**
+             * Returns an string identifying the module's name.
+             * @return The module's name.
+             */
+            inline auto name() const -> const char * override
+            {
+                return "refine";
+            }
+
+            auto run(const io::manager&, pipeline::pipe&) const -> pipeline::pipe override;
+            auto check(const io::manager&) const -> bool override;
+        };
+    }
+
+    namespace refine
+    {
+        /**
+         * Alias for the iterative refinement module's runner.
+         * @since 0.1.1
+         */
+        using module = museqa::module::refine;
+
+        /**
+         * Alias for the iterative refinement module's conduit.
+         * @since 0.1.1
+         */
+        using conduit = museqa::module::refine::conduit;
+    }
+}
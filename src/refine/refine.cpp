@@ -0,0 +1,312 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the iterative refinement module's functionality.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include <deque>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "buffer.hpp"
+#include "parallel.hpp"
+#include "pairwise.cuh"
+#include "phylogeny.cuh"
+
+#include "pgalign/sequence.cuh"
+#include "pgalign/alignment.cuh"
+#include "pgalign/myers/aligner.hpp"
+
+#include "refine/refine.cuh"
+
+namespace
+{
+    using namespace museqa;
+    using namespace refine;
+
+    using pgalign::alignment;
+    using operation = pgalign::myers::aligner::operation;
+    using index_type = pgalign::sequence::index_type;
+    using clock = std::chrono::steady_clock;
+
+    /*
+     * Refinement configuration parameters. The guide tree's edges are visited for
+     * at most the given number of passes, even if the time budget allows for more.
+     * A realignment is only kept if it overcomes the score's rounding errors.
+     */
+    enum : size_t { max_passes = 4 };
+    static constexpr score tolerance = 1e-5f;
+
+    /**
+     * Lays out the guide tree's leaves so every subtree's leaves are contiguous.
+     * Thus, the sequences on each side of an edge are quickly told apart.
+     * @since 0.1.1
+     */
+    struct layout
+    {
+        std::vector<size_t> offset;         /// The offset of each node's leaves.
+        std::vector<size_t> size;           /// The number of leaves below each node.
+        std::vector<size_t> depth;          /// The distance of each node from the root.
+    };
+
+    /**
+     * A realignment of the groups of sequences on each side of one of the guide
+     * tree's edges. The columns made only of gaps within a group are removed, so
+     * the groups' profiles can be realigned from scratch.
+     * @since 0.1.1
+     */
+    struct attempt
+    {
+        oturef edge;                        /// The guide tree's edge being cut.
+        std::vector<size_t> rows[2];        /// The alignment's rows on each side of the edge.
+        alignment group[2];                 /// The groups of sequences on each side of the edge.
+        std::vector<operation> current;     /// The groups' current alignment.
+        double gain = 0;                    /// The sum-of-pairs score gained by the realignment.
+    };
+
+    /**
+     * Lays out the guide tree's leaves. As a node's children always have lower
+     * references than itself, the nodes can simply be visited in order.
+     * @param tree The alignment's guide tree.
+     * @param leaves The guide tree's number of leaves.
+     * @return The guide tree's layout.
+     */
+    static auto arrange(const phylogeny::guidetree& tree, size_t leaves) -> layout
+    {
+        const size_t nodes = 2 * leaves - 1;
+
+        layout result;
+
+        result.offset.resize(nodes, 0);
+        result.size.resize(nodes, 1);
+        result.depth.resize(nodes, 0);
+
+        for(size_t p = leaves; p < nodes; ++p)
+            result.size[p] = result.size[tree[p].child[0]] + result.size[tree[p].child[1]];
+
+        for(size_t p = nodes - 1; p >= leaves; --p)
+            for(size_t k = 0, displ = 0; k < 2; displ += result.size[tree[p].child[k++]]) {
+                result.offset[tree[p].child[k]] = result.offset[p] + displ;
+                result.depth[tree[p].child[k]] = result.depth[p] + 1;
+            }
+
+        return result;
+    }
+
+    /**
+     * Lists the guide tree's edges in the order they must be visited, from the
+     * deepest to the shallowest edges. As both of the root's edges split the
+     * sequences into the same groups, only one of them is kept.
+     * @param tree The alignment's guide tree.
+     * @param plan The guide tree's layout.
+     * @param leaves The guide tree's number of leaves.
+     * @return The guide tree's edges, each named by its lower node.
+     */
+    static auto edges(const phylogeny::guidetree& tree, const layout& plan, size_t leaves) -> std::vector<oturef>
+    {
+        const size_t root = 2 * leaves - 2;
+        std::vector<oturef> result;
+
+        for(size_t p = 0; p < root; ++p)
+            if(p != tree[root].child[1])
+                result.push_back(oturef(p));
+
+        std::stable_sort(result.begin(), result.end(), [&](oturef a, oturef b) {
+            return plan.depth[a] > plan.depth[b];
+        });
+
+        return result;
+    }
+
+    /**
+     * Splits the alignment's sequences into the groups on each side of an edge.
+     * The groups' sequences are copies whose gap runs are rebuilt without the
+     * group's columns of gaps only, thus the groups can be realigned by any thread,
+     * without ever touching the alignment's sequences.
+     * @param target The alignment being refined.
+     * @param plan The guide tree's layout.
+     * @param edge The guide tree's edge to be cut.
+     * @return The realignment attempt.
+     */
+    static auto split(const alignment& target, const layout& plan, oturef edge) -> attempt
+    {
+        const size_t count = target.count();
+        const size_t length = target[0].length();
+
+        std::vector<uint8_t> used (length, 0);
+        std::vector<index_type> columns;
+
+        attempt result;
+        result.edge = edge;
+
+        for(size_t k = 0; k < count; ++k) {
+            const size_t leaf = plan.offset[target.origin(k)];
+            const int side = leaf >= plan.offset[edge] && leaf < plan.offset[edge] + plan.size[edge] ? 0 : 1;
+
+            columns.resize(target[k].residues());
+            target[k].columns(columns.data());
+
+            for(const auto column : columns)
+                used[column] |= 1 << side;
+
+            result.rows[side].push_back(k);
+        }
+
+        std::vector<index_type> map[2] = {std::vector<index_type> (length), std::vector<index_type> (length)};
+        index_type kept[2] = {0, 0};
+
+        for(size_t c = 0; c < length; ++c) {
+            map[0][c] = kept[0];
+            map[1][c] = kept[1];
+
+            kept[0] += used[c] & 1;
+            kept[1] += used[c] >> 1;
+
+            if(used[c] == 3)      result.current.push_back(operation::match);
+            else if(used[c] == 1) result.current.push_back(operation::deletion);
+            else if(used[c] == 2) result.current.push_back(operation::insertion);
+        }
+
+        std::vector<pgalign::sequence::run> runs;
+
+        for(int side = 0; side < 2; ++side) {
+            const size_t total = result.rows[side].size();
+            auto& group = result.group[side] = alignment {
+                    buffer<pgalign::sequence>::make(total)
+                ,   buffer<uint32_t>::make(total)
+                };
+
+            for(size_t i = 0; i < total; ++i) {
+                const auto& original = target[result.rows[side][i]];
+                const index_type residues = static_cast<index_type>(original.residues());
+
+                columns.resize(residues);
+                original.columns(columns.data());
+                runs.clear();
+
+                for(index_type r = 0; r <= residues; ++r) {
+                    const index_type gaps = (r < residues ? map[side][columns[r]] : kept[side]) - r;
+                    if(gaps > (runs.empty() ? 0 : runs.back().total)) runs.push_back({r, gaps});
+                }
+
+                group[i] = original;
+                group[i].assign(runs.data(), runs.size());
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * Realigns the groups of sequences on each side of an edge. As the groups'
+     * own alignments are kept, only the score between pairs of sequences from
+     * different groups can change, which is exactly what the profile aligner
+     * maximizes. Thus, the realignment is kept only if it beats the current one.
+     * @param current The realignment attempt.
+     * @param table The scoring table to align the groups with.
+     */
+    static void realign(attempt& current, const pairwise::scoring_table& table)
+    {
+        const auto one = pgalign::myers::make_profile(current.group[0], table);
+        const auto two = pgalign::myers::make_profile(current.group[1], table);
+
+        pgalign::myers::aligner worker {one, two, table};
+
+        const score before = worker.evaluate(current.current);
+        const auto& script = worker.run();
+        const score after = worker.evaluate(script);
+
+        if(after - before > tolerance * (1 + std::abs(before))) {
+            current.gain = double(after - before) * current.rows[0].size() * current.rows[1].size();
+            pgalign::myers::expand(current.group[0], current.group[1], script);
+        }
+    }
+
+    /**
+     * Replaces the alignment's sequences by their realigned copies.
+     * @param target The alignment being refined.
+     * @param current The realignment attempt to be kept.
+     */
+    static void apply(alignment& target, const attempt& current)
+    {
+        for(int side = 0; side < 2; ++side)
+            for(size_t i = 0; i < current.rows[side].size(); ++i)
+                target[current.rows[side][i]] = current.group[side][i];
+    }
+}
+
+namespace museqa
+{
+    /**
+     * Iteratively refines an alignment by tree-dependent restricted partitioning.
+     * Each of the guide tree's edges splits the sequences into two groups, which
+     * are realigned to each other. The edges are attempted in batches, one edge
+     * for each host thread, and the best improvement within a batch is kept. As
+     * the batch's other attempts become stale, their edges are attempted again.
+     * @param target The alignment to be refined.
+     * @param ctx The refinement's context.
+     * @return The refinement's report.
+     */
+    auto refine::run(pgalign::alignment& target, const context& ctx) -> report
+    {
+        const size_t count = target.count();
+        report result;
+
+        // With only two sequences, the only edge splits them apart, and they have
+        // already been optimally aligned to each other by the profile-aligner.
+        if(count < 3 || ctx.budget <= 0) {
+            return result;
+        }
+
+        const auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double> {ctx.budget}
+            );
+
+        const auto plan = arrange(ctx.tree, count);
+        const auto list = edges(ctx.tree, plan, count);
+        const size_t workers = utils::max<size_t>(parallel::global().size(), 1);
+
+        for(size_t pass = 0; pass < max_passes && clock::now() < deadline; ++pass) {
+            std::deque<oturef> queue {list.begin(), list.end()};
+            bool improved = false;
+
+            while(!queue.empty() && clock::now() < deadline) {
+                std::vector<attempt> batch;
+
+                for(; !queue.empty() && batch.size() < workers; queue.pop_front())
+                    batch.push_back(split(target, plan, queue.front()));
+
+                parallel::foreach(batch.size(), [&](const range<size_t>& partition, size_t) {
+                    for(size_t k = partition.offset; k < partition.offset + partition.total; ++k)
+                        realign(batch[k], ctx.table);
+                });
+
+                size_t best = 0;
+
+                for(size_t k = 1; k < batch.size(); ++k)
+                    if(batch[k].gain > batch[best].gain)
+                        best = k;
+
+                result.attempts += batch.size();
+
+                if(batch[best].gain > 0) {
+                    apply(target, batch[best]);
+                    improved = true;
+                    ++result.accepted;
+
+                    for(size_t k = batch.size(); k-- > 0; )
+                        if(k != best && batch[k].gain > 0)
+                            queue.push_front(batch[k].edge);
+                }
+            }
+
+            if(!improved) break;
+        }
+
+        return result;
+    }
+}
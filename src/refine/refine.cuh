@@ -0,0 +1,43 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements the iterative refinement module's functionality.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "pairwise.cuh"
+#include "phylogeny.cuh"
+
+#include "pgalign/alignment.cuh"
+
+namespace museqa
+{
+    namespace refine
+    {
+        /**
+         * Represents the iterative refinement's context.
+         * @since 0.1.1
+         */
+        struct context
+        {
+            const phylogeny::guidetree& tree;       /// The tree which has guided the alignment.
+            const pairwise::scoring_table& table;   /// The scoring table to align profiles with.
+            const double budget;                    /// The refinement's time budget, in seconds.
+        };
+
+        /**
+         * Reports the outcome of an iterative refinement.
+         * @since 0.1.1
+         */
+        struct report
+        {
+            size_t attempts = 0;                    /// The number of edges realigned.
+            size_t accepted = 0;                    /// The number of realignments kept.
+        };
+
+        extern auto run(pgalign::alignment&, const context&) -> report;
+    }
+}
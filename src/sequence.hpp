@@ -118,6 +118,16 @@ namespace museqa
                 return length;
             }
 
+            /**
+             * Decodes the whole sequence into its units, in bulk. The given buffer
+             * must have room for all units, including the padding ones.
+             * @param out The buffer to write the sequence's units to.
+             */
+            __host__ __device__ inline void unpack(encoder::unit *out) const noexcept
+            {
+                encoder::unpack(this->raw(), size(), out);
+            }
+
             /**
              * Transforms the sequence into a string.
              * @return The sequence representation as a string.
@@ -187,6 +197,86 @@ namespace museqa
             }
     };
 
+    /**
+     * Borrows an encoded sequence, or a sequence's slice, without sharing its
+     * ownership. As with every buffer view, a sequence reference is trivially
+     * copied, thus it is the type to pass sequences around within inner loops
+     * and device kernels, while the sequences are owned by their databases.
+     * @since 0.1.1
+     */
+    class sequence_ref : public buffer_view<const encoder::block>
+    {
+        protected:
+            using underlying_view = buffer_view<const encoder::block>;  /// The underlying view type.
+
+        public:
+            static constexpr encoder::unit padding = encoder::end;
+
+        public:
+            __host__ __device__ inline constexpr sequence_ref() noexcept = default;
+            __host__ __device__ inline constexpr sequence_ref(const sequence_ref&) noexcept = default;
+            __host__ __device__ inline constexpr sequence_ref(sequence_ref&&) noexcept = default;
+
+            using underlying_view::buffer_view;
+
+            __host__ __device__ inline sequence_ref& operator=(const sequence_ref&) noexcept = default;
+            __host__ __device__ inline sequence_ref& operator=(sequence_ref&&) noexcept = default;
+
+            /**
+             * Retrieves the encoded unit at given offset.
+             * @param offset The requested offset.
+             * @return The unit in the specified offset.
+             */
+            __host__ __device__ inline encoder::unit operator[](ptrdiff_t offset) const noexcept
+            {
+                return encoder::access(block(offset / encoder::block_size), offset % encoder::block_size);
+            }
+
+            /**
+             * Retrieves an encoded character block from sequence.
+             * @param offset The index of the requested block.
+             * @return The requested encoded block.
+             */
+            __host__ __device__ inline encoder::block block(ptrdiff_t offset) const noexcept
+            {
+                return underlying_view::operator[](offset);
+            }
+
+            /**
+             * Informs the length of the sequence.
+             * @return The sequence's length.
+             */
+            __host__ __device__ inline size_t length() const noexcept
+            {
+                return size() * encoder::block_size;
+            }
+
+            /**
+             * Retrieves the sequence's unpadded length.
+             * @return The sequence's length without any padding.
+             */
+            __host__ __device__ inline size_t unpadded() const noexcept
+            {
+                encoder::block last_block = block(size() - 1);
+                size_t length = this->length();
+
+                for(size_t i = 1; i < encoder::block_size; ++i)
+                    length -= (padding == encoder::access(last_block, i));
+
+                return length;
+            }
+
+            /**
+             * Decodes the whole sequence into its units, in bulk. The given buffer
+             * must have room for all units, including the padding ones.
+             * @param out The buffer to write the sequence's units to.
+             */
+            __host__ __device__ inline void unpack(encoder::unit *out) const noexcept
+            {
+                encoder::unpack(this->raw(), size(), out);
+            }
+    };
+
     namespace fmt
     {
         /**
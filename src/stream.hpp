@@ -0,0 +1,27 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Exposes the arrival of the sequences streamed by the bootstrap module.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2018-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace museqa
+{
+    /**
+     * The bootstrap module sends the sequences database to the slave nodes in
+     * chunks, and does not wait for all of them to arrive. Thus, modules must
+     * wait for the sequences they need before reading them. As sequences arrive
+     * in order, a prefix of the database is always available.
+     * @see module::bootstrap
+     * @since 0.1.1
+     */
+    namespace stream
+    {
+        extern void await(size_t);
+        extern void progress();
+        extern void complete();
+    }
+}
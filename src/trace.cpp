@@ -0,0 +1,179 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implementation for the tracing layer's spans and their Chrome trace export.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#include "environment.h"
+
+#if defined(__museqa_tracing)
+
+#include <set>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+
+#include "mpi.hpp"
+#include "node.hpp"
+#include "utils.hpp"
+#include "trace.hpp"
+#include "benchmark.hpp"
+#include "exception.hpp"
+
+namespace
+{
+    using namespace museqa;
+
+    /**
+     * The node's ring buffer of spans, and the total number of spans ever recorded
+     * into it. The buffer's oldest spans are overwritten once it is full.
+     * @since 0.1.1
+     */
+    static std::vector<trace::span> ring (trace::capacity);
+    static std::atomic<size_t> written {0};
+
+    /**
+     * The trace's origin. All spans are timed relative to it, and all nodes set
+     * their origins at once, so their timelines can be merged together.
+     * @since 0.1.1
+     */
+    static benchmark::ticker::time_point origin = benchmark::ticker::now();
+
+    /**
+     * Identifies each host thread within the node's trace. Threads are numbered
+     * in the order they record their first spans.
+     * @since 0.1.1
+     */
+    static std::atomic<uint32_t> threads {0};
+    thread_local const uint32_t thread = threads++;
+
+    /**
+     * Writes a span as a Chrome trace's complete event. The event's timestamps are
+     * given in microseconds, and its process is the node the span ran on.
+     * @param out The stream to write the event into.
+     * @param current The span to be written.
+     */
+    static void serialize(std::ostream& out, const trace::span& current)
+    {
+        out << ",\n{\"name\":\"" << current.name << "\",\"cat\":\"" << current.category << "\""
+            << ",\"ph\":\"X\",\"pid\":" << node::rank << ",\"tid\":" << current.thread
+            << ",\"ts\":" << current.start * 1e6 << ",\"dur\":" << current.duration * 1e6 << "}";
+    }
+
+    /**
+     * Writes the metadata naming a node's process or one of its threads.
+     * @param out The stream to write the metadata into.
+     * @param kind The metadata's kind, either a process or thread name.
+     * @param tid The named thread, if any.
+     * @param name The process's or thread's name.
+     */
+    static void name(std::ostream& out, const char *kind, uint32_t tid, const std::string& name)
+    {
+        out << ",\n{\"name\":\"" << kind << "\",\"ph\":\"M\",\"pid\":" << node::rank
+            << ",\"tid\":" << tid << ",\"args\":{\"name\":\"" << name << "\"}}";
+    }
+}
+
+namespace museqa
+{
+    /**
+     * Retrieves the time elapsed since the trace's origin.
+     * @return The current time, in seconds since the trace's origin.
+     */
+    auto trace::clock() noexcept -> double
+    {
+        return std::chrono::duration<double> {benchmark::ticker::now() - origin}.count();
+    }
+
+    /**
+     * Records a span ran by the current host thread.
+     * @param name The span's task name.
+     * @param category The span's category.
+     * @param start The span's start time.
+     * @param duration The span's duration.
+     */
+    void trace::record(const char *name, const char *category, double start, double duration) noexcept
+    {
+        trace::record(name, category, start, duration, thread);
+    }
+
+    /**
+     * Records a span into the node's ring buffer.
+     * @param name The span's task name.
+     * @param category The span's category.
+     * @param start The span's start time.
+     * @param duration The span's duration.
+     * @param tid The thread or device the span ran on.
+     */
+    void trace::record(const char *name, const char *category, double start, double duration, uint32_t tid) noexcept
+    {
+        ring[written++ % trace::capacity] = {name, category, start, duration, tid};
+    }
+
+    /**
+     * Sets the trace's origin at once on all nodes. Any spans recorded before the
+     * origin has been set are discarded.
+     * @see mpi::init
+     */
+    void trace::init()
+    {
+        mpi::barrier();
+
+        origin = benchmark::ticker::now();
+        written = 0;
+    }
+
+    /**
+     * Merges the spans recorded by all nodes into a Chrome trace file on the master
+     * node. Each node is shown as a process, with a timeline for each of its host
+     * threads and devices. This is a collective operation.
+     * @param filename The name of the file to write the trace into.
+     */
+    void trace::dump(const std::string& filename)
+    {
+        trace::flush();
+
+        std::ostringstream out;
+        std::set<uint32_t> seen;
+
+        out << std::fixed << std::setprecision(3);
+
+        const size_t total = written;
+        const size_t first = total > trace::capacity ? total - trace::capacity : 0;
+
+        name(out, "process_name", 0, node::rank == node::master ? "master" : "node " + std::to_string(node::rank));
+
+        for(size_t i = first; i < total; ++i) {
+            const auto& current = ring[i % trace::capacity];
+
+            if(seen.insert(current.thread).second)
+                name(out, "thread_name", current.thread, current.thread >= trace::device_thread
+                    ? "device " + std::to_string(current.thread - trace::device_thread)
+                    : "thread " + std::to_string(current.thread));
+
+            serialize(out, current);
+        }
+
+        const std::string text = out.str();
+        std::vector<char> local (text.begin(), text.end());
+        std::vector<char> all = mpi::gather(local);
+
+        onlymaster {
+            std::ofstream file (filename);
+            enforce(!file.fail(), "could not write trace file '%s'", filename);
+
+            // Every event is preceded by a comma, so the very first one must be
+            // skipped over for the list of events to be valid.
+            file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+            file.write(all.data() + 1, all.size() - 1);
+            file << "\n]}\n";
+        }
+    }
+}
+
+#endif
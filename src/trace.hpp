@@ -0,0 +1,173 @@
+/**
+ * Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+ * @file Implements a low-overhead tracing layer for the software's hot paths.
+ * @author Rodrigo Siqueira <rodriados@gmail.com>
+ * @copyright 2020-present Rodrigo Siqueira
+ */
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "cuda.cuh"
+#include "environment.h"
+
+namespace museqa
+{
+    namespace trace
+    {
+        /**
+         * A span of time spent by a node on a named task. The span's name and
+         * category are not copied, so they must be string literals. Spans are
+         * timed relative to the trace's origin, which is shared by all nodes.
+         * @since 0.1.1
+         */
+        struct span
+        {
+            const char *name;           /// The span's task name.
+            const char *category;       /// The span's category.
+            double start;               /// The span's start, in seconds since the origin.
+            double duration;            /// The span's duration, in seconds.
+            uint32_t thread;            /// The thread or device the span ran on.
+        };
+
+        /*
+         * The number of spans kept by each node. Spans are kept in a ring buffer,
+         * so only the latest spans are kept when a trace runs for too long. Device
+         * spans are shown on their own timelines, after the host threads'.
+         */
+        enum : size_t { capacity = 1 << 18 };
+        enum : uint32_t { device_thread = 1000 };
+
+      #if defined(__museqa_tracing)
+        /**
+         * Informs whether the tracing layer has been compiled in.
+         * @since 0.1.1
+         */
+        enum : bool { enabled = true };
+
+        extern auto clock() noexcept -> double;
+        extern void record(const char *, const char *, double, double) noexcept;
+        extern void record(const char *, const char *, double, double, uint32_t) noexcept;
+
+        extern void init();
+        extern void flush();
+        extern void dump(const std::string&);
+
+        /**
+         * Times the scope it lives in as a span. The span is recorded when the
+         * scope is left, so its duration includes everything done by the scope.
+         * @since 0.1.1
+         */
+        class scope
+        {
+            protected:
+                const char *m_name;             /// The span's task name.
+                const char *m_category;         /// The span's category.
+                const double m_start;           /// The span's start time.
+
+            public:
+                /**
+                 * Starts timing a new span.
+                 * @param name The span's task name.
+                 * @param category The span's category.
+                 */
+                inline scope(const char *name, const char *category = "host") noexcept
+                :   m_name {name}
+                ,   m_category {category}
+                ,   m_start {trace::clock()}
+                {}
+
+                scope(const scope&) = delete;
+                scope& operator=(const scope&) = delete;
+
+                /**
+                 * Records the span, as its scope is left.
+                 * @see trace::scope::scope
+                 */
+                inline ~scope() noexcept
+                {
+                    trace::record(m_name, m_category, m_start, trace::clock() - m_start);
+                }
+        };
+
+        #if defined(__museqa_compiler_nvcc)
+          extern void enqueue(const char *, cudaEvent_t, cudaEvent_t) noexcept;
+
+          /**
+           * Times the device work enqueued into a stream while the scope lives.
+           * As the host must not wait for the device, the span's events are only
+           * resolved into a span when the trace is dumped, or if too many pile up.
+           * @since 0.1.1
+           */
+          class kernel
+          {
+              protected:
+                  const char *m_name;           /// The span's task name.
+                  cudaStream_t m_stream;        /// The stream the work is enqueued into.
+                  cudaEvent_t m_start;          /// The event marking the work's start.
+
+              public:
+                  /**
+                   * Marks the start of the device work enqueued into a stream.
+                   * @param name The span's task name.
+                   * @param stream The stream the work is enqueued into.
+                   */
+                  inline kernel(const char *name, cudaStream_t stream = 0) noexcept
+                  :   m_name {name}
+                  ,   m_stream {stream}
+                  {
+                      cudaEventCreate(&m_start);
+                      cudaEventRecord(m_start, m_stream);
+                  }
+
+                  kernel(const kernel&) = delete;
+                  kernel& operator=(const kernel&) = delete;
+
+                  /**
+                   * Marks the end of the device work, and hands both events over
+                   * to be resolved later on.
+                   * @see trace::kernel::kernel
+                   */
+                  inline ~kernel() noexcept
+                  {
+                      cudaEvent_t stop;
+                      cudaEventCreate(&stop);
+                      cudaEventRecord(stop, m_stream);
+                      trace::enqueue(m_name, m_start, stop);
+                  }
+          };
+        #endif
+      #else
+        /**
+         * Informs whether the tracing layer has been compiled in. When it has not,
+         * all spans are empty objects and are entirely optimized away.
+         * @since 0.1.1
+         */
+        enum : bool { enabled = false };
+
+        inline void init() noexcept {}
+        inline void dump(const std::string&) noexcept {}
+
+        /**
+         * The no-op scope span, used when tracing has not been compiled in.
+         * @since 0.1.1
+         */
+        struct scope
+        {
+            inline constexpr scope(const char *, const char * = "host") noexcept {}
+        };
+
+        #if defined(__museqa_compiler_nvcc)
+          /**
+           * The no-op device span, used when tracing has not been compiled in.
+           * @since 0.1.1
+           */
+          struct kernel
+          {
+              inline constexpr kernel(const char *, cudaStream_t = 0) noexcept {}
+          };
+        #endif
+      #endif
+    }
+}
@@ -118,5 +118,16 @@ namespace museqa
                 return {shape.y, shape.y};
             }
         };
+
+        /**
+         * Implements a lazily compacted transformation. Spatially, this transformation
+         * behaves exactly as a linear one, but tells shrinkable matrices to reach
+         * their elements through a list of active offsets. Removed offsets are thus
+         * simply left behind, instead of having their elements physically moved.
+         * This transformation can only be applied to 2-dimensional spaces.
+         * @since 0.1.1
+         */
+        struct lazy : public linear<2>
+        {};
     }
 }
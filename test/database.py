@@ -73,3 +73,30 @@ def testIfCanMergeDatabases(subsets):
             assert sequence == str(db[0][name].contents)
 
     assert sum(len(s) for s in subsets) == db[0].count
+
+# Tests whether a list of sequences can be added to the database at once.
+# @param database The database sequences to test with.
+# @since 0.1.1
+def testIfCanAddSequencesInBulk(database):
+    db = Database()
+    db.add([*database.values()])
+
+    for i, sequence in enumerate(database.values()):
+        assert sequence == str(db[i].contents)
+
+    assert len(database) == db.count
+
+# Tests whether sequences can be parsed in place from a FASTA file's contents.
+# @param database The database sequences to test with.
+# @since 0.1.1
+def testIfCanAddSequencesFromContents(database):
+    contents = "".join(">{}\n{}\n".format(name, sequence) for name, sequence in database.items())
+
+    db = Database()
+    db.add(memoryview(contents.encode('ascii')))
+
+    for name, sequence in database.items():
+        assert name == db[name].description
+        assert sequence == str(db[name].contents)
+
+    assert len(database) == db.count
@@ -53,6 +53,77 @@ def testLoadFromFastaFile(fasta):
         assert key == database[key].description
         assert digest == md5(str(database[key].contents).encode()).hexdigest()
 
+# Tests whether gzip compressed FASTA files are parsed into the same sequences as
+# their plain counterparts.
+# @param fasta The file fixture to run the test with.
+# @since 0.1.1
+def testLoadFromGzipFile(fasta):
+    filename, expected = fasta
+    plain = Database.load(filename)
+    database = Database.load(filename + ".gz")
+
+    assert plain.count == database.count
+
+    for key, digest in expected.items():
+        assert key == database[key].description
+        assert digest == md5(str(database[key].contents).encode()).hexdigest()
+        assert str(plain[key].contents) == str(database[key].contents)
+
+# Tests whether a database dumped into a binary database file is loaded back with
+# exactly the same sequences.
+# @param fasta The file fixture to run the test with.
+# @param tmp_path The temporary directory to dump the database into.
+# @since 0.1.1
+def testLoadFromBinaryFile(fasta, tmp_path):
+    filename, expected = fasta
+    target = str(tmp_path / "mock.mdb")
+
+    Database.load(filename).dump(target)
+    database = Database.load(target)
+
+    assert len(expected) == database.count
+
+    for key, digest in expected.items():
+        assert key == database[key].description
+        assert digest == md5(str(database[key].contents).encode()).hexdigest()
+
+# Tests whether a binary database file whose size is not a multiple of the blocks'
+# size is loaded back whole, both its sequences and its trailing descriptions.
+# @param tmp_path The temporary directory to dump the database into.
+# @since 0.1.1
+def testLoadFromOddSizedBinaryFile(tmp_path):
+    target = str(tmp_path / "odd.mdb")
+
+    db = Database()
+    db.add(("odd", "MNNQRKKTGRPSFNM"))
+    db.add(("size", "LKRARNRVS"))
+    db.dump(target)
+
+    database = Database.load(target)
+
+    assert database.count == 2
+    assert database["odd"].description == "odd"
+    assert database["size"].description == "size"
+    assert str(database["odd"].contents) == "MNNQRKKTGRPSFNM"
+    assert str(database["size"].contents) == "LKRARNRVS"
+
+# Tests whether a FASTA file whose sequences have empty descriptions can be parsed,
+# even if the very first description line is a bare header.
+# @param tmp_path The temporary directory to write the FASTA file into.
+# @since 0.1.1
+def testLoadWithEmptyDescription(tmp_path):
+    target = tmp_path / "empty.fasta"
+    target.write_text(">\nMNNQRKKTG\n>second\nPSFNMLKRA\n>\nNRVSTGSQL\n")
+
+    database = Database.load(str(target))
+
+    assert database.count == 3
+    assert database[0].description == ""
+    assert database[2].description == ""
+    assert database["second"].description == "second"
+    assert str(database[0].contents) == "MNNQRKKTG"
+    assert str(database[2].contents) == "NRVSTGSQL"
+
 # Tests whether an exception is thrown when trying to parse unknown file.
 # @since 0.1.1
 def testIfRaisesOnUnknownFile():
@@ -6,6 +6,7 @@
 from museqa.algorithm import pairwise as algorithm
 from museqa.database import Database
 from museqa import pairwise
+import random
 import pytest
 
 # Defines some fixture files to be processed by different test cases.
@@ -57,6 +58,13 @@ def assertAlgorithmExecution(db, reference, target, **extra):
 def testSequentialNeedleman(database, table):
     assertAlgorithmExecution(database, 'sequential', algorithm.needleman, table = table)
 
+# Tests whether the vectorized needleman algorithm produces the expected matrix.
+# @param database The database to test the algorithm with.
+# @param table The scoring table to run the algorothm with.
+# @since 0.1.1
+def testSimdNeedleman(database, table):
+    assertAlgorithmExecution(database, 'sequential', 'simd', table = table)
+
 # Tests whether the hybrid needleman algorithm produces the expected matrix.
 # @param database The database to test the algorithm with.
 # @param table The scoring table to run the algorothm with.
@@ -64,3 +72,78 @@ def testSequentialNeedleman(database, table):
 @pytest.mark.skip(reason = "a CUDA device may not be available")
 def testHybridNeedleman(database, table):
     assertAlgorithmExecution(database, 'hybrid', algorithm.needleman, table = table)
+
+# Creates a fixture for a database whose pairs' best alignments run along the edge
+# of a band. The sequences share a common core, but have long runs of residues
+# removed from or added to either end, so their best paths only join the band's
+# lower edge well below the alignment matrix's first lines.
+# @since 0.1.1
+@pytest.fixture
+def skewed():
+    rng = random.Random(1)
+    residue = lambda n: ''.join(rng.choice("ARNDCQEGHILKMFPSTWYV") for _ in range(n))
+    core = residue(160)
+
+    db = Database()
+    db.add({
+        "SK01": core
+    ,   "SK02": core[70:]
+    ,   "SK03": core[:90]
+    ,   "SK04": core[40:130]
+    ,   "SK05": residue(60) + core
+    ,   "SK06": core[:60] + residue(40) + core[100:]
+    })
+
+    return db
+
+# Tests whether the sequential banded needleman algorithm produces the expected
+# matrix, even when the best alignments touch the band's lower edge.
+# @param skewed The database to test the algorithm with.
+# @param table The scoring table to run the algorothm with.
+# @since 0.1.1
+def testSequentialBandedNeedleman(skewed, table):
+    assertAlgorithmExecution(skewed, 'sequential', 'sequential-banded', table = table)
+
+# Tests whether the hybrid banded needleman algorithm produces the expected matrix,
+# even when the best alignments touch the band's lower edge.
+# @param skewed The database to test the algorithm with.
+# @param table The scoring table to run the algorothm with.
+# @since 0.1.1
+@pytest.mark.skip(reason = "a CUDA device may not be available")
+def testHybridBandedNeedleman(skewed, table):
+    assertAlgorithmExecution(skewed, 'sequential', 'banded', table = table)
+
+# Tests whether the k-mer algorithm produces a symmetric matrix of similarities,
+# in which identical sequences are as similar as any sequences can be.
+# @param database The database to test the algorithm with.
+# @since 0.1.1
+def testKmerDistances(database):
+    db = Database()
+    db.merge(database)
+    db.add({"DUPLICATE": str(database[0].contents)})
+
+    matrix = pairwise.run(db, algorithm = 'kmer')
+    assert matrix.count == db.count
+
+    for i in range(matrix.count):
+        for j in range(i):
+            assert matrix[i, j] == matrix[j, i]
+            assert -1 <= matrix[i, j] <= 0
+
+    assert matrix[0, db.count - 1] == 0
+
+# Tests whether the distance matrix's scores can be viewed without any copies.
+# @param database The database to test the view with.
+# @since 0.1.1
+def testDistanceMatrixView(database):
+    matrix = pairwise.run(database, algorithm = 'sequential')
+    view = memoryview(matrix)
+
+    assert view.readonly and view.format == 'f'
+    assert len(view) == matrix.count * (matrix.count - 1) // 2
+
+    for i in range(matrix.count):
+        for j in range(i):
+            assert view[i * (i - 1) // 2 + j] == matrix[i, j]
+
+    assertTablesAreEqual(matrix, pairwise.DistanceMatrix(view, matrix.count))
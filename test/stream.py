@@ -0,0 +1,42 @@
+#!/usr/bin/env python
+# Museqa: Multiple Sequence Aligner using hybrid parallel computing.
+# @file Tests for the database stream among the nodes of a single host.
+# @author Rodrigo Siqueira <rodriados@gmail.com>
+# @copyright 2021-present Rodrigo Siqueira
+import subprocess
+import shutil
+import pytest
+import os
+
+# The software's binary and the files in which the sequences to be aligned are.
+# On debug builds, these files are streamed to the nodes in many small chunks.
+# @since 0.1.1
+binary = "../bin/museqa"
+fixtures = ["fixtures/mock1.fasta", "fixtures/mock2.fasta", "fixtures/mock3.fasta"]
+
+# Runs the software on the given number of nodes, all within the current host.
+# @param nodes The number of nodes to run the software with.
+# @param args The command line arguments to run the software with.
+# @return The finished process.
+# @since 0.1.1
+def execute(nodes, *args):
+    command = ["mpirun", "-np", str(nodes), "--oversubscribe", binary, "-r"] + list(args) + fixtures
+    return subprocess.run(command, stdout = subprocess.DEVNULL, stderr = subprocess.PIPE, timeout = 300)
+
+# Tests whether a statically partitioned run finishes, even though the host's first
+# node, which is also the master node, needs none of the sequences and thus reaches
+# the scores gathering while the host's other nodes still wait for later chunks.
+# @param algorithm The pairwise algorithm to run with.
+# @since 0.1.1
+@pytest.mark.skipif(not os.path.exists(binary) or not shutil.which("mpirun"), reason = "the software's binary may not be built")
+@pytest.mark.parametrize('algorithm', ['sequential', 'kmer'])
+def testStaticRunFinishesWhileNodesAwait(algorithm):
+    result = execute(3, "-1", algorithm)
+    assert result.returncode == 0, result.stderr.decode()
+
+# Tests whether a dynamically scheduled run finishes while its chunks are streamed.
+# @since 0.1.1
+@pytest.mark.skipif(not os.path.exists(binary) or not shutil.which("mpirun"), reason = "the software's binary may not be built")
+def testDynamicRunFinishesWhileNodesAwait():
+    result = execute(3, "-1", "dynamic")
+    assert result.returncode == 0, result.stderr.decode()